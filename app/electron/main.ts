@@ -146,6 +146,8 @@ interface ColopressoNativeAddon {
   getVersionInfo(): NativeVersionInfo;
   getThreadInfo(): NativeThreadInfo;
   convert(formatId: string, options: Record<string, unknown>, inputBytes: Uint8Array, threadCount?: number): Promise<NativeConversionResult>;
+  createCancelToken(): unknown;
+  cancel(cancelToken: unknown): void;
 }
 
 interface ResolvedUpdateConfig {
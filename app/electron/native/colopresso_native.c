@@ -22,6 +22,7 @@
 #define COLOPRESSO_NATIVE_ERROR_INVALID_ARGUMENT "invalid_argument"
 #define COLOPRESSO_NATIVE_ERROR_CONVERSION_FAILED "conversion_failed"
 #define COLOPRESSO_NATIVE_ERROR_OUTPUT_NOT_SMALLER "output_larger_than_input"
+#define COLOPRESSO_NATIVE_ERROR_CANCELLED "cancelled"
 
 typedef struct {
   napi_env env;
@@ -34,6 +35,7 @@ typedef struct {
   size_t output_size;
   cpres_config_t config;
   cpres_rgba_color_t *protected_colors;
+  napi_ref cancel_token_ref;
   int requested_threads;
   bool has_requested_threads;
   cpres_error_t error;
@@ -416,6 +418,50 @@ static void apply_pngx_options(napi_env env, napi_value options, cpres_config_t
   apply_int_property(env, options, "pngx_palette256_tune_speed_max", &config->pngx_palette256_tune_speed_max);
   apply_int_property(env, options, "pngx_palette256_tune_quality_min_floor", &config->pngx_palette256_tune_quality_min_floor);
   apply_int_property(env, options, "pngx_palette256_tune_quality_max_target", &config->pngx_palette256_tune_quality_max_target);
+  apply_bool_property(env, options, "pngx_parallel_branches", &config->pngx_parallel_branches);
+  apply_bool_property(env, options, "pngx_search_enable", &config->pngx_search_enable);
+  apply_bool_property(env, options, "pngx_tiled_dither_enable", &config->pngx_tiled_dither_enable);
+  apply_bool_property(env, options, "memory_limited", &config->memory_limited);
+  apply_int_property(env, options, "time_budget_ms", &config->time_budget_ms);
+}
+
+static void finalize_cancel_token(napi_env env, void *data, void *hint) {
+  (void)env;
+  (void)hint;
+
+  cpres_cancel_token_destroy((cpres_cancel_token_t *)data);
+}
+
+static bool get_cancel_token(napi_env env, napi_value value, cpres_cancel_token_t **out_token) {
+  napi_valuetype type;
+  void *data = NULL;
+
+  if (napi_typeof(env, value, &type) != napi_ok || type != napi_external || napi_get_value_external(env, value, &data) != napi_ok || !data) {
+    return false;
+  }
+
+  *out_token = (cpres_cancel_token_t *)data;
+
+  return true;
+}
+
+/* The work holds a reference to the token so an abandoned promise cannot let it be collected while the encoder still polls it. */
+static bool apply_cancel_token(napi_env env, napi_value options, colopresso_convert_work_t *work) {
+  napi_value value;
+  napi_valuetype type;
+  cpres_cancel_token_t *token;
+
+  if (!get_named_property(env, options, "cancelToken", &value) || napi_typeof(env, value, &type) != napi_ok || type == napi_undefined || type == napi_null) {
+    return true;
+  }
+
+  if (!get_cancel_token(env, value, &token) || napi_create_reference(env, value, 1, &work->cancel_token_ref) != napi_ok) {
+    set_work_error(work, COLOPRESSO_NATIVE_ERROR_INVALID_ARGUMENT, "cancelToken must come from createCancelToken()");
+    return false;
+  }
+  work->config.cancel_token = token;
+
+  return true;
 }
 
 static bool resolve_thread_count(napi_env env, napi_value options, colopresso_convert_work_t *work, int argument_threads, bool has_argument_threads) {
@@ -492,7 +538,7 @@ static bool apply_options(napi_env env, napi_value options, colopresso_convert_w
   apply_avif_options(env, options, &work->config);
   apply_pngx_options(env, options, &work->config);
 
-  return apply_protected_colors(env, options, work);
+  return apply_cancel_token(env, options, work) && apply_protected_colors(env, options, work);
 }
 
 static void execute_convert(napi_env env, void *data) {
@@ -517,7 +563,9 @@ static void execute_convert(napi_env env, void *data) {
 
   if (work->error != CPRES_OK) {
     const char *message = cpres_error_string(work->error);
-    const char *code = work->error == CPRES_ERROR_OUTPUT_NOT_SMALLER ? COLOPRESSO_NATIVE_ERROR_OUTPUT_NOT_SMALLER : COLOPRESSO_NATIVE_ERROR_CONVERSION_FAILED;
+    const char *code = work->error == CPRES_ERROR_OUTPUT_NOT_SMALLER ? COLOPRESSO_NATIVE_ERROR_OUTPUT_NOT_SMALLER
+                       : work->error == CPRES_ERROR_CANCELLED      ? COLOPRESSO_NATIVE_ERROR_CANCELLED
+                                                                   : COLOPRESSO_NATIVE_ERROR_CONVERSION_FAILED;
     set_work_error(work, code, message ? message : "conversion failed");
   }
 }
@@ -529,6 +577,9 @@ static void cleanup_convert_work(colopresso_convert_work_t *work) {
   if (work->async_work) {
     napi_delete_async_work(work->env, work->async_work);
   }
+  if (work->cancel_token_ref) {
+    napi_delete_reference(work->env, work->cancel_token_ref);
+  }
   free(work->input_data);
   if (work->output_data) {
     cpres_free(work->output_data);
@@ -633,6 +684,42 @@ static napi_value get_thread_info(napi_env env, napi_callback_info info) {
   return result;
 }
 
+static napi_value create_cancel_token(napi_env env, napi_callback_info info) {
+  cpres_cancel_token_t *token;
+  napi_value result;
+
+  (void)info;
+
+  token = cpres_cancel_token_create();
+  if (!token) {
+    napi_throw_error(env, COLOPRESSO_NATIVE_ERROR_CONVERSION_FAILED, "failed to allocate cancel token");
+    return NULL;
+  }
+
+  if (napi_create_external(env, token, finalize_cancel_token, NULL, &result) != napi_ok) {
+    cpres_cancel_token_destroy(token);
+    napi_throw_error(env, COLOPRESSO_NATIVE_ERROR_CONVERSION_FAILED, "failed to create cancel token");
+    return NULL;
+  }
+
+  return result;
+}
+
+static napi_value cancel(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  size_t argc;
+  cpres_cancel_token_t *token;
+
+  argc = 1;
+  if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 1 || !get_cancel_token(env, args[0], &token)) {
+    return throw_type_error(env, "cancel(cancelToken) requires a token from createCancelToken()");
+  }
+
+  cpres_cancel_token_cancel(token);
+
+  return NULL;
+}
+
 static napi_value convert(napi_env env, napi_callback_info info) {
   napi_value args[4], promise, resource_name;
   size_t argc, format_length;
@@ -724,6 +811,8 @@ static napi_value init_module(napi_env env, napi_value exports) {
       {"getVersionInfo", NULL, get_version_info, NULL, NULL, NULL, napi_default, NULL},
       {"getThreadInfo", NULL, get_thread_info, NULL, NULL, NULL, napi_default, NULL},
       {"convert", NULL, convert, NULL, NULL, NULL, napi_default, NULL},
+      {"createCancelToken", NULL, create_cancel_token, NULL, NULL, NULL, napi_default, NULL},
+      {"cancel", NULL, cancel, NULL, NULL, NULL, napi_default, NULL},
   };
 
   napi_define_properties(env, exports, sizeof(descriptors) / sizeof(descriptors[0]), descriptors);
@@ -343,9 +343,10 @@ export const pngxFormat: FormatDefinition = {
           return losslessResult.length < inputBytes.length ? losslessResult : inputBytes;
         }
 
-        let quantResult = pngxQuantize(prepareResult.rgba, prepareResult.width, prepareResult.height, {
+        // Quantize once without a quality floor; a result below qualityMin is what the old retry produced anyway.
+        const quantResult = pngxQuantize(prepareResult.rgba, prepareResult.width, prepareResult.height, {
           speed: prepareResult.speed,
-          qualityMin: prepareResult.qualityMin,
+          qualityMin: 0,
           qualityMax: prepareResult.qualityMax,
           maxColors: prepareResult.maxColors,
           ditheringLevel: prepareResult.ditherLevel,
@@ -354,19 +355,6 @@ export const pngxFormat: FormatDefinition = {
           fixedColors: prepareResult.fixedColors ?? undefined,
         });
 
-        if (quantResult.status === 1 && prepareResult.qualityMin > 0) {
-          quantResult = pngxQuantize(prepareResult.rgba, prepareResult.width, prepareResult.height, {
-            speed: prepareResult.speed,
-            qualityMin: 0,
-            qualityMax: prepareResult.qualityMax,
-            maxColors: prepareResult.maxColors,
-            ditheringLevel: prepareResult.ditherLevel,
-            remap: true,
-            importanceMap: prepareResult.importanceMap ?? undefined,
-            fixedColors: prepareResult.fixedColors ?? undefined,
-          });
-        }
-
         if (quantResult.status !== 0) {
           pngxPalette256Cleanup(Module);
           const losslessResult = pngxOptimizeLossless(inputBytes, { optimizationLevel, stripSafe, optimizeAlpha });
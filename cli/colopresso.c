@@ -39,6 +39,14 @@ typedef struct {
   char *output_file;
   cpres_rgba_color_t *protected_colors;
   int32_t protected_colors_count;
+  bool batch_mode;
+  uint32_t jobs;
+  const char *manifest_file;
+  const char *input_dir;
+  const char *output_dir;
+  const char *cache_dir;
+  uint64_t cache_max_bytes;
+  cpres_cache_t *cache;
 } cli_context_t;
 
 static struct option kLongOptions[] = {
@@ -51,6 +59,12 @@ static struct option kLongOptions[] = {
     {"lossless", no_argument, 0, 'l'},
     {"method", required_argument, 0, 'm'},
     {"threads", required_argument, 0, 't'},
+    {"jobs", required_argument, 0, 'j'},
+    {"manifest", required_argument, 0, 0},
+    {"cache-dir", required_argument, 0, 0},
+    {"cache-max-size", required_argument, 0, 0},
+    {"memory-limited", no_argument, 0, 0},
+    {"time-budget", required_argument, 0, 0},
     {"size", required_argument, 0, 's'},
     {"psnr", required_argument, 0, 'p'},
     {"sns", required_argument, 0, 0},
@@ -99,6 +113,9 @@ static struct option kLongOptions[] = {
     {"alpha-bleed-max-distance", required_argument, 0, 0},
     {"alpha-bleed-opaque-threshold", required_argument, 0, 0},
     {"alpha-bleed-soft-limit", required_argument, 0, 0},
+    {"parallel-branches", no_argument, 0, 0},
+    {"search", no_argument, 0, 0},
+    {"tiled-dither", no_argument, 0, 0},
     {"protect-color", required_argument, 0, 0},
     {0, 0, 0, 0}};
 
@@ -1198,6 +1215,21 @@ static inline bool handle_long_option(const char *name, const char *optarg, cpre
     return true;
   }
 
+  if (strcmp(name, "parallel-branches") == 0) {
+    config->pngx_parallel_branches = true;
+    return true;
+  }
+
+  if (strcmp(name, "search") == 0) {
+    config->pngx_search_enable = true;
+    return true;
+  }
+
+  if (strcmp(name, "tiled-dither") == 0) {
+    config->pngx_tiled_dither_enable = true;
+    return true;
+  }
+
   if (strcmp(name, "alpha-bleed") == 0) {
     config->pngx_palette256_alpha_bleed_enable = true;
     return true;
@@ -1261,6 +1293,8 @@ static inline bool handle_long_option(const char *name, const char *optarg, cpre
 
 static inline void print_usage(const char *program_name) {
   printf("Usage: %s [--format=<format>] [OPTIONS] <input.png> <output>\n", program_name);
+  printf("       %s --format=<format> --jobs <int> [OPTIONS] <input_dir> <output_dir>\n", program_name);
+  printf("       %s --format=<format> --jobs <int> --manifest <file> [OPTIONS] <output_dir>\n", program_name);
   printf("\nPNG converter and optimizer\n");
   printf("\nNote: The output file extension will be automatically determined from the format.\n");
   printf("\nFormat Selection:\n");
@@ -1272,6 +1306,18 @@ static inline void print_usage(const char *program_name) {
   printf("  -V, --version               Show version information\n");
   printf("  -t, --threads <int>         Number of threads (>=0, default: all cores)\n");
   printf("  -l, --lossless              Use lossless compression\n");
+  printf("      --memory-limited        Decode PNG rows straight into the WebP/AVIF encoder planes, skipping one full RGBA copy (no effect on PNGX)\n");
+  printf("      --time-budget <ms>      Lower encoder effort per image to fit the budget (0: unlimited, default: 0)\n");
+  printf("\nBatch Options:\n");
+  printf("  -j, --jobs <int>            Encode a directory tree or manifest with N parallel jobs (0: all cores)\n");
+  printf("      --manifest <file>       Read inputs from a manifest instead of a directory\n");
+  printf("                              Plain text: one input path per line ('#' starts a comment)\n");
+  printf("                              JSON: [\"a.png\", {\"input\": \"b.png\", \"output\": \"out/b\"}, ...]\n");
+  printf("                              Directory layout is mirrored under <output_dir>\n");
+  printf("\nCache Options:\n");
+  printf("      --cache-dir <dir>       Reuse results for unchanged inputs and settings from <dir>\n");
+  printf("                              Not used with --time-budget: budgeted results depend on timing\n");
+  printf("      --cache-max-size <int>  Cache size limit in MiB (default: 1024); oldest entries are evicted\n");
   printf("\n=== WebP Options (--format=webp) ===\n");
   printf("  -q, --quality <float>       Set quality (0-100, default: 80)\n");
   printf("  -m, --method <int>          Compression method (0-6, default: 6)\n");
@@ -1334,6 +1380,9 @@ static inline void print_usage(const char *program_name) {
   printf("      --alpha-bleed-max-distance <int>     Bleed propagation distance (0-65535, default: 64)\n");
   printf("      --alpha-bleed-opaque-threshold <int> Opaque seed alpha threshold (0-255, default: 248)\n");
   printf("      --alpha-bleed-soft-limit <int>       Apply bleed when alpha <= soft limit (0-255, default: 160)\n");
+  printf("      --parallel-branches                  Run lossy and lossless branches concurrently (splits threads)\n");
+  printf("      --search                             Try every lossy type and smaller palettes, keep the smallest (slower)\n");
+  printf("      --tiled-dither                       Dither limited4444/reduced in parallel row bands (uses threads)\n");
   printf("      --protect-color <list>               Protect colors from quantization\n");
   printf("                                             Format: RRGGBB or RRGGBBAA (hex), comma-separated\n");
   printf("                                             Example: --protect-color=FF0000,00FF00,0000FFFF\n");
@@ -1427,6 +1476,8 @@ static inline void print_version(void) {
   rust_version = cpres_get_rust_version_string();
   printf("  Rust:            %s\n", rust_version ? rust_version : "unknown");
 
+  printf("  SIMD:            %s\n", cpres_simd_level_string(cpres_get_simd_level()));
+
   buildtime = cpres_get_buildtime();
   format_buildtime(buildtime, buildtime_buf, sizeof(buildtime_buf));
   printf("  Build time:      %s\n", buildtime_buf);
@@ -1472,13 +1523,17 @@ static inline void free_cli_context(cli_context_t *ctx) {
 
   ctx->config.pngx_protected_colors = NULL;
   ctx->config.pngx_protected_colors_count = 0;
+
+  cpres_cache_close(ctx->cache);
+  ctx->cache = NULL;
 }
 
 static inline bool parse_arguments(int argc, char *argv[], cli_context_t *ctx, int *exit_code) {
   const char *input_file, *output_base, *output_extension;
   output_format_t format = FORMAT_UNKNOWN, inferred_format;
   int32_t quality_min = 0, quality_max = 0;
-  bool format_specified = false, verbose = false, append_extension, quality_scalar_set = false, quality_range_set = false, pngx_type_specified = false, dither_specified = false;
+  bool format_specified = false, verbose = false, append_extension, quality_scalar_set = false, quality_range_set = false, pngx_type_specified = false, dither_specified = false,
+       batch_mode = false;
   char *output_file;
   int opt, option_index = 0;
   long parsed_long = 0;
@@ -1492,7 +1547,7 @@ static inline bool parse_arguments(int argc, char *argv[], cli_context_t *ctx, i
   }
 
   optind = 1;
-  while ((opt = getopt_long(argc, argv, "q:lm:s:p:t:vhV", kLongOptions, &option_index)) != -1) {
+  while ((opt = getopt_long(argc, argv, "q:lm:s:p:t:j:vhV", kLongOptions, &option_index)) != -1) {
     switch (opt) {
     case 0: {
       const char *name = kLongOptions[option_index].name;
@@ -1505,6 +1560,26 @@ static inline bool parse_arguments(int argc, char *argv[], cli_context_t *ctx, i
           *exit_code = 1;
           return false;
         }
+      } else if (strcmp(name, "manifest") == 0) {
+        ctx->manifest_file = optarg;
+      } else if (strcmp(name, "cache-dir") == 0) {
+        ctx->cache_dir = optarg;
+      } else if (strcmp(name, "memory-limited") == 0) {
+        ctx->config.memory_limited = true;
+      } else if (strcmp(name, "time-budget") == 0) {
+        if (!parse_long_range(optarg, 0, INT_MAX, &parsed_long)) {
+          fprintf(stderr, "Error: Invalid time budget (must be a non-negative number of milliseconds)\n");
+          *exit_code = 1;
+          return false;
+        }
+        ctx->config.time_budget_ms = (int)parsed_long;
+      } else if (strcmp(name, "cache-max-size") == 0) {
+        if (!parse_long_value(optarg, &parsed_long) || parsed_long <= 0) {
+          fprintf(stderr, "Error: Invalid cache size (must be a positive number of MiB)\n");
+          *exit_code = 1;
+          return false;
+        }
+        ctx->cache_max_bytes = (uint64_t)parsed_long * 1024ULL * 1024ULL;
       } else if (strcmp(name, "type") == 0) {
         pngx_type_specified = true;
         if (!parse_pngx_type_option(optarg, &ctx->config.pngx_lossy_type)) {
@@ -1580,6 +1655,15 @@ static inline bool parse_arguments(int argc, char *argv[], cli_context_t *ctx, i
       ctx->config.avif_threads = (int)parsed_long;
       ctx->config.pngx_threads = (int)parsed_long;
       break;
+    case 'j':
+      if (!parse_long_value(optarg, &parsed_long) || parsed_long < 0 || parsed_long > INT_MAX) {
+        fprintf(stderr, "Error: Invalid job count\n");
+        *exit_code = 1;
+        return false;
+      }
+      batch_mode = true;
+      ctx->jobs = (uint32_t)parsed_long;
+      break;
     case 'v':
       verbose = true;
       break;
@@ -1598,18 +1682,57 @@ static inline bool parse_arguments(int argc, char *argv[], cli_context_t *ctx, i
     }
   }
 
-  if (optind + 2 > argc) {
-    fprintf(stderr, "Error: Missing input or output file\n");
-    print_usage(argv[0]);
+  if (ctx->cache_max_bytes > 0 && !ctx->cache_dir) {
+    fprintf(stderr, "Error: --cache-max-size requires --cache-dir\n");
     *exit_code = 1;
     return false;
   }
 
-  input_file = argv[optind];
-  output_base = argv[optind + 1];
+  if (ctx->manifest_file && !batch_mode) {
+    fprintf(stderr, "Error: --manifest requires --jobs\n");
+    *exit_code = 1;
+    return false;
+  }
 
-  output_extension = colopresso_extract_extension(output_base);
-  inferred_format = infer_format_from_extension(output_base);
+  if (batch_mode) {
+    if (optind + (ctx->manifest_file ? 1 : 2) != argc) {
+      fprintf(stderr, ctx->manifest_file ? "Error: Batch mode with --manifest expects exactly one output directory\n" : "Error: Batch mode expects an input directory and an output directory\n");
+      print_usage(argv[0]);
+      *exit_code = 1;
+      return false;
+    }
+    if (!format_specified) {
+      fprintf(stderr, "Error: Batch mode requires --format\n");
+      *exit_code = 1;
+      return false;
+    }
+    if (!ctx->manifest_file) {
+      ctx->input_dir = argv[optind];
+      if (!colopresso_is_directory(ctx->input_dir)) {
+        fprintf(stderr, "Error: Input '%s' is not a directory\n", ctx->input_dir);
+        *exit_code = 1;
+        return false;
+      }
+    }
+    ctx->output_dir = argv[argc - 1];
+    input_file = NULL;
+    output_base = NULL;
+    output_extension = NULL;
+    inferred_format = FORMAT_UNKNOWN;
+  } else {
+    if (optind + 2 > argc) {
+      fprintf(stderr, "Error: Missing input or output file\n");
+      print_usage(argv[0]);
+      *exit_code = 1;
+      return false;
+    }
+
+    input_file = argv[optind];
+    output_base = argv[optind + 1];
+
+    output_extension = colopresso_extract_extension(output_base);
+    inferred_format = infer_format_from_extension(output_base);
+  }
 
   if (!format_specified && format == FORMAT_UNKNOWN && inferred_format != FORMAT_UNKNOWN) {
     format = inferred_format;
@@ -1656,6 +1779,13 @@ static inline bool parse_arguments(int argc, char *argv[], cli_context_t *ctx, i
     }
   }
 
+  if (batch_mode) {
+    ctx->batch_mode = true;
+    ctx->format = format;
+    ctx->verbose = verbose;
+    return true;
+  }
+
   if (format_specified && inferred_format != FORMAT_UNKNOWN && inferred_format != format) {
     fprintf(stderr,
             "Warning: Output file extension '%s' does not match --format=%s; encoding as %s\n",
@@ -1683,6 +1813,33 @@ static inline bool parse_arguments(int argc, char *argv[], cli_context_t *ctx, i
   return true;
 }
 
+static inline cpres_format_t to_cpres_format(output_format_t format) {
+  switch (format) {
+  case FORMAT_WEBP:
+    return CPRES_FORMAT_WEBP;
+  case FORMAT_AVIF:
+    return CPRES_FORMAT_AVIF;
+  default:
+    return CPRES_FORMAT_PNGX;
+  }
+}
+
+static inline bool open_cache(cli_context_t *ctx) {
+  cpres_error_t error;
+
+  if (!ctx->cache_dir) {
+    return true;
+  }
+
+  error = cpres_cache_open(ctx->cache_dir, ctx->cache_max_bytes, &ctx->cache);
+  if (error != CPRES_OK) {
+    fprintf(stderr, "Error: Failed to open cache directory '%s': %s\n", ctx->cache_dir, cpres_error_string(error));
+    return false;
+  }
+
+  return true;
+}
+
 static inline int run_conversion(cli_context_t *ctx) {
   int64_t input_size, output_size, ref_input_size;
   int32_t size_check;
@@ -1692,6 +1849,7 @@ static inline int run_conversion(cli_context_t *ctx) {
   int ret = 1;
   bool force_rgba_output = false;
   cpres_error_t result = CPRES_ERROR_INVALID_FORMAT, read_error = CPRES_OK;
+  cpres_cache_stats_t cache_stats;
 
   input_size = get_file_size(ctx->input_file);
   force_rgba_output = (ctx->format == FORMAT_PNGX && ctx->config.pngx_lossy_enable &&
@@ -1708,28 +1866,24 @@ static inline int run_conversion(cli_context_t *ctx) {
     ctx->config.pngx_protected_colors_count = (int)ctx->protected_colors_count;
   }
 
+  if (!open_cache(ctx)) {
+    goto bailout;
+  }
+
   read_error = cpres_read_file_to_memory(ctx->input_file, &png_data, &png_size);
   if (read_error != CPRES_OK) {
     fprintf(stderr, "Error: Failed to read input file '%s': %s\n", ctx->input_file, cpres_error_string(read_error));
     goto bailout;
   }
 
-  switch (ctx->format) {
-  case FORMAT_WEBP:
+  if (ctx->format != FORMAT_UNKNOWN) {
     encoded_deallocator = cpres_free;
-    result = cpres_encode_webp_memory(png_data, png_size, &encoded_data, &encoded_size, &ctx->config);
-    break;
-  case FORMAT_AVIF:
-    encoded_deallocator = cpres_free;
-    result = cpres_encode_avif_memory(png_data, png_size, &encoded_data, &encoded_size, &ctx->config);
-    break;
-  case FORMAT_PNGX:
-    encoded_deallocator = cpres_free;
-    result = cpres_encode_pngx_memory(png_data, png_size, &encoded_data, &encoded_size, &ctx->config);
-    break;
-  default:
-    result = CPRES_ERROR_INVALID_FORMAT;
-    break;
+    result = cpres_cache_encode_memory(ctx->cache, to_cpres_format(ctx->format), png_data, png_size, &encoded_data, &encoded_size, &ctx->config);
+  }
+
+  if (ctx->cache && ctx->verbose) {
+    cpres_cache_get_stats(ctx->cache, &cache_stats);
+    printf("Cache: %s\n", ctx->config.time_budget_ms > 0 ? "bypassed (time budget)" : (cache_stats.hits > 0 ? "hit" : "miss"));
   }
 
   free(png_data);
@@ -1793,6 +1947,737 @@ bailout:
   return ret;
 }
 
+#define CLI_BATCH_WINDOW_PER_JOB 16
+
+typedef struct {
+  char *input_path;
+  char *output_path;
+} cli_batch_entry_t;
+
+typedef struct {
+  cli_batch_entry_t *entries;
+  size_t count;
+  size_t capacity;
+} cli_batch_plan_t;
+
+typedef struct {
+  cli_batch_plan_t *plan;
+  output_format_t format;
+  const char *input_root;
+  const char *output_root;
+  const char *relative;
+  bool failed;
+} cli_batch_walk_t;
+
+typedef struct {
+  const cli_context_t *ctx;
+  cpres_cache_t *cache;
+  size_t succeeded;
+  size_t skipped;
+  size_t failed;
+  uint64_t input_bytes;
+  uint64_t output_bytes;
+} cli_batch_state_t;
+
+typedef struct {
+  const char *cur;
+  const char *end;
+} cli_json_reader_t;
+
+static inline bool is_path_separator(char c) { return c == '/' || c == '\\'; }
+
+static inline char *join_path(const char *base, const char *name) {
+  size_t base_len = strlen(base), len;
+  char *joined;
+  bool needs_separator = base_len > 0 && !is_path_separator(base[base_len - 1]);
+
+  len = base_len + (needs_separator ? 1 : 0) + strlen(name) + 1;
+  joined = (char *)malloc(len);
+  if (!joined) {
+    return NULL;
+  }
+
+  snprintf(joined, len, "%s%s%s", base, needs_separator ? "/" : "", name);
+
+  return joined;
+}
+
+static inline bool is_absolute_path(const char *path) {
+  if (is_path_separator(path[0])) {
+    return true;
+  }
+
+  return isalpha((unsigned char)path[0]) && path[1] == ':';
+}
+
+static inline const char *mirror_relative_path(const char *path) {
+  const char *p, *base;
+
+  /* Paths that would escape <output_dir> are flattened to their basename. */
+  for (p = path; *p; ++p) {
+    if (p[0] == '.' && p[1] == '.' && (p == path || is_path_separator(p[-1])) && (p[2] == '\0' || is_path_separator(p[2]))) {
+      break;
+    }
+  }
+  if (*p || is_absolute_path(path)) {
+    base = path;
+    for (p = path; *p; ++p) {
+      if (is_path_separator(*p) || *p == ':') {
+        base = p + 1;
+      }
+    }
+    return base;
+  }
+
+  while (path[0] == '.' && is_path_separator(path[1])) {
+    path += 2;
+    while (is_path_separator(path[0])) {
+      ++path;
+    }
+  }
+
+  return path;
+}
+
+static inline char *build_batch_output_path(const char *output_root, const char *relative, output_format_t format) {
+  size_t len = strlen(relative), stem_len;
+  char *stem, *output_path;
+
+  stem_len = path_has_extension_ci(relative, ".png") ? len - 4 : len;
+  stem = (char *)malloc(stem_len + 1);
+  if (!stem) {
+    return NULL;
+  }
+  memcpy(stem, relative, stem_len);
+  stem[stem_len] = '\0';
+
+  output_path = join_path(output_root, stem);
+  free(stem);
+  if (!output_path) {
+    return NULL;
+  }
+
+  stem = output_path;
+  output_path = build_output_path(stem, format);
+  free(stem);
+
+  return output_path;
+}
+
+static inline bool batch_plan_add(cli_batch_plan_t *plan, char *input_path, char *output_path) {
+  cli_batch_entry_t *grown;
+  size_t capacity;
+
+  if (!input_path || !output_path) {
+    free(input_path);
+    free(output_path);
+    return false;
+  }
+
+  if (plan->count == plan->capacity) {
+    capacity = plan->capacity > 0 ? plan->capacity * 2 : 64;
+    grown = (cli_batch_entry_t *)realloc(plan->entries, sizeof(cli_batch_entry_t) * capacity);
+    if (!grown) {
+      free(input_path);
+      free(output_path);
+      return false;
+    }
+    plan->entries = grown;
+    plan->capacity = capacity;
+  }
+
+  plan->entries[plan->count].input_path = input_path;
+  plan->entries[plan->count].output_path = output_path;
+  ++plan->count;
+
+  return true;
+}
+
+static inline void batch_plan_free(cli_batch_plan_t *plan) {
+  size_t i;
+
+  for (i = 0; i < plan->count; ++i) {
+    free(plan->entries[i].input_path);
+    free(plan->entries[i].output_path);
+  }
+  free(plan->entries);
+  memset(plan, 0, sizeof(*plan));
+}
+
+static int batch_entry_compare(const void *lhs, const void *rhs) {
+  const cli_batch_entry_t *a = (const cli_batch_entry_t *)lhs, *b = (const cli_batch_entry_t *)rhs;
+
+  return strcmp(a->input_path, b->input_path);
+}
+
+static bool collect_directory_entry(const char *name, bool is_directory, void *user_data) {
+  cli_batch_walk_t *walk = (cli_batch_walk_t *)user_data, child;
+  char *relative, *directory;
+  bool success;
+
+  relative = walk->relative ? join_path(walk->relative, name) : strdup(name);
+  if (!relative) {
+    walk->failed = true;
+    return false;
+  }
+
+  if (is_directory) {
+    directory = join_path(walk->input_root, relative);
+    if (!directory) {
+      free(relative);
+      walk->failed = true;
+      return false;
+    }
+    child = *walk;
+    child.relative = relative;
+    success = colopresso_read_directory(directory, collect_directory_entry, &child);
+    if (!success || child.failed) {
+      fprintf(stderr, "Error: Failed to read directory '%s'\n", directory);
+      walk->failed = true;
+    }
+    free(directory);
+    free(relative);
+    return !walk->failed;
+  }
+
+  if (path_has_extension_ci(name, ".png")) {
+    if (!batch_plan_add(walk->plan, join_path(walk->input_root, relative), build_batch_output_path(walk->output_root, relative, walk->format))) {
+      free(relative);
+      walk->failed = true;
+      return false;
+    }
+  }
+  free(relative);
+
+  return true;
+}
+
+static inline bool collect_directory(const cli_context_t *ctx, cli_batch_plan_t *plan) {
+  cli_batch_walk_t walk;
+
+  memset(&walk, 0, sizeof(walk));
+  walk.plan = plan;
+  walk.format = ctx->format;
+  walk.input_root = ctx->input_dir;
+  walk.output_root = ctx->output_dir;
+  walk.relative = NULL;
+
+  if (!colopresso_read_directory(ctx->input_dir, collect_directory_entry, &walk) || walk.failed) {
+    if (!walk.failed) {
+      fprintf(stderr, "Error: Failed to read directory '%s'\n", ctx->input_dir);
+    }
+    return false;
+  }
+
+  if (plan->count > 1) {
+    qsort(plan->entries, plan->count, sizeof(cli_batch_entry_t), batch_entry_compare);
+  }
+
+  return true;
+}
+
+static inline void json_skip_whitespace(cli_json_reader_t *reader) {
+  while (reader->cur < reader->end && isspace((unsigned char)*reader->cur)) {
+    ++reader->cur;
+  }
+}
+
+static inline bool json_append_utf8(char *out, size_t *len, uint32_t codepoint) {
+  if (codepoint < 0x80) {
+    out[(*len)++] = (char)codepoint;
+  } else if (codepoint < 0x800) {
+    out[(*len)++] = (char)(0xC0 | (codepoint >> 6));
+    out[(*len)++] = (char)(0x80 | (codepoint & 0x3F));
+  } else if (codepoint >= 0xD800 && codepoint <= 0xDFFF) {
+    return false;
+  } else {
+    out[(*len)++] = (char)(0xE0 | (codepoint >> 12));
+    out[(*len)++] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[(*len)++] = (char)(0x80 | (codepoint & 0x3F));
+  }
+
+  return true;
+}
+
+static inline char *json_parse_string(cli_json_reader_t *reader) {
+  const char *start;
+  char *out, hex[5];
+  size_t len = 0;
+  uint32_t codepoint;
+
+  if (reader->cur >= reader->end || *reader->cur != '"') {
+    return NULL;
+  }
+  start = ++reader->cur;
+
+  /* Escapes never expand, so the raw span bounds the decoded length. */
+  while (reader->cur < reader->end && *reader->cur != '"') {
+    reader->cur += (*reader->cur == '\\' && reader->cur + 1 < reader->end) ? 2 : 1;
+  }
+  if (reader->cur >= reader->end) {
+    return NULL;
+  }
+
+  out = (char *)malloc((size_t)(reader->cur - start) + 1);
+  if (!out) {
+    return NULL;
+  }
+
+  reader->cur = start;
+  while (*reader->cur != '"') {
+    if (*reader->cur != '\\') {
+      out[len++] = *reader->cur++;
+      continue;
+    }
+
+    ++reader->cur;
+    switch (*reader->cur) {
+    case '"':
+    case '\\':
+    case '/':
+      out[len++] = *reader->cur;
+      break;
+    case 'b':
+      out[len++] = '\b';
+      break;
+    case 'f':
+      out[len++] = '\f';
+      break;
+    case 'n':
+      out[len++] = '\n';
+      break;
+    case 'r':
+      out[len++] = '\r';
+      break;
+    case 't':
+      out[len++] = '\t';
+      break;
+    case 'u':
+      if (reader->end - reader->cur < 5) {
+        free(out);
+        return NULL;
+      }
+      memcpy(hex, reader->cur + 1, 4);
+      hex[4] = '\0';
+      codepoint = (uint32_t)strtoul(hex, NULL, 16);
+      /* A decoded NUL would silently cut the path short, so it is a malformed manifest. */
+      if (codepoint == 0 || !isxdigit((unsigned char)hex[0]) || !isxdigit((unsigned char)hex[1]) || !isxdigit((unsigned char)hex[2]) || !isxdigit((unsigned char)hex[3]) ||
+          !json_append_utf8(out, &len, codepoint)) {
+        free(out);
+        return NULL;
+      }
+      reader->cur += 4;
+      break;
+    default:
+      free(out);
+      return NULL;
+    }
+    ++reader->cur;
+  }
+  ++reader->cur;
+  out[len] = '\0';
+
+  return out;
+}
+
+static inline bool add_manifest_entry(const cli_context_t *ctx, cli_batch_plan_t *plan, char *input_path, char *output_base) {
+  char *output_path = NULL, *joined;
+
+  if (!input_path || input_path[0] == '\0') {
+    free(input_path);
+    free(output_base);
+    return false;
+  }
+
+  if (output_base && output_base[0] != '\0') {
+    if (is_absolute_path(output_base)) {
+      joined = output_base;
+      output_base = NULL;
+    } else {
+      joined = join_path(ctx->output_dir, output_base);
+    }
+    if (joined && should_append_extension(joined, ctx->format, true)) {
+      output_path = build_output_path(joined, ctx->format);
+      free(joined);
+    } else {
+      output_path = joined;
+    }
+  } else {
+    output_path = build_batch_output_path(ctx->output_dir, mirror_relative_path(input_path), ctx->format);
+  }
+  free(output_base);
+
+  return batch_plan_add(plan, input_path, output_path);
+}
+
+static inline bool parse_json_manifest(const cli_context_t *ctx, cli_batch_plan_t *plan, cli_json_reader_t *reader) {
+  char *key, *value, *input_path, *output_base;
+
+  ++reader->cur;
+  json_skip_whitespace(reader);
+  if (reader->cur < reader->end && *reader->cur == ']') {
+    return true;
+  }
+
+  while (reader->cur < reader->end) {
+    if (*reader->cur == '"') {
+      if (!add_manifest_entry(ctx, plan, json_parse_string(reader), NULL)) {
+        return false;
+      }
+    } else if (*reader->cur == '{') {
+      ++reader->cur;
+      input_path = NULL;
+      output_base = NULL;
+      for (;;) {
+        json_skip_whitespace(reader);
+        key = json_parse_string(reader);
+        json_skip_whitespace(reader);
+        if (!key || reader->cur >= reader->end || *reader->cur != ':') {
+          free(key);
+          free(input_path);
+          free(output_base);
+          return false;
+        }
+        ++reader->cur;
+        json_skip_whitespace(reader);
+        value = json_parse_string(reader);
+        if (!value) {
+          free(key);
+          free(input_path);
+          free(output_base);
+          return false;
+        }
+        if (strcmp(key, "input") == 0) {
+          free(input_path);
+          input_path = value;
+        } else if (strcmp(key, "output") == 0) {
+          free(output_base);
+          output_base = value;
+        } else {
+          free(value);
+        }
+        free(key);
+
+        json_skip_whitespace(reader);
+        if (reader->cur < reader->end && *reader->cur == ',') {
+          ++reader->cur;
+          continue;
+        }
+        if (reader->cur < reader->end && *reader->cur == '}') {
+          ++reader->cur;
+          break;
+        }
+        free(input_path);
+        free(output_base);
+        return false;
+      }
+      if (!add_manifest_entry(ctx, plan, input_path, output_base)) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+
+    json_skip_whitespace(reader);
+    if (reader->cur < reader->end && *reader->cur == ',') {
+      ++reader->cur;
+      json_skip_whitespace(reader);
+      continue;
+    }
+    if (reader->cur < reader->end && *reader->cur == ']') {
+      ++reader->cur;
+      json_skip_whitespace(reader);
+      return reader->cur == reader->end;
+    }
+    return false;
+  }
+
+  return false;
+}
+
+static inline bool parse_text_manifest(const cli_context_t *ctx, cli_batch_plan_t *plan, const char *text, size_t length) {
+  const char *line = text, *end = text + length, *line_end, *trim_end;
+  char *input_path;
+  size_t line_len;
+
+  while (line < end) {
+    line_end = memchr(line, '\n', (size_t)(end - line));
+    if (!line_end) {
+      line_end = end;
+    }
+
+    while (line < line_end && isspace((unsigned char)*line)) {
+      ++line;
+    }
+    trim_end = line_end;
+    while (trim_end > line && isspace((unsigned char)trim_end[-1])) {
+      --trim_end;
+    }
+
+    line_len = (size_t)(trim_end - line);
+    if (line_len > 0 && line[0] != '#') {
+      input_path = (char *)malloc(line_len + 1);
+      if (!input_path) {
+        return false;
+      }
+      memcpy(input_path, line, line_len);
+      input_path[line_len] = '\0';
+      if (!add_manifest_entry(ctx, plan, input_path, NULL)) {
+        return false;
+      }
+    }
+
+    line = line_end + 1;
+  }
+
+  return true;
+}
+
+static inline bool collect_manifest(const cli_context_t *ctx, cli_batch_plan_t *plan) {
+  cli_json_reader_t reader;
+  uint8_t *data = NULL;
+  size_t size = 0;
+  cpres_error_t error;
+  bool success;
+
+  error = cpres_read_file_to_memory(ctx->manifest_file, &data, &size);
+  if (error != CPRES_OK) {
+    fprintf(stderr, "Error: Failed to read manifest '%s': %s\n", ctx->manifest_file, cpres_error_string(error));
+    return false;
+  }
+
+  reader.cur = (const char *)data;
+  reader.end = (const char *)data + size;
+  json_skip_whitespace(&reader);
+
+  if (reader.cur < reader.end && *reader.cur == '[') {
+    success = parse_json_manifest(ctx, plan, &reader);
+  } else {
+    success = parse_text_manifest(ctx, plan, (const char *)data, size);
+  }
+  free(data);
+
+  if (!success) {
+    fprintf(stderr, "Error: Invalid manifest '%s'\n", ctx->manifest_file);
+  }
+
+  return success;
+}
+
+static inline bool ensure_parent_directories(const char *path) {
+  char *copy;
+  size_t i, len;
+  bool success = true;
+
+  copy = strdup(path);
+  if (!copy) {
+    return false;
+  }
+
+  len = strlen(copy);
+  for (i = 1; i < len && success; ++i) {
+    if (!is_path_separator(copy[i]) || is_path_separator(copy[i - 1]) || copy[i - 1] == ':') {
+      continue;
+    }
+    copy[i] = '\0';
+    if (!colopresso_is_directory(copy)) {
+      success = colopresso_make_directory(copy);
+    }
+    copy[i] = '/';
+  }
+  free(copy);
+
+  return success;
+}
+
+static inline void batch_record_result(cli_batch_state_t *state, const cli_batch_entry_t *entry, size_t png_size, cpres_error_t error, const uint8_t *data, size_t size) {
+  state->input_bytes += png_size;
+
+  if (error == CPRES_OK) {
+    if (!ensure_parent_directories(entry->output_path) || !write_file_from_memory(entry->output_path, data, size)) {
+      fprintf(stderr, "Error: Failed to write output file '%s'\n", entry->output_path);
+      ++state->failed;
+    } else {
+      ++state->succeeded;
+      state->output_bytes += size;
+      if (state->ctx->verbose) {
+        printf("%s -> %s (%zu -> %zu bytes)\n", entry->input_path, entry->output_path, png_size, size);
+      }
+    }
+  } else if (error == CPRES_ERROR_OUTPUT_NOT_SMALLER) {
+    ++state->skipped;
+    fprintf(stderr, "Warning: %s: %s output would not be smaller; skipped\n", entry->input_path, get_format_name(state->ctx->format));
+  } else {
+    ++state->failed;
+    fprintf(stderr, "Error: %s: %s\n", entry->input_path, cpres_error_string(error));
+  }
+}
+
+static void batch_result_callback(size_t index, const cpres_batch_item_t *item, const cpres_batch_result_t *result, void *callback_data) {
+  cli_batch_state_t *state = (cli_batch_state_t *)callback_data;
+
+  (void)index;
+
+  batch_record_result(state, (const cli_batch_entry_t *)item->user_data, item->png_size, result->error, result->data, result->size);
+  if (state->cache) {
+    cpres_cache_store(state->cache, item->format, item->png_data, item->png_size, item->config, result->error, result->data, result->size);
+  }
+
+  cpres_free(result->data);
+}
+
+static inline void print_batch_summary(const cli_batch_state_t *state, size_t total, uint32_t jobs, double elapsed) {
+  char input_buf[32], output_buf[32];
+  cpres_cache_stats_t cache_stats;
+  double ratio;
+
+  format_bytes((int64_t)state->input_bytes, input_buf, sizeof(input_buf));
+  format_bytes((int64_t)state->output_bytes, output_buf, sizeof(output_buf));
+
+  printf("\nBatch summary:\n");
+  printf("  Files:      %zu (%zu converted, %zu skipped, %zu failed)\n", total, state->succeeded, state->skipped, state->failed);
+  printf("  Jobs:       %u\n", jobs);
+  printf("  Input:      %s\n", input_buf);
+  if (state->input_bytes > 0) {
+    ratio = ((double)state->output_bytes / (double)state->input_bytes) * 100.0;
+    printf("  Output:     %s (%.1f%% of input)\n", output_buf, ratio);
+  } else {
+    printf("  Output:     %s\n", output_buf);
+  }
+  if (state->cache) {
+    cpres_cache_get_stats(state->cache, &cache_stats);
+    printf("  Cache:      %llu hits, %llu misses, %llu evictions\n", (unsigned long long)cache_stats.hits, (unsigned long long)cache_stats.misses, (unsigned long long)cache_stats.evictions);
+  }
+  printf("  Elapsed:    %.2f s\n", elapsed);
+  if (elapsed > 0.0) {
+    printf("  Throughput: %.1f files/s, %.2f MiB/s\n", (double)total / elapsed, ((double)state->input_bytes / (1024.0 * 1024.0)) / elapsed);
+  }
+}
+
+static inline int run_batch(cli_context_t *ctx) {
+  cli_batch_plan_t plan;
+  cli_batch_state_t state;
+  cpres_batch_item_t *items = NULL, *item;
+  uint8_t **inputs = NULL, *cached_data;
+  size_t window, start, end, i, item_count, png_size, cached_size;
+  uint32_t jobs;
+  double started;
+  cpres_error_t error, cached_error;
+  int ret = 1;
+
+  memset(&plan, 0, sizeof(plan));
+  memset(&state, 0, sizeof(state));
+  state.ctx = ctx;
+
+  if (ctx->format == FORMAT_PNGX && ctx->protected_colors_count > 0) {
+    ctx->config.pngx_protected_colors = ctx->protected_colors;
+    ctx->config.pngx_protected_colors_count = (int)ctx->protected_colors_count;
+  }
+
+  if (!open_cache(ctx)) {
+    return 1;
+  }
+  state.cache = ctx->cache;
+
+  if (!(ctx->manifest_file ? collect_manifest(ctx, &plan) : collect_directory(ctx, &plan))) {
+    batch_plan_free(&plan);
+    return 1;
+  }
+
+  if (plan.count == 0) {
+    fprintf(stderr, "Warning: No PNG inputs found\n");
+    batch_plan_free(&plan);
+    return 0;
+  }
+
+  if (!colopresso_is_directory(ctx->output_dir) && !colopresso_make_directory(ctx->output_dir)) {
+    fprintf(stderr, "Error: Failed to create output directory '%s'\n", ctx->output_dir);
+    batch_plan_free(&plan);
+    return 1;
+  }
+
+  jobs = ctx->jobs > 0 ? ctx->jobs : cpres_get_max_thread_count();
+  if (jobs > cpres_get_max_thread_count()) {
+    jobs = cpres_get_max_thread_count();
+  }
+  if (jobs == 0) {
+    jobs = 1;
+  }
+
+  /* Inputs are loaded one window at a time to bound memory on large trees. */
+  window = (size_t)jobs * CLI_BATCH_WINDOW_PER_JOB;
+  if (window > plan.count) {
+    window = plan.count;
+  }
+
+  items = (cpres_batch_item_t *)calloc(window, sizeof(cpres_batch_item_t));
+  inputs = (uint8_t **)calloc(window, sizeof(uint8_t *));
+  if (!items || !inputs) {
+    fprintf(stderr, "Error: Failed to allocate batch buffers\n");
+    goto bailout;
+  }
+
+  if (ctx->verbose) {
+    printf("Batch: %zu inputs, format %s, %u jobs\n", plan.count, get_format_name(ctx->format), jobs);
+  }
+
+  started = colopresso_get_monotonic_seconds();
+  for (start = 0; start < plan.count; start = end) {
+    end = start + window < plan.count ? start + window : plan.count;
+    item_count = 0;
+
+    for (i = start; i < end; ++i) {
+      item = &items[item_count];
+      png_size = 0;
+      error = cpres_read_file_to_memory(plan.entries[i].input_path, &inputs[item_count], &png_size);
+      if (error != CPRES_OK) {
+        fprintf(stderr, "Error: Failed to read input file '%s': %s\n", plan.entries[i].input_path, cpres_error_string(error));
+        ++state.failed;
+        continue;
+      }
+
+      if (ctx->cache && cpres_cache_lookup(ctx->cache, to_cpres_format(ctx->format), inputs[item_count], png_size, &ctx->config, &cached_error, &cached_data, &cached_size)) {
+        batch_record_result(&state, &plan.entries[i], png_size, cached_error, cached_data, cached_size);
+        cpres_free(cached_data);
+        free(inputs[item_count]);
+        inputs[item_count] = NULL;
+        continue;
+      }
+
+      item->png_data = inputs[item_count];
+      item->png_size = png_size;
+      item->format = to_cpres_format(ctx->format);
+      item->config = &ctx->config;
+      item->user_data = &plan.entries[i];
+      ++item_count;
+    }
+
+    if (item_count > 0) {
+      error = cpres_encode_batch(items, item_count, jobs, batch_result_callback, &state);
+      if (error != CPRES_OK) {
+        fprintf(stderr, "Error: %s\n", cpres_error_string(error));
+        state.failed += item_count;
+      }
+    }
+
+    for (i = 0; i < item_count; ++i) {
+      free(inputs[i]);
+      inputs[i] = NULL;
+    }
+  }
+
+  print_batch_summary(&state, plan.count, jobs, colopresso_get_monotonic_seconds() - started);
+
+  ret = state.failed > 0 ? 1 : (state.skipped > 0 ? 2 : 0);
+
+bailout:
+  free(inputs);
+  free(items);
+  batch_plan_free(&plan);
+
+  return ret;
+}
+
 int main(int argc, char *argv[]) {
   cli_context_t ctx;
   int exit_code = 0;
@@ -1804,7 +2689,7 @@ int main(int argc, char *argv[]) {
     return exit_code;
   }
 
-  exit_code = run_conversion(&ctx);
+  exit_code = ctx.batch_mode ? run_batch(&ctx) : run_conversion(&ctx);
   free_cli_context(&ctx);
 
   return exit_code;
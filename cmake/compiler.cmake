@@ -21,7 +21,9 @@ function(colopresso_configure_simd)
     if(CMAKE_SYSTEM_PROCESSOR MATCHES "ARM64|aarch64")
       set(COLOPRESSO_HAS_NEON ON PARENT_SCOPE)
       set(COLOPRESSO_SIMD_TYPE "NEON" PARENT_SCOPE)
-    elseif(CMAKE_SYSTEM_PROCESSOR MATCHES "AMD64|x86_64|x86")
+    elseif(CMAKE_SYSTEM_PROCESSOR MATCHES "AMD64|x86_64")
+      set(COLOPRESSO_SIMD_TYPE "SSE2/SSE4.1/AVX2 (runtime dispatch)" PARENT_SCOPE)
+    elseif(CMAKE_SYSTEM_PROCESSOR MATCHES "x86")
       set(COLOPRESSO_SIMD_TYPE "SSE4.1" PARENT_SCOPE)
     endif()
   else()
@@ -35,6 +37,9 @@ function(colopresso_configure_simd)
       set(COLOPRESSO_HAS_NEON ON PARENT_SCOPE)
       set(COLOPRESSO_SIMD_FLAGS "-mfpu=neon" PARENT_SCOPE)
       set(COLOPRESSO_SIMD_TYPE "NEON" PARENT_SCOPE)
+    elseif(CMAKE_SYSTEM_PROCESSOR MATCHES "AMD64|amd64|x86_64")
+      # No -m flag on purpose: the wider kernels carry their own target attributes and simd.c picks one from CPUID at run time.
+      set(COLOPRESSO_SIMD_TYPE "SSE2/SSE4.1/AVX2 (runtime dispatch)" PARENT_SCOPE)
     else()
       check_c_compiler_flag("-msse4.1" _has_sse41)
       if(_has_sse41)
@@ -334,6 +334,11 @@ set(WASM_EXPORTED_FUNCTIONS
   _emscripten_config_pngx_postprocess_smooth_importance_cutoff
   _emscripten_config_pngx_protected_colors
   _emscripten_config_pngx_threads
+  _emscripten_config_pngx_parallel_branches
+  _emscripten_config_pngx_search_enable
+  _emscripten_config_pngx_tiled_dither_enable
+  _emscripten_config_memory_limited
+  _emscripten_config_time_budget_ms
   _emscripten_is_threads_enabled
   _emscripten_get_version
   _emscripten_get_libwebp_version
@@ -89,3 +89,13 @@ file(GLOB TEST_SOURCES "library/tests/test_*.c")
 foreach(TEST_SOURCE ${TEST_SOURCES})
   colopresso_register_test(${TEST_SOURCE})
 endforeach()
+
+if(TARGET colopresso_cli)
+  set(_cli_manifest_nul "${CMAKE_BINARY_DIR}/tests/manifest_nul_escape.json")
+  file(WRITE ${_cli_manifest_nul} "[{\"input\": \"missing.png\", \"output\": \"out\\u0000/escaped\"}]\n")
+  add_test(
+    NAME cli_manifest_rejects_nul_escape
+    COMMAND colopresso_cli --format=pngx --jobs 1 --manifest ${_cli_manifest_nul} ${CMAKE_BINARY_DIR}/tests/cli_manifest_out
+  )
+  set_tests_properties(cli_manifest_rejects_nul_escape PROPERTIES PASS_REGULAR_EXPRESSION "Invalid manifest")
+endif()
@@ -84,6 +84,11 @@
 #define COLOPRESSO_PNGX_DEFAULT_PALETTE256_TUNE_QUALITY_MIN_FLOOR 90
 #define COLOPRESSO_PNGX_DEFAULT_PALETTE256_TUNE_QUALITY_MAX_TARGET 100
 #define COLOPRESSO_PNGX_DEFAULT_THREADS 1
+#define COLOPRESSO_PNGX_DEFAULT_PARALLEL_BRANCHES false
+#define COLOPRESSO_PNGX_DEFAULT_SEARCH_ENABLE false
+#define COLOPRESSO_PNGX_DEFAULT_TILED_DITHER_ENABLE false
+#define COLOPRESSO_DEFAULT_MEMORY_LIMITED false
+#define COLOPRESSO_DEFAULT_TIME_BUDGET_MS 0
 #define COLOPRESSO_PNGX_LOSSY_TYPE_PALETTE256 0
 #define COLOPRESSO_PNGX_LOSSY_TYPE_LIMITED_RGBA4444 1
 #define COLOPRESSO_PNGX_LOSSY_TYPE_REDUCED_RGBA32 2
@@ -113,6 +118,25 @@ typedef enum {
   CPRES_PNGX_LOSSY_TYPE_REDUCED_RGBA32 = COLOPRESSO_PNGX_LOSSY_TYPE_REDUCED_RGBA32,
 } cpres_pngx_lossy_type_t;
 
+/* Shared flag an encode polls to stop early with CPRES_ERROR_CANCELLED. Safe to cancel from any thread while encodes that use it are running.
+ * Interrupted mid-stage: libwebp's encode (progress hook), imagequant's histogram/palette search and dithered remap, and the PNGX dither and color reduction loops.
+ * Not interruptible: libavif's AV1 encode and oxipng's filter/deflate trials (neither library has an abort hook), and imagequant's undithered remap.
+ * A cancel during one of those is returned as soon as that stage ends. */
+typedef struct cpres_cancel_token cpres_cancel_token_t;
+
+/* Effort an encode runs at after time_budget_ms has been applied. */
+typedef struct {
+  int webp_method;
+  int avif_speed;
+  int pngx_level;        /* Lowest oxipng level any pass ran at; PNGX re-plans it against the wall clock after quantization */
+  int pngx_lossy_speed;
+  uint32_t estimated_ms; /* Cost model estimate for the planned effort, not a measurement */
+  bool scaled;           /* true when the budget lowered the configured effort */
+} cpres_effort_t;
+
+/* Reports encode progress in [0, 1]. May be called from the encoding thread or one of its workers; keep it short and never block. */
+typedef void (*cpres_progress_callback_t)(float progress, void *user_data);
+
 typedef struct {
   /* WebP */
   float webp_quality;          /* WebP quality (0-100) */
@@ -185,6 +209,16 @@ typedef struct {
   cpres_rgba_color_t *pngx_protected_colors;            /* Array of colors to protect from quantization (NULL if none) */
   int pngx_protected_colors_count;                      /* Number of protected colors (0 if none, max 256) */
   int pngx_threads;                                     /* Max threads (>=0, 0=auto) */
+  bool pngx_parallel_branches;                          /* Run lossy and lossless branches concurrently (splits pngx_threads; may keep the lossless result where the serial path keeps a palette oxipng shrank by over a third) */
+  bool pngx_search_enable;                              /* Try every lossy type and smaller palettes, keep the smallest result (ignores pngx_lossy_type) */
+  bool pngx_tiled_dither_enable;                        /* Dither limited4444/reduced_rgba32 in row bands across pngx_threads (slightly different output than the serial pass) */
+  /* Common */
+  bool memory_limited;                         /* Skip the intermediate RGBA image for WebP/AVIF: PNG rows go straight into the encoder's own full-size ARGB or YUV planes, saving one image-sized buffer. No effect on PNGX, whose analysis, quantizers and oxipng all work on the whole RGBA image */
+  int time_budget_ms;                          /* Per-call encode budget; lowers WebP method, AVIF speed, PNGX level and quantizer speed to fit (0 = unlimited) */
+  cpres_effort_t *effort_report;               /* Filled with the effort the encode actually ran at (NULL = not reported; untouched on a cache hit) */
+  cpres_cancel_token_t *cancel_token;          /* Polled between stages and inside the interruptible ones (see cpres_cancel_token_t); must outlive the encode (NULL = not cancellable) */
+  cpres_progress_callback_t progress_callback; /* Progress reports for WebP, AVIF and PNGX encodes (NULL = none) */
+  void *progress_user_data;                    /* Passed to progress_callback */
 } cpres_config_t;
 
 typedef enum {
@@ -198,6 +232,7 @@ typedef enum {
   CPRES_ERROR_IO = 7,
   CPRES_ERROR_INVALID_PARAMETER = 8,
   CPRES_ERROR_OUTPUT_NOT_SMALLER = 9,
+  CPRES_ERROR_CANCELLED = 10,
 } cpres_error_t;
 
 typedef enum {
@@ -209,12 +244,85 @@ typedef enum {
 
 typedef void (*colopresso_log_callback_t)(colopresso_log_level_t level, const char *message);
 
+typedef enum {
+  CPRES_FORMAT_WEBP = 0,
+  CPRES_FORMAT_AVIF = 1,
+  CPRES_FORMAT_PNGX = 2,
+} cpres_format_t;
+
+/* Instruction set the pixel kernels run on, chosen once per process from what the CPU reports. */
+typedef enum {
+  CPRES_SIMD_LEVEL_NONE = 0,
+  CPRES_SIMD_LEVEL_SSE2 = 1,
+  CPRES_SIMD_LEVEL_SSE41 = 2,
+  CPRES_SIMD_LEVEL_AVX2 = 3,
+  CPRES_SIMD_LEVEL_NEON = 4,
+  CPRES_SIMD_LEVEL_WASM128 = 5,
+} cpres_simd_level_t;
+
+/* Receives encoded bytes in order. Returning false aborts the encode with CPRES_ERROR_IO. */
+typedef bool (*cpres_write_callback_t)(const uint8_t *data, size_t size, void *user_data);
+
+/* Encoder bound to one format and config, reused across images. Not thread-safe: use one encoder per thread. */
+typedef struct cpres_encoder cpres_encoder_t;
+
+typedef struct {
+  const uint8_t *png_data;
+  size_t png_size;
+  cpres_format_t format;
+  const cpres_config_t *config; /* NULL uses defaults; thread fields and effort_report are overridden by the batch scheduler */
+  void *user_data;
+} cpres_batch_item_t;
+
+typedef struct {
+  cpres_error_t error;
+  uint8_t *data; /* Owned by the callback; release with cpres_free() */
+  size_t size;
+  cpres_effort_t effort; /* Effort the item ran at (see cpres_config_t.effort_report) */
+} cpres_batch_result_t;
+
+/* Called once per item from a worker thread as soon as it finishes. Calls are serialized but arrive in completion order. */
+typedef void (*cpres_batch_callback_t)(size_t index, const cpres_batch_item_t *item, const cpres_batch_result_t *result, void *callback_data);
+
 extern void cpres_config_init_defaults(cpres_config_t *config);
 
 extern cpres_error_t cpres_encode_webp_memory(const uint8_t *png_data, size_t png_size, uint8_t **webp_data, size_t *webp_size, const cpres_config_t *config);
 extern cpres_error_t cpres_encode_avif_memory(const uint8_t *png_data, size_t png_size, uint8_t **avif_data, size_t *avif_size, const cpres_config_t *config);
 extern cpres_error_t cpres_encode_pngx_memory(const uint8_t *png_data, size_t png_size, uint8_t **optimized_data, size_t *optimized_size, const cpres_config_t *config);
 
+/* Encode a caller-owned RGBA8 frame without a PNG round trip. stride is the byte distance between rows (0 means width * 4). width and height are limited to 65536 like decoded
+ * PNGs, and stride to INT_MAX with stride * height addressable; anything larger is CPRES_ERROR_INVALID_PARAMETER. The buffer is only read and may be released once the call
+ * returns. There is no compressed input to compare against, so CPRES_ERROR_OUTPUT_NOT_SMALLER is never returned. PNGX hands the frame to oxipng as a raw image; only its quantizers
+ * work on a packed copy. */
+extern cpres_error_t cpres_encode_webp_rgba(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **webp_data, size_t *webp_size, const cpres_config_t *config);
+extern cpres_error_t cpres_encode_avif_rgba(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **avif_data, size_t *avif_size, const cpres_config_t *config);
+extern cpres_error_t cpres_encode_pngx_rgba(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **optimized_data, size_t *optimized_size,
+                                            const cpres_config_t *config);
+
+/* Stream the encoded image to write instead of returning a buffer. WebP bytes are forwarded while the encoder runs; AVIF and PNGX hand over their finished buffer without a copy.
+ * No output-size check is made against the input, and a failed WebP encode may already have written some bytes. written_size may be NULL. */
+extern cpres_error_t cpres_encode_webp_to_writer(const uint8_t *png_data, size_t png_size, cpres_write_callback_t write, void *user_data, size_t *written_size, const cpres_config_t *config);
+extern cpres_error_t cpres_encode_avif_to_writer(const uint8_t *png_data, size_t png_size, cpres_write_callback_t write, void *user_data, size_t *written_size, const cpres_config_t *config);
+extern cpres_error_t cpres_encode_pngx_to_writer(const uint8_t *png_data, size_t png_size, cpres_write_callback_t write, void *user_data, size_t *written_size, const cpres_config_t *config);
+
+/* Reports the effort an encode of a width x height image is planned at under config, from the cost model alone. PNGX encodes may still lower pngx_level once they have measured
+ * how long quantization took; effort_report carries what was actually used. Values are normalized as the encoders do: AVIF speed is clamped, PNGX level and quantizer speed fall
+ * back to their defaults, and a WebP method outside 0-6 (which the WebP encoder rejects) returns CPRES_ERROR_INVALID_PARAMETER. */
+extern cpres_error_t cpres_resolve_effort(cpres_format_t format, uint32_t width, uint32_t height, const cpres_config_t *config, cpres_effort_t *effort);
+
+/* A token starts uncancelled and can be reused after cpres_cancel_token_reset once no encode holds it. Destroy it only after every encode using it has returned. */
+extern cpres_cancel_token_t *cpres_cancel_token_create(void);
+extern void cpres_cancel_token_cancel(cpres_cancel_token_t *token);
+extern bool cpres_cancel_token_is_cancelled(const cpres_cancel_token_t *token);
+extern void cpres_cancel_token_reset(cpres_cancel_token_t *token);
+extern void cpres_cancel_token_destroy(cpres_cancel_token_t *token);
+
+extern cpres_error_t cpres_encode_batch(const cpres_batch_item_t *items, size_t item_count, uint32_t threads, cpres_batch_callback_t callback, void *callback_data);
+
+extern cpres_error_t cpres_encoder_create(cpres_format_t format, const cpres_config_t *config, cpres_encoder_t **encoder_out);
+extern cpres_error_t cpres_encoder_encode(cpres_encoder_t *encoder, const uint8_t *png_data, size_t png_size, uint8_t **out_data, size_t *out_size);
+extern void cpres_encoder_destroy(cpres_encoder_t *encoder);
+
 #if COLOPRESSO_WITH_FILE_OPS
 #include <colopresso/file.h>
 #endif
@@ -235,10 +343,13 @@ extern uint32_t cpres_get_pngx_libimagequant_version(void);
 extern uint32_t cpres_get_buildtime(void);
 extern const char *cpres_get_compiler_version_string(void);
 extern const char *cpres_get_rust_version_string(void);
+extern cpres_simd_level_t cpres_get_simd_level(void);
+extern const char *cpres_simd_level_string(cpres_simd_level_t level);
 
 extern bool cpres_is_threads_enabled(void);
 extern uint32_t cpres_get_default_thread_count(void);
 extern uint32_t cpres_get_max_thread_count(void);
+extern void cpres_thread_pool_shutdown(void);
 
 #ifdef __cplusplus
 }
@@ -67,6 +67,20 @@ extern int colopresso_mutex_lock(colopresso_mutex_t *mutex);
 extern int colopresso_mutex_unlock(colopresso_mutex_t *mutex);
 extern int colopresso_mutex_destroy(colopresso_mutex_t *mutex);
 
+typedef CONDITION_VARIABLE colopresso_cond_t;
+
+extern int colopresso_cond_init(colopresso_cond_t *cond, const void *attr);
+extern int colopresso_cond_wait(colopresso_cond_t *cond, colopresso_mutex_t *mutex);
+extern int colopresso_cond_signal(colopresso_cond_t *cond);
+extern int colopresso_cond_broadcast(colopresso_cond_t *cond);
+extern int colopresso_cond_destroy(colopresso_cond_t *cond);
+
+typedef INIT_ONCE colopresso_once_t;
+
+#define COLOPRESSO_ONCE_INIT INIT_ONCE_STATIC_INIT
+
+extern int colopresso_once(colopresso_once_t *once, void (*init_routine)(void));
+
 #else
 
 #include <getopt.h>
@@ -76,6 +90,10 @@ extern int colopresso_mutex_destroy(colopresso_mutex_t *mutex);
 
 typedef pthread_t colopresso_thread_t;
 typedef pthread_mutex_t colopresso_mutex_t;
+typedef pthread_cond_t colopresso_cond_t;
+typedef pthread_once_t colopresso_once_t;
+
+#define COLOPRESSO_ONCE_INIT PTHREAD_ONCE_INIT
 
 #define colopresso_thread_create pthread_create
 #define colopresso_thread_join pthread_join
@@ -83,6 +101,12 @@ typedef pthread_mutex_t colopresso_mutex_t;
 #define colopresso_mutex_lock pthread_mutex_lock
 #define colopresso_mutex_unlock pthread_mutex_unlock
 #define colopresso_mutex_destroy pthread_mutex_destroy
+#define colopresso_cond_init pthread_cond_init
+#define colopresso_cond_wait pthread_cond_wait
+#define colopresso_cond_signal pthread_cond_signal
+#define colopresso_cond_broadcast pthread_cond_broadcast
+#define colopresso_cond_destroy pthread_cond_destroy
+#define colopresso_once pthread_once
 
 #endif
 
@@ -90,9 +114,21 @@ extern uint32_t colopresso_get_cpu_count(void);
 extern const char *colopresso_extract_extension(const char *path);
 extern void colopresso_tm_set_gmt_offset(struct tm *tm);
 
+extern double colopresso_get_monotonic_seconds(void);
+
+extern int32_t colopresso_atomic_load_i32(const volatile int32_t *ptr);
+extern void colopresso_atomic_store_i32(volatile int32_t *ptr, int32_t value);
+
 #if COLOPRESSO_WITH_FILE_OPS
+typedef bool (*colopresso_dir_callback_t)(const char *name, bool is_directory, void *user_data);
+
 extern bool colopresso_fseeko(FILE *fp, uint64_t offset, int whence);
 extern bool colopresso_ftello(FILE *fp, uint64_t *position_out);
+extern bool colopresso_is_directory(const char *path);
+extern bool colopresso_make_directory(const char *path);
+extern bool colopresso_read_directory(const char *path, colopresso_dir_callback_t callback, void *user_data);
+extern bool colopresso_touch_file(const char *path);
+extern uint32_t colopresso_get_process_id(void);
 #endif
 
 #ifdef __cplusplus
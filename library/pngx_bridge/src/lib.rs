@@ -16,7 +16,10 @@
 ))]
 mod wasm;
 
-use imagequant::{new as iq_new, Error as IqError, RGBA as IqRGBA};
+use imagequant::{
+    new as iq_new, ControlFlow as IqControlFlow, Error as IqError, Image as IqImage,
+    QuantizationResult as IqResult, RGBA as IqRGBA,
+};
 use oxipng::Options;
 #[cfg(feature = "rayon")]
 use rayon::ThreadPool;
@@ -27,6 +30,12 @@ use std::collections::HashMap;
     not(target_os = "emscripten"),
     feature = "wasm-bindgen"
 )))]
+use std::mem::MaybeUninit;
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
 use std::os::raw::c_int;
 #[cfg(all(
     not(target_os = "emscripten"),
@@ -44,6 +53,7 @@ use std::panic::{catch_unwind, AssertUnwindSafe};
 )))]
 use std::ptr;
 use std::slice;
+use std::sync::atomic::{AtomicI32, Ordering};
 #[cfg(feature = "rayon")]
 use std::sync::{Mutex, OnceLock};
 
@@ -70,6 +80,7 @@ pub enum PngxResult {
     InvalidInput = 1,
     OptimizationFailed = 2,
     IoError = 3,
+    Cancelled = 4,
 }
 
 #[repr(C)]
@@ -87,6 +98,8 @@ pub struct PngxBridgeLosslessOptions {
     pub optimization_level: u8,
     pub strip_safe: bool,
     pub optimize_alpha: bool,
+    pub cancel_flag: *const i32,
+    pub thread_count: u32,
 }
 
 #[repr(C)]
@@ -103,6 +116,8 @@ pub struct PngxBridgeQuantParams {
     pub fixed_colors: *const RgbaColor,
     pub fixed_colors_len: usize,
     pub remap: bool,
+    pub cancel_flag: *const i32,
+    pub thread_count: u32,
 }
 
 #[repr(C)]
@@ -121,6 +136,13 @@ pub enum PngxBridgeQuantStatus {
     Ok = 0,
     QualityTooLow = 1,
     Error = 2,
+    Cancelled = 3,
+}
+
+/// Polls the word behind a `cpres_cancel_token_t`, which the C side only ever stores atomically.
+/// A null flag means the caller cannot cancel.
+pub(crate) fn cancel_requested(flag: *const i32) -> bool {
+    !flag.is_null() && unsafe { (*(flag as *const AtomicI32)).load(Ordering::Acquire) != 0 }
 }
 
 pub(crate) fn convert_lossless_options(opts: &PngxBridgeLosslessOptions) -> Options {
@@ -132,48 +154,18 @@ pub(crate) fn convert_lossless_options(opts: &PngxBridgeLosslessOptions) -> Opti
     options
 }
 
-#[cfg(not(all(
+fn iq_pixels(src: &[RgbaColor]) -> &[IqRGBA] {
+    const _: () = assert!(std::mem::size_of::<RgbaColor>() == std::mem::size_of::<IqRGBA>());
+    const _: () = assert!(std::mem::align_of::<RgbaColor>() == std::mem::align_of::<IqRGBA>());
+    // Both are #[repr(C)] r, g, b, a bytes, so the caller's buffer can be handed to imagequant as is.
+    unsafe { slice::from_raw_parts(src.as_ptr() as *const IqRGBA, src.len()) }
+}
+
+#[cfg(all(
     target_arch = "wasm32",
     not(target_os = "emscripten"),
     feature = "wasm-bindgen"
-)))]
-fn allocate_copy<T: Copy>(slice: &[T]) -> Result<*mut T, String> {
-    if slice.is_empty() {
-        return Ok(ptr::null_mut());
-    }
-    let bytes = slice
-        .len()
-        .checked_mul(std::mem::size_of::<T>())
-        .ok_or_else(|| {
-            format!(
-                "Integer overflow when calculating allocation size: {} * {}",
-                slice.len(),
-                std::mem::size_of::<T>()
-            )
-        })?;
-    let ptr = unsafe { malloc(bytes) as *mut T };
-    if ptr.is_null() {
-        return Err(format!("Memory allocation failed for {} bytes", bytes));
-    }
-    unsafe {
-        ptr::copy_nonoverlapping(slice.as_ptr(), ptr, slice.len());
-    }
-    Ok(ptr)
-}
-
-fn iq_rgba_from_slice(src: &[RgbaColor]) -> Vec<IqRGBA> {
-    let mut out = Vec::with_capacity(src.len());
-    for px in src {
-        out.push(IqRGBA {
-            r: px.r,
-            g: px.g,
-            b: px.b,
-            a: px.a,
-        });
-    }
-    out
-}
-
+))]
 fn convert_palette(palette: &[IqRGBA]) -> Vec<RgbaColor> {
     let mut out = Vec::with_capacity(palette.len());
     for px in palette {
@@ -187,6 +179,11 @@ fn convert_palette(palette: &[IqRGBA]) -> Vec<RgbaColor> {
     out
 }
 
+#[cfg(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+))]
 pub(crate) struct QuantizeOutcome {
     pub(crate) palette: Option<Vec<RgbaColor>>,
     pub(crate) indices: Option<Vec<u8>>,
@@ -195,24 +192,42 @@ pub(crate) struct QuantizeOutcome {
 
 pub(crate) enum QuantizeError {
     QualityTooLow,
+    Cancelled,
     Generic,
 }
 
-pub(crate) fn quantize_image(
-    pixels: &[RgbaColor],
+fn build_quantization<'p>(
+    pixels: &'p [RgbaColor],
     width: usize,
     height: usize,
     params: &PngxBridgeQuantParams,
-) -> Result<QuantizeOutcome, QuantizeError> {
+) -> Result<(IqImage<'p>, IqResult, i32), QuantizeError> {
     if width == 0 || height == 0 || pixels.len() != width * height {
         return Err(QuantizeError::Generic);
     }
 
+    if cancel_requested(params.cancel_flag) {
+        return Err(QuantizeError::Cancelled);
+    }
+
     let mut attr = iq_new();
     debug_assert!((1..=10).contains(&params.speed));
     attr.set_speed(params.speed)
         .map_err(|_| QuantizeError::Generic)?;
 
+    if !params.cancel_flag.is_null() {
+        // imagequant polls this between histogram and palette passes; the address travels as usize
+        // so the closure stays Send + Sync, and the caller keeps the token alive for the whole call.
+        let flag = params.cancel_flag as usize;
+        attr.set_progress_callback(move |_| {
+            if cancel_requested(flag as *const i32) {
+                IqControlFlow::Break
+            } else {
+                IqControlFlow::Continue
+            }
+        });
+    }
+
     let quality_min = params.quality_min;
     let mut quality_max = params.quality_max;
     if quality_max < quality_min {
@@ -231,12 +246,12 @@ pub(crate) fn quantize_image(
             .map_err(|_| QuantizeError::Generic)?;
     }
 
-    let rgba_vec = iq_rgba_from_slice(pixels);
     let mut image = attr
-        .new_image(rgba_vec, width, height, 0.0)
+        .new_image_borrowed(iq_pixels(pixels), width, height, 0.0)
         .map_err(|_| QuantizeError::Generic)?;
 
     if !params.importance_map.is_null() && params.importance_map_len == pixels.len() {
+        // imagequant takes ownership of the map, so this one byte per pixel is still copied.
         let map =
             unsafe { slice::from_raw_parts(params.importance_map, params.importance_map_len) };
         image
@@ -262,6 +277,7 @@ pub(crate) fn quantize_image(
     let mut result = match attr.quantize(&mut image) {
         Ok(res) => res,
         Err(IqError::QualityTooLow) => return Err(QuantizeError::QualityTooLow),
+        Err(IqError::Aborted) => return Err(QuantizeError::Cancelled),
         Err(_) => return Err(QuantizeError::Generic),
     };
 
@@ -270,6 +286,28 @@ pub(crate) fn quantize_image(
         .map(|q| i32::from(q))
         .unwrap_or(-1);
 
+    if params.remap && params.dithering_level >= 0.0 && params.dithering_level.is_finite() {
+        if result.set_dithering_level(params.dithering_level).is_err() {
+            return Err(QuantizeError::Generic);
+        }
+    }
+
+    Ok((image, result, quality))
+}
+
+#[cfg(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+))]
+pub(crate) fn quantize_image(
+    pixels: &[RgbaColor],
+    width: usize,
+    height: usize,
+    params: &PngxBridgeQuantParams,
+) -> Result<QuantizeOutcome, QuantizeError> {
+    let (mut image, mut result, quality) = build_quantization(pixels, width, height, params)?;
+
     if !params.remap {
         return Ok(QuantizeOutcome {
             palette: None,
@@ -278,12 +316,6 @@ pub(crate) fn quantize_image(
         });
     }
 
-    if params.dithering_level >= 0.0 && params.dithering_level.is_finite() {
-        if result.set_dithering_level(params.dithering_level).is_err() {
-            return Err(QuantizeError::Generic);
-        }
-    }
-
     let (palette, indices) = result
         .remapped(&mut image)
         .map_err(|_| QuantizeError::Generic)?;
@@ -301,23 +333,158 @@ pub(crate) fn quantize_image(
     not(target_os = "emscripten"),
     feature = "wasm-bindgen"
 )))]
-#[no_mangle]
-pub unsafe extern "C" fn pngx_bridge_optimize_lossless(
-    input_data: *const u8,
-    input_size: usize,
+fn quantize_image_into(
+    pixels: &[RgbaColor],
+    width: usize,
+    height: usize,
+    params: &PngxBridgeQuantParams,
+    palette_out: &mut [RgbaColor],
+    indices_out: &mut [MaybeUninit<u8>],
+) -> Result<(usize, i32), QuantizeError> {
+    let (mut image, mut result, quality) = build_quantization(pixels, width, height, params)?;
+
+    if !params.remap {
+        return Ok((0, quality));
+    }
+
+    // The progress callback set in build_quantization carries over to the result, and imagequant
+    // polls it between rows of the dithered remap; the undithered remap runs through.
+    match result.remap_into(&mut image, indices_out) {
+        Ok(()) => {}
+        Err(IqError::Aborted) => return Err(QuantizeError::Cancelled),
+        Err(_) => return Err(QuantizeError::Generic),
+    }
+    if cancel_requested(params.cancel_flag) {
+        return Err(QuantizeError::Cancelled);
+    }
+
+    // Remapping may refine the palette, so it is only read back afterwards.
+    let palette = result.palette();
+    if palette.len() > palette_out.len() {
+        return Err(QuantizeError::Generic);
+    }
+    for (dst, src) in palette_out.iter_mut().zip(palette.iter()) {
+        *dst = RgbaColor {
+            r: src.r,
+            g: src.g,
+            b: src.b,
+            a: src.a,
+        };
+    }
+
+    Ok((palette.len(), quality))
+}
+
+/// Lets a job that borrows the caller's FFI buffers move into a rayon pool. `install` blocks until
+/// the job returns, so the borrows outlive it.
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+struct AssertSend<T>(T);
+
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+unsafe impl<T> Send for AssertSend<T> {}
+
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+impl<T> AssertSend<T> {
+    // Taking self whole keeps closures from capturing just the (non-Send) field.
+    fn into_inner(self) -> T {
+        self.0
+    }
+}
+
+/// Runs `job` on the pool sized for this call, so concurrent callers with different thread
+/// budgets never share or swap each other's pool.
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+fn in_thread_pool<R, F>(threads: u32, job: F) -> R
+where
+    R: Send,
+    F: FnOnce() -> R + Send,
+{
+    #[cfg(all(feature = "rayon", not(target_arch = "wasm32")))]
+    {
+        if let Some(pool) = thread_pool_for(threads) {
+            return pool.install(job);
+        }
+    }
+
+    let _ = threads;
+    job()
+}
+
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+fn run_oxipng<F>(threads: u32, optimize: F) -> Result<Vec<u8>, ()>
+where
+    F: FnOnce() -> Result<Vec<u8>, oxipng::PngError> + Send,
+{
+    #[cfg(target_os = "emscripten")]
+    return in_thread_pool(threads, optimize).map_err(|_| ());
+
+    #[cfg(not(target_os = "emscripten"))]
+    match catch_unwind(AssertUnwindSafe(|| in_thread_pool(threads, optimize))) {
+        Ok(Ok(output_vec)) => Ok(output_vec),
+        Ok(Err(_)) | Err(_) => Err(()),
+    }
+}
+
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+unsafe fn write_output(
+    result: &[u8],
     output_data: *mut *mut u8,
     output_size: *mut usize,
-    options: *const PngxBridgeLosslessOptions,
 ) -> PngxResult {
-    if input_data.is_null() || output_data.is_null() || output_size.is_null() {
-        return PngxResult::InvalidInput;
+    let len = result.len();
+    if len == 0 {
+        *output_data = ptr::null_mut();
+        *output_size = 0;
+        return PngxResult::Success;
     }
 
-    let input_slice = slice::from_raw_parts(input_data, input_size);
+    let buffer = malloc(len) as *mut u8;
+    if buffer.is_null() {
+        return PngxResult::IoError;
+    }
+
+    ptr::copy_nonoverlapping(result.as_ptr(), buffer, len);
+    *output_data = buffer;
+    *output_size = len;
+    PngxResult::Success
+}
+
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+unsafe fn lossless_options_or_default(options: *const PngxBridgeLosslessOptions) -> Options {
     let default_opts = PngxBridgeLosslessOptions {
         optimization_level: 5,
         strip_safe: true,
         optimize_alpha: true,
+        cancel_flag: ptr::null(),
+        thread_count: 0,
     };
     let opts_ref = if options.is_null() {
         &default_opts
@@ -325,72 +492,229 @@ pub unsafe extern "C" fn pngx_bridge_optimize_lossless(
         &*options
     };
 
-    let rust_opts = convert_lossless_options(opts_ref);
-
-    #[cfg(all(
-        feature = "rayon",
-        not(target_arch = "wasm32"),
-        not(target_os = "emscripten")
-    ))]
-    let attempt = if let Some(pool) = get_current_thread_pool() {
-        pool.install(|| {
-            catch_unwind(AssertUnwindSafe(|| {
-                oxipng::optimize_from_memory(input_slice, &rust_opts)
-            }))
-        })
+    convert_lossless_options(opts_ref)
+}
+
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+unsafe fn lossless_cancel_flag(options: *const PngxBridgeLosslessOptions) -> *const i32 {
+    if options.is_null() {
+        ptr::null()
     } else {
-        catch_unwind(AssertUnwindSafe(|| {
-            oxipng::optimize_from_memory(input_slice, &rust_opts)
-        }))
-    };
+        (*options).cancel_flag
+    }
+}
 
-    #[cfg(all(
-        not(target_os = "emscripten"),
-        any(not(feature = "rayon"), target_arch = "wasm32")
-    ))]
-    let attempt = catch_unwind(AssertUnwindSafe(|| {
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+unsafe fn lossless_thread_count(options: *const PngxBridgeLosslessOptions) -> u32 {
+    if options.is_null() {
+        0
+    } else {
+        (*options).thread_count
+    }
+}
+
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+#[no_mangle]
+pub unsafe extern "C" fn pngx_bridge_optimize_lossless(
+    input_data: *const u8,
+    input_size: usize,
+    output_data: *mut *mut u8,
+    output_size: *mut usize,
+    options: *const PngxBridgeLosslessOptions,
+) -> PngxResult {
+    if input_data.is_null() || output_data.is_null() || output_size.is_null() {
+        return PngxResult::InvalidInput;
+    }
+
+    let input_slice = slice::from_raw_parts(input_data, input_size);
+    let rust_opts = lossless_options_or_default(options);
+    let cancel_flag = lossless_cancel_flag(options);
+
+    // oxipng has no abort hook, so a cancel lands before the trials start or is honoured once they finish.
+    if cancel_requested(cancel_flag) {
+        return PngxResult::Cancelled;
+    }
+
+    let attempt = run_oxipng(lossless_thread_count(options), || {
         oxipng::optimize_from_memory(input_slice, &rust_opts)
-    }));
+    });
+    if cancel_requested(cancel_flag) {
+        return PngxResult::Cancelled;
+    }
 
-    #[cfg(target_os = "emscripten")]
-    let result = match oxipng::optimize_from_memory(input_slice, &rust_opts) {
-        Ok(output_vec) => output_vec,
-        Err(_) => input_slice.to_vec(),
+    match attempt {
+        Ok(output_vec) => write_output(&output_vec, output_data, output_size),
+        Err(()) => write_output(input_slice, output_data, output_size),
+    }
+}
+
+/// Encodes 8-bit palette indices (one byte per pixel, no filter bytes) straight through oxipng's
+/// reduction, filter and deflate search, so no intermediate PNG has to be written and re-parsed.
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+#[no_mangle]
+pub unsafe extern "C" fn pngx_bridge_optimize_indexed(
+    indices: *const u8,
+    indices_len: usize,
+    width: u32,
+    height: u32,
+    palette: *const RgbaColor,
+    palette_len: usize,
+    output_data: *mut *mut u8,
+    output_size: *mut usize,
+    options: *const PngxBridgeLosslessOptions,
+) -> PngxResult {
+    if indices.is_null() || palette.is_null() || output_data.is_null() || output_size.is_null() {
+        return PngxResult::InvalidInput;
+    }
+
+    let expected = (width as usize).checked_mul(height as usize);
+    if expected != Some(indices_len) || palette_len == 0 || palette_len > 256 {
+        return PngxResult::InvalidInput;
+    }
+
+    let cancel_flag = lossless_cancel_flag(options);
+    if cancel_requested(cancel_flag) {
+        return PngxResult::Cancelled;
+    }
+
+    let palette_slice = slice::from_raw_parts(palette, palette_len);
+    let palette_vec: Vec<oxipng::RGBA8> = palette_slice
+        .iter()
+        .map(|c| oxipng::RGBA8 {
+            r: c.r,
+            g: c.g,
+            b: c.b,
+            a: c.a,
+        })
+        .collect();
+    // RawImage owns its pixel data, so this is the one copy left (a byte per pixel).
+    let data = slice::from_raw_parts(indices, indices_len).to_vec();
+    let rust_opts = lossless_options_or_default(options);
+
+    let image = match oxipng::RawImage::new(
+        width,
+        height,
+        oxipng::ColorType::Indexed {
+            palette: palette_vec,
+        },
+        oxipng::BitDepth::Eight,
+        data,
+    ) {
+        Ok(image) => image,
+        Err(_) => return PngxResult::InvalidInput,
     };
 
-    #[cfg(not(target_os = "emscripten"))]
-    let result = match attempt {
-        Ok(Ok(output_vec)) => output_vec,
-        Ok(Err(_)) | Err(_) => input_slice.to_vec(),
+    let attempt = run_oxipng(lossless_thread_count(options), || {
+        image.create_optimized_png(&rust_opts)
+    });
+    if cancel_requested(cancel_flag) {
+        return PngxResult::Cancelled;
+    }
+
+    match attempt {
+        Ok(output_vec) => write_output(&output_vec, output_data, output_size),
+        Err(()) => PngxResult::OptimizationFailed,
+    }
+}
+
+/// Encodes an 8-bit RGBA frame (`stride` bytes per row, at least `width * 4`) straight through
+/// oxipng's reduction, filter and deflate search, so the caller never writes a PNG for it to re-parse.
+#[cfg(not(all(
+    target_arch = "wasm32",
+    not(target_os = "emscripten"),
+    feature = "wasm-bindgen"
+)))]
+#[no_mangle]
+pub unsafe extern "C" fn pngx_bridge_optimize_rgba(
+    rgba: *const u8,
+    width: u32,
+    height: u32,
+    stride: usize,
+    output_data: *mut *mut u8,
+    output_size: *mut usize,
+    options: *const PngxBridgeLosslessOptions,
+) -> PngxResult {
+    if rgba.is_null() || output_data.is_null() || output_size.is_null() || width == 0 || height == 0
+    {
+        return PngxResult::InvalidInput;
+    }
+
+    let row_bytes = match (width as usize).checked_mul(4) {
+        Some(row_bytes) if stride >= row_bytes => row_bytes,
+        _ => return PngxResult::InvalidInput,
+    };
+    let span = match stride
+        .checked_mul(height as usize - 1)
+        .and_then(|rows| rows.checked_add(row_bytes))
+    {
+        Some(span) => span,
+        None => return PngxResult::InvalidInput,
     };
 
-    let len = result.len();
-    if len == 0 {
-        *output_data = ptr::null_mut();
-        *output_size = 0;
-        return PngxResult::Success;
+    let cancel_flag = lossless_cancel_flag(options);
+    if cancel_requested(cancel_flag) {
+        return PngxResult::Cancelled;
     }
 
-    let buffer = unsafe { malloc(len) as *mut u8 };
-    if buffer.is_null() {
-        return PngxResult::IoError;
+    // RawImage owns its pixel data, so the rows are packed once here; that copy replaces the PNG
+    // the caller would otherwise have encoded and oxipng decoded again.
+    let input = slice::from_raw_parts(rgba, span);
+    let mut data = Vec::with_capacity(row_bytes * height as usize);
+    for row in input.chunks(stride).take(height as usize) {
+        data.extend_from_slice(&row[..row_bytes]);
     }
+    let rust_opts = lossless_options_or_default(options);
+
+    let image = match oxipng::RawImage::new(
+        width,
+        height,
+        oxipng::ColorType::RGBA,
+        oxipng::BitDepth::Eight,
+        data,
+    ) {
+        Ok(image) => image,
+        Err(_) => return PngxResult::InvalidInput,
+    };
 
-    unsafe {
-        ptr::copy_nonoverlapping(result.as_ptr(), buffer, len);
+    let attempt = run_oxipng(lossless_thread_count(options), || {
+        image.create_optimized_png(&rust_opts)
+    });
+    if cancel_requested(cancel_flag) {
+        return PngxResult::Cancelled;
+    }
+
+    match attempt {
+        Ok(output_vec) => write_output(&output_vec, output_data, output_size),
+        Err(()) => PngxResult::OptimizationFailed,
     }
-    *output_data = buffer;
-    *output_size = len;
-    PngxResult::Success
 }
 
+/// Quantizes without copying through Rust-owned buffers: `pixels` is borrowed, indices are
+/// written to `output.indices` (`output.indices_len` bytes, at least `pixel_count`) and the
+/// palette to `output.palette` (room for 256 entries). Nothing is allocated for the caller to free.
 #[cfg(not(all(
     target_arch = "wasm32",
     not(target_os = "emscripten"),
     feature = "wasm-bindgen"
 )))]
 #[no_mangle]
-pub unsafe extern "C" fn pngx_bridge_quantize(
+pub unsafe extern "C" fn pngx_bridge_quantize_into(
     pixels: *const RgbaColor,
     pixel_count: usize,
     width: u32,
@@ -402,102 +726,72 @@ pub unsafe extern "C" fn pngx_bridge_quantize(
         return PngxBridgeQuantStatus::Error;
     }
 
-    let mut out = PngxBridgeQuantOutput {
-        palette: ptr::null_mut(),
-        palette_len: 0,
-        indices: ptr::null_mut(),
-        indices_len: 0,
-        quality: -1,
-    };
-
+    let out = &mut *output;
     let params_ref = &*params;
+    let palette_ptr = out.palette;
+    let indices_ptr = out.indices;
+    let indices_capacity = out.indices_len;
+
+    out.palette_len = 0;
+    out.indices_len = 0;
+    out.quality = -1;
+
     let expected = (width as usize).checked_mul(height as usize);
     if expected != Some(pixel_count) {
-        unsafe {
-            *output = out;
-        }
+        return PngxBridgeQuantStatus::Error;
+    }
+    if params_ref.remap
+        && (palette_ptr.is_null() || indices_ptr.is_null() || indices_capacity < pixel_count)
+    {
         return PngxBridgeQuantStatus::Error;
     }
 
     let pixels_slice = slice::from_raw_parts(pixels, pixel_count);
+    let (palette_slice, indices_slice): (&mut [RgbaColor], &mut [MaybeUninit<u8>]) =
+        if params_ref.remap {
+            (
+                slice::from_raw_parts_mut(palette_ptr, 256),
+                slice::from_raw_parts_mut(indices_ptr as *mut MaybeUninit<u8>, pixel_count),
+            )
+        } else {
+            (&mut [], &mut [])
+        };
+
+    let threads = params_ref.thread_count;
+    let job = AssertSend(|| {
+        quantize_image_into(
+            pixels_slice,
+            width as usize,
+            height as usize,
+            params_ref,
+            palette_slice,
+            indices_slice,
+        )
+    });
 
     #[cfg(not(target_os = "emscripten"))]
-    let outcome = {
-        let outcome = catch_unwind(AssertUnwindSafe(|| {
-            quantize_image(pixels_slice, width as usize, height as usize, params_ref)
-        }));
-
-        match outcome {
-            Ok(result) => result,
-            Err(_) => {
-                unsafe {
-                    *output = out;
-                }
-                return PngxBridgeQuantStatus::Error;
-            }
-        }
+    let outcome = match catch_unwind(AssertUnwindSafe(|| {
+        in_thread_pool(threads, move || job.into_inner()())
+    })) {
+        Ok(result) => result,
+        Err(_) => return PngxBridgeQuantStatus::Error,
     };
 
     #[cfg(target_os = "emscripten")]
-    let outcome = quantize_image(pixels_slice, width as usize, height as usize, params_ref);
+    let outcome = in_thread_pool(threads, move || job.into_inner()());
 
     match outcome {
-        Ok(result) => {
-            out.quality = result.quality;
+        Ok((palette_len, quality)) => {
+            out.quality = quality;
             if params_ref.remap {
-                if let Some(palette) = result.palette {
-                    match allocate_copy(&palette) {
-                        Ok(ptr_palette) => {
-                            out.palette = ptr_palette;
-                            out.palette_len = palette.len();
-                        }
-                        Err(_) => {
-                            unsafe {
-                                *output = out;
-                            }
-                            return PngxBridgeQuantStatus::Error;
-                        }
-                    }
-                }
-                if let Some(indices) = result.indices {
-                    match allocate_copy(&indices) {
-                        Ok(ptr_indices) => {
-                            out.indices = ptr_indices;
-                            out.indices_len = indices.len();
-                        }
-                        Err(_) => {
-                            if !out.palette.is_null() {
-                                unsafe {
-                                    free(out.palette as *mut std::ffi::c_void);
-                                }
-                                out.palette = ptr::null_mut();
-                                out.palette_len = 0;
-                            }
-                            unsafe {
-                                *output = out;
-                            }
-                            return PngxBridgeQuantStatus::Error;
-                        }
-                    }
-                }
-            }
-            unsafe {
-                *output = out;
+                out.palette_len = palette_len;
+                out.indices_len = pixel_count;
             }
             PngxBridgeQuantStatus::Ok
         }
-        Err(QuantizeError::QualityTooLow) => {
-            unsafe {
-                *output = out;
-            }
-            PngxBridgeQuantStatus::QualityTooLow
-        }
-        Err(QuantizeError::Generic) => {
-            unsafe {
-                *output = out;
-            }
-            PngxBridgeQuantStatus::Error
-        }
+        Err(QuantizeError::QualityTooLow) => PngxBridgeQuantStatus::QualityTooLow,
+        Err(QuantizeError::Cancelled) => PngxBridgeQuantStatus::Cancelled,
+        Err(QuantizeError::Generic) => PngxBridgeQuantStatus::Error,
     }
 }
 
@@ -556,6 +850,8 @@ pub extern "C" fn pngx_bridge_rust_version_string() -> *const std::os::raw::c_ch
     VERSION.as_ptr() as *const std::os::raw::c_char
 }
 
+/// Sets the pool used by calls whose options leave `thread_count` at 0. Calls that carry their
+/// own count get a pool of that size and never read or change this default.
 #[cfg(not(all(
     target_arch = "wasm32",
     not(target_os = "emscripten"),
@@ -579,28 +875,13 @@ pub extern "C" fn pngx_bridge_init_threads(num_threads: c_int) -> bool {
                 .unwrap_or(1)
         };
 
-        let cache = THREAD_POOL_CACHE.get_or_init(|| Mutex::new(HashMap::new()));
-        let current = CURRENT_THREAD_COUNT.get_or_init(|| Mutex::new(0));
-
-        let needs_new_pool = {
-            let cache_guard = cache.lock().unwrap();
-            !cache_guard.contains_key(&target_threads)
-        };
-
-        if needs_new_pool {
-            let builder = rayon::ThreadPoolBuilder::new().num_threads(target_threads);
-            if let Ok(pool) = builder.build() {
-                let mut cache_guard = cache.lock().unwrap();
-                cache_guard.insert(target_threads, std::sync::Arc::new(pool));
-            } else {
-                return false;
-            }
+        if cached_thread_pool(target_threads).is_none() {
+            return false;
         }
 
-        {
-            let mut current_guard = current.lock().unwrap();
-            *current_guard = target_threads;
-        }
+        let current = CURRENT_THREAD_COUNT.get_or_init(|| Mutex::new(0));
+        let mut current_guard = current.lock().unwrap();
+        *current_guard = target_threads;
 
         true
     }
@@ -612,6 +893,25 @@ pub extern "C" fn pngx_bridge_init_threads(num_threads: c_int) -> bool {
     }
 }
 
+#[cfg(all(feature = "rayon", not(target_arch = "wasm32")))]
+fn cached_thread_pool(threads: usize) -> Option<std::sync::Arc<ThreadPool>> {
+    let cache = THREAD_POOL_CACHE.get_or_init(|| Mutex::new(HashMap::new()));
+    let mut cache_guard = cache.lock().ok()?;
+
+    if let Some(pool) = cache_guard.get(&threads) {
+        return Some(pool.clone());
+    }
+
+    let pool = std::sync::Arc::new(
+        rayon::ThreadPoolBuilder::new()
+            .num_threads(threads)
+            .build()
+            .ok()?,
+    );
+    cache_guard.insert(threads, pool.clone());
+    Some(pool)
+}
+
 #[cfg(all(feature = "rayon", not(target_arch = "wasm32")))]
 fn get_current_thread_pool() -> Option<std::sync::Arc<ThreadPool>> {
     let cache = THREAD_POOL_CACHE.get()?;
@@ -624,3 +924,12 @@ fn get_current_thread_pool() -> Option<std::sync::Arc<ThreadPool>> {
     let cache_guard = cache.lock().ok()?;
     cache_guard.get(&target_threads).cloned()
 }
+
+#[cfg(all(feature = "rayon", not(target_arch = "wasm32")))]
+fn thread_pool_for(threads: u32) -> Option<std::sync::Arc<ThreadPool>> {
+    if threads == 0 {
+        get_current_thread_pool()
+    } else {
+        cached_thread_pool(threads as usize)
+    }
+}
@@ -184,6 +184,8 @@ pub fn pngx_wasm_optimize_lossless(
         optimization_level: opts.optimization_level,
         strip_safe: opts.strip_safe,
         optimize_alpha: opts.optimize_alpha,
+        cancel_flag: std::ptr::null(),
+        thread_count: 0,
     };
 
     let rust_opts = convert_lossless_options(&bridge_opts);
@@ -255,6 +257,8 @@ pub fn pngx_wasm_quantize(
         fixed_colors: std::ptr::null(),
         fixed_colors_len: 0,
         remap: p.remap,
+        cancel_flag: std::ptr::null(),
+        thread_count: 0,
     };
 
     match quantize_image(
@@ -285,7 +289,7 @@ pub fn pngx_wasm_quantize(
             quality: -1,
             status: 1,
         },
-        Err(QuantizeError::Generic) => WasmQuantResult {
+        Err(QuantizeError::Cancelled) | Err(QuantizeError::Generic) => WasmQuantResult {
             palette: Vec::new(),
             indices: Vec::new(),
             quality: -1,
@@ -373,6 +377,8 @@ pub fn pngx_wasm_quantize_advanced(
         fixed_colors: fixed_ptr,
         fixed_colors_len: fixed_len,
         remap,
+        cancel_flag: std::ptr::null(),
+        thread_count: 0,
     };
 
     match quantize_image(
@@ -403,7 +409,7 @@ pub fn pngx_wasm_quantize_advanced(
             quality: -1,
             status: 1,
         },
-        Err(QuantizeError::Generic) => WasmQuantResult {
+        Err(QuantizeError::Cancelled) | Err(QuantizeError::Generic) => WasmQuantResult {
             palette: Vec::new(),
             indices: Vec::new(),
             quality: -1,
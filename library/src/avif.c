@@ -21,6 +21,7 @@
 #include <colopresso.h>
 
 #include "internal/avif.h"
+#include "internal/cancel.h"
 #include "internal/log.h"
 
 static int g_avif_last_error = 0;
@@ -75,7 +76,7 @@ static inline void apply_avif_config(avifEncoder *encoder, const cpres_config_t
   }
 }
 
-static avifImage *create_avif_image_from_rgba(uint8_t *rgba_data, uint32_t width, uint32_t height) {
+static avifImage *create_avif_image_from_rgba(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride) {
   avifImage *image = NULL;
   avifRGBImage rgb;
 
@@ -92,8 +93,9 @@ static avifImage *create_avif_image_from_rgba(uint8_t *rgba_data, uint32_t width
   rgb.format = AVIF_RGB_FORMAT_RGBA;
   rgb.depth = 8;
   rgb.chromaUpsampling = AVIF_CHROMA_UPSAMPLING_AUTOMATIC;
-  rgb.pixels = rgba_data;
-  rgb.rowBytes = width * 4;
+  /* avifImageRGBToYUV only reads the pixels, so the caller's buffer is used in place. */
+  rgb.pixels = (uint8_t *)rgba_data;
+  rgb.rowBytes = stride;
 
   if (avifImageRGBToYUV(image, &rgb) != AVIF_RESULT_OK) {
     avifImageDestroy(image);
@@ -103,47 +105,46 @@ static avifImage *create_avif_image_from_rgba(uint8_t *rgba_data, uint32_t width
   return image;
 }
 
-static inline cpres_error_t encode_avif_common(uint8_t *rgba_data, uint32_t width, uint32_t height, avifRWData *output, const cpres_config_t *config) {
-  avifImage *image = NULL;
+static cpres_error_t encode_avif_image(avifImage *image, avifRWData *output, const cpres_config_t *config) {
   avifEncoder *encoder = NULL;
   avifResult result;
 
-  if (!rgba_data || !output || !config) {
-    return CPRES_ERROR_INVALID_PARAMETER;
-  }
-
-  image = create_avif_image_from_rgba(rgba_data, width, height);
-  if (!image) {
-    avif_set_last_error(AVIF_RESULT_OUT_OF_MEMORY);
-    return CPRES_ERROR_OUT_OF_MEMORY;
-  }
-
   encoder = avifEncoderCreate();
   if (!encoder) {
-    avifImageDestroy(image);
     avif_set_last_error(AVIF_RESULT_OUT_OF_MEMORY);
     return CPRES_ERROR_OUT_OF_MEMORY;
   }
 
   apply_avif_config(encoder, config);
 
+  /* libavif has no abort hook: the AV1 encode inside avifEncoderAddImage runs to completion, so a cancel is honoured on either side of it. */
+  if (cancel_requested(config)) {
+    avifEncoderDestroy(encoder);
+    return CPRES_ERROR_CANCELLED;
+  }
+  cancel_report_progress(config->progress_callback, config->progress_user_data, 0.0f);
+
   result = avifEncoderAddImage(encoder, image, 1, AVIF_ADD_IMAGE_FLAG_SINGLE);
   if (result != AVIF_RESULT_OK) {
     avif_set_last_error(result);
     avifEncoderDestroy(encoder);
-    avifImageDestroy(image);
     if (result == AVIF_RESULT_OUT_OF_MEMORY) {
       return CPRES_ERROR_OUT_OF_MEMORY;
     }
     return CPRES_ERROR_ENCODE_FAILED;
   }
 
+  if (cancel_requested(config)) {
+    avifEncoderDestroy(encoder);
+    return CPRES_ERROR_CANCELLED;
+  }
+  cancel_report_progress(config->progress_callback, config->progress_user_data, 0.9f);
+
   result = avifEncoderFinish(encoder, output);
 
   if (result != AVIF_RESULT_OK) {
     avif_set_last_error(result);
     avifEncoderDestroy(encoder);
-    avifImageDestroy(image);
     if (result == AVIF_RESULT_OUT_OF_MEMORY) {
       return CPRES_ERROR_OUT_OF_MEMORY;
     }
@@ -152,11 +153,37 @@ static inline cpres_error_t encode_avif_common(uint8_t *rgba_data, uint32_t widt
 
   avif_set_last_error(AVIF_RESULT_OK);
   avifEncoderDestroy(encoder);
-  avifImageDestroy(image);
+  cancel_report_progress(config->progress_callback, config->progress_user_data, 1.0f);
+
   return CPRES_OK;
 }
 
+static inline cpres_error_t encode_avif_common(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, avifRWData *output, const cpres_config_t *config) {
+  avifImage *image = NULL;
+  cpres_error_t err;
+
+  if (!rgba_data || !output || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  image = create_avif_image_from_rgba(rgba_data, width, height, stride);
+  if (!image) {
+    avif_set_last_error(AVIF_RESULT_OUT_OF_MEMORY);
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+
+  err = encode_avif_image(image, output, config);
+  avifImageDestroy(image);
+
+  return err;
+}
+
 extern cpres_error_t avif_encode_rgba_to_memory(uint8_t *rgba_data, uint32_t width, uint32_t height, uint8_t **avif_data, size_t *avif_size, const cpres_config_t *config) {
+  return avif_encode_rgba_strided_to_memory(rgba_data, width, height, width * 4, avif_data, avif_size, config);
+}
+
+extern cpres_error_t avif_encode_rgba_strided_to_memory(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **avif_data, size_t *avif_size,
+                                                        const cpres_config_t *config) {
   avifRWData encoded = AVIF_DATA_EMPTY;
   cpres_error_t err;
 
@@ -167,7 +194,7 @@ extern cpres_error_t avif_encode_rgba_to_memory(uint8_t *rgba_data, uint32_t wid
   *avif_data = NULL;
   *avif_size = 0;
 
-  err = encode_avif_common(rgba_data, width, height, &encoded, config);
+  err = encode_avif_common(rgba_data, width, height, stride, &encoded, config);
   if (err != CPRES_OK) {
     if (encoded.data) {
       avifRWDataFree(&encoded);
@@ -186,3 +213,174 @@ extern cpres_error_t avif_encode_rgba_to_memory(uint8_t *rgba_data, uint32_t wid
 
   return CPRES_OK;
 }
+
+extern cpres_error_t avif_encode_rgba_to_writer(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, cpres_write_callback_t write, void *user_data, size_t *written_size,
+                                                const cpres_config_t *config) {
+  avifRWData encoded = AVIF_DATA_EMPTY;
+  cpres_error_t err;
+  bool accepted;
+
+  if (!rgba_data || !write || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (written_size) {
+    *written_size = 0;
+  }
+
+  err = encode_avif_common(rgba_data, width, height, stride, &encoded, config);
+  if (err != CPRES_OK) {
+    if (encoded.data) {
+      avifRWDataFree(&encoded);
+    }
+    return err;
+  }
+
+  /* libavif only produces the file in one piece at avifEncoderFinish, so its buffer goes to the writer as-is. */
+  accepted = write(encoded.data, encoded.size, user_data);
+  if (accepted && written_size) {
+    *written_size = encoded.size;
+  }
+  avifRWDataFree(&encoded);
+
+  return accepted ? CPRES_OK : CPRES_ERROR_IO;
+}
+
+typedef struct {
+  avifImage *image;
+  avifImage *view;
+} avif_row_importer_t;
+
+static cpres_error_t avif_rows_begin(void *context, png_uint_32 width, png_uint_32 height) {
+  avif_row_importer_t *importer = (avif_row_importer_t *)context;
+
+  importer->image = avifImageCreate((uint32_t)width, (uint32_t)height, 8, AVIF_PIXEL_FORMAT_YUV444);
+  importer->view = avifImageCreateEmpty();
+  if (!importer->image || !importer->view) {
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+
+  /* avifImageRGBToYUV only allocates planes that are missing, so allocating them up front lets each strip convert into a view of the full image. */
+  if (avifImageAllocatePlanes(importer->image, AVIF_PLANES_ALL) != AVIF_RESULT_OK) {
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+
+  return CPRES_OK;
+}
+
+static cpres_error_t avif_rows_import(void *context, const uint8_t *rgba, png_uint_32 first_row, png_uint_32 row_count) {
+  avif_row_importer_t *importer = (avif_row_importer_t *)context;
+  avifCropRect rect;
+  avifRGBImage rgb;
+
+  rect.x = 0;
+  rect.y = (uint32_t)first_row;
+  rect.width = importer->image->width;
+  rect.height = (uint32_t)row_count;
+
+  if (avifImageSetViewRect(importer->view, importer->image, &rect) != AVIF_RESULT_OK) {
+    return CPRES_ERROR_ENCODE_FAILED;
+  }
+
+  avifRGBImageSetDefaults(&rgb, importer->view);
+  rgb.format = AVIF_RGB_FORMAT_RGBA;
+  rgb.depth = 8;
+  rgb.chromaUpsampling = AVIF_CHROMA_UPSAMPLING_AUTOMATIC;
+  rgb.pixels = (uint8_t *)rgba;
+  rgb.rowBytes = importer->image->width * 4;
+
+  if (avifImageRGBToYUV(importer->view, &rgb) != AVIF_RESULT_OK) {
+    return CPRES_ERROR_ENCODE_FAILED;
+  }
+
+  return CPRES_OK;
+}
+
+static cpres_error_t encode_avif_png_rows(const png_row_input_t *input, avifRWData *output, const cpres_config_t *config) {
+  avif_row_importer_t importer;
+  png_row_sink_t sink;
+  cpres_error_t err;
+
+  memset(&importer, 0, sizeof(importer));
+  sink.begin = avif_rows_begin;
+  sink.rows = avif_rows_import;
+  sink.context = &importer;
+
+  /* YUV444 has no chroma siting across rows, so converting strip by strip gives the same planes as converting the whole image. */
+  err = png_decode_rows(input, &sink);
+  if (err == CPRES_OK) {
+    err = encode_avif_image(importer.image, output, config);
+  } else if (err == CPRES_ERROR_OUT_OF_MEMORY) {
+    avif_set_last_error(AVIF_RESULT_OUT_OF_MEMORY);
+  }
+
+  if (importer.view) {
+    avifImageDestroy(importer.view);
+  }
+  if (importer.image) {
+    avifImageDestroy(importer.image);
+  }
+
+  return err;
+}
+
+extern cpres_error_t avif_encode_png_rows_to_memory(const png_row_input_t *input, uint8_t **avif_data, size_t *avif_size, const cpres_config_t *config) {
+  avifRWData encoded = AVIF_DATA_EMPTY;
+  cpres_error_t err;
+
+  if (!input || !avif_data || !avif_size || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  *avif_data = NULL;
+  *avif_size = 0;
+
+  err = encode_avif_png_rows(input, &encoded, config);
+  if (err != CPRES_OK) {
+    if (encoded.data) {
+      avifRWDataFree(&encoded);
+    }
+    return err;
+  }
+
+  *avif_data = (uint8_t *)malloc(encoded.size);
+  if (!*avif_data) {
+    avifRWDataFree(&encoded);
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+  memcpy(*avif_data, encoded.data, encoded.size);
+  *avif_size = encoded.size;
+  avifRWDataFree(&encoded);
+
+  return CPRES_OK;
+}
+
+extern cpres_error_t avif_encode_png_rows_to_writer(const png_row_input_t *input, cpres_write_callback_t write, void *user_data, size_t *written_size, const cpres_config_t *config) {
+  avifRWData encoded = AVIF_DATA_EMPTY;
+  cpres_error_t err;
+  bool accepted;
+
+  if (!input || !write || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (written_size) {
+    *written_size = 0;
+  }
+
+  err = encode_avif_png_rows(input, &encoded, config);
+  if (err != CPRES_OK) {
+    if (encoded.data) {
+      avifRWDataFree(&encoded);
+    }
+    return err;
+  }
+
+  accepted = write(encoded.data, encoded.size, user_data);
+  if (accepted && written_size) {
+    *written_size = encoded.size;
+  }
+  avifRWDataFree(&encoded);
+
+  return accepted ? CPRES_OK : CPRES_ERROR_IO;
+}
@@ -0,0 +1,257 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <colopresso.h>
+#include <colopresso/portable.h>
+
+#include "internal/log.h"
+#include "internal/threads.h"
+
+typedef struct {
+  size_t png_size;
+  size_t index;
+} batch_order_t;
+
+typedef struct {
+  const cpres_batch_item_t *items;
+  const batch_order_t *order;
+  size_t item_count;
+  size_t next_item;
+  uint32_t total_threads;
+  uint32_t threads_in_use;
+  cpres_batch_callback_t callback;
+  void *callback_data;
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_t mutex;
+  colopresso_mutex_t callback_mutex;
+#endif
+} batch_parallel_ctx_t;
+
+static inline void batch_lock(batch_parallel_ctx_t *ctx) {
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_lock(&ctx->mutex);
+#else
+  (void)ctx;
+#endif
+}
+
+static inline void batch_unlock(batch_parallel_ctx_t *ctx) {
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_unlock(&ctx->mutex);
+#else
+  (void)ctx;
+#endif
+}
+
+static inline void batch_deliver(batch_parallel_ctx_t *ctx, size_t index, const cpres_batch_result_t *result) {
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_lock(&ctx->callback_mutex);
+#endif
+  ctx->callback(index, &ctx->items[index], result, ctx->callback_data);
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_unlock(&ctx->callback_mutex);
+#endif
+}
+
+static int batch_order_compare(const void *lhs, const void *rhs) {
+  const batch_order_t *a = (const batch_order_t *)lhs, *b = (const batch_order_t *)rhs;
+
+  if (a->png_size != b->png_size) {
+    return a->png_size > b->png_size ? -1 : 1;
+  }
+
+  return a->index < b->index ? -1 : (a->index > b->index ? 1 : 0);
+}
+
+static inline bool batch_claim_item(batch_parallel_ctx_t *ctx, size_t *out_index, uint32_t *out_threads) {
+  size_t remaining;
+  uint32_t idle, threads;
+
+  batch_lock(ctx);
+  if (ctx->next_item >= ctx->item_count) {
+    batch_unlock(ctx);
+    return false;
+  }
+
+  *out_index = ctx->order[ctx->next_item].index;
+  remaining = ctx->item_count - ctx->next_item;
+  ++ctx->next_item;
+
+  /* Spread threads that no queued job can use over the items that are left, so the tail of a batch still saturates the pool. */
+  idle = ctx->total_threads > ctx->threads_in_use ? ctx->total_threads - ctx->threads_in_use : 0;
+  threads = remaining < (size_t)idle ? (uint32_t)(idle / remaining) : 1;
+  ctx->threads_in_use += threads;
+  batch_unlock(ctx);
+
+  *out_threads = threads;
+
+  return true;
+}
+
+typedef struct {
+  cpres_encoder_t *encoder;
+  cpres_format_t format;
+  const cpres_config_t *config;
+  uint32_t threads;
+  cpres_effort_t effort; /* The encoder's effort_report, copied into each result */
+} batch_worker_encoder_t;
+
+static inline void batch_encode_item(batch_worker_encoder_t *worker, const cpres_batch_item_t *item, uint32_t threads, cpres_batch_result_t *result) {
+  cpres_config_t config;
+
+  result->error = CPRES_OK;
+  result->data = NULL;
+  result->size = 0;
+  memset(&result->effort, 0, sizeof(result->effort));
+
+  if (item->format != CPRES_FORMAT_WEBP && item->format != CPRES_FORMAT_AVIF && item->format != CPRES_FORMAT_PNGX) {
+    result->error = CPRES_ERROR_INVALID_FORMAT;
+    return;
+  }
+
+  /* Consecutive items sharing a format and config (the common case for a directory batch) keep the worker's encoder and its buffers. */
+  if (!worker->encoder || worker->format != item->format || worker->config != item->config || worker->threads != threads) {
+    cpres_encoder_destroy(worker->encoder);
+    worker->encoder = NULL;
+
+    if (item->config) {
+      config = *item->config;
+    } else {
+      cpres_config_init_defaults(&config);
+    }
+
+    config.webp_thread_level = threads > 1 ? 1 : 0;
+    config.avif_threads = (int)threads;
+    config.pngx_threads = (int)threads;
+    config.effort_report = &worker->effort;
+
+    result->error = cpres_encoder_create(item->format, &config, &worker->encoder);
+    if (result->error != CPRES_OK) {
+      return;
+    }
+
+    worker->format = item->format;
+    worker->config = item->config;
+    worker->threads = threads;
+  }
+
+  memset(&worker->effort, 0, sizeof(worker->effort));
+  result->error = cpres_encoder_encode(worker->encoder, item->png_data, item->png_size, &result->data, &result->size);
+  result->effort = worker->effort;
+
+  if (result->error != CPRES_OK && result->data) {
+    cpres_free(result->data);
+    result->data = NULL;
+  }
+}
+
+static void batch_parallel_worker(void *context, uint32_t start_index, uint32_t end_index) {
+  batch_parallel_ctx_t *ctx = (batch_parallel_ctx_t *)context;
+  batch_worker_encoder_t worker;
+  cpres_batch_result_t result;
+  size_t index;
+  uint32_t threads;
+
+  (void)start_index;
+  (void)end_index;
+
+  memset(&worker, 0, sizeof(worker));
+
+  while (batch_claim_item(ctx, &index, &threads)) {
+    batch_encode_item(&worker, &ctx->items[index], threads, &result);
+
+    batch_lock(ctx);
+    ctx->threads_in_use -= threads;
+    batch_unlock(ctx);
+
+    batch_deliver(ctx, index, &result);
+  }
+
+  cpres_encoder_destroy(worker.encoder);
+}
+
+extern cpres_error_t cpres_encode_batch(const cpres_batch_item_t *items, size_t item_count, uint32_t threads, cpres_batch_callback_t callback, void *callback_data) {
+  batch_parallel_ctx_t ctx;
+  batch_order_t *order;
+  uint32_t job_slots;
+  size_t i;
+
+  if (!callback || (!items && item_count > 0)) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (item_count == 0) {
+    return CPRES_OK;
+  }
+
+  order = (batch_order_t *)malloc(sizeof(batch_order_t) * item_count);
+  if (!order) {
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+
+  /* Largest inputs first, so a big straggler does not start last and stretch the batch. */
+  for (i = 0; i < item_count; ++i) {
+    order[i].png_size = items[i].png_size;
+    order[i].index = i;
+  }
+  qsort(order, item_count, sizeof(batch_order_t), batch_order_compare);
+
+  if (threads == 0) {
+    threads = cpres_get_default_thread_count();
+  }
+  if (threads > cpres_get_max_thread_count()) {
+    threads = cpres_get_max_thread_count();
+  }
+  if (threads == 0) {
+    threads = 1;
+  }
+
+  job_slots = item_count < (size_t)threads ? (uint32_t)item_count : threads;
+
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.items = items;
+  ctx.order = order;
+  ctx.item_count = item_count;
+  ctx.next_item = 0;
+  ctx.total_threads = threads;
+  ctx.threads_in_use = 0;
+  ctx.callback = callback;
+  ctx.callback_data = callback_data;
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "Batch: %zu items across %u threads (%u concurrent jobs)", item_count, threads, job_slots);
+
+#if COLOPRESSO_ENABLE_THREADS
+  if (colopresso_mutex_init(&ctx.mutex, NULL) != 0) {
+    free(order);
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+  if (colopresso_mutex_init(&ctx.callback_mutex, NULL) != 0) {
+    colopresso_mutex_destroy(&ctx.mutex);
+    free(order);
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+#endif
+
+  colopresso_parallel_for(job_slots, job_slots, batch_parallel_worker, &ctx);
+
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_destroy(&ctx.callback_mutex);
+  colopresso_mutex_destroy(&ctx.mutex);
+#endif
+  free(order);
+
+  return CPRES_OK;
+}
@@ -0,0 +1,690 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <colopresso.h>
+#include <colopresso/portable.h>
+
+#include "internal/log.h"
+#include "internal/sha256.h"
+
+#if COLOPRESSO_WITH_FILE_OPS
+
+#define CACHE_FORMAT_VERSION 1
+#define CACHE_KEY_HEX_LEN (COLOPRESSO_SHA256_DIGEST_SIZE * 2)
+#define CACHE_FILE_SUFFIX ".cpc"
+#define CACHE_NAME_SIZE (CACHE_KEY_HEX_LEN + sizeof(CACHE_FILE_SUFFIX))
+#define CACHE_HEADER_SIZE 60
+
+static const uint8_t kCacheMagic[4] = {'C', 'P', 'R', 'C'};
+
+typedef struct {
+  char name[CACHE_NAME_SIZE];
+  uint64_t size;
+  uint64_t last_used;
+} cache_entry_t;
+
+struct cpres_cache {
+  char *directory;
+  cache_entry_t *entries;
+  size_t count;
+  size_t capacity;
+  uint64_t total_bytes;
+  uint64_t clock;
+  uint32_t temp_counter;
+  cpres_cache_stats_t stats;
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_t mutex;
+#endif
+};
+
+typedef struct {
+  uint8_t key[COLOPRESSO_SHA256_DIGEST_SIZE];
+  char name[CACHE_NAME_SIZE];
+} cache_key_t;
+
+static inline void cache_lock(cpres_cache_t *cache) {
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_lock(&cache->mutex);
+#else
+  (void)cache;
+#endif
+}
+
+static inline void cache_unlock(cpres_cache_t *cache) {
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_unlock(&cache->mutex);
+#else
+  (void)cache;
+#endif
+}
+
+static inline void store_u32_le(uint8_t *out, uint32_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+  out[2] = (uint8_t)(value >> 16);
+  out[3] = (uint8_t)(value >> 24);
+}
+
+static inline void store_u64_le(uint8_t *out, uint64_t value) {
+  store_u32_le(out, (uint32_t)value);
+  store_u32_le(out + 4, (uint32_t)(value >> 32));
+}
+
+static inline uint32_t load_u32_le(const uint8_t *in) { return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24); }
+
+static inline uint64_t load_u64_le(const uint8_t *in) { return (uint64_t)load_u32_le(in) | ((uint64_t)load_u32_le(in + 4) << 32); }
+
+static inline void hash_u32(colopresso_sha256_t *sha, uint32_t value) {
+  uint8_t buf[4];
+
+  store_u32_le(buf, value);
+  colopresso_sha256_update(sha, buf, sizeof(buf));
+}
+
+static inline void hash_int(colopresso_sha256_t *sha, int value) { hash_u32(sha, (uint32_t)(int32_t)value); }
+
+static inline void hash_bool(colopresso_sha256_t *sha, bool value) {
+  uint8_t byte = value ? 1 : 0;
+
+  colopresso_sha256_update(sha, &byte, 1);
+}
+
+static inline void hash_float(colopresso_sha256_t *sha, float value) {
+  uint32_t bits;
+
+  /* Fold -0.0 into 0.0 so equal settings always hash alike. */
+  if (value == 0.0f) {
+    value = 0.0f;
+  }
+  memcpy(&bits, &value, sizeof(bits));
+  hash_u32(sha, bits);
+}
+
+static inline void hash_string(colopresso_sha256_t *sha, const char *value) {
+  size_t len = value ? strlen(value) : 0;
+
+  hash_u32(sha, (uint32_t)len);
+  if (len > 0) {
+    colopresso_sha256_update(sha, value, len);
+  }
+}
+
+/* Every field that can change the encoded bytes, in a fixed order with fixed widths. Thread counts, pngx_parallel_branches and memory_limited only change scheduling or peak memory, and the cancel token and progress callback never change a finished result, so they are left out. */
+static inline void hash_config(colopresso_sha256_t *sha, const cpres_config_t *config) {
+  int i, count;
+
+  hash_float(sha, config->webp_quality);
+  hash_bool(sha, config->webp_lossless);
+  hash_int(sha, config->webp_method);
+  hash_int(sha, config->webp_target_size);
+  hash_float(sha, config->webp_target_psnr);
+  hash_int(sha, config->webp_segments);
+  hash_int(sha, config->webp_sns_strength);
+  hash_int(sha, config->webp_filter_strength);
+  hash_int(sha, config->webp_filter_sharpness);
+  hash_int(sha, config->webp_filter_type);
+  hash_bool(sha, config->webp_autofilter);
+  hash_bool(sha, config->webp_alpha_compression);
+  hash_int(sha, config->webp_alpha_filtering);
+  hash_int(sha, config->webp_alpha_quality);
+  hash_int(sha, config->webp_pass);
+  hash_int(sha, config->webp_preprocessing);
+  hash_int(sha, config->webp_partitions);
+  hash_int(sha, config->webp_partition_limit);
+  hash_bool(sha, config->webp_emulate_jpeg_size);
+  hash_bool(sha, config->webp_low_memory);
+  hash_int(sha, config->webp_near_lossless);
+  hash_bool(sha, config->webp_exact);
+  hash_bool(sha, config->webp_use_delta_palette);
+  hash_bool(sha, config->webp_use_sharp_yuv);
+
+  hash_float(sha, config->avif_quality);
+  hash_int(sha, config->avif_alpha_quality);
+  hash_bool(sha, config->avif_lossless);
+  hash_int(sha, config->avif_speed);
+
+  hash_int(sha, config->pngx_level);
+  hash_bool(sha, config->pngx_strip_safe);
+  hash_bool(sha, config->pngx_optimize_alpha);
+  hash_bool(sha, config->pngx_lossy_enable);
+  hash_int(sha, config->pngx_lossy_type);
+  hash_int(sha, config->pngx_lossy_max_colors);
+  hash_int(sha, config->pngx_lossy_reduced_colors);
+  hash_int(sha, config->pngx_lossy_reduced_bits_rgb);
+  hash_int(sha, config->pngx_lossy_reduced_alpha_bits);
+  hash_int(sha, config->pngx_lossy_quality_min);
+  hash_int(sha, config->pngx_lossy_quality_max);
+  hash_int(sha, config->pngx_lossy_speed);
+  hash_float(sha, config->pngx_lossy_dither_level);
+  hash_bool(sha, config->pngx_saliency_map_enable);
+  hash_bool(sha, config->pngx_chroma_anchor_enable);
+  hash_bool(sha, config->pngx_adaptive_dither_enable);
+  hash_bool(sha, config->pngx_gradient_boost_enable);
+  hash_bool(sha, config->pngx_chroma_weight_enable);
+  hash_bool(sha, config->pngx_postprocess_smooth_enable);
+  hash_float(sha, config->pngx_postprocess_smooth_importance_cutoff);
+  hash_bool(sha, config->pngx_palette256_gradient_profile_enable);
+  hash_float(sha, config->pngx_palette256_gradient_dither_floor);
+  hash_bool(sha, config->pngx_palette256_alpha_bleed_enable);
+  hash_int(sha, config->pngx_palette256_alpha_bleed_max_distance);
+  hash_int(sha, config->pngx_palette256_alpha_bleed_opaque_threshold);
+  hash_int(sha, config->pngx_palette256_alpha_bleed_soft_limit);
+  hash_float(sha, config->pngx_palette256_profile_opaque_ratio_threshold);
+  hash_float(sha, config->pngx_palette256_profile_gradient_mean_max);
+  hash_float(sha, config->pngx_palette256_profile_saturation_mean_max);
+  hash_float(sha, config->pngx_palette256_tune_opaque_ratio_threshold);
+  hash_float(sha, config->pngx_palette256_tune_gradient_mean_max);
+  hash_float(sha, config->pngx_palette256_tune_saturation_mean_max);
+  hash_int(sha, config->pngx_palette256_tune_speed_max);
+  hash_int(sha, config->pngx_palette256_tune_quality_min_floor);
+  hash_int(sha, config->pngx_palette256_tune_quality_max_target);
+  hash_bool(sha, config->pngx_search_enable);
+  hash_bool(sha, config->pngx_tiled_dither_enable);
+
+  count = config->pngx_protected_colors ? config->pngx_protected_colors_count : 0;
+  if (count < 0) {
+    count = 0;
+  }
+  hash_int(sha, count);
+  for (i = 0; i < count; ++i) {
+    colopresso_sha256_update(sha, &config->pngx_protected_colors[i], sizeof(cpres_rgba_color_t));
+  }
+}
+
+/* A time-budgeted encode lowers its effort against the wall clock, so its result is a property of that run rather than of the input and settings. */
+static inline bool cache_bypassed(const cpres_config_t *config) { return config->time_budget_ms > 0; }
+
+static inline void compute_cache_key(cpres_format_t format, const uint8_t *png_data, size_t png_size, const cpres_config_t *config, cache_key_t *key) {
+  static const char kHexDigits[] = "0123456789abcdef";
+  colopresso_sha256_t sha;
+  size_t i;
+
+  colopresso_sha256_init(&sha);
+  hash_string(&sha, "colopresso-cache");
+  hash_u32(&sha, CACHE_FORMAT_VERSION);
+  hash_u32(&sha, cpres_get_version());
+  hash_u32(&sha, cpres_get_libwebp_version());
+  hash_u32(&sha, cpres_get_libavif_version());
+  hash_u32(&sha, cpres_get_libpng_version());
+  hash_u32(&sha, cpres_get_pngx_oxipng_version());
+  hash_u32(&sha, cpres_get_pngx_libimagequant_version());
+  hash_string(&sha, cpres_get_rust_version_string());
+  hash_u32(&sha, (uint32_t)format);
+  hash_config(&sha, config);
+  hash_u32(&sha, (uint32_t)png_size);
+  hash_u32(&sha, (uint32_t)((uint64_t)png_size >> 32));
+  colopresso_sha256_update(&sha, png_data, png_size);
+  colopresso_sha256_final(&sha, key->key);
+
+  for (i = 0; i < COLOPRESSO_SHA256_DIGEST_SIZE; ++i) {
+    key->name[i * 2] = kHexDigits[key->key[i] >> 4];
+    key->name[i * 2 + 1] = kHexDigits[key->key[i] & 0x0f];
+  }
+  memcpy(key->name + CACHE_KEY_HEX_LEN, CACHE_FILE_SUFFIX, sizeof(CACHE_FILE_SUFFIX));
+}
+
+static inline char *cache_entry_path(const cpres_cache_t *cache, const char *name) {
+  size_t len = strlen(cache->directory) + strlen(name) + 2;
+  char *path = (char *)malloc(len);
+
+  if (path) {
+    snprintf(path, len, "%s/%s", cache->directory, name);
+  }
+
+  return path;
+}
+
+static inline bool cache_find(const cpres_cache_t *cache, const char *name, size_t *out_index) {
+  size_t lo = 0, hi = cache->count, mid;
+  int cmp;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    cmp = strcmp(cache->entries[mid].name, name);
+    if (cmp == 0) {
+      *out_index = mid;
+      return true;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  *out_index = lo;
+
+  return false;
+}
+
+static inline bool cache_insert(cpres_cache_t *cache, const char *name, uint64_t size, uint64_t last_used) {
+  cache_entry_t *grown;
+  size_t index, capacity;
+
+  if (cache_find(cache, name, &index)) {
+    cache->total_bytes -= cache->entries[index].size;
+    cache->entries[index].size = size;
+    cache->entries[index].last_used = last_used;
+    cache->total_bytes += size;
+    return true;
+  }
+
+  if (cache->count == cache->capacity) {
+    capacity = cache->capacity > 0 ? cache->capacity * 2 : 256;
+    grown = (cache_entry_t *)realloc(cache->entries, sizeof(cache_entry_t) * capacity);
+    if (!grown) {
+      return false;
+    }
+    cache->entries = grown;
+    cache->capacity = capacity;
+  }
+
+  memmove(&cache->entries[index + 1], &cache->entries[index], sizeof(cache_entry_t) * (cache->count - index));
+  memcpy(cache->entries[index].name, name, CACHE_NAME_SIZE);
+  cache->entries[index].size = size;
+  cache->entries[index].last_used = last_used;
+  ++cache->count;
+  cache->total_bytes += size;
+
+  return true;
+}
+
+static inline void cache_remove_at(cpres_cache_t *cache, size_t index, bool delete_file) {
+  char *path;
+
+  if (delete_file) {
+    path = cache_entry_path(cache, cache->entries[index].name);
+    if (path) {
+      remove(path);
+      free(path);
+    }
+  }
+
+  cache->total_bytes -= cache->entries[index].size;
+  memmove(&cache->entries[index], &cache->entries[index + 1], sizeof(cache_entry_t) * (cache->count - index - 1));
+  --cache->count;
+}
+
+static inline uint64_t cache_tick(cpres_cache_t *cache) {
+  uint64_t now = (uint64_t)time(NULL);
+
+  cache->clock = now > cache->clock ? now : cache->clock + 1;
+
+  return cache->clock;
+}
+
+static inline void cache_evict(cpres_cache_t *cache) {
+  size_t i, oldest;
+
+  while (cache->total_bytes > cache->stats.max_bytes && cache->count > 0) {
+    oldest = 0;
+    for (i = 1; i < cache->count; ++i) {
+      if (cache->entries[i].last_used < cache->entries[oldest].last_used) {
+        oldest = i;
+      }
+    }
+    cache_remove_at(cache, oldest, true);
+    ++cache->stats.evictions;
+  }
+}
+
+static bool cache_scan_entry(const char *name, bool is_directory, void *user_data) {
+  cpres_cache_t *cache = (cpres_cache_t *)user_data;
+  struct stat st;
+  char *path;
+  size_t len = strlen(name);
+
+  if (is_directory || len != CACHE_NAME_SIZE - 1 || strcmp(name + CACHE_KEY_HEX_LEN, CACHE_FILE_SUFFIX) != 0) {
+    return true;
+  }
+
+  path = cache_entry_path(cache, name);
+  if (!path) {
+    return false;
+  }
+  if (stat(path, &st) == 0 && st.st_size > 0) {
+    if (!cache_insert(cache, name, (uint64_t)st.st_size, (uint64_t)st.st_mtime)) {
+      free(path);
+      return false;
+    }
+    if ((uint64_t)st.st_mtime > cache->clock) {
+      cache->clock = (uint64_t)st.st_mtime;
+    }
+  }
+  free(path);
+
+  return true;
+}
+
+static inline bool read_cache_file(const char *path, const cache_key_t *key, size_t png_size, cpres_error_t *result_out, uint8_t **data_out, size_t *size_out) {
+  uint8_t header[CACHE_HEADER_SIZE], *payload = NULL;
+  uint64_t input_size, output_size;
+  int32_t result;
+  FILE *fp;
+  bool valid;
+
+  fp = fopen(path, "rb");
+  if (!fp) {
+    return false;
+  }
+
+  valid = fread(header, 1, sizeof(header), fp) == sizeof(header) && memcmp(header, kCacheMagic, sizeof(kCacheMagic)) == 0 && load_u32_le(header + 4) == CACHE_FORMAT_VERSION &&
+          memcmp(header + 8, key->key, COLOPRESSO_SHA256_DIGEST_SIZE) == 0;
+  if (valid) {
+    input_size = load_u64_le(header + 40);
+    result = (int32_t)load_u32_le(header + 48);
+    output_size = load_u64_le(header + 52);
+    valid = input_size == (uint64_t)png_size && output_size <= (uint64_t)SIZE_MAX && (result == CPRES_OK || result == CPRES_ERROR_OUTPUT_NOT_SMALLER);
+  }
+  if (valid && result == CPRES_OK) {
+    payload = output_size > 0 ? (uint8_t *)malloc((size_t)output_size) : NULL;
+    valid = payload && fread(payload, 1, (size_t)output_size, fp) == (size_t)output_size;
+    if (!valid) {
+      free(payload);
+      payload = NULL;
+    }
+  }
+  fclose(fp);
+
+  if (!valid) {
+    return false;
+  }
+
+  *result_out = (cpres_error_t)result;
+  *data_out = payload;
+  *size_out = (size_t)output_size;
+
+  return true;
+}
+
+static inline bool write_cache_file(const char *path, const char *temp_path, const cache_key_t *key, size_t png_size, cpres_error_t result, const uint8_t *data, size_t size) {
+  uint8_t header[CACHE_HEADER_SIZE];
+  FILE *fp;
+  bool success;
+
+  memcpy(header, kCacheMagic, sizeof(kCacheMagic));
+  store_u32_le(header + 4, CACHE_FORMAT_VERSION);
+  memcpy(header + 8, key->key, COLOPRESSO_SHA256_DIGEST_SIZE);
+  store_u64_le(header + 40, (uint64_t)png_size);
+  store_u32_le(header + 48, (uint32_t)(int32_t)result);
+  store_u64_le(header + 52, (uint64_t)size);
+
+  fp = fopen(temp_path, "wb");
+  if (!fp) {
+    return false;
+  }
+
+  success = fwrite(header, 1, sizeof(header), fp) == sizeof(header);
+  if (success && result == CPRES_OK && size > 0) {
+    success = fwrite(data, 1, size, fp) == size;
+  }
+  success = fclose(fp) == 0 && success;
+
+  if (success && rename(temp_path, path) != 0) {
+    /* Windows refuses to rename over an existing file. */
+    remove(path);
+    success = rename(temp_path, path) == 0;
+  }
+  if (!success) {
+    remove(temp_path);
+  }
+
+  return success;
+}
+
+extern cpres_error_t cpres_cache_open(const char *directory, uint64_t max_bytes, cpres_cache_t **cache_out) {
+  cpres_cache_t *cache;
+  size_t len;
+
+  if (!directory || directory[0] == '\0' || !cache_out) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  *cache_out = NULL;
+
+  if (!colopresso_is_directory(directory) && !colopresso_make_directory(directory)) {
+    colopresso_log(CPRES_LOG_LEVEL_ERROR, "Cache: Failed to create directory '%s'", directory);
+    return CPRES_ERROR_IO;
+  }
+
+  cache = (cpres_cache_t *)calloc(1, sizeof(cpres_cache_t));
+  if (!cache) {
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+
+  len = strlen(directory);
+  while (len > 1 && (directory[len - 1] == '/' || directory[len - 1] == '\\')) {
+    --len;
+  }
+  cache->directory = (char *)malloc(len + 1);
+  if (!cache->directory) {
+    free(cache);
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+  memcpy(cache->directory, directory, len);
+  cache->directory[len] = '\0';
+  cache->stats.max_bytes = max_bytes > 0 ? max_bytes : COLOPRESSO_CACHE_DEFAULT_MAX_BYTES;
+
+#if COLOPRESSO_ENABLE_THREADS
+  if (colopresso_mutex_init(&cache->mutex, NULL) != 0) {
+    free(cache->directory);
+    free(cache);
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+#endif
+
+  if (!colopresso_read_directory(cache->directory, cache_scan_entry, cache)) {
+    colopresso_log(CPRES_LOG_LEVEL_ERROR, "Cache: Failed to scan '%s'", cache->directory);
+    cpres_cache_close(cache);
+    return CPRES_ERROR_IO;
+  }
+
+  cache_evict(cache);
+  cache->stats.evictions = 0;
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "Cache: Opened '%s' with %zu entries (%llu bytes)", cache->directory, cache->count, (unsigned long long)cache->total_bytes);
+
+  *cache_out = cache;
+
+  return CPRES_OK;
+}
+
+extern void cpres_cache_close(cpres_cache_t *cache) {
+  if (!cache) {
+    return;
+  }
+
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_destroy(&cache->mutex);
+#endif
+  free(cache->entries);
+  free(cache->directory);
+  free(cache);
+}
+
+extern bool cpres_cache_lookup(cpres_cache_t *cache, cpres_format_t format, const uint8_t *png_data, size_t png_size, const cpres_config_t *config, cpres_error_t *result_out, uint8_t **data_out,
+                               size_t *size_out) {
+  cache_key_t key;
+  cpres_error_t result = CPRES_OK;
+  uint8_t *data = NULL;
+  size_t size = 0, index;
+  char *path;
+  bool known, hit = false;
+
+  if (!cache || !png_data || png_size == 0 || !config || !result_out || !data_out || !size_out) {
+    return false;
+  }
+
+  *data_out = NULL;
+  *size_out = 0;
+
+  if (cache_bypassed(config)) {
+    return false;
+  }
+
+  compute_cache_key(format, png_data, png_size, config, &key);
+
+  cache_lock(cache);
+  known = cache_find(cache, key.name, &index);
+  cache_unlock(cache);
+
+  if (known) {
+    path = cache_entry_path(cache, key.name);
+    if (path) {
+      hit = read_cache_file(path, &key, png_size, &result, &data, &size);
+      if (hit) {
+        colopresso_touch_file(path);
+      }
+      free(path);
+    }
+  }
+
+  cache_lock(cache);
+  if (hit) {
+    ++cache->stats.hits;
+    if (cache_find(cache, key.name, &index)) {
+      cache->entries[index].last_used = cache_tick(cache);
+    }
+  } else {
+    ++cache->stats.misses;
+    if (known && cache_find(cache, key.name, &index)) {
+      cache_remove_at(cache, index, true);
+    }
+  }
+  cache_unlock(cache);
+
+  if (!hit) {
+    return false;
+  }
+
+  *result_out = result;
+  *data_out = data;
+  *size_out = size;
+
+  return true;
+}
+
+extern bool cpres_cache_store(cpres_cache_t *cache, cpres_format_t format, const uint8_t *png_data, size_t png_size, const cpres_config_t *config, cpres_error_t result, const uint8_t *data,
+                              size_t size) {
+  cache_key_t key;
+  char *path, *temp_path;
+  size_t temp_len;
+  uint32_t counter;
+  bool success;
+
+  if (!cache || !png_data || png_size == 0 || !config || cache_bypassed(config)) {
+    return false;
+  }
+  if (result != CPRES_OK && result != CPRES_ERROR_OUTPUT_NOT_SMALLER) {
+    return false;
+  }
+  if (result == CPRES_OK && (!data || size == 0)) {
+    return false;
+  }
+
+  compute_cache_key(format, png_data, png_size, config, &key);
+
+  path = cache_entry_path(cache, key.name);
+  if (!path) {
+    return false;
+  }
+
+  cache_lock(cache);
+  counter = ++cache->temp_counter;
+  cache_unlock(cache);
+
+  temp_len = strlen(path) + 32;
+  temp_path = (char *)malloc(temp_len);
+  if (!temp_path) {
+    free(path);
+    return false;
+  }
+  snprintf(temp_path, temp_len, "%s.%u.%u.tmp", path, (unsigned)colopresso_get_process_id(), (unsigned)counter);
+
+  success = write_cache_file(path, temp_path, &key, png_size, result, data, size);
+  free(temp_path);
+  free(path);
+
+  cache_lock(cache);
+  if (success) {
+    ++cache->stats.stores;
+    success = cache_insert(cache, key.name, (uint64_t)CACHE_HEADER_SIZE + (result == CPRES_OK ? (uint64_t)size : 0), cache_tick(cache));
+    cache_evict(cache);
+  }
+  cache_unlock(cache);
+
+  return success;
+}
+
+extern cpres_error_t cpres_cache_encode_memory(cpres_cache_t *cache, cpres_format_t format, const uint8_t *png_data, size_t png_size, uint8_t **out_data, size_t *out_size,
+                                               const cpres_config_t *config) {
+  cpres_error_t result;
+
+  if (!png_data || png_size == 0 || !out_data || !out_size || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  *out_data = NULL;
+  *out_size = 0;
+
+  if (cache && cpres_cache_lookup(cache, format, png_data, png_size, config, &result, out_data, out_size)) {
+    return result;
+  }
+
+  switch (format) {
+  case CPRES_FORMAT_WEBP:
+    result = cpres_encode_webp_memory(png_data, png_size, out_data, out_size, config);
+    break;
+  case CPRES_FORMAT_AVIF:
+    result = cpres_encode_avif_memory(png_data, png_size, out_data, out_size, config);
+    break;
+  case CPRES_FORMAT_PNGX:
+    result = cpres_encode_pngx_memory(png_data, png_size, out_data, out_size, config);
+    break;
+  default:
+    return CPRES_ERROR_INVALID_FORMAT;
+  }
+
+  if (cache) {
+    cpres_cache_store(cache, format, png_data, png_size, config, result, *out_data, *out_size);
+  }
+
+  return result;
+}
+
+extern void cpres_cache_get_stats(cpres_cache_t *cache, cpres_cache_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  if (!cache) {
+    return;
+  }
+
+  cache_lock(cache);
+  *stats = cache->stats;
+  stats->entries = (uint64_t)cache->count;
+  stats->bytes = cache->total_bytes;
+  cache_unlock(cache);
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <colopresso.h>
+#include <colopresso/portable.h>
+
+#include "internal/cancel.h"
+
+/* A single 32-bit word so the Rust bridge can read the same flag as an AtomicI32. */
+struct cpres_cancel_token {
+  volatile int32_t cancelled;
+};
+
+const int32_t *cancel_token_flag(const cpres_cancel_token_t *token) { return token ? (const int32_t *)&token->cancelled : NULL; }
+
+bool cancel_requested(const cpres_config_t *config) { return config && cpres_cancel_token_is_cancelled(config->cancel_token); }
+
+void cancel_report_progress(cpres_progress_callback_t callback, void *user_data, float progress) {
+  if (!callback) {
+    return;
+  }
+
+  if (progress < 0.0f) {
+    progress = 0.0f;
+  } else if (progress > 1.0f) {
+    progress = 1.0f;
+  }
+
+  callback(progress, user_data);
+}
+
+extern cpres_cancel_token_t *cpres_cancel_token_create(void) { return (cpres_cancel_token_t *)calloc(1, sizeof(cpres_cancel_token_t)); }
+
+extern void cpres_cancel_token_cancel(cpres_cancel_token_t *token) {
+  if (token) {
+    colopresso_atomic_store_i32(&token->cancelled, 1);
+  }
+}
+
+extern bool cpres_cancel_token_is_cancelled(const cpres_cancel_token_t *token) { return token && colopresso_atomic_load_i32(&token->cancelled) != 0; }
+
+extern void cpres_cancel_token_reset(cpres_cancel_token_t *token) {
+  if (token) {
+    colopresso_atomic_store_i32(&token->cancelled, 0);
+  }
+}
+
+extern void cpres_cancel_token_destroy(cpres_cancel_token_t *token) { free(token); }
@@ -9,7 +9,9 @@
  * Developed with AI (LLM) code assistance. See `NOTICE` for details.
  */
 
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,6 +19,7 @@
 #include <avif/avif.h>
 #include <png.h>
 #include <webp/encode.h>
+#include <zlib.h>
 
 #include <colopresso.h>
 #include <colopresso/portable.h>
@@ -25,7 +28,10 @@
 #include "internal/png.h"
 
 #include "internal/avif.h"
+#include "internal/cancel.h"
+#include "internal/effort.h"
 #include "internal/pngx.h"
+#include "internal/pngx_common.h"
 #include "internal/webp.h"
 
 extern void cpres_config_init_defaults(cpres_config_t *config) {
@@ -103,9 +109,22 @@ extern void cpres_config_init_defaults(cpres_config_t *config) {
   config->pngx_palette256_tune_quality_min_floor = COLOPRESSO_PNGX_DEFAULT_PALETTE256_TUNE_QUALITY_MIN_FLOOR;
   config->pngx_palette256_tune_quality_max_target = COLOPRESSO_PNGX_DEFAULT_PALETTE256_TUNE_QUALITY_MAX_TARGET;
   config->pngx_threads = COLOPRESSO_PNGX_DEFAULT_THREADS;
+  config->pngx_parallel_branches = COLOPRESSO_PNGX_DEFAULT_PARALLEL_BRANCHES;
+  config->pngx_search_enable = COLOPRESSO_PNGX_DEFAULT_SEARCH_ENABLE;
+  config->pngx_tiled_dither_enable = COLOPRESSO_PNGX_DEFAULT_TILED_DITHER_ENABLE;
+
+  config->memory_limited = COLOPRESSO_DEFAULT_MEMORY_LIMITED;
+  config->time_budget_ms = COLOPRESSO_DEFAULT_TIME_BUDGET_MS;
+  config->effort_report = NULL;
+  config->cancel_token = NULL;
+  config->progress_callback = NULL;
+  config->progress_user_data = NULL;
 }
 
 extern cpres_error_t cpres_encode_webp_memory(const uint8_t *png_data, size_t png_size, uint8_t **webp_data, size_t *webp_size, const cpres_config_t *config) {
+  WebPConfig webp_config;
+  cpres_config_t scaled_config;
+  png_row_input_t input;
   uint32_t width, height;
   cpres_error_t error;
   uint8_t *rgba_data;
@@ -126,17 +145,29 @@ extern cpres_error_t cpres_encode_webp_memory(const uint8_t *png_data, size_t pn
   *webp_data = NULL;
   *webp_size = 0;
   encoded_size = 0;
-
   rgba_data = NULL;
-  error = png_decode_from_memory(png_data, png_size, &rgba_data, &width, &height);
-  if (error != CPRES_OK) {
-    colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG decode from memory failed: %s", cpres_error_string(error));
-    return error;
-  }
 
-  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNG decoded from memory - %dx%d pixels", width, height);
+  input.png_data = png_data;
+  input.png_size = png_size;
+  input.path = NULL;
+  config = effort_apply_png(CPRES_FORMAT_WEBP, &input, config, &scaled_config);
+
+  if (config->memory_limited) {
+    if (!webp_prepare_config(&webp_config, config)) {
+      return CPRES_ERROR_INVALID_PARAMETER;
+    }
+    error = webp_encode_png_rows_to_memory(&input, webp_data, &encoded_size, &webp_config, config);
+  } else {
+    error = png_decode_from_memory(png_data, png_size, &rgba_data, &width, &height);
+    if (error != CPRES_OK) {
+      colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG decode from memory failed: %s", cpres_error_string(error));
+      return error;
+    }
+
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNG decoded from memory - %dx%d pixels", width, height);
 
-  error = webp_encode_rgba_to_memory(rgba_data, width, height, webp_data, &encoded_size, config);
+    error = webp_encode_rgba_to_memory(rgba_data, width, height, webp_data, &encoded_size, config);
+  }
   if (error == CPRES_OK) {
     if (*webp_data && encoded_size >= png_size) {
       colopresso_log(CPRES_LOG_LEVEL_WARNING, "WebP: Encoded output larger than input (%zu > %zu)", encoded_size, png_size);
@@ -153,6 +184,8 @@ extern cpres_error_t cpres_encode_webp_memory(const uint8_t *png_data, size_t pn
 }
 
 extern cpres_error_t cpres_encode_avif_memory(const uint8_t *png_data, size_t png_size, uint8_t **avif_data, size_t *avif_size, const cpres_config_t *config) {
+  cpres_config_t scaled_config;
+  png_row_input_t input;
   uint32_t width, height;
   uint8_t *rgba_data;
   size_t encoded_size;
@@ -172,17 +205,26 @@ extern cpres_error_t cpres_encode_avif_memory(const uint8_t *png_data, size_t pn
   *avif_data = NULL;
   *avif_size = 0;
   encoded_size = 0;
-
   rgba_data = NULL;
-  error = png_decode_from_memory(png_data, png_size, &rgba_data, &width, &height);
-  if (error != CPRES_OK) {
-    colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG decode (AVIF) from memory failed: %s", cpres_error_string(error));
-    return error;
-  }
 
-  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNG decoded (AVIF) from memory - %dx%d pixels", width, height);
+  input.png_data = png_data;
+  input.png_size = png_size;
+  input.path = NULL;
+  config = effort_apply_png(CPRES_FORMAT_AVIF, &input, config, &scaled_config);
+
+  if (config->memory_limited) {
+    error = avif_encode_png_rows_to_memory(&input, avif_data, &encoded_size, config);
+  } else {
+    error = png_decode_from_memory(png_data, png_size, &rgba_data, &width, &height);
+    if (error != CPRES_OK) {
+      colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG decode (AVIF) from memory failed: %s", cpres_error_string(error));
+      return error;
+    }
 
-  error = avif_encode_rgba_to_memory(rgba_data, width, height, avif_data, &encoded_size, config);
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNG decoded (AVIF) from memory - %dx%d pixels", width, height);
+
+    error = avif_encode_rgba_to_memory(rgba_data, width, height, avif_data, &encoded_size, config);
+  }
   if (error == CPRES_OK) {
     if (*avif_data && encoded_size >= png_size) {
       colopresso_log(CPRES_LOG_LEVEL_WARNING, "AVIF: Encoded output larger than input (%zu > %zu)", encoded_size, png_size);
@@ -197,107 +239,119 @@ extern cpres_error_t cpres_encode_avif_memory(const uint8_t *png_data, size_t pn
   return error;
 }
 
-extern cpres_error_t cpres_encode_pngx_memory(const uint8_t *png_data, size_t png_size, uint8_t **optimized_data, size_t *optimized_size, const cpres_config_t *config) {
-  pngx_options_t opts;
-  uint8_t *lossless_data, *quant_data, *quant_optimized, *final_data;
-  size_t lossless_size, quant_size, quant_optimized_size, final_size, candidate_size;
-  bool lossless_ok, quant_ok, quant_lossless_ok, quant_is_rgba_lossy, final_is_quantized;
-  int quant_quality, threads;
-
-  if (!png_data || png_size == 0 || !optimized_data || !optimized_size || !config) {
-    return CPRES_ERROR_INVALID_PARAMETER;
-  }
-
-  if (png_size > COLOPRESSO_PNG_MAX_MEMORY_INPUT_SIZE) {
-    return CPRES_ERROR_INVALID_PARAMETER;
-  }
+static cpres_error_t pngx_encode_source_with_options(const pngx_source_t *source, pngx_rgba_image_t *decoded_image, bool require_smaller, uint8_t **optimized_data, size_t *optimized_size,
+                                                     const pngx_options_t *opts) {
+  pngx_rgba_image_t source_image;
+  pngx_branch_result_t branches;
+  pngx_options_t timed_opts;
+  const uint8_t *png_data;
+  uint8_t *lossless_data, *quant_data, *final_data;
+  size_t png_size, lossless_size, quant_size, final_size;
+  bool source_loaded, quant_ok, quant_is_rgba_lossy, final_is_quantized;
 
   *optimized_data = NULL;
   *optimized_size = 0;
 
-  lossless_data = NULL;
-  lossless_size = 0;
-  quant_data = NULL;
-  quant_size = 0;
-  quant_optimized = NULL;
-  quant_optimized_size = 0;
+  memset(&source_image, 0, sizeof(source_image));
   final_data = NULL;
   final_size = 0;
-  candidate_size = 0;
-  lossless_ok = false;
-  quant_ok = false;
-  quant_lossless_ok = false;
-  quant_is_rgba_lossy = false;
+  source_loaded = false;
   final_is_quantized = false;
-  quant_quality = -1;
-  threads = 0;
+  png_data = source->png_data;
+  png_size = source->rgba ? (size_t)source->stride * source->height : source->png_size;
 
   colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Starting optimization - input size: %zu bytes", png_size);
 
-  pngx_fill_pngx_options(&opts, config);
+  if (pngx_cancelled(opts)) {
+    return CPRES_ERROR_CANCELLED;
+  }
 
-  threads = config ? config->pngx_threads : 0;
-#if !defined(PNGX_BRIDGE_WASM_SEPARATION)
-  if (threads >= 0) {
-    pngx_bridge_init_threads(threads);
+  /* The clock starts here so the branches can re-plan their oxipng level against what decoding and quantization really took. */
+  if (opts->time_budget_ms > 0) {
+    timed_opts = *opts;
+    timed_opts.deadline = colopresso_get_monotonic_seconds() + (double)opts->time_budget_ms / 1000.0;
+    opts = &timed_opts;
+  }
+  cancel_report_progress(opts->progress_callback, opts->progress_user_data, 0.0f);
+
+  /* A search result competes with the lossless one like any palette; only an explicitly requested RGBA lossy type is forced. */
+  quant_is_rgba_lossy = !opts->search_enable && (opts->lossy_type == PNGX_LOSSY_TYPE_LIMITED_RGBA4444 || opts->lossy_type == PNGX_LOSSY_TYPE_REDUCED_RGBA32);
+
+  if (decoded_image && decoded_image->rgba) {
+    source_image = *decoded_image;
+    decoded_image->rgba = NULL;
+    source_loaded = true;
+  } else if (pngx_should_attempt_quantization(opts)) {
+    source_loaded = load_rgba_image_scratch(png_data, png_size, opts->scratch, &source_image);
+    if (source_loaded) {
+      colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Decoded %ux%u source (color_type=%u, bit_depth=%u)", source_image.width, source_image.height, source_image.source_color_type,
+                     source_image.source_bit_depth);
+    }
   }
-#else
-  (void)threads;
-#endif
 
-  quant_is_rgba_lossy = (opts.lossy_type == PNGX_LOSSY_TYPE_LIMITED_RGBA4444 || opts.lossy_type == PNGX_LOSSY_TYPE_REDUCED_RGBA32);
+  pngx_run_branches(source, opts, source_loaded ? &source_image : NULL, &branches);
+  rgba_image_reset(&source_image);
 
-  quant_ok = pngx_should_attempt_quantization(&opts) && pngx_run_quantization(png_data, png_size, &opts, &quant_data, &quant_size, &quant_quality);
-  if (quant_ok) {
-    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Quantization produced %zu bytes (quality=%d)", quant_size, quant_quality);
+  if (opts->effort_report && (int)branches.optimization_level < opts->effort_report->pngx_level) {
+    opts->effort_report->pngx_level = branches.optimization_level;
+    opts->effort_report->scaled = true;
   }
 
-  lossless_ok = pngx_run_lossless_optimization(png_data, png_size, &opts, &lossless_data, &lossless_size);
-  if (!lossless_ok) {
-    lossless_data = (uint8_t *)malloc(png_size);
-    if (!lossless_data) {
-      free(quant_data);
-      return CPRES_ERROR_OUT_OF_MEMORY;
-    }
-    memcpy(lossless_data, png_data, png_size);
-    lossless_size = png_size;
+  if (pngx_cancelled(opts)) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Optimization cancelled");
+    free(branches.lossless_data);
+    free(branches.quant_data);
+    return CPRES_ERROR_CANCELLED;
   }
-  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Lossless optimization produced %zu bytes", lossless_size);
 
-  final_data = lossless_data;
-  final_size = lossless_size;
-  final_is_quantized = false;
+  if (branches.quant_out_of_memory) {
+    free(branches.lossless_data);
+    free(branches.quant_data);
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
 
-  if (quant_ok) {
-    if (!quant_is_rgba_lossy) {
-      quant_lossless_ok = pngx_run_lossless_optimization(quant_data, quant_size, &opts, &quant_optimized, &quant_optimized_size);
-      if (quant_lossless_ok) {
-        colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Lossless optimization on quantized data produced %zu bytes", quant_optimized_size);
+  quant_ok = branches.quant_ok;
+  quant_data = branches.quant_data;
+  quant_size = branches.quant_size;
+  lossless_data = branches.lossless_data;
+  lossless_size = branches.lossless_size;
+
+  if (!branches.lossless_ok && !branches.lossless_skipped) {
+    free(lossless_data);
+    lossless_data = NULL;
+    lossless_size = 0;
+    if (source->rgba) {
+      /* Without oxipng a raw frame has no PNG to fall back on, so libpng writes the output itself. */
+      if (!create_rgba_png_strided(source->rgba, source->stride, source->width, source->height, Z_BEST_COMPRESSION, &lossless_data, &lossless_size)) {
         free(quant_data);
-        quant_data = NULL;
-      } else {
-        quant_optimized = quant_data;
-        quant_optimized_size = quant_size;
-        quant_data = NULL;
+        return CPRES_ERROR_ENCODE_FAILED;
       }
     } else {
-      quant_optimized = quant_data;
-      quant_optimized_size = quant_size;
-      quant_data = NULL;
+      lossless_data = (uint8_t *)malloc(png_size);
+      if (!lossless_data) {
+        free(quant_data);
+        return CPRES_ERROR_OUT_OF_MEMORY;
+      }
+      memcpy(lossless_data, png_data, png_size);
+      lossless_size = png_size;
     }
   }
+  if (lossless_data) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Lossless optimization produced %zu bytes", lossless_size);
+  }
+
+  final_data = lossless_data;
+  final_size = lossless_size;
 
   if (quant_ok) {
-    candidate_size = quant_optimized_size;
-    if (quant_is_rgba_lossy || pngx_quantization_better(lossless_size, candidate_size)) {
-      final_data = quant_optimized;
-      final_size = candidate_size;
+    if (quant_is_rgba_lossy || pngx_quantization_better(lossless_size, quant_size)) {
+      final_data = quant_data;
+      final_size = quant_size;
       final_is_quantized = true;
       free(lossless_data);
       colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Selected quantized result (%zu bytes)", final_size);
     } else {
-      free(quant_optimized);
-      quant_optimized = NULL;
+      free(quant_data);
       colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Selected lossless result (%zu bytes)", final_size);
     }
   }
@@ -306,7 +360,7 @@ extern cpres_error_t cpres_encode_pngx_memory(const uint8_t *png_data, size_t pn
     return CPRES_ERROR_ENCODE_FAILED;
   }
 
-  if (final_size >= png_size) {
+  if (require_smaller && final_size >= png_size) {
     if (!(quant_is_rgba_lossy && final_is_quantized)) {
       colopresso_log(CPRES_LOG_LEVEL_WARNING, "PNGX: Optimized output larger than input (%zu > %zu)", final_size, png_size);
       free(final_data);
@@ -320,10 +374,470 @@ extern cpres_error_t cpres_encode_pngx_memory(const uint8_t *png_data, size_t pn
 
   *optimized_data = final_data;
   *optimized_size = final_size;
+  cancel_report_progress(opts->progress_callback, opts->progress_user_data, 1.0f);
+
+  return CPRES_OK;
+}
+
+static inline cpres_error_t pngx_encode_memory_with_options(const uint8_t *png_data, size_t png_size, pngx_rgba_image_t *decoded_image, bool require_smaller, uint8_t **optimized_data,
+                                                            size_t *optimized_size, const pngx_options_t *opts) {
+  pngx_source_t source;
+
+  memset(&source, 0, sizeof(source));
+  source.png_data = png_data;
+  source.png_size = png_size;
+
+  return pngx_encode_source_with_options(&source, decoded_image, require_smaller, optimized_data, optimized_size, opts);
+}
+
+extern cpres_error_t cpres_encode_pngx_memory(const uint8_t *png_data, size_t png_size, uint8_t **optimized_data, size_t *optimized_size, const cpres_config_t *config) {
+  cpres_config_t scaled_config;
+  png_row_input_t input;
+  pngx_options_t opts;
+
+  if (!png_data || png_size == 0 || !optimized_data || !optimized_size || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (png_size > COLOPRESSO_PNG_MAX_MEMORY_INPUT_SIZE) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  input.png_data = png_data;
+  input.png_size = png_size;
+  input.path = NULL;
+  config = effort_apply_png(CPRES_FORMAT_PNGX, &input, config, &scaled_config);
+
+  pngx_fill_pngx_options(&opts, config);
+
+  return pngx_encode_memory_with_options(png_data, png_size, NULL, true, optimized_data, optimized_size, &opts);
+}
+
+static inline cpres_error_t validate_rgba_input(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t *stride, uint8_t **out_data, size_t *out_size, const cpres_config_t *config) {
+  if (!rgba_data || !out_data || !out_size || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  /* Same bounds the PNG decoder enforces, which also keeps width * 4 within uint32_t. */
+  if (width == 0 || height == 0 || width > 65536 || height > 65536) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (*stride == 0) {
+    *stride = width * 4;
+  }
+  if (*stride < width * 4) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  /* libwebp takes the stride as an int, and the whole frame has to be addressable (wasm32 has a 32-bit size_t). */
+  if (*stride > (uint32_t)INT_MAX || (uint64_t)*stride * (uint64_t)height > (uint64_t)SIZE_MAX) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  *out_data = NULL;
+  *out_size = 0;
+
+  return CPRES_OK;
+}
+
+extern cpres_error_t cpres_encode_webp_rgba(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **webp_data, size_t *webp_size, const cpres_config_t *config) {
+  WebPConfig webp_config;
+  cpres_config_t scaled_config;
+  cpres_error_t error;
+
+  error = validate_rgba_input(rgba_data, width, height, &stride, webp_data, webp_size, config);
+  if (error != CPRES_OK) {
+    return error;
+  }
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "WebP: Encoding %ux%u RGBA frame (stride %u)", width, height, stride);
+
+  config = effort_apply(CPRES_FORMAT_WEBP, width, height, config, &scaled_config);
+
+  if (!webp_prepare_config(&webp_config, config)) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  return webp_encode_rgba_with_config(rgba_data, width, height, stride, webp_data, webp_size, &webp_config, config);
+}
+
+extern cpres_error_t cpres_encode_avif_rgba(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **avif_data, size_t *avif_size, const cpres_config_t *config) {
+  cpres_config_t scaled_config;
+  cpres_error_t error;
+
+  error = validate_rgba_input(rgba_data, width, height, &stride, avif_data, avif_size, config);
+  if (error != CPRES_OK) {
+    return error;
+  }
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "AVIF: Encoding %ux%u RGBA frame (stride %u)", width, height, stride);
+
+  config = effort_apply(CPRES_FORMAT_AVIF, width, height, config, &scaled_config);
+
+  return avif_encode_rgba_strided_to_memory(rgba_data, width, height, stride, avif_data, avif_size, config);
+}
+
+extern cpres_error_t cpres_encode_pngx_rgba(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **optimized_data, size_t *optimized_size,
+                                            const cpres_config_t *config) {
+  cpres_config_t scaled_config;
+  pngx_options_t opts;
+  pngx_source_t source;
+  pngx_rgba_image_t image;
+  size_t row_bytes;
+  uint32_t y;
+  cpres_error_t error;
+
+  error = validate_rgba_input(rgba_data, width, height, &stride, optimized_data, optimized_size, config);
+  if (error != CPRES_OK) {
+    return error;
+  }
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Encoding %ux%u RGBA frame (stride %u)", width, height, stride);
+
+  config = effort_apply(CPRES_FORMAT_PNGX, width, height, config, &scaled_config);
+  pngx_fill_pngx_options(&opts, config);
+
+  /* The lossless branch hands the frame to oxipng as a raw image, so no intermediate PNG is written and decoded again. */
+  memset(&source, 0, sizeof(source));
+  source.rgba = rgba_data;
+  source.width = width;
+  source.height = height;
+  source.stride = stride;
+
+  /* The quantizers take ownership of their image and modify it, so they get a packed copy rather than the caller's frame. */
+  memset(&image, 0, sizeof(image));
+  if (pngx_should_attempt_quantization(&opts)) {
+    row_bytes = (size_t)width * 4;
+    image.rgba = (uint8_t *)malloc(row_bytes * (size_t)height);
+    if (!image.rgba) {
+      return CPRES_ERROR_OUT_OF_MEMORY;
+    }
+    for (y = 0; y < height; ++y) {
+      memcpy(image.rgba + (size_t)y * row_bytes, rgba_data + (size_t)y * stride, row_bytes);
+    }
+    image.width = width;
+    image.height = height;
+    image.pixel_count = (size_t)width * (size_t)height;
+    image.source_bit_depth = 8;
+    image.source_color_type = PNG_COLOR_TYPE_RGB_ALPHA;
+    image.source_has_trns = false;
+  }
+
+  error = pngx_encode_source_with_options(&source, &image, false, optimized_data, optimized_size, &opts);
+
+  rgba_image_reset(&image);
+
+  return error;
+}
+
+extern cpres_error_t cpres_encode_webp_to_writer(const uint8_t *png_data, size_t png_size, cpres_write_callback_t write, void *user_data, size_t *written_size, const cpres_config_t *config) {
+  WebPConfig webp_config;
+  cpres_config_t scaled_config;
+  png_row_input_t input;
+  uint32_t width, height;
+  uint8_t *rgba_data;
+  cpres_error_t error;
+
+  if (!png_data || png_size == 0 || !write || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (png_size > COLOPRESSO_PNG_MAX_MEMORY_INPUT_SIZE) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (written_size) {
+    *written_size = 0;
+  }
+
+  input.png_data = png_data;
+  input.png_size = png_size;
+  input.path = NULL;
+  config = effort_apply_png(CPRES_FORMAT_WEBP, &input, config, &scaled_config);
+
+  if (!webp_prepare_config(&webp_config, config)) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (config->memory_limited) {
+    return webp_encode_png_rows_to_writer(&input, write, user_data, written_size, &webp_config, config);
+  }
+
+  rgba_data = NULL;
+  error = png_decode_from_memory(png_data, png_size, &rgba_data, &width, &height);
+  if (error != CPRES_OK) {
+    colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG decode from memory failed: %s", cpres_error_string(error));
+    return error;
+  }
+
+  error = webp_encode_rgba_to_writer(rgba_data, width, height, width * 4, write, user_data, written_size, &webp_config, config);
+  free(rgba_data);
+
+  return error;
+}
+
+extern cpres_error_t cpres_encode_avif_to_writer(const uint8_t *png_data, size_t png_size, cpres_write_callback_t write, void *user_data, size_t *written_size, const cpres_config_t *config) {
+  cpres_config_t scaled_config;
+  png_row_input_t input;
+  uint32_t width, height;
+  uint8_t *rgba_data;
+  cpres_error_t error;
+
+  if (!png_data || png_size == 0 || !write || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (png_size > COLOPRESSO_PNG_MAX_MEMORY_INPUT_SIZE) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (written_size) {
+    *written_size = 0;
+  }
+
+  input.png_data = png_data;
+  input.png_size = png_size;
+  input.path = NULL;
+  config = effort_apply_png(CPRES_FORMAT_AVIF, &input, config, &scaled_config);
+
+  if (config->memory_limited) {
+    return avif_encode_png_rows_to_writer(&input, write, user_data, written_size, config);
+  }
+
+  rgba_data = NULL;
+  error = png_decode_from_memory(png_data, png_size, &rgba_data, &width, &height);
+  if (error != CPRES_OK) {
+    colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG decode (AVIF) from memory failed: %s", cpres_error_string(error));
+    return error;
+  }
+
+  error = avif_encode_rgba_to_writer(rgba_data, width, height, width * 4, write, user_data, written_size, config);
+  free(rgba_data);
+
+  return error;
+}
+
+extern cpres_error_t cpres_encode_pngx_to_writer(const uint8_t *png_data, size_t png_size, cpres_write_callback_t write, void *user_data, size_t *written_size, const cpres_config_t *config) {
+  cpres_config_t scaled_config;
+  png_row_input_t input;
+  pngx_options_t opts;
+  uint8_t *optimized_data;
+  size_t optimized_size;
+  cpres_error_t error;
+
+  if (!png_data || png_size == 0 || !write || !config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (png_size > COLOPRESSO_PNG_MAX_MEMORY_INPUT_SIZE) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (written_size) {
+    *written_size = 0;
+  }
+
+  input.png_data = png_data;
+  input.png_size = png_size;
+  input.path = NULL;
+  config = effort_apply_png(CPRES_FORMAT_PNGX, &input, config, &scaled_config);
+  pngx_fill_pngx_options(&opts, config);
+
+  optimized_data = NULL;
+  optimized_size = 0;
+  error = pngx_encode_memory_with_options(png_data, png_size, NULL, false, &optimized_data, &optimized_size, &opts);
+  if (error != CPRES_OK) {
+    return error;
+  }
+
+  if (!write(optimized_data, optimized_size, user_data)) {
+    free(optimized_data);
+    return CPRES_ERROR_IO;
+  }
+
+  if (written_size) {
+    *written_size = optimized_size;
+  }
+  free(optimized_data);
 
   return CPRES_OK;
 }
 
+struct cpres_encoder {
+  cpres_format_t format;
+  cpres_config_t config;
+  cpres_rgba_color_t *protected_colors;
+  WebPConfig webp_config;
+  pngx_options_t pngx_opts;
+  pngx_scratch_t *pngx_scratch;
+  uint8_t *rgba_buffer;
+  size_t rgba_capacity;
+};
+
+extern cpres_error_t cpres_encoder_create(cpres_format_t format, const cpres_config_t *config, cpres_encoder_t **encoder_out) {
+  cpres_encoder_t *encoder;
+  size_t colors_size;
+
+  if (!encoder_out) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  *encoder_out = NULL;
+
+  if (format != CPRES_FORMAT_WEBP && format != CPRES_FORMAT_AVIF && format != CPRES_FORMAT_PNGX) {
+    return CPRES_ERROR_INVALID_FORMAT;
+  }
+
+  encoder = (cpres_encoder_t *)calloc(1, sizeof(cpres_encoder_t));
+  if (!encoder) {
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+
+  encoder->format = format;
+  if (config) {
+    encoder->config = *config;
+  } else {
+    cpres_config_init_defaults(&encoder->config);
+  }
+
+  /* The encoder outlives the caller's config, so it keeps its own copy of the protected colors. */
+  if (encoder->config.pngx_protected_colors && encoder->config.pngx_protected_colors_count > 0) {
+    colors_size = sizeof(cpres_rgba_color_t) * (size_t)encoder->config.pngx_protected_colors_count;
+    encoder->protected_colors = (cpres_rgba_color_t *)malloc(colors_size);
+    if (!encoder->protected_colors) {
+      free(encoder);
+      return CPRES_ERROR_OUT_OF_MEMORY;
+    }
+    memcpy(encoder->protected_colors, encoder->config.pngx_protected_colors, colors_size);
+    encoder->config.pngx_protected_colors = encoder->protected_colors;
+  } else {
+    encoder->config.pngx_protected_colors = NULL;
+    encoder->config.pngx_protected_colors_count = 0;
+  }
+
+  switch (format) {
+  case CPRES_FORMAT_WEBP:
+    if (!webp_prepare_config(&encoder->webp_config, &encoder->config)) {
+      cpres_encoder_destroy(encoder);
+      return CPRES_ERROR_INVALID_PARAMETER;
+    }
+    break;
+  case CPRES_FORMAT_PNGX:
+    pngx_fill_pngx_options(&encoder->pngx_opts, &encoder->config);
+    encoder->pngx_scratch = pngx_scratch_create();
+    if (!encoder->pngx_scratch) {
+      cpres_encoder_destroy(encoder);
+      return CPRES_ERROR_OUT_OF_MEMORY;
+    }
+    encoder->pngx_opts.scratch = encoder->pngx_scratch;
+    break;
+  default:
+    break;
+  }
+
+  *encoder_out = encoder;
+
+  return CPRES_OK;
+}
+
+extern cpres_error_t cpres_encoder_encode(cpres_encoder_t *encoder, const uint8_t *png_data, size_t png_size, uint8_t **out_data, size_t *out_size) {
+  const cpres_config_t *config;
+  cpres_config_t scaled_config;
+  WebPConfig scaled_webp_config;
+  const WebPConfig *webp_config;
+  pngx_options_t scaled_pngx_opts;
+  const pngx_options_t *pngx_opts;
+  png_row_input_t input;
+  uint32_t width, height;
+  size_t encoded_size = 0;
+  cpres_error_t error;
+  const char *label;
+
+  if (!encoder || !png_data || png_size == 0 || !out_data || !out_size) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (png_size > COLOPRESSO_PNG_MAX_MEMORY_INPUT_SIZE) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  input.png_data = png_data;
+  input.png_size = png_size;
+  input.path = NULL;
+
+  /* The prepared options only hold while the budget leaves the configured effort alone; a scaled image gets its own copy for this call. */
+  config = effort_apply_png(encoder->format, &input, &encoder->config, &scaled_config);
+  webp_config = &encoder->webp_config;
+  pngx_opts = &encoder->pngx_opts;
+  if (config != &encoder->config) {
+    if (encoder->format == CPRES_FORMAT_WEBP) {
+      if (!webp_prepare_config(&scaled_webp_config, config)) {
+        return CPRES_ERROR_INVALID_PARAMETER;
+      }
+      webp_config = &scaled_webp_config;
+    } else if (encoder->format == CPRES_FORMAT_PNGX) {
+      pngx_fill_pngx_options(&scaled_pngx_opts, config);
+      scaled_pngx_opts.scratch = encoder->pngx_scratch;
+      pngx_opts = &scaled_pngx_opts;
+    }
+  }
+
+  if (encoder->format == CPRES_FORMAT_PNGX) {
+    pngx_scratch_begin(encoder->pngx_scratch);
+    error = pngx_encode_memory_with_options(png_data, png_size, NULL, true, out_data, out_size, pngx_opts);
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Encoder scratch made %u new allocation(s)", pngx_scratch_allocations(encoder->pngx_scratch));
+    return error;
+  }
+
+  *out_data = NULL;
+  *out_size = 0;
+  label = encoder->format == CPRES_FORMAT_WEBP ? "WebP" : "AVIF";
+
+  if (config->memory_limited) {
+    if (encoder->format == CPRES_FORMAT_WEBP) {
+      error = webp_encode_png_rows_to_memory(&input, out_data, &encoded_size, webp_config, config);
+    } else {
+      error = avif_encode_png_rows_to_memory(&input, out_data, &encoded_size, config);
+    }
+  } else {
+    error = png_decode_from_memory_reuse(png_data, png_size, &encoder->rgba_buffer, &encoder->rgba_capacity, &width, &height, NULL);
+    if (error != CPRES_OK) {
+      colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG decode from memory failed: %s", cpres_error_string(error));
+      return error;
+    }
+
+    if (encoder->format == CPRES_FORMAT_WEBP) {
+      error = webp_encode_rgba_with_config(encoder->rgba_buffer, width, height, width * 4, out_data, &encoded_size, webp_config, config);
+    } else {
+      error = avif_encode_rgba_to_memory(encoder->rgba_buffer, width, height, out_data, &encoded_size, config);
+    }
+  }
+
+  if (error == CPRES_OK) {
+    if (*out_data && encoded_size >= png_size) {
+      colopresso_log(CPRES_LOG_LEVEL_WARNING, "%s: Encoded output larger than input (%zu > %zu)", label, encoded_size, png_size);
+      cpres_free(*out_data);
+      *out_data = NULL;
+      error = CPRES_ERROR_OUTPUT_NOT_SMALLER;
+    }
+    *out_size = encoded_size;
+  }
+
+  return error;
+}
+
+extern void cpres_encoder_destroy(cpres_encoder_t *encoder) {
+  if (!encoder) {
+    return;
+  }
+
+  pngx_scratch_destroy(encoder->pngx_scratch);
+  free(encoder->rgba_buffer);
+  free(encoder->protected_colors);
+  free(encoder);
+}
+
 extern void cpres_free(uint8_t *data) {
   if (data) {
     free(data);
@@ -352,6 +866,8 @@ extern const char *cpres_error_string(cpres_error_t error) {
     return "Invalid parameter";
   case CPRES_ERROR_OUTPUT_NOT_SMALLER:
     return "Output image would be larger than input";
+  case CPRES_ERROR_CANCELLED:
+    return "Encoding cancelled";
   default:
     return "Unknown error";
   }
@@ -0,0 +1,225 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <colopresso.h>
+
+#include "internal/effort.h"
+#include "internal/log.h"
+#include "internal/png.h"
+
+/* Rough single-core throughput in pixels per millisecond for each effort level. The budget only needs the relative cost of the levels to be right; threads and content make real
+ * encodes faster or slower, so the estimate is a planning figure rather than a deadline guarantee. */
+static const uint32_t kWebpMethodThroughput[7] = {40000, 30000, 20000, 12000, 8000, 5000, 3000};
+static const uint32_t kAvifSpeedThroughput[11] = {50, 100, 200, 350, 600, 1000, 1600, 2500, 4000, 6000, 10000};
+static const uint32_t kPngxLevelThroughput[7] = {20000, 10000, 6000, 4000, 2500, 1200, 600};
+static const uint32_t kPngxLossySpeedThroughput[10] = {1000, 1800, 2600, 3400, 4200, 5000, 6000, 7000, 8000, 9000};
+
+static inline uint64_t cost_ms(uint64_t pixels, uint32_t throughput) { return (pixels + throughput - 1) / throughput; }
+
+static inline uint64_t webp_cost_ms(uint64_t pixels, int method, bool lossless) {
+  uint64_t ms = cost_ms(pixels, kWebpMethodThroughput[method]);
+
+  return lossless ? ms * EFFORT_WEBP_LOSSLESS_SLOWDOWN : ms;
+}
+
+static inline uint64_t avif_cost_ms(uint64_t pixels, int speed, bool lossless) {
+  uint64_t ms = cost_ms(pixels, kAvifSpeedThroughput[speed]);
+
+  return lossless ? ms * EFFORT_AVIF_LOSSLESS_SLOWDOWN : ms;
+}
+
+static inline uint64_t pngx_lossless_cost_ms(uint64_t pixels, int level) { return cost_ms(pixels, kPngxLevelThroughput[level]); }
+
+static inline uint64_t pngx_quant_cost_ms(uint64_t pixels, int speed, const cpres_config_t *config) {
+  return config->pngx_lossy_enable ? cost_ms(pixels, kPngxLossySpeedThroughput[speed - 1]) : 0;
+}
+
+static inline uint64_t pngx_cost_ms(uint64_t pixels, int level, int speed, const cpres_config_t *config) {
+  uint64_t lossless = pngx_lossless_cost_ms(pixels, level), quant = pngx_quant_cost_ms(pixels, speed, config), total;
+
+  total = config->pngx_parallel_branches ? (lossless > quant ? lossless : quant) : lossless + quant;
+
+  return config->pngx_search_enable && config->pngx_lossy_enable ? total * EFFORT_PNGX_SEARCH_SLOWDOWN : total;
+}
+
+static inline uint32_t estimate_ms(uint64_t ms) { return ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms; }
+
+static bool resolve_webp(uint64_t pixels, uint64_t budget, const cpres_config_t *config, cpres_effort_t *effort) {
+  while (budget > 0 && effort->webp_method > 0 && webp_cost_ms(pixels, effort->webp_method, config->webp_lossless) > budget) {
+    --effort->webp_method;
+  }
+  effort->estimated_ms = estimate_ms(webp_cost_ms(pixels, effort->webp_method, config->webp_lossless));
+
+  return effort->webp_method != config->webp_method;
+}
+
+static bool resolve_avif(uint64_t pixels, uint64_t budget, const cpres_config_t *config, cpres_effort_t *effort) {
+  int speed;
+
+  /* Out-of-range speeds are clamped, exactly as apply_avif_config does. */
+  if (effort->avif_speed < 0) {
+    effort->avif_speed = 0;
+  } else if (effort->avif_speed > 10) {
+    effort->avif_speed = 10;
+  }
+  speed = effort->avif_speed;
+
+  while (budget > 0 && effort->avif_speed < 10 && avif_cost_ms(pixels, effort->avif_speed, config->avif_lossless) > budget) {
+    ++effort->avif_speed;
+  }
+  effort->estimated_ms = estimate_ms(avif_cost_ms(pixels, effort->avif_speed, config->avif_lossless));
+
+  return effort->avif_speed != speed;
+}
+
+static bool resolve_pngx(uint64_t pixels, uint64_t budget, const cpres_config_t *config, cpres_effort_t *effort) {
+  int level, speed;
+
+  /* Out-of-range values fall back to the defaults, exactly as pngx_fill_pngx_options treats them. */
+  if (effort->pngx_level < 0 || effort->pngx_level > 6) {
+    effort->pngx_level = COLOPRESSO_PNGX_DEFAULT_LEVEL;
+  }
+  if (effort->pngx_lossy_speed < 1 || effort->pngx_lossy_speed > 10) {
+    effort->pngx_lossy_speed = COLOPRESSO_PNGX_DEFAULT_LOSSY_SPEED;
+  }
+  level = effort->pngx_level;
+  speed = effort->pngx_lossy_speed;
+
+  /* Lower whichever stage currently dominates the estimate, one step at a time. */
+  while (budget > 0 && pngx_cost_ms(pixels, effort->pngx_level, effort->pngx_lossy_speed, config) > budget) {
+    if (effort->pngx_lossy_speed < 10 && config->pngx_lossy_enable &&
+        (effort->pngx_level == 0 || pngx_quant_cost_ms(pixels, effort->pngx_lossy_speed, config) > pngx_lossless_cost_ms(pixels, effort->pngx_level))) {
+      ++effort->pngx_lossy_speed;
+    } else if (effort->pngx_level > 0) {
+      --effort->pngx_level;
+    } else {
+      break;
+    }
+  }
+  effort->estimated_ms = estimate_ms(pngx_cost_ms(pixels, effort->pngx_level, effort->pngx_lossy_speed, config));
+
+  return effort->pngx_level != level || effort->pngx_lossy_speed != speed;
+}
+
+bool effort_resolve(cpres_format_t format, uint32_t width, uint32_t height, const cpres_config_t *config, cpres_effort_t *effort) {
+  uint64_t pixels = (uint64_t)width * (uint64_t)height, budget;
+
+  memset(effort, 0, sizeof(*effort));
+  effort->webp_method = config->webp_method;
+  effort->avif_speed = config->avif_speed;
+  effort->pngx_level = config->pngx_level;
+  effort->pngx_lossy_speed = config->pngx_lossy_speed;
+
+  /* WebPValidateConfig rejects such a method, so there is no effort to plan; the encode fails with CPRES_ERROR_INVALID_PARAMETER. */
+  if (format == CPRES_FORMAT_WEBP && (config->webp_method < 0 || config->webp_method > 6)) {
+    return false;
+  }
+
+  if (pixels == 0) {
+    return true;
+  }
+
+  budget = config->time_budget_ms > 0 ? (uint64_t)config->time_budget_ms : 0;
+
+  switch (format) {
+  case CPRES_FORMAT_WEBP:
+    effort->scaled = resolve_webp(pixels, budget, config, effort);
+    break;
+  case CPRES_FORMAT_AVIF:
+    effort->scaled = resolve_avif(pixels, budget, config, effort);
+    break;
+  case CPRES_FORMAT_PNGX:
+    effort->scaled = resolve_pngx(pixels, budget, config, effort);
+    break;
+  default:
+    break;
+  }
+
+  return true;
+}
+
+int effort_pngx_level_within(uint64_t pixels, uint64_t remaining_ms, int level, uint32_t passes) {
+  if (level < 0 || level > 6) {
+    return level;
+  }
+
+  while (level > 0 && pngx_lossless_cost_ms(pixels, level) * passes > remaining_ms) {
+    --level;
+  }
+
+  return level;
+}
+
+const cpres_config_t *effort_apply(cpres_format_t format, uint32_t width, uint32_t height, const cpres_config_t *config, cpres_config_t *scaled) {
+  cpres_effort_t effort;
+
+  if (!config || !scaled || (config->time_budget_ms <= 0 && !config->effort_report)) {
+    return config;
+  }
+
+  if (!effort_resolve(format, width, height, config, &effort)) {
+    return config;
+  }
+  if (config->effort_report) {
+    *config->effort_report = effort;
+  }
+  if (!effort.scaled) {
+    return config;
+  }
+
+  *scaled = *config;
+  switch (format) {
+  case CPRES_FORMAT_WEBP:
+    scaled->webp_method = effort.webp_method;
+    colopresso_log(CPRES_LOG_LEVEL_INFO, "WebP: %d ms budget for %ux%u lowers method %d -> %d (estimated %u ms)", config->time_budget_ms, width, height, config->webp_method, effort.webp_method,
+                   effort.estimated_ms);
+    break;
+  case CPRES_FORMAT_AVIF:
+    scaled->avif_speed = effort.avif_speed;
+    colopresso_log(CPRES_LOG_LEVEL_INFO, "AVIF: %d ms budget for %ux%u raises speed %d -> %d (estimated %u ms)", config->time_budget_ms, width, height, config->avif_speed, effort.avif_speed,
+                   effort.estimated_ms);
+    break;
+  default:
+    scaled->pngx_level = effort.pngx_level;
+    scaled->pngx_lossy_speed = effort.pngx_lossy_speed;
+    colopresso_log(CPRES_LOG_LEVEL_INFO, "PNGX: %d ms budget for %ux%u uses level %d and quantizer speed %d (estimated %u ms)", config->time_budget_ms, width, height, effort.pngx_level,
+                   effort.pngx_lossy_speed, effort.estimated_ms);
+    break;
+  }
+
+  return scaled;
+}
+
+const cpres_config_t *effort_apply_png(cpres_format_t format, const png_row_input_t *input, const cpres_config_t *config, cpres_config_t *scaled) {
+  png_uint_32 width, height;
+
+  if (!config || (config->time_budget_ms <= 0 && !config->effort_report) || !png_peek_dimensions(input, &width, &height)) {
+    return config;
+  }
+
+  return effort_apply(format, width, height, config, scaled);
+}
+
+extern cpres_error_t cpres_resolve_effort(cpres_format_t format, uint32_t width, uint32_t height, const cpres_config_t *config, cpres_effort_t *effort) {
+  if (!config || !effort || width == 0 || height == 0) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (format != CPRES_FORMAT_WEBP && format != CPRES_FORMAT_AVIF && format != CPRES_FORMAT_PNGX) {
+    return CPRES_ERROR_INVALID_FORMAT;
+  }
+
+  return effort_resolve(format, width, height, config, effort) ? CPRES_OK : CPRES_ERROR_INVALID_PARAMETER;
+}
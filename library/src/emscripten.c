@@ -615,6 +615,41 @@ void emscripten_config_pngx_threads(cpres_config_t *config, int threads) {
   }
 }
 
+EMSCRIPTEN_KEEPALIVE
+void emscripten_config_pngx_parallel_branches(cpres_config_t *config, int enabled) {
+  if (config) {
+    config->pngx_parallel_branches = enabled ? true : false;
+  }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void emscripten_config_pngx_search_enable(cpres_config_t *config, int enabled) {
+  if (config) {
+    config->pngx_search_enable = enabled ? true : false;
+  }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void emscripten_config_pngx_tiled_dither_enable(cpres_config_t *config, int enabled) {
+  if (config) {
+    config->pngx_tiled_dither_enable = enabled ? true : false;
+  }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void emscripten_config_memory_limited(cpres_config_t *config, int enabled) {
+  if (config) {
+    config->memory_limited = enabled ? true : false;
+  }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void emscripten_config_time_budget_ms(cpres_config_t *config, int budget_ms) {
+  if (config) {
+    config->time_budget_ms = budget_ms < 0 ? 0 : budget_ms;
+  }
+}
+
 EMSCRIPTEN_KEEPALIVE
 bool emscripten_is_threads_enabled(void) { return cpres_is_threads_enabled(); }
 
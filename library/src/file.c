@@ -23,6 +23,7 @@
 #include <colopresso/portable.h>
 
 #include "internal/avif.h"
+#include "internal/effort.h"
 #include "internal/log.h"
 #include "internal/png.h"
 #include "internal/webp.h"
@@ -107,6 +108,9 @@ extern cpres_error_t cpres_read_file_to_memory(const char *path, uint8_t **data_
 }
 
 extern cpres_error_t cpres_encode_webp_file(const char *input_path, const char *output_path, const cpres_config_t *config) {
+  WebPConfig webp_config;
+  cpres_config_t scaled_config;
+  png_row_input_t input;
   FILE *fp = NULL;
   uint32_t width, height;
   uint8_t *rgba_data = NULL, *webp_data = NULL;
@@ -120,16 +124,28 @@ extern cpres_error_t cpres_encode_webp_file(const char *input_path, const char *
 
   have_input_size = cpres_get_file_size_bytes(input_path, &input_size);
 
-  error = png_decode_from_file(input_path, &rgba_data, &width, &height);
-  if (error != CPRES_OK) {
-    colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG read failed: %s", cpres_error_string(error));
-    return error;
-  }
+  input.png_data = NULL;
+  input.png_size = 0;
+  input.path = input_path;
+  config = effort_apply_png(CPRES_FORMAT_WEBP, &input, config, &scaled_config);
+
+  if (config->memory_limited) {
+    if (!webp_prepare_config(&webp_config, config)) {
+      return CPRES_ERROR_INVALID_PARAMETER;
+    }
+    error = webp_encode_png_rows_to_memory(&input, &webp_data, &webp_size, &webp_config, config);
+  } else {
+    error = png_decode_from_file(input_path, &rgba_data, &width, &height);
+    if (error != CPRES_OK) {
+      colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG read failed: %s", cpres_error_string(error));
+      return error;
+    }
 
-  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNG loaded - %dx%d pixels", width, height);
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNG loaded - %dx%d pixels", width, height);
 
-  error = webp_encode_rgba_to_memory(rgba_data, width, height, &webp_data, &webp_size, config);
-  free(rgba_data);
+    error = webp_encode_rgba_to_memory(rgba_data, width, height, &webp_data, &webp_size, config);
+    free(rgba_data);
+  }
 
   if (error != CPRES_OK) {
     return error;
@@ -161,6 +177,8 @@ extern cpres_error_t cpres_encode_webp_file(const char *input_path, const char *
 }
 
 extern cpres_error_t cpres_encode_avif_file(const char *input_path, const char *output_path, const cpres_config_t *config) {
+  cpres_config_t scaled_config;
+  png_row_input_t input;
   FILE *fp = NULL;
   uint32_t width, height;
   uint8_t *rgba_data = NULL, *avif_data = NULL;
@@ -174,16 +192,25 @@ extern cpres_error_t cpres_encode_avif_file(const char *input_path, const char *
 
   have_input_size = cpres_get_file_size_bytes(input_path, &input_size);
 
-  error = png_decode_from_file(input_path, &rgba_data, &width, &height);
-  if (error != CPRES_OK) {
-    colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG read (AVIF) failed: %s", cpres_error_string(error));
-    return error;
-  }
+  input.png_data = NULL;
+  input.png_size = 0;
+  input.path = input_path;
+  config = effort_apply_png(CPRES_FORMAT_AVIF, &input, config, &scaled_config);
+
+  if (config->memory_limited) {
+    error = avif_encode_png_rows_to_memory(&input, &avif_data, &avif_size, config);
+  } else {
+    error = png_decode_from_file(input_path, &rgba_data, &width, &height);
+    if (error != CPRES_OK) {
+      colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNG read (AVIF) failed: %s", cpres_error_string(error));
+      return error;
+    }
 
-  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNG loaded (AVIF) - %dx%d pixels", width, height);
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNG loaded (AVIF) - %dx%d pixels", width, height);
 
-  error = avif_encode_rgba_to_memory(rgba_data, width, height, &avif_data, &avif_size, config);
-  free(rgba_data);
+    error = avif_encode_rgba_to_memory(rgba_data, width, height, &avif_data, &avif_size, config);
+    free(rgba_data);
+  }
 
   if (error != CPRES_OK) {
     return error;
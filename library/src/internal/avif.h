@@ -18,11 +18,20 @@
 
 #include <colopresso.h>
 
+#include "png.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 cpres_error_t avif_encode_rgba_to_memory(uint8_t *rgba_data, uint32_t width, uint32_t height, uint8_t **avif_data, size_t *avif_size, const cpres_config_t *config);
+cpres_error_t avif_encode_rgba_strided_to_memory(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **avif_data, size_t *avif_size,
+                                                 const cpres_config_t *config);
+cpres_error_t avif_encode_rgba_to_writer(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, cpres_write_callback_t write, void *user_data, size_t *written_size,
+                                         const cpres_config_t *config);
+/* Memory-limited variants: decode row strips straight into the AVIF YUV planes instead of a full RGBA buffer. The YUV planes are still full size. */
+cpres_error_t avif_encode_png_rows_to_memory(const png_row_input_t *input, uint8_t **avif_data, size_t *avif_size, const cpres_config_t *config);
+cpres_error_t avif_encode_png_rows_to_writer(const png_row_input_t *input, cpres_write_callback_t write, void *user_data, size_t *written_size, const cpres_config_t *config);
 
 int avif_get_last_error(void);
 void avif_set_last_error(int error_code);
@@ -0,0 +1,35 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#ifndef COLOPRESSO_INTERNAL_CANCEL_H
+#define COLOPRESSO_INTERNAL_CANCEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <colopresso.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The token's flag word, for the Rust bridge to poll without calling back into C. NULL for a NULL token. */
+const int32_t *cancel_token_flag(const cpres_cancel_token_t *token);
+/* True once config's token has been cancelled; a config without a token never is. */
+bool cancel_requested(const cpres_config_t *config);
+/* Calls the progress callback, if any, with progress clamped to [0, 1]. */
+void cancel_report_progress(cpres_progress_callback_t callback, void *user_data, float progress);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLOPRESSO_INTERNAL_CANCEL_H */
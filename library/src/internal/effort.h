@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#ifndef COLOPRESSO_INTERNAL_EFFORT_H
+#define COLOPRESSO_INTERNAL_EFFORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <colopresso.h>
+
+#include "png.h"
+
+#define EFFORT_WEBP_LOSSLESS_SLOWDOWN 8u
+#define EFFORT_AVIF_LOSSLESS_SLOWDOWN 2u
+#define EFFORT_PNGX_SEARCH_SLOWDOWN 3u
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Fills *effort from config for a width x height image, lowering the effort knobs until the cost model fits config->time_budget_ms. Returns false for a config the encoder rejects. */
+bool effort_resolve(cpres_format_t format, uint32_t width, uint32_t height, const cpres_config_t *config, cpres_effort_t *effort);
+/* Returns config itself when no budget applies or nothing had to change, otherwise *scaled: a copy with the resolved effort written in. Also fills config->effort_report when set. */
+const cpres_config_t *effort_apply(cpres_format_t format, uint32_t width, uint32_t height, const cpres_config_t *config, cpres_config_t *scaled);
+/* Highest oxipng level at or below level whose passes over pixels fit in remaining_ms, for re-planning once earlier stages have been timed. */
+int effort_pngx_level_within(uint64_t pixels, uint64_t remaining_ms, int level, uint32_t passes);
+/* Same as effort_apply, taking the dimensions from the PNG header. An unreadable header leaves config untouched for the decoder to reject. */
+const cpres_config_t *effort_apply_png(cpres_format_t format, const png_row_input_t *input, const cpres_config_t *config, cpres_config_t *scaled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLOPRESSO_INTERNAL_EFFORT_H */
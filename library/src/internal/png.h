@@ -12,6 +12,7 @@
 #ifndef COLOPRESSO_INTERNAL_PNG_H
 #define COLOPRESSO_INTERNAL_PNG_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <png.h>
@@ -22,7 +23,37 @@
 extern "C" {
 #endif
 
+typedef struct {
+  uint8_t bit_depth;
+  uint8_t color_type;
+  uint8_t interlace_type;
+  bool has_trns;
+} png_source_info_t;
+
+#define PNG_ROW_STRIP_ROWS 64
+
+typedef struct {
+  const uint8_t *png_data; /* Decoded from memory when set */
+  size_t png_size;
+  const char *path; /* Otherwise read from this file (file ops builds only) */
+} png_row_input_t;
+
+/* begin() receives the dimensions before any pixels; rows() then gets consecutive strips of packed RGBA8 rows (width * 4 bytes each). */
+typedef struct {
+  cpres_error_t (*begin)(void *context, png_uint_32 width, png_uint_32 height);
+  cpres_error_t (*rows)(void *context, const uint8_t *rgba, png_uint_32 first_row, png_uint_32 row_count);
+  void *context;
+} png_row_sink_t;
+
 cpres_error_t png_decode_from_memory(const uint8_t *png_data, size_t png_size, uint8_t **rgba_data, png_uint_32 *width, png_uint_32 *height);
+cpres_error_t png_decode_from_memory_with_info(const uint8_t *png_data, size_t png_size, uint8_t **rgba_data, png_uint_32 *width, png_uint_32 *height, png_source_info_t *source_info);
+/* Decodes into *rgba_data, growing it (and *rgba_capacity) only when the image does not fit. The buffer stays owned by the caller, even on failure. */
+cpres_error_t png_decode_from_memory_reuse(const uint8_t *png_data, size_t png_size, uint8_t **rgba_data, size_t *rgba_capacity, png_uint_32 *width, png_uint_32 *height,
+                                           png_source_info_t *source_info);
+/* Decodes strip by strip so only PNG_ROW_STRIP_ROWS rows of RGBA are held at once. Interlaced images fall back to one full buffer. */
+cpres_error_t png_decode_rows(const png_row_input_t *input, const png_row_sink_t *sink);
+/* Reads only the IHDR dimensions, without decoding. Returns false when the header is missing or malformed; the full decode still validates everything else. */
+bool png_peek_dimensions(const png_row_input_t *input, png_uint_32 *width, png_uint_32 *height);
 
 #if COLOPRESSO_WITH_FILE_OPS
 cpres_error_t png_decode_from_file(const char *filename, uint8_t **rgba_data, png_uint_32 *width, png_uint_32 *height);
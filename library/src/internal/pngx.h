@@ -60,6 +60,8 @@
 #define PNGX_COMMON_LUMA_B_COEFF 0.0722f
 #define PNGX_COMMON_LUMA_G_COEFF 0.7152f
 #define PNGX_COMMON_LUMA_R_COEFF 0.2126f
+#define PNGX_COMMON_PALETTE_INDEX_LEAF_SIZE 64u
+#define PNGX_COMMON_PALETTE_INDEX_STACK_DEPTH 64u
 #define PNGX_COMMON_PREPARE_ALPHA_BASE 0.4f
 #define PNGX_COMMON_PREPARE_ALPHA_MULTIPLIER 0.6f
 #define PNGX_COMMON_PREPARE_ALPHA_THRESHOLD 0.85f
@@ -99,6 +101,7 @@
 #define PNGX_COMMON_RESOLVE_DEFAULT_VIBRANT 0.05f
 #define PNGX_COMMON_RESOLVE_MAX 0.90f
 #define PNGX_COMMON_RESOLVE_MIN 0.02f
+#define PNGX_PALETTE256_ALPHA_BLEED_STRIP_ROWS 256u
 #define PNGX_PALETTE256_GRADIENT_PROFILE_DITHER_FLOOR 0.78f
 #define PNGX_PALETTE256_GRADIENT_PROFILE_GRADIENT_MEAN_MAX 0.16f
 #define PNGX_PALETTE256_GRADIENT_PROFILE_OPAQUE_RATIO_THRESHOLD 0.90f
@@ -126,6 +129,9 @@
 #define PNGX_REDUCED_ALPHA_SIMPLE_TRANSLUCENT_REF 0.12f
 #define PNGX_REDUCED_ALPHA_SIMPLE_TRANSLUCENT_WEIGHT 0.4f
 #define PNGX_REDUCED_ALPHA_TRANSLUCENT_LIMIT 0.06f
+#define PNGX_REDUCED_COLOR_HASH_INITIAL_CAPACITY 1024u
+#define PNGX_REDUCED_COLOR_HASH_MAX_COLORS 262144u
+#define PNGX_REDUCED_COLOR_HASH_SLICE_PIXELS 65536u
 #define PNGX_REDUCED_HEAD_DOMINANCE_LIMIT 64
 #define PNGX_REDUCED_IMPORTANCE_LEVEL_FULL 232
 #define PNGX_REDUCED_IMPORTANCE_LEVEL_HIGH 184
@@ -280,6 +286,17 @@
 #define PNGX_MAX_DERIVED_COLORS 48
 #define PNGX_POSTPROCESS_DISABLE_DITHER_THRESHOLD 0.25f
 #define PNGX_POSTPROCESS_MAX_COLOR_DISTANCE_SQ 900
+#define PNGX_PARALLEL_BRANCH_PRUNE_RATIO 1.5f
+#define PNGX_DITHER_BAND_ROWS 64u
+#define PNGX_DITHER_BAND_WARMUP_ROWS 8u
+#define PNGX_ANALYSIS_SLICE_ROWS 64u
+#define PNGX_PREPARE_MAX_SLICES 32u
+#define PNGX_SEARCH_MAX_CANDIDATES 5u
+#define PNGX_SEARCH_MAX_PALETTE_STEPS 2u
+#define PNGX_SEARCH_MIN_COLORS 32u
+#define PNGX_SEARCH_PRUNE_RATIO 1.1f
+#define PNGX_CANCEL_POLL_MASK 0xffffu
+#define PNGX_PROGRESS_QUANTIZED 0.5f
 
 #ifdef __cplusplus
 extern "C" {
@@ -290,12 +307,14 @@ typedef enum {
   PNGX_BRIDGE_RESULT_INVALID_INPUT = 1,
   PNGX_BRIDGE_RESULT_OPTIMIZATION_FAILED = 2,
   PNGX_BRIDGE_RESULT_IO_ERROR = 3,
+  PNGX_BRIDGE_RESULT_CANCELLED = 4,
 } PngxBridgeResult;
 
 typedef enum {
   PNGX_BRIDGE_QUANT_STATUS_OK = 0,
   PNGX_BRIDGE_QUANT_STATUS_QUALITY_TOO_LOW = 1,
   PNGX_BRIDGE_QUANT_STATUS_ERROR = 2,
+  PNGX_BRIDGE_QUANT_STATUS_CANCELLED = 3,
 } PngxBridgeQuantStatus;
 
 typedef enum {
@@ -314,6 +333,8 @@ typedef struct {
   uint8_t optimization_level;
   bool strip_safe;
   bool optimize_alpha;
+  const int32_t *cancel_flag;
+  uint32_t thread_count; /* 0 = the bridge's default pool */
 } PngxBridgeLosslessOptions;
 
 typedef struct {
@@ -328,6 +349,8 @@ typedef struct {
   const cpres_rgba_color_t *fixed_colors;
   size_t fixed_colors_len;
   bool remap;
+  const int32_t *cancel_flag;
+  uint32_t thread_count; /* 0 = the bridge's default pool */
 } PngxBridgeQuantParams;
 
 typedef struct {
@@ -338,6 +361,21 @@ typedef struct {
   int32_t quality;
 } PngxBridgeQuantOutput;
 
+/* Per-pixel buffers a reusable encoder keeps across PNGX calls. Each slot lends its buffer to one borrower at a time. */
+typedef enum {
+  PNGX_SCRATCH_SOURCE_RGBA = 0,
+  PNGX_SCRATCH_SEARCH_RGBA,
+  PNGX_SCRATCH_IMPORTANCE_WORK,
+  PNGX_SCRATCH_IMPORTANCE_MAP,
+  PNGX_SCRATCH_INDICES,
+  PNGX_SCRATCH_INDEX_REFERENCE,
+  PNGX_SCRATCH_DIFFUSION_ROWS,
+  PNGX_SCRATCH_HISTOGRAM_SAMPLES,
+  PNGX_SCRATCH_SLOT_COUNT
+} pngx_scratch_slot_t;
+
+typedef struct pngx_scratch pngx_scratch_t;
+
 typedef struct {
   PngxBridgeOptions bridge;
   bool lossy_enable;
@@ -376,6 +414,17 @@ typedef struct {
   int16_t palette256_tune_quality_min_floor;
   int16_t palette256_tune_quality_max_target;
   uint32_t thread_count;
+  bool parallel_branches;
+  bool search_enable;
+  bool tiled_dither_enable;
+  bool lossless_deferred;
+  uint32_t time_budget_ms;
+  double deadline; /* colopresso_get_monotonic_seconds() the budget runs out at, 0 = no re-planning */
+  pngx_scratch_t *scratch; /* Buffers kept by a reusable encoder (NULL = allocate per call) */
+  cpres_effort_t *effort_report;
+  const cpres_cancel_token_t *cancel_token;
+  cpres_progress_callback_t progress_callback;
+  void *progress_user_data;
 } pngx_options_t;
 
 typedef struct {
@@ -384,13 +433,52 @@ typedef struct {
   size_t capacity;
 } png_memory_buffer_t;
 
+typedef struct {
+  uint8_t *quant_data;
+  size_t quant_size;
+  int quant_quality;
+  bool quant_ok;
+  bool quant_pruned;
+  bool quant_out_of_memory; /* The search could not quantize every candidate */
+  uint8_t *lossless_data;
+  size_t lossless_size;
+  bool lossless_ok;
+  bool lossless_skipped;
+  uint8_t optimization_level; /* Lowest oxipng level either branch ran at */
+} pngx_branch_result_t;
+
+/* What the lossless branch optimizes: PNG bytes, or, when rgba is set, a raw 8-bit RGBA frame that oxipng encodes without an intermediate PNG. */
+typedef struct {
+  const uint8_t *png_data;
+  size_t png_size;
+  const uint8_t *rgba;
+  uint32_t width;
+  uint32_t height;
+  uint32_t stride;
+} pngx_source_t;
+
 typedef struct {
   uint8_t *rgba;
   png_uint_32 width;
   png_uint_32 height;
   size_t pixel_count;
+  uint8_t source_bit_depth;
+  uint8_t source_color_type;
+  bool source_has_trns;
+  bool borrowed; /* rgba belongs to the caller; rgba_image_reset drops it without freeing */
 } pngx_rgba_image_t;
 
+/* A palette256 result before it is written: post-processed indices (owned, freed by pngx_indexed_image_reset) and the sanitized palette. */
+typedef struct {
+  uint8_t *indices;
+  size_t indices_len;
+  cpres_rgba_color_t palette[256];
+  size_t palette_len;
+  uint32_t width;
+  uint32_t height;
+  pngx_scratch_t *scratch; /* Pool indices came from, if any */
+} pngx_indexed_image_t;
+
 typedef struct {
   float gradient_mean;
   float gradient_max;
@@ -400,6 +488,19 @@ typedef struct {
   float vibrant_ratio;
 } pngx_image_stats_t;
 
+/* Measurements shared by every lossy mode, gathered by analyze_image in one pass. Luma is in 0..255 units. */
+typedef struct {
+  size_t pixel_count;
+  size_t opaque_pixels;      /* alpha > PNGX_COMMON_DITHER_ALPHA_OPAQUE_THRESHOLD */
+  size_t translucent_pixels; /* alpha > PNGX_COMMON_DITHER_ALPHA_TRANSLUCENT_THRESHOLD and not opaque */
+  size_t non_opaque_pixels;  /* alpha < 255 */
+  size_t gradient_samples;
+  double gradient_accum; /* Sum of absolute luma steps to the right and below neighbours */
+  float luma_min;
+  float luma_max;
+  uint32_t alpha_levels; /* Distinct alpha values */
+} pngx_image_analysis_t;
+
 typedef struct {
   uint8_t *importance_map;
   size_t importance_map_len;
@@ -409,11 +510,17 @@ typedef struct {
   size_t combined_fixed_len;
   uint8_t *bit_hint_map;
   size_t bit_hint_len;
+  pngx_scratch_t *scratch; /* Pool importance_map came from, if any */
 } pngx_quant_support_t;
 
 /* from pngx_bridge rust library */
 PngxBridgeResult pngx_bridge_optimize_lossless(const uint8_t *input_data, size_t input_size, uint8_t **output_data, size_t *output_size, const PngxBridgeLosslessOptions *options);
-PngxBridgeQuantStatus pngx_bridge_quantize(const cpres_rgba_color_t *pixels, size_t pixel_count, uint32_t width, uint32_t height, const PngxBridgeQuantParams *params, PngxBridgeQuantOutput *output);
+PngxBridgeResult pngx_bridge_optimize_indexed(const uint8_t *indices, size_t indices_len, uint32_t width, uint32_t height, const cpres_rgba_color_t *palette, size_t palette_len, uint8_t **output_data,
+                                              size_t *output_size, const PngxBridgeLosslessOptions *options);
+PngxBridgeResult pngx_bridge_optimize_rgba(const uint8_t *rgba, uint32_t width, uint32_t height, size_t stride, uint8_t **output_data, size_t *output_size, const PngxBridgeLosslessOptions *options);
+/* output->palette (256 entries) and output->indices (output->indices_len bytes) are caller-owned; pixels are read in place. */
+PngxBridgeQuantStatus pngx_bridge_quantize_into(const cpres_rgba_color_t *pixels, size_t pixel_count, uint32_t width, uint32_t height, const PngxBridgeQuantParams *params,
+                                                PngxBridgeQuantOutput *output);
 void pngx_bridge_free(uint8_t *ptr);
 uint32_t pngx_bridge_oxipng_version(void);
 uint32_t pngx_bridge_libimagequant_version(void);
@@ -441,7 +548,19 @@ PNGX_DEFINE_CLAMP(uint16_t);
 PNGX_DEFINE_CLAMP(uint8_t);
 PNGX_DEFINE_CLAMP(float);
 
+/* Polled once per row by the quantizer loops, so an abandoned encode stops within a row of work. */
+static inline bool pngx_cancelled(const pngx_options_t *opts) { return opts && cpres_cancel_token_is_cancelled(opts->cancel_token); }
+
 bool pngx_quantize_palette256(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality);
+bool pngx_quantize_palette256_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality);
+/* Quantizes without writing, so a caller can settle the oxipng level before pngx_palette256_write_indexed spends it. */
+bool pngx_quantize_palette256_indexed(pngx_rgba_image_t *image, const pngx_options_t *opts, pngx_indexed_image_t *out, int *quant_quality);
+/* *out_optimized (optional) reports whether the PNG went through oxipng, in which case a second lossless pass is wasted work. */
+bool pngx_palette256_write_indexed(const pngx_indexed_image_t *indexed, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, bool *out_optimized);
+void pngx_indexed_image_reset(pngx_indexed_image_t *indexed);
+bool pngx_palette256_prepare_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_rgba, uint32_t *out_width, uint32_t *out_height, uint8_t **out_importance_map,
+                                   size_t *out_importance_map_len, int32_t *out_speed, uint8_t *out_quality_min, uint8_t *out_quality_max, uint32_t *out_max_colors, float *out_dither_level,
+                                   uint8_t **out_fixed_colors, size_t *out_fixed_colors_len);
 bool pngx_palette256_prepare(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_rgba, uint32_t *out_width, uint32_t *out_height, uint8_t **out_importance_map,
                              size_t *out_importance_map_len, int32_t *out_speed, uint8_t *out_quality_min, uint8_t *out_quality_max, uint32_t *out_max_colors, float *out_dither_level,
                              uint8_t **out_fixed_colors, size_t *out_fixed_colors_len);
@@ -449,14 +568,36 @@ bool pngx_palette256_finalize(const uint8_t *indices, size_t indices_len, const
 void pngx_palette256_cleanup(void);
 bool pngx_create_palette_png(const uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len, uint32_t width, uint32_t height, uint8_t **out_data, size_t *out_size);
 bool create_rgba_png(const uint8_t *rgba, size_t pixel_count, uint32_t width, uint32_t height, uint8_t **out_data, size_t *out_size);
+bool create_rgba_png_strided(const uint8_t *rgba, size_t row_stride, uint32_t width, uint32_t height, int compression_level, uint8_t **out_data, size_t *out_size);
+/* Writes a quantizer's RGBA result. Deferred output (opts->lossless_deferred) only ranks search candidates before oxipng rewrites the survivors, so it uses the fast deflate level. */
+bool create_quantized_rgba_png(const pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size);
 bool pngx_quantize_limited4444(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size);
+bool pngx_quantize_limited4444_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size);
 bool pngx_quantize_reduced_rgba32(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint32_t *resolved_target, uint32_t *applied_colors, uint8_t **out_data, size_t *out_size);
+bool pngx_quantize_reduced_rgba32_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint32_t *resolved_target, uint32_t *applied_colors, uint8_t **out_data, size_t *out_size);
 void pngx_fill_pngx_options(pngx_options_t *opts, const cpres_config_t *config);
 bool pngx_run_quantization(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality);
+bool pngx_run_quantization_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality);
 bool pngx_run_lossless_optimization(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size);
+bool pngx_run_indexed_optimization(const uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len, uint32_t width, uint32_t height, const pngx_options_t *opts,
+                                   uint8_t **out_data, size_t *out_size);
+bool pngx_run_rgba_optimization(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t stride, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size);
+void pngx_run_branches(const pngx_source_t *source, const pngx_options_t *opts, pngx_rgba_image_t *source_image, pngx_branch_result_t *result);
 bool pngx_should_attempt_quantization(const pngx_options_t *opts);
 bool pngx_quantization_better(size_t baseline_size, size_t candidate_size);
 
+pngx_scratch_t *pngx_scratch_create(void);
+void pngx_scratch_destroy(pngx_scratch_t *scratch);
+/* Starts a call: takes back every buffer the previous call left lent (borrowed images never hand theirs back) and restarts the allocation count. */
+void pngx_scratch_begin(pngx_scratch_t *scratch);
+/* Allocations made since pngx_scratch_begin, including the ones for a slot that was already lent. */
+uint32_t pngx_scratch_allocations(pngx_scratch_t *scratch);
+/* Lends the slot's buffer grown to size, or mallocs one when scratch is NULL or the slot is lent. Contents are undefined. */
+void *pngx_scratch_acquire(pngx_scratch_t *scratch, pngx_scratch_slot_t slot, size_t size);
+/* Gives back a buffer from pngx_scratch_acquire: the slot's own buffer returns to the pool, anything else is freed. */
+void pngx_scratch_release(pngx_scratch_t *scratch, pngx_scratch_slot_t slot, void *buffer);
+
+/* Per thread: the result of the last bridge call made on the calling thread. */
 int pngx_get_last_error(void);
 void pngx_set_last_error(int error_code);
 
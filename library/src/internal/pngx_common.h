@@ -13,27 +13,63 @@
 #define COLOPRESSO_INTERNAL_PNGX_COMMON_H
 
 #include "pngx.h"
+#include "simd.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct {
+  uint32_t start;
+  uint32_t end;
+  int32_t left; /* -1 on leaves */
+  int32_t right;
+  uint8_t axis;
+  uint8_t left_max;
+  uint8_t right_min;
+} pngx_palette_node_t;
+
+/* k-d tree over a packed RGBA palette whose leaves are scanned with simd_palette_nearest. Built once per palette and shared read-only between threads. */
+typedef struct {
+  simd_palette_t planes; /* Entries in leaf order */
+  uint32_t *order;       /* Leaf position -> caller palette index */
+  pngx_palette_node_t *nodes;
+  size_t node_count;
+  size_t count;
+} pngx_palette_index_t;
+
 void image_stats_reset(pngx_image_stats_t *stats);
 void quant_support_reset(pngx_quant_support_t *support);
 const char *lossy_type_label(uint8_t lossy_type);
 void rgba_image_reset(pngx_rgba_image_t *image);
 bool load_rgba_image(const uint8_t *png_data, size_t png_size, pngx_rgba_image_t *image);
+/* Like load_rgba_image, but decodes into the PNGX_SCRATCH_SOURCE_RGBA buffer when scratch has it free; the image then borrows it. */
+bool load_rgba_image_scratch(const uint8_t *png_data, size_t png_size, pngx_scratch_t *scratch, pngx_rgba_image_t *image);
 uint8_t clamp_reduced_bits(uint8_t bits);
 uint8_t quantize_channel_value(float value, uint8_t bits_per_channel);
 uint8_t quantize_bits(uint8_t value, uint8_t bits);
 void snap_rgba_to_bits(uint8_t *r, uint8_t *g, uint8_t *b, uint8_t *a, uint8_t bits_rgb, uint8_t bits_alpha);
 void snap_rgba_image_to_bits(uint32_t thread_count, uint8_t *rgba, size_t pixel_count, uint8_t bits_rgb, uint8_t bits_alpha);
 uint32_t color_distance_sq(const cpres_rgba_color_t *lhs, const cpres_rgba_color_t *rhs);
+bool palette_index_build(pngx_palette_index_t *index, const uint32_t *colors, size_t count);
+/* Same answer as a first-minimum linear scan of colors by simd_color_distance_sq_u32, including the lowest index on ties. */
+uint32_t palette_index_nearest(const pngx_palette_index_t *index, uint32_t color);
+void palette_index_free(pngx_palette_index_t *index);
+/* Error-diffuses row_count rows starting at image row first_y, where rows points at the first of them, swapping *err_curr and *err_next after every row. Warm-up rows are scratch copies whose
+ * pixels are thrown away. Returns false to stop early. */
+typedef bool (*pngx_dither_rows_fn)(void *context, uint8_t *rows, uint32_t first_y, uint32_t row_count, bool warmup, float **err_curr, float **err_next);
+/* Runs fn over PNGX_DITHER_BAND_ROWS-row bands in parallel. Each band primes its error rows on a copy of the PNGX_DITHER_BAND_WARMUP_ROWS source rows above it, so the output depends on the image
+ * alone and never on thread_count. Returns false if fn stopped or an allocation failed. */
+bool dither_rows_in_bands(uint32_t thread_count, uint8_t *rgba, png_uint_32 width, png_uint_32 height, pngx_dither_rows_fn fn, void *context);
+/* Fills analysis from PNGX_ANALYSIS_SLICE_ROWS-row slices run in parallel and folded in row order, so the record is the same for any thread_count. The record is zeroed on failure. */
+bool analyze_image(uint32_t thread_count, const uint8_t *rgba, png_uint_32 width, png_uint_32 height, pngx_image_analysis_t *analysis);
+float dither_level_from_analysis(const pngx_image_analysis_t *analysis, uint8_t bits_per_channel);
+float dither_level_limited4444_from_analysis(const pngx_image_analysis_t *analysis);
 float estimate_bitdepth_dither_level(const uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_per_channel);
-float estimate_bitdepth_dither_level_limited4444(const uint8_t *rgba, png_uint_32 width, png_uint_32 height);
 void build_fixed_palette(const pngx_options_t *source_opts, pngx_quant_support_t *support, pngx_options_t *patched_opts);
 float resolve_quant_dither(const pngx_options_t *opts, const pngx_image_stats_t *stats);
-bool prepare_quant_support(const pngx_rgba_image_t *image, const pngx_options_t *opts, pngx_quant_support_t *support, pngx_image_stats_t *stats);
+/* Alpha ratios in stats are taken from analysis, which must describe image. */
+bool prepare_quant_support(const pngx_rgba_image_t *image, const pngx_image_analysis_t *analysis, const pngx_options_t *opts, pngx_quant_support_t *support, pngx_image_stats_t *stats);
 bool create_rgba_png(const uint8_t *rgba, size_t pixel_count, uint32_t width, uint32_t height, uint8_t **out_data, size_t *out_size);
 
 #ifdef __cplusplus
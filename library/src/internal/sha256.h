@@ -0,0 +1,39 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#ifndef COLOPRESSO_INTERNAL_SHA256_H
+#define COLOPRESSO_INTERNAL_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COLOPRESSO_SHA256_DIGEST_SIZE 32
+
+typedef struct {
+  uint32_t state[8];
+  uint64_t length;
+  uint8_t buffer[64];
+  size_t buffer_len;
+} colopresso_sha256_t;
+
+void colopresso_sha256_init(colopresso_sha256_t *ctx);
+void colopresso_sha256_update(colopresso_sha256_t *ctx, const void *data, size_t len);
+void colopresso_sha256_final(colopresso_sha256_t *ctx, uint8_t digest[COLOPRESSO_SHA256_DIGEST_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLOPRESSO_INTERNAL_SHA256_H */
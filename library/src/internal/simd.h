@@ -12,8 +12,12 @@
 #ifndef COLOPRESSO_INTERNAL_SIMD_H
 #define COLOPRESSO_INTERNAL_SIMD_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include <colopresso.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,9 +32,25 @@ extern "C" {
 #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
 #define CPRES_SIMD_NEON 1
 #include <arm_neon.h>
-#elif defined(_M_IX86) || defined(_M_X64)
+#elif defined(_M_X64) || defined(__x86_64__)
+/* SSE2 is the x86-64 baseline. The SSE4.1 and AVX2 kernels are compiled with per-function target attributes and picked at run time from CPUID, so one binary serves every host. */
+#define CPRES_SIMD_SSE2 1
+#define CPRES_SIMD_X86_DISPATCH 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+#elif defined(_M_IX86)
 #define CPRES_SIMD_SSE41 1
+#if defined(__AVX2__)
+#define CPRES_SIMD_AVX2 1
+#endif
 #include <intrin.h>
+#elif defined(__AVX2__)
+#define CPRES_SIMD_AVX2 1
+#define CPRES_SIMD_SSE41 1
+#include <immintrin.h>
 #elif defined(__SSE4_1__)
 #define CPRES_SIMD_SSE41 1
 #include <smmintrin.h>
@@ -44,7 +64,27 @@ extern "C" {
 #endif
 #endif
 
+/* Palette split into paired-channel planes for the batched nearest-colour kernels: rg[i] holds R | G << 16 and ba[i] holds B | A << 16. */
+typedef struct {
+  uint32_t *rg;
+  uint32_t *ba;
+  size_t count;
+} simd_palette_t;
+
 uint32_t simd_color_distance_sq_u32(uint32_t lhs, uint32_t rhs);
+/* colors are packed R | G << 8 | B << 16 | A << 24, the same layout simd_color_distance_sq_u32 takes. */
+bool simd_palette_init(simd_palette_t *palette, const uint32_t *colors, size_t count);
+void simd_palette_free(simd_palette_t *palette);
+/* Index in [start, end) of the entry nearest to color by squared RGBA distance, the lowest index on ties, with the distance in out_dist; returns end for an empty range. */
+size_t simd_palette_nearest(const simd_palette_t *palette, size_t start, size_t end, uint32_t color, uint32_t *out_dist);
+/* Snaps every channel of pixel_count RGBA pixels in place, bit-identical to quantize_bits(value, bits_rgb) on R/G/B and quantize_bits(value, bits_alpha) on A. */
+void simd_snap_rgba_bits(uint8_t *rgba, size_t pixel_count, uint8_t bits_rgb, uint8_t bits_alpha);
+/* Single-pixel form of simd_snap_rgba_bits for loops whose bit depths change from pixel to pixel. */
+void simd_snap_rgba_pixel(uint8_t *pixel, uint8_t bits_rgb, uint8_t bits_alpha);
+/* Highest level this build can run on the current CPU, whatever simd_force_level has selected since. */
+cpres_simd_level_t simd_detected_level(void);
+/* Switches the kernels to level for tests and benchmarks. Fails, leaving the selection alone, when the build or the CPU cannot run it; CPRES_SIMD_LEVEL_NONE always succeeds. */
+bool simd_force_level(cpres_simd_level_t level);
 
 #ifdef __cplusplus
 }
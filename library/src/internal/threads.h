@@ -20,6 +20,17 @@
 extern "C" {
 #endif
 
+/* Per-thread storage for state that concurrent encodes must not share. */
+#if defined(_MSC_VER)
+#define COLOPRESSO_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define COLOPRESSO_THREAD_LOCAL __thread
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define COLOPRESSO_THREAD_LOCAL _Thread_local
+#else
+#define COLOPRESSO_THREAD_LOCAL
+#endif
+
 typedef void (*parallel_func_t)(void *context, uint32_t start_index, uint32_t end_index);
 bool colopresso_parallel_for(uint32_t use_threads, uint32_t total_items, parallel_func_t func, void *context);
 
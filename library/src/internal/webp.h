@@ -19,11 +19,23 @@
 
 #include <colopresso.h>
 
+#include "png.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+bool webp_prepare_config(WebPConfig *webp_config, const cpres_config_t *config);
 cpres_error_t webp_encode_rgba_to_memory(uint8_t *rgba_data, uint32_t width, uint32_t height, uint8_t **webp_data, size_t *webp_size, const cpres_config_t *config);
+/* In the functions taking a prepared webp_config, config only supplies the cancel token and progress callback and may be NULL. */
+cpres_error_t webp_encode_rgba_to_writer(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, cpres_write_callback_t write, void *user_data, size_t *written_size,
+                                         const WebPConfig *webp_config, const cpres_config_t *config);
+cpres_error_t webp_encode_rgba_with_config(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **webp_data, size_t *webp_size, const WebPConfig *webp_config,
+                                           const cpres_config_t *config);
+/* Memory-limited variants: decode row strips straight into the WebP picture instead of a full RGBA buffer. The picture's ARGB plane is still full size. */
+cpres_error_t webp_encode_png_rows_to_writer(const png_row_input_t *input, cpres_write_callback_t write, void *user_data, size_t *written_size, const WebPConfig *webp_config,
+                                             const cpres_config_t *config);
+cpres_error_t webp_encode_png_rows_to_memory(const png_row_input_t *input, uint8_t **webp_data, size_t *webp_size, const WebPConfig *webp_config, const cpres_config_t *config);
 
 int webp_get_last_error(void);
 void webp_set_last_error(int error_code);
@@ -43,11 +43,13 @@ static void png_read_from_memory(png_structp png_ptr, png_bytep data, png_size_t
   reader->pos += length;
 }
 
-static inline cpres_error_t read_png_common(png_structp png, png_infop info, uint8_t **rgba_data, png_uint_32 *width, png_uint_32 *height) {
-  png_byte color_type, bit_depth;
+typedef struct {
+  uint8_t *buffer;
   png_bytep *row_pointers;
-  png_uint_32 y;
-  size_t row_bytes, total_size;
+} png_row_state_t;
+
+static inline cpres_error_t setup_rgba_transforms(png_structp png, png_infop info, png_uint_32 *width, png_uint_32 *height, png_source_info_t *source_info) {
+  png_byte color_type, bit_depth;
 
   png_read_info(png, info);
 
@@ -60,6 +62,13 @@ static inline cpres_error_t read_png_common(png_structp png, png_infop info, uin
     return CPRES_ERROR_INVALID_PNG;
   }
 
+  if (source_info) {
+    source_info->bit_depth = bit_depth;
+    source_info->color_type = color_type;
+    source_info->interlace_type = png_get_interlace_type(png, info);
+    source_info->has_trns = png_get_valid(png, info, PNG_INFO_tRNS) != 0;
+  }
+
   if (bit_depth == 16) {
     png_set_strip_16(png);
   }
@@ -84,8 +93,25 @@ static inline cpres_error_t read_png_common(png_structp png, png_infop info, uin
     png_set_gray_to_rgb(png);
   }
 
+  png_set_interlace_handling(png);
+
   png_read_update_info(png, info);
 
+  return CPRES_OK;
+}
+
+static inline cpres_error_t read_png_common(png_structp png, png_infop info, uint8_t **rgba_data, size_t *rgba_capacity, png_uint_32 *width, png_uint_32 *height, png_source_info_t *source_info) {
+  png_bytep *row_pointers;
+  png_uint_32 y;
+  size_t row_bytes, total_size;
+  uint8_t *grown;
+  cpres_error_t error;
+
+  error = setup_rgba_transforms(png, info, width, height, source_info);
+  if (error != CPRES_OK) {
+    return error;
+  }
+
   row_bytes = png_get_rowbytes(png, info);
 
   if (*height > 0 && row_bytes > SIZE_MAX / (*height)) {
@@ -95,15 +121,29 @@ static inline cpres_error_t read_png_common(png_structp png, png_infop info, uin
 
   total_size = row_bytes * (*height);
 
-  *rgba_data = (uint8_t *)malloc(total_size);
-  if (!*rgba_data) {
-    return CPRES_ERROR_OUT_OF_MEMORY;
+  if (rgba_capacity) {
+    /* Caller-owned buffer that survives across decodes; only grow it. */
+    if (!*rgba_data || *rgba_capacity < total_size) {
+      grown = (uint8_t *)realloc(*rgba_data, total_size);
+      if (!grown) {
+        return CPRES_ERROR_OUT_OF_MEMORY;
+      }
+      *rgba_data = grown;
+      *rgba_capacity = total_size;
+    }
+  } else {
+    *rgba_data = (uint8_t *)malloc(total_size);
+    if (!*rgba_data) {
+      return CPRES_ERROR_OUT_OF_MEMORY;
+    }
   }
 
   row_pointers = (png_bytep *)malloc(sizeof(png_bytep) * (*height));
   if (!row_pointers) {
-    free(*rgba_data);
-    *rgba_data = NULL;
+    if (!rgba_capacity) {
+      free(*rgba_data);
+      *rgba_data = NULL;
+    }
     return CPRES_ERROR_OUT_OF_MEMORY;
   }
 
@@ -118,7 +158,168 @@ static inline cpres_error_t read_png_common(png_structp png, png_infop info, uin
   return CPRES_OK;
 }
 
+static cpres_error_t read_png_rows(png_structp png, png_infop info, const png_row_sink_t *sink, png_row_state_t *state) {
+  png_uint_32 width, height, y, rows, i;
+  size_t row_bytes;
+  cpres_error_t error;
+
+  error = setup_rgba_transforms(png, info, &width, &height, NULL);
+  if (error != CPRES_OK) {
+    return error;
+  }
+
+  row_bytes = png_get_rowbytes(png, info);
+  if (row_bytes != (size_t)width * 4) {
+    return CPRES_ERROR_INVALID_PNG;
+  }
+
+  error = sink->begin(sink->context, width, height);
+  if (error != CPRES_OK) {
+    return error;
+  }
+
+  if (png_get_interlace_type(png, info) != PNG_INTERLACE_NONE) {
+    /* Adam7 rows are only complete after the last pass, so interlaced images are buffered whole and then handed over strip by strip. */
+    if (row_bytes > SIZE_MAX / height) {
+      return CPRES_ERROR_OUT_OF_MEMORY;
+    }
+
+    state->buffer = (uint8_t *)malloc(row_bytes * height);
+    state->row_pointers = (png_bytep *)malloc(sizeof(png_bytep) * height);
+    if (!state->buffer || !state->row_pointers) {
+      return CPRES_ERROR_OUT_OF_MEMORY;
+    }
+
+    for (y = 0; y < height; ++y) {
+      state->row_pointers[y] = state->buffer + (size_t)y * row_bytes;
+    }
+
+    png_read_image(png, state->row_pointers);
+
+    for (y = 0; y < height; y += rows) {
+      rows = height - y < PNG_ROW_STRIP_ROWS ? height - y : PNG_ROW_STRIP_ROWS;
+      error = sink->rows(sink->context, state->buffer + (size_t)y * row_bytes, y, rows);
+      if (error != CPRES_OK) {
+        return error;
+      }
+    }
+
+    return CPRES_OK;
+  }
+
+  state->buffer = (uint8_t *)malloc(row_bytes * PNG_ROW_STRIP_ROWS);
+  state->row_pointers = (png_bytep *)malloc(sizeof(png_bytep) * PNG_ROW_STRIP_ROWS);
+  if (!state->buffer || !state->row_pointers) {
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+
+  for (i = 0; i < PNG_ROW_STRIP_ROWS; ++i) {
+    state->row_pointers[i] = state->buffer + (size_t)i * row_bytes;
+  }
+
+  for (y = 0; y < height; y += rows) {
+    rows = height - y < PNG_ROW_STRIP_ROWS ? height - y : PNG_ROW_STRIP_ROWS;
+    png_read_rows(png, state->row_pointers, NULL, rows);
+    error = sink->rows(sink->context, state->buffer, y, rows);
+    if (error != CPRES_OK) {
+      return error;
+    }
+  }
+
+  return CPRES_OK;
+}
+
+/* fp is opened and closed by the caller, so nothing in this frame that the longjmp path reads is reassigned after setjmp. */
+static cpres_error_t decode_rows_from(const png_row_input_t *input, FILE *fp, const png_row_sink_t *sink) {
+  png_structp png;
+  png_infop info;
+  png_memory_reader_t reader = {0};
+  png_row_state_t state = {0};
+  cpres_error_t result;
+
+  png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (!png) {
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+
+  info = png_create_info_struct(png);
+  if (!info) {
+    png_destroy_read_struct(&png, NULL, NULL);
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+
+  if (setjmp(png_jmpbuf(png))) {
+    free(state.row_pointers);
+    free(state.buffer);
+    png_destroy_read_struct(&png, &info, NULL);
+    return CPRES_ERROR_INVALID_PNG;
+  }
+
+  if (fp) {
+    png_init_io(png, fp);
+  } else {
+    reader.data = input->png_data;
+    reader.size = input->png_size;
+    reader.pos = 0;
+    png_set_read_fn(png, &reader, png_read_from_memory);
+  }
+
+  result = read_png_rows(png, info, sink, &state);
+
+  free(state.row_pointers);
+  free(state.buffer);
+  png_destroy_read_struct(&png, &info, NULL);
+
+  return result;
+}
+
+extern cpres_error_t png_decode_rows(const png_row_input_t *input, const png_row_sink_t *sink) {
+  FILE *fp = NULL;
+  cpres_error_t result;
+
+  if (!input || !sink || !sink->begin || !sink->rows) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (input->png_data) {
+    if (input->png_size < 8) {
+      return CPRES_ERROR_INVALID_PARAMETER;
+    }
+    if (png_sig_cmp(input->png_data, 0, 8) != 0) {
+      return CPRES_ERROR_INVALID_PNG;
+    }
+  } else {
+#if COLOPRESSO_WITH_FILE_OPS
+    if (!input->path) {
+      return CPRES_ERROR_INVALID_PARAMETER;
+    }
+    fp = fopen(input->path, "rb");
+    if (!fp) {
+      return CPRES_ERROR_FILE_NOT_FOUND;
+    }
+#else
+    return CPRES_ERROR_INVALID_PARAMETER;
+#endif
+  }
+
+  result = decode_rows_from(input, fp, sink);
+  if (fp) {
+    fclose(fp);
+  }
+
+  return result;
+}
+
 extern cpres_error_t png_decode_from_memory(const uint8_t *png_data, size_t png_size, uint8_t **rgba_data, png_uint_32 *width, png_uint_32 *height) {
+  return png_decode_from_memory_with_info(png_data, png_size, rgba_data, width, height, NULL);
+}
+
+extern cpres_error_t png_decode_from_memory_with_info(const uint8_t *png_data, size_t png_size, uint8_t **rgba_data, png_uint_32 *width, png_uint_32 *height, png_source_info_t *source_info) {
+  return png_decode_from_memory_reuse(png_data, png_size, rgba_data, NULL, width, height, source_info);
+}
+
+extern cpres_error_t png_decode_from_memory_reuse(const uint8_t *png_data, size_t png_size, uint8_t **rgba_data, size_t *rgba_capacity, png_uint_32 *width, png_uint_32 *height,
+                                                  png_source_info_t *source_info) {
   png_structp png;
   png_infop info;
   png_memory_reader_t reader = {0};
@@ -153,13 +354,60 @@ extern cpres_error_t png_decode_from_memory(const uint8_t *png_data, size_t png_
   reader.pos = 0;
   png_set_read_fn(png, &reader, png_read_from_memory);
 
-  result = read_png_common(png, info, rgba_data, width, height);
+  result = read_png_common(png, info, rgba_data, rgba_capacity, width, height, source_info);
 
   png_destroy_read_struct(&png, &info, NULL);
 
   return result;
 }
 
+extern bool png_peek_dimensions(const png_row_input_t *input, png_uint_32 *width, png_uint_32 *height) {
+  uint8_t header[24];
+  const uint8_t *bytes;
+#if COLOPRESSO_WITH_FILE_OPS
+  FILE *fp;
+#endif
+
+  if (!input || !width || !height) {
+    return false;
+  }
+
+  if (input->png_data) {
+    if (input->png_size < sizeof(header)) {
+      return false;
+    }
+    bytes = input->png_data;
+  } else {
+#if COLOPRESSO_WITH_FILE_OPS
+    if (!input->path) {
+      return false;
+    }
+    fp = fopen(input->path, "rb");
+    if (!fp) {
+      return false;
+    }
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header)) {
+      fclose(fp);
+      return false;
+    }
+    fclose(fp);
+    bytes = header;
+#else
+    return false;
+#endif
+  }
+
+  /* IHDR is always the first chunk, so the dimensions sit at a fixed offset after the signature and chunk header. */
+  if (png_sig_cmp(bytes, 0, 8) != 0 || memcmp(bytes + 12, "IHDR", 4) != 0) {
+    return false;
+  }
+
+  *width = png_get_uint_32(bytes + 16);
+  *height = png_get_uint_32(bytes + 20);
+
+  return *width > 0 && *height > 0;
+}
+
 #if COLOPRESSO_WITH_FILE_OPS
 extern cpres_error_t png_decode_from_file(const char *filename, uint8_t **rgba_data, png_uint_32 *width, png_uint_32 *height) {
   FILE *fp;
@@ -193,7 +441,7 @@ extern cpres_error_t png_decode_from_file(const char *filename, uint8_t **rgba_d
 
   png_init_io(png, fp);
 
-  result = read_png_common(png, info, rgba_data, width, height);
+  result = read_png_common(png, info, rgba_data, NULL, width, height, NULL);
 
   png_destroy_read_struct(&png, &info, NULL);
   fclose(fp);
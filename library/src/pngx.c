@@ -10,27 +10,67 @@
  */
 
 #include <colopresso.h>
+#include <colopresso/portable.h>
 
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "internal/cancel.h"
+#include "internal/effort.h"
 #include "internal/log.h"
 #include "internal/pngx_common.h"
-
-static int g_pngx_last_error = 0;
+#include "internal/threads.h"
+
+typedef struct {
+  const pngx_source_t *source;
+  const pngx_options_t *opts;
+  pngx_options_t quant_opts;
+  pngx_options_t lossless_opts;
+  pngx_rgba_image_t *source_image;
+  pngx_branch_result_t *result;
+  uint64_t pixels;
+  bool quant_is_rgba_lossy;
+  bool concurrent;
+  bool lossless_done;
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_t mutex;
+#endif
+} branch_parallel_ctx_t;
+
+typedef struct {
+  pngx_options_t opts;
+  uint8_t *data;
+  size_t size;
+  int quality;
+  bool ok;
+  bool pending; /* Its slot had no scratch buffer, so it still needs quantizing */
+} search_candidate_t;
+
+typedef struct {
+  search_candidate_t *candidates;
+  const pngx_rgba_image_t *source;
+  pngx_scratch_t *pool;
+  uint32_t count;
+  uint32_t slots;
+} search_ctx_t;
+
+/* Set by the bridge call that last ran on this thread: the concurrent branches, search slots and batch workers each see only their own. */
+static COLOPRESSO_THREAD_LOCAL int g_pngx_last_error = 0;
 
 int pngx_get_last_error(void) { return g_pngx_last_error; }
 
 void pngx_set_last_error(int error_code) { g_pngx_last_error = error_code; }
 
-bool pngx_run_quantization(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality) {
+bool pngx_run_quantization_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality) {
   const char *label;
   uint32_t resolved_colors = 0, applied_colors = 0;
   bool success;
 
-  if (!png_data || png_size == 0 || !opts || !out_data || !out_size) {
+  if (!image || !image->rgba || !opts || !out_data || !out_size) {
+    rgba_image_reset(image);
     return false;
   }
 
@@ -41,7 +81,7 @@ bool pngx_run_quantization(const uint8_t *png_data, size_t png_size, const pngx_
   }
 
   if (opts->lossy_type == PNGX_LOSSY_TYPE_REDUCED_RGBA32) {
-    success = pngx_quantize_reduced_rgba32(png_data, png_size, opts, &resolved_colors, &applied_colors, out_data, out_size);
+    success = pngx_quantize_reduced_rgba32_image(image, opts, &resolved_colors, &applied_colors, out_data, out_size);
     if (success) {
       label = lossy_type_label(opts->lossy_type);
       colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: %s target %u colors -> %u unique", label, resolved_colors, applied_colors);
@@ -50,10 +90,475 @@ bool pngx_run_quantization(const uint8_t *png_data, size_t png_size, const pngx_
   }
 
   if (opts->lossy_type == PNGX_LOSSY_TYPE_LIMITED_RGBA4444) {
-    return pngx_quantize_limited4444(png_data, png_size, opts, out_data, out_size);
+    return pngx_quantize_limited4444_image(image, opts, out_data, out_size);
+  }
+
+  return pngx_quantize_palette256_image(image, opts, out_data, out_size, quant_quality);
+}
+
+bool pngx_run_quantization(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality) {
+  pngx_rgba_image_t image;
+
+  if (!png_data || png_size == 0 || !opts || !out_data || !out_size) {
+    return false;
+  }
+
+  *out_data = NULL;
+  *out_size = 0;
+  if (quant_quality) {
+    *quant_quality = -1;
+  }
+
+  if (!load_rgba_image(png_data, png_size, &image)) {
+    return false;
+  }
+
+  return pngx_run_quantization_image(&image, opts, out_data, out_size, quant_quality);
+}
+
+static inline void branch_lock(branch_parallel_ctx_t *ctx) {
+#if COLOPRESSO_ENABLE_THREADS
+  if (ctx->concurrent) {
+    colopresso_mutex_lock(&ctx->mutex);
+  }
+#else
+  (void)ctx;
+#endif
+}
+
+static inline void branch_unlock(branch_parallel_ctx_t *ctx) {
+#if COLOPRESSO_ENABLE_THREADS
+  if (ctx->concurrent) {
+    colopresso_mutex_unlock(&ctx->mutex);
+  }
+#else
+  (void)ctx;
+#endif
+}
+
+/* The budget was planned up front from a throughput guess. Once quantization has really been timed, lower the oxipng level so the passes still to run fit what is left. */
+static void branch_replan_level(branch_parallel_ctx_t *ctx, pngx_options_t *opts, uint32_t passes) {
+  pngx_branch_result_t *result = ctx->result;
+  double remaining_ms;
+  int level;
+
+  if (opts->deadline > 0.0 && ctx->pixels > 0 && passes > 0) {
+    remaining_ms = (opts->deadline - colopresso_get_monotonic_seconds()) * 1000.0;
+    level = effort_pngx_level_within(ctx->pixels, remaining_ms > 0.0 ? (uint64_t)remaining_ms : 0, opts->bridge.optimization_level, passes);
+    if (level < (int)opts->bridge.optimization_level) {
+      colopresso_log(CPRES_LOG_LEVEL_INFO, "PNGX: %.0f ms of the budget left for %u lossless pass(es) lowers level %u -> %d", remaining_ms > 0.0 ? remaining_ms : 0.0, passes,
+                     (unsigned)opts->bridge.optimization_level, level);
+      opts->bridge.optimization_level = (uint8_t)level;
+    }
+  }
+
+  branch_lock(ctx);
+  if (opts->bridge.optimization_level < result->optimization_level) {
+    result->optimization_level = opts->bridge.optimization_level;
+  }
+  branch_unlock(ctx);
+}
+
+static inline void search_add_candidate(search_candidate_t *candidate, const pngx_options_t *base, uint8_t lossy_type, uint16_t max_colors) {
+  memset(candidate, 0, sizeof(*candidate));
+  candidate->quality = -1;
+  candidate->opts = *base;
+  candidate->opts.lossy_type = lossy_type;
+  candidate->opts.lossy_max_colors = max_colors;
+  candidate->opts.lossless_deferred = true;
+}
+
+static inline void search_quantize_candidate(search_candidate_t *candidate, const pngx_rgba_image_t *source, uint8_t *scratch) {
+  pngx_rgba_image_t image;
+
+  memcpy(scratch, source->rgba, source->pixel_count * 4);
+  image = *source;
+  image.rgba = scratch;
+  image.borrowed = true;
+  candidate->ok = pngx_run_quantization_image(&image, &candidate->opts, &candidate->data, &candidate->size, &candidate->quality);
+}
+
+/* Each item is a slot that quantizes every slots-th candidate. The quantizers modify their image, so a slot refills one scratch buffer from the shared source for each of its
+ * candidates and lends it to them, rather than every candidate holding its own copy. A slot that cannot get its buffer leaves its candidates pending for search_run_pending. */
+static void search_worker(void *context, uint32_t start_index, uint32_t end_index) {
+  search_ctx_t *ctx = (search_ctx_t *)context;
+  uint8_t *scratch;
+  uint32_t slot, i;
+
+  if (!ctx) {
+    return;
+  }
+
+  for (slot = start_index; slot < end_index && slot < ctx->slots; ++slot) {
+    scratch = (uint8_t *)pngx_scratch_acquire(ctx->pool, PNGX_SCRATCH_SEARCH_RGBA, ctx->source->pixel_count * 4);
+
+    for (i = slot; i < ctx->count; i += ctx->slots) {
+      if (pngx_cancelled(&ctx->candidates[i].opts)) {
+        continue;
+      }
+      if (!scratch) {
+        ctx->candidates[i].pending = true;
+        continue;
+      }
+      search_quantize_candidate(&ctx->candidates[i], ctx->source, scratch);
+    }
+
+    pngx_scratch_release(ctx->pool, PNGX_SCRATCH_SEARCH_RGBA, scratch);
+  }
+}
+
+/* Quantizes the candidates a slot left behind, one at a time through a single buffer. False when even that buffer is unavailable: ranking what did get quantized would
+ * report a winner picked from an incomplete set. */
+static bool search_run_pending(search_ctx_t *ctx) {
+  uint8_t *scratch;
+  uint32_t i, pending = 0;
+
+  for (i = 0; i < ctx->count; ++i) {
+    if (ctx->candidates[i].pending) {
+      ++pending;
+    }
+  }
+  if (pending == 0) {
+    return true;
+  }
+
+  scratch = (uint8_t *)pngx_scratch_acquire(ctx->pool, PNGX_SCRATCH_SEARCH_RGBA, ctx->source->pixel_count * 4);
+  if (!scratch) {
+    return false;
+  }
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Search quantizing %u candidate(s) serially after a scratch allocation failed", pending);
+  for (i = 0; i < ctx->count; ++i) {
+    if (ctx->candidates[i].pending && !pngx_cancelled(&ctx->candidates[i].opts)) {
+      search_quantize_candidate(&ctx->candidates[i], ctx->source, scratch);
+    }
+    ctx->candidates[i].pending = false;
+  }
+
+  pngx_scratch_release(ctx->pool, PNGX_SCRATCH_SEARCH_RGBA, scratch);
+
+  return true;
+}
+
+static inline void search_drop_candidate(search_candidate_t *candidate) {
+  free(candidate->data);
+  candidate->data = NULL;
+  candidate->size = 0;
+  candidate->ok = false;
+}
+
+/* Quantizes every lossy type plus smaller palettes in parallel, keeping each candidate as a PNG written at the fast deflate level. That size is the estimate: oxipng
+ * rarely reorders candidates that are more than PNGX_SEARCH_PRUNE_RATIO apart, so only the ones near the best estimate go through the expensive lossless pass, which
+ * rewrites them from scratch. A survivor whose pass fails keeps its fast-deflate bytes. */
+static void run_lossy_search(branch_parallel_ctx_t *ctx) {
+  search_candidate_t candidates[PNGX_SEARCH_MAX_CANDIDATES];
+  search_ctx_t search;
+  pngx_branch_result_t *result = ctx->result;
+  pngx_options_t *base = &ctx->quant_opts;
+  uint8_t types[PNGX_SEARCH_MAX_CANDIDATES], *optimized = NULL;
+  uint16_t colors[PNGX_SEARCH_MAX_CANDIDATES], step_colors;
+  uint32_t planned = 0, count, threads, i, best, pruned = 0, survivors = 0;
+  size_t best_estimate = 0, optimized_size = 0;
+
+  types[planned] = PNGX_LOSSY_TYPE_PALETTE256;
+  colors[planned++] = base->lossy_max_colors;
+  for (step_colors = base->lossy_max_colors / 2, i = 0; i < PNGX_SEARCH_MAX_PALETTE_STEPS && step_colors >= PNGX_SEARCH_MIN_COLORS; step_colors /= 2, ++i) {
+    types[planned] = PNGX_LOSSY_TYPE_PALETTE256;
+    colors[planned++] = step_colors;
+  }
+  types[planned] = PNGX_LOSSY_TYPE_REDUCED_RGBA32;
+  colors[planned++] = base->lossy_max_colors;
+  types[planned] = PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+  colors[planned++] = base->lossy_max_colors;
+
+  count = planned;
+  for (i = 0; i < count; ++i) {
+    search_add_candidate(&candidates[i], base, types[i], colors[i]);
+  }
+
+  threads = base->thread_count > 0 ? base->thread_count : cpres_get_default_thread_count();
+  search.candidates = candidates;
+  search.source = ctx->source_image;
+  search.pool = base->scratch;
+  search.count = count;
+  search.slots = threads < count ? threads : count;
+  for (i = 0; i < count; ++i) {
+    candidates[i].opts.thread_count = threads > search.slots ? threads / search.slots : 1;
+  }
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Searching %u lossy candidates across %u threads", count, threads);
+
+  colopresso_parallel_for(search.slots, search.slots, search_worker, &search);
+  if (!search_run_pending(&search)) {
+    colopresso_log(CPRES_LOG_LEVEL_WARNING, "PNGX: Search ran out of memory for its scratch image");
+    for (i = 0; i < count; ++i) {
+      search_drop_candidate(&candidates[i]);
+    }
+    rgba_image_reset(ctx->source_image);
+    result->quant_out_of_memory = true;
+    return;
+  }
+  rgba_image_reset(ctx->source_image);
+  cancel_report_progress(base->progress_callback, base->progress_user_data, PNGX_PROGRESS_QUANTIZED);
+
+  /* Smaller palettes only earn their place by holding the quality floor; the configured palette is kept even when relaxed, as in the single-type path. */
+  for (i = 0; i < count; ++i) {
+    if (candidates[i].ok && candidates[i].opts.lossy_type == PNGX_LOSSY_TYPE_PALETTE256 && candidates[i].opts.lossy_max_colors < base->lossy_max_colors &&
+        candidates[i].quality >= 0 && candidates[i].quality < (int)base->lossy_quality_min) {
+      colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Search dropped %u colors palette (quality %d < %u)", (unsigned)candidates[i].opts.lossy_max_colors, candidates[i].quality,
+                     (unsigned)base->lossy_quality_min);
+      search_drop_candidate(&candidates[i]);
+    }
+    if (candidates[i].ok && (best_estimate == 0 || candidates[i].size < best_estimate)) {
+      best_estimate = candidates[i].size;
+    }
+  }
+
+  /* The estimates only compare with each other: a finished lossless result has been through oxipng, so it is left to the final selection instead of pruning here. */
+  for (i = 0; i < count; ++i) {
+    if (!candidates[i].ok) {
+      continue;
+    }
+
+    if ((float)candidates[i].size > (float)best_estimate * PNGX_SEARCH_PRUNE_RATIO) {
+      colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Search pruned %s/%u (%zu bytes, best estimate %zu bytes)", lossy_type_label(candidates[i].opts.lossy_type),
+                     (unsigned)candidates[i].opts.lossy_max_colors, candidates[i].size, best_estimate);
+      search_drop_candidate(&candidates[i]);
+      ++pruned;
+      continue;
+    }
+    ++survivors;
+  }
+
+  /* The serial path still owes the lossless branch its pass after these. */
+  branch_replan_level(ctx, base, ctx->concurrent ? survivors : survivors + 1);
+
+  best = count;
+  for (i = 0; i < count; ++i) {
+    if (candidates[i].ok && pngx_cancelled(ctx->opts)) {
+      search_drop_candidate(&candidates[i]);
+    }
+    if (!candidates[i].ok) {
+      continue;
+    }
+
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Search optimizing %s/%u (%zu bytes estimate)", lossy_type_label(candidates[i].opts.lossy_type), (unsigned)candidates[i].opts.lossy_max_colors,
+                   candidates[i].size);
+    if (pngx_run_lossless_optimization(candidates[i].data, candidates[i].size, base, &optimized, &optimized_size)) {
+      if (optimized_size < candidates[i].size) {
+        free(candidates[i].data);
+        candidates[i].data = optimized;
+        candidates[i].size = optimized_size;
+      } else {
+        free(optimized);
+      }
+    }
+
+    if (best == count || candidates[i].size < candidates[best].size) {
+      best = i;
+    }
+  }
+
+  for (i = 0; i < count; ++i) {
+    if (i != best) {
+      search_drop_candidate(&candidates[i]);
+    }
+  }
+
+  if (best == count) {
+    return;
+  }
+
+  result->quant_ok = true;
+  result->quant_data = candidates[best].data;
+  result->quant_size = candidates[best].size;
+  result->quant_quality = candidates[best].quality;
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Search picked %s/%u at %zu bytes (%u candidates, %u pruned before lossless)", lossy_type_label(candidates[best].opts.lossy_type),
+                 (unsigned)candidates[best].opts.lossy_max_colors, result->quant_size, count, pruned);
+}
+
+/* palette256 comes back as indices rather than a PNG, so the oxipng level is re-planned with quantization timed before the indexed pass spends it. The same gap is where a
+ * concurrent lossless result that already finished can drop the candidate without running the pass at all. */
+static void run_palette256_branch(branch_parallel_ctx_t *ctx) {
+  pngx_branch_result_t *result = ctx->result;
+  pngx_indexed_image_t indexed;
+  uint8_t *fallback = NULL;
+  size_t fallback_size = 0, lossless_size;
+
+  if (!pngx_quantize_palette256_indexed(ctx->source_image, &ctx->quant_opts, &indexed, &result->quant_quality)) {
+    return;
+  }
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Quantization produced %zu colors (quality=%d)", indexed.palette_len, result->quant_quality);
+  cancel_report_progress(ctx->quant_opts.progress_callback, ctx->quant_opts.progress_user_data, PNGX_PROGRESS_QUANTIZED);
+
+  if (pngx_cancelled(ctx->opts)) {
+    pngx_indexed_image_reset(&indexed);
+    return;
   }
 
-  return pngx_quantize_palette256(png_data, png_size, opts, out_data, out_size, quant_quality);
+  branch_replan_level(ctx, &ctx->quant_opts, ctx->concurrent ? 1 : 2);
+
+  branch_lock(ctx);
+  lossless_size = ctx->lossless_done && result->lossless_ok ? result->lossless_size : 0;
+  branch_unlock(ctx);
+
+  /* Not like for like: the libpng fallback is before oxipng and the lossless size after it. A dropped candidate would have needed oxipng to shrink it by more than a third
+   * to win, which it rarely does, but when it would have, the serial path keeps it and this one does not (see pngx_parallel_branches). The fallback is only written when
+   * there is something to compare it with, and then doubles as the output should the indexed pass fail. */
+  if (lossless_size > 0 && pngx_create_palette_png(indexed.indices, indexed.indices_len, indexed.palette, indexed.palette_len, indexed.width, indexed.height, &fallback, &fallback_size) &&
+      (float)fallback_size > (float)lossless_size * PNGX_PARALLEL_BRANCH_PRUNE_RATIO) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Dropped quantized candidate (%zu bytes) against finished lossless result (%zu bytes)", fallback_size, lossless_size);
+    free(fallback);
+    pngx_indexed_image_reset(&indexed);
+    result->quant_pruned = true;
+    return;
+  }
+
+  if (fallback) {
+    if (pngx_run_indexed_optimization(indexed.indices, indexed.indices_len, indexed.palette, indexed.palette_len, indexed.width, indexed.height, &ctx->quant_opts, &result->quant_data,
+                                      &result->quant_size)) {
+      free(fallback);
+    } else {
+      result->quant_data = fallback;
+      result->quant_size = fallback_size;
+    }
+    result->quant_ok = true;
+  } else {
+    result->quant_ok = pngx_palette256_write_indexed(&indexed, &ctx->quant_opts, &result->quant_data, &result->quant_size, NULL);
+  }
+  if (result->quant_ok) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Palette output at level %u produced %zu bytes", (unsigned)ctx->quant_opts.bridge.optimization_level, result->quant_size);
+  }
+
+  pngx_indexed_image_reset(&indexed);
+}
+
+static void run_lossy_branch(branch_parallel_ctx_t *ctx) {
+  pngx_branch_result_t *result = ctx->result;
+
+  if (!ctx->source_image || !ctx->source_image->rgba) {
+    return;
+  }
+
+  if (ctx->quant_opts.search_enable) {
+    run_lossy_search(ctx);
+    return;
+  }
+
+  if (!ctx->quant_is_rgba_lossy) {
+    run_palette256_branch(ctx);
+    return;
+  }
+
+  /* The RGBA modes skip oxipng altogether, so there is nothing left to plan. */
+  result->quant_ok = pngx_run_quantization_image(ctx->source_image, &ctx->quant_opts, &result->quant_data, &result->quant_size, &result->quant_quality);
+  if (result->quant_ok) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Quantization produced %zu bytes (quality=%d)", result->quant_size, result->quant_quality);
+    cancel_report_progress(ctx->quant_opts.progress_callback, ctx->quant_opts.progress_user_data, PNGX_PROGRESS_QUANTIZED);
+  }
+}
+
+static void run_lossless_branch(branch_parallel_ctx_t *ctx) {
+  pngx_branch_result_t *result = ctx->result;
+  uint8_t *data = NULL;
+  size_t size = 0;
+  bool ok;
+
+  if (!ctx->concurrent && ctx->quant_is_rgba_lossy && result->quant_ok) {
+    result->lossless_skipped = true;
+    return;
+  }
+
+  /* Run concurrently, this pass starts with nothing timed yet. */
+  if (!ctx->concurrent) {
+    branch_replan_level(ctx, &ctx->lossless_opts, 1);
+  }
+
+  if (ctx->source->rgba) {
+    ok = pngx_run_rgba_optimization(ctx->source->rgba, ctx->source->width, ctx->source->height, ctx->source->stride, &ctx->lossless_opts, &data, &size);
+  } else {
+    ok = pngx_run_lossless_optimization(ctx->source->png_data, ctx->source->png_size, &ctx->lossless_opts, &data, &size);
+  }
+
+  branch_lock(ctx);
+  result->lossless_ok = ok;
+  result->lossless_data = data;
+  result->lossless_size = size;
+  ctx->lossless_done = true;
+  branch_unlock(ctx);
+
+  if (ok) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Lossless branch finished (%zu bytes)", size);
+  }
+}
+
+static void branch_parallel_worker(void *context, uint32_t start_index, uint32_t end_index) {
+  branch_parallel_ctx_t *ctx = (branch_parallel_ctx_t *)context;
+  uint32_t i;
+
+  if (!ctx) {
+    return;
+  }
+
+  for (i = start_index; i < end_index; ++i) {
+    if (i == 0) {
+      run_lossy_branch(ctx);
+    } else {
+      run_lossless_branch(ctx);
+    }
+  }
+}
+
+void pngx_run_branches(const pngx_source_t *source, const pngx_options_t *opts, pngx_rgba_image_t *source_image, pngx_branch_result_t *result) {
+  branch_parallel_ctx_t ctx;
+#if COLOPRESSO_ENABLE_THREADS
+  uint32_t total_threads, quant_threads;
+#endif
+
+  if (!result) {
+    return;
+  }
+
+  memset(result, 0, sizeof(*result));
+  result->quant_quality = -1;
+
+  if (!source || (!source->rgba && (!source->png_data || source->png_size == 0)) || !opts) {
+    return;
+  }
+  result->optimization_level = opts->bridge.optimization_level;
+
+  ctx.source = source;
+  ctx.opts = opts;
+  ctx.quant_opts = *opts;
+  ctx.lossless_opts = *opts;
+  ctx.source_image = source_image;
+  ctx.result = result;
+  ctx.pixels = source_image && source_image->rgba ? (uint64_t)source_image->width * (uint64_t)source_image->height : 0;
+  ctx.quant_is_rgba_lossy = !opts->search_enable && (opts->lossy_type == PNGX_LOSSY_TYPE_LIMITED_RGBA4444 || opts->lossy_type == PNGX_LOSSY_TYPE_REDUCED_RGBA32);
+  ctx.concurrent = false;
+  ctx.lossless_done = false;
+
+#if COLOPRESSO_ENABLE_THREADS
+  total_threads = opts->thread_count > 0 ? opts->thread_count : cpres_get_default_thread_count();
+  quant_threads = total_threads;
+  if (opts->parallel_branches && !ctx.quant_is_rgba_lossy && source_image && source_image->rgba && total_threads >= 2) {
+    /* Each branch hands its own share to the bridge, so neither can grow into the other's pool. */
+    quant_threads = total_threads / 2;
+    ctx.quant_opts.thread_count = quant_threads;
+    ctx.lossless_opts.thread_count = total_threads - quant_threads;
+    ctx.concurrent = colopresso_mutex_init(&ctx.mutex, NULL) == 0;
+  }
+
+  if (ctx.concurrent) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Running lossy and lossless branches concurrently (%u + %u threads)", quant_threads, total_threads - quant_threads);
+    colopresso_parallel_for(2, 2, branch_parallel_worker, &ctx);
+    colopresso_mutex_destroy(&ctx.mutex);
+    return;
+  }
+#endif
+
+  branch_parallel_worker(&ctx, 0, 2);
 }
 
 void pngx_fill_pngx_options(pngx_options_t *opts, const cpres_config_t *config) {
@@ -69,7 +574,9 @@ void pngx_fill_pngx_options(pngx_options_t *opts, const cpres_config_t *config)
        saliency_map_enable = COLOPRESSO_PNGX_DEFAULT_SALIENCY_MAP_ENABLE, chroma_anchor_enable = COLOPRESSO_PNGX_DEFAULT_CHROMA_ANCHOR_ENABLE,
        adaptive_dither_enable = COLOPRESSO_PNGX_DEFAULT_ADAPTIVE_DITHER_ENABLE, gradient_boost_enable = COLOPRESSO_PNGX_DEFAULT_GRADIENT_BOOST_ENABLE,
        chroma_weight_enable = COLOPRESSO_PNGX_DEFAULT_CHROMA_WEIGHT_ENABLE, postprocess_smooth_enable = COLOPRESSO_PNGX_DEFAULT_POSTPROCESS_SMOOTH_ENABLE,
-       palette256_gradient_profile_enable = COLOPRESSO_PNGX_DEFAULT_PALETTE256_GRADIENT_PROFILE_ENABLE, palette256_alpha_bleed_enable = COLOPRESSO_PNGX_DEFAULT_PALETTE256_ALPHA_BLEED_ENABLE;
+       palette256_gradient_profile_enable = COLOPRESSO_PNGX_DEFAULT_PALETTE256_GRADIENT_PROFILE_ENABLE, palette256_alpha_bleed_enable = COLOPRESSO_PNGX_DEFAULT_PALETTE256_ALPHA_BLEED_ENABLE,
+       parallel_branches = COLOPRESSO_PNGX_DEFAULT_PARALLEL_BRANCHES, search_enable = COLOPRESSO_PNGX_DEFAULT_SEARCH_ENABLE,
+       tiled_dither_enable = COLOPRESSO_PNGX_DEFAULT_TILED_DITHER_ENABLE;
   float lossy_dither_level = COLOPRESSO_PNGX_DEFAULT_LOSSY_DITHER_LEVEL, postprocess_smooth_importance_cutoff = COLOPRESSO_PNGX_DEFAULT_POSTPROCESS_SMOOTH_IMPORTANCE_CUTOFF,
         palette256_gradient_profile_dither_floor = PNGX_PALETTE256_GRADIENT_PROFILE_DITHER_FLOOR, palette256_profile_opaque_ratio_threshold = PNGX_PALETTE256_GRADIENT_PROFILE_OPAQUE_RATIO_THRESHOLD,
         palette256_profile_gradient_mean_max = PNGX_PALETTE256_GRADIENT_PROFILE_GRADIENT_MEAN_MAX, palette256_profile_saturation_mean_max = PNGX_PALETTE256_GRADIENT_PROFILE_SATURATION_MEAN_MAX,
@@ -193,9 +700,22 @@ void pngx_fill_pngx_options(pngx_options_t *opts, const cpres_config_t *config)
     if (config->pngx_threads >= 0) {
       thread_count = (uint32_t)config->pngx_threads;
     }
+    parallel_branches = config->pngx_parallel_branches;
+    search_enable = config->pngx_search_enable;
+    tiled_dither_enable = config->pngx_tiled_dither_enable;
+    opts->time_budget_ms = config->time_budget_ms > 0 ? (uint32_t)config->time_budget_ms : 0;
+    opts->effort_report = config->effort_report;
+    opts->cancel_token = config->cancel_token;
+    opts->progress_callback = config->progress_callback;
+    opts->progress_user_data = config->progress_user_data;
   } else {
     opts->protected_colors = NULL;
     opts->protected_colors_count = 0;
+    opts->time_budget_ms = 0;
+    opts->effort_report = NULL;
+    opts->cancel_token = NULL;
+    opts->progress_callback = NULL;
+    opts->progress_user_data = NULL;
   }
 
   lossy_quality_min = clamp_uint8_t(lossy_quality_min, 0, 100);
@@ -296,6 +816,21 @@ void pngx_fill_pngx_options(pngx_options_t *opts, const cpres_config_t *config)
   opts->palette256_tune_quality_min_floor = palette256_tune_quality_min_floor;
   opts->palette256_tune_quality_max_target = palette256_tune_quality_max_target;
   opts->thread_count = thread_count;
+  opts->parallel_branches = parallel_branches;
+  opts->search_enable = search_enable;
+  opts->tiled_dither_enable = tiled_dither_enable;
+  opts->lossless_deferred = false;
+  opts->deadline = 0.0;
+  opts->scratch = NULL;
+}
+
+static inline void fill_lossless_options(PngxBridgeLosslessOptions *lossless, const pngx_options_t *opts) {
+  memset(lossless, 0, sizeof(*lossless));
+  lossless->optimization_level = opts->bridge.optimization_level;
+  lossless->strip_safe = opts->bridge.strip_safe;
+  lossless->optimize_alpha = opts->bridge.optimize_alpha;
+  lossless->cancel_flag = cancel_token_flag(opts->cancel_token);
+  lossless->thread_count = opts->thread_count;
 }
 
 bool pngx_run_lossless_optimization(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size) {
@@ -309,10 +844,7 @@ bool pngx_run_lossless_optimization(const uint8_t *png_data, size_t png_size, co
   *out_data = NULL;
   *out_size = 0;
 
-  memset(&lossless, 0, sizeof(lossless));
-  lossless.optimization_level = opts->bridge.optimization_level;
-  lossless.strip_safe = opts->bridge.strip_safe;
-  lossless.optimize_alpha = opts->bridge.optimize_alpha;
+  fill_lossless_options(&lossless, opts);
   result = pngx_bridge_optimize_lossless(png_data, png_size, out_data, out_size, &lossless);
   pngx_set_last_error((int)result);
 
@@ -323,6 +855,65 @@ bool pngx_run_lossless_optimization(const uint8_t *png_data, size_t png_size, co
   return true;
 }
 
+bool pngx_run_rgba_optimization(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t stride, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size) {
+  PngxBridgeLosslessOptions lossless;
+  PngxBridgeResult result;
+
+  if (!rgba || width == 0 || height == 0 || !opts || !out_data || !out_size) {
+    return false;
+  }
+
+  *out_data = NULL;
+  *out_size = 0;
+
+  fill_lossless_options(&lossless, opts);
+  result = pngx_bridge_optimize_rgba(rgba, width, height, (size_t)stride, out_data, out_size, &lossless);
+  if (result == PNGX_BRIDGE_RESULT_SUCCESS && !*out_data) {
+    result = PNGX_BRIDGE_RESULT_OPTIMIZATION_FAILED;
+  }
+  pngx_set_last_error((int)result);
+
+  if (result != PNGX_BRIDGE_RESULT_SUCCESS) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: RGBA lossless optimization failed (bridge result %d)", (int)result);
+    free(*out_data);
+    *out_data = NULL;
+    *out_size = 0;
+    return false;
+  }
+
+  return true;
+}
+
+bool pngx_run_indexed_optimization(const uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len, uint32_t width, uint32_t height, const pngx_options_t *opts,
+                                   uint8_t **out_data, size_t *out_size) {
+  PngxBridgeLosslessOptions lossless;
+  PngxBridgeResult result;
+
+  if (!indices || indices_len == 0 || !palette || palette_len == 0 || !opts || !out_data || !out_size) {
+    return false;
+  }
+
+  *out_data = NULL;
+  *out_size = 0;
+
+  fill_lossless_options(&lossless, opts);
+  result = pngx_bridge_optimize_indexed(indices, indices_len, width, height, palette, palette_len, out_data, out_size, &lossless);
+  if (result == PNGX_BRIDGE_RESULT_SUCCESS && !*out_data) {
+    result = PNGX_BRIDGE_RESULT_OPTIMIZATION_FAILED;
+  }
+  pngx_set_last_error((int)result);
+
+  if (result != PNGX_BRIDGE_RESULT_SUCCESS) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Indexed lossless optimization failed (bridge result %d)", (int)result);
+    free(*out_data);
+    *out_data = NULL;
+    *out_size = 0;
+    return false;
+  }
+
+  return true;
+}
+
 bool pngx_should_attempt_quantization(const pngx_options_t *opts) {
   if (!opts) {
     return false;
@@ -39,29 +39,63 @@ typedef struct {
   uint8_t bits_alpha;
 } snap_rgba_parallel_ctx_t;
 
+typedef struct {
+  uint8_t *rgba;
+  const uint8_t *warmup;
+  png_uint_32 width;
+  png_uint_32 height;
+  pngx_dither_rows_fn fn;
+  void *context;
+  volatile int32_t stopped;
+} dither_band_ctx_t;
+
+typedef struct {
+  double gradient_accum;
+  size_t opaque_pixels;
+  size_t translucent_pixels;
+  size_t non_opaque_pixels;
+  float luma_min;
+  float luma_max;
+  bool alpha_used[256];
+} image_analysis_slice_t;
+
+typedef struct {
+  const uint8_t *rgba;
+  png_uint_32 width;
+  png_uint_32 height;
+  image_analysis_slice_t *slices;
+  volatile int32_t failed;
+} image_analysis_ctx_t;
+
+typedef struct {
+  float gradient_sum;
+  float saturation_sum;
+  float gradient_max;
+  size_t vibrant_pixels;
+  uint16_t raw_min;
+  uint16_t raw_max;
+} prepare_slice_t;
+
+typedef struct {
+  const pngx_rgba_image_t *image;
+  const pngx_options_t *opts;
+  prepare_slice_t *slices;
+  chroma_bucket_t *buckets; /* PNGX_CHROMA_BUCKET_COUNT per slice, or NULL */
+  uint16_t *importance_work;
+  uint32_t slice_rows;
+  volatile int32_t failed;
+} prepare_support_ctx_t;
+
 static void snap_rgba_parallel_worker(void *context, uint32_t start, uint32_t end) {
   snap_rgba_parallel_ctx_t *ctx = (snap_rgba_parallel_ctx_t *)context;
-  uint8_t r, g, b, a;
-  size_t base, i;
+  size_t last;
 
-  if (!ctx || !ctx->rgba) {
+  if (!ctx || !ctx->rgba || (size_t)start >= ctx->pixel_count) {
     return;
   }
 
-  for (i = (size_t)start; i < (size_t)end && i < ctx->pixel_count; ++i) {
-    base = i * 4;
-    r = ctx->rgba[base + 0];
-    g = ctx->rgba[base + 1];
-    b = ctx->rgba[base + 2];
-    a = ctx->rgba[base + 3];
-
-    snap_rgba_to_bits(&r, &g, &b, &a, ctx->bits_rgb, ctx->bits_alpha);
-
-    ctx->rgba[base + 0] = r;
-    ctx->rgba[base + 1] = g;
-    ctx->rgba[base + 2] = b;
-    ctx->rgba[base + 3] = a;
-  }
+  last = (size_t)end < ctx->pixel_count ? (size_t)end : ctx->pixel_count;
+  simd_snap_rgba_bits(ctx->rgba + (size_t)start * 4, last - (size_t)start, clamp_reduced_bits(ctx->bits_rgb), clamp_reduced_bits(ctx->bits_alpha));
 }
 
 static inline float absf(float value) { return (value < 0.0f) ? -value : value; }
@@ -96,14 +130,14 @@ static inline float calc_saturation(uint8_t r, uint8_t g, uint8_t b) {
 
 static inline float calc_luma(uint8_t r, uint8_t g, uint8_t b) { return PNGX_COMMON_LUMA_R_COEFF * (float)r + PNGX_COMMON_LUMA_G_COEFF * (float)g + PNGX_COMMON_LUMA_B_COEFF * (float)b; }
 
-static inline bool decode_png_rgba(const uint8_t *png_data, size_t png_size, uint8_t **rgba, png_uint_32 *width, png_uint_32 *height) {
+static inline bool decode_png_rgba(const uint8_t *png_data, size_t png_size, uint8_t **rgba, png_uint_32 *width, png_uint_32 *height, png_source_info_t *source_info) {
   cpres_error_t status;
 
   if (!png_data || png_size == 0 || !rgba || !width || !height) {
     return false;
   }
 
-  status = png_decode_from_memory(png_data, png_size, rgba, width, height);
+  status = png_decode_from_memory_with_info(png_data, png_size, rgba, width, height, source_info);
   if (status != CPRES_OK) {
     colopresso_log(CPRES_LOG_LEVEL_WARNING, "PNGX: Failed to decode PNG (%d)", (int)status);
     return false;
@@ -220,9 +254,10 @@ void quant_support_reset(pngx_quant_support_t *support) {
     return;
   }
 
-  free(support->importance_map);
+  pngx_scratch_release(support->scratch, PNGX_SCRATCH_IMPORTANCE_MAP, support->importance_map);
   support->importance_map = NULL;
   support->importance_map_len = 0;
+  support->scratch = NULL;
 
   free(support->derived_colors);
   support->derived_colors = NULL;
@@ -253,24 +288,33 @@ void rgba_image_reset(pngx_rgba_image_t *image) {
     return;
   }
 
-  free(image->rgba);
+  if (!image->borrowed) {
+    free(image->rgba);
+  }
   image->rgba = NULL;
+  image->borrowed = false;
   image->width = 0;
   image->height = 0;
   image->pixel_count = 0;
+  image->source_bit_depth = 0;
+  image->source_color_type = 0;
+  image->source_has_trns = false;
 }
 
 bool load_rgba_image(const uint8_t *png_data, size_t png_size, pngx_rgba_image_t *image) {
+  png_source_info_t source_info = {0};
+
   if (!png_data || png_size == 0 || !image) {
     return false;
   }
 
   image->rgba = NULL;
+  image->borrowed = false;
   image->width = 0;
   image->height = 0;
   image->pixel_count = 0;
 
-  if (!decode_png_rgba(png_data, png_size, &image->rgba, &image->width, &image->height)) {
+  if (!decode_png_rgba(png_data, png_size, &image->rgba, &image->width, &image->height, &source_info)) {
     rgba_image_reset(image);
     return false;
   }
@@ -285,6 +329,202 @@ bool load_rgba_image(const uint8_t *png_data, size_t png_size, pngx_rgba_image_t
     return false;
   }
 
+  image->source_bit_depth = source_info.bit_depth;
+  image->source_color_type = source_info.color_type;
+  image->source_has_trns = source_info.has_trns;
+  image->pixel_count = (size_t)image->width * (size_t)image->height;
+
+  return true;
+}
+
+struct pngx_scratch {
+  void *data[PNGX_SCRATCH_SLOT_COUNT];
+  size_t capacity[PNGX_SCRATCH_SLOT_COUNT];
+  bool lent[PNGX_SCRATCH_SLOT_COUNT];
+  uint32_t allocations;
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_t mutex; /* Search slots and concurrent branches borrow from one pool */
+#endif
+};
+
+static inline void scratch_lock(pngx_scratch_t *scratch) {
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_lock(&scratch->mutex);
+#else
+  (void)scratch;
+#endif
+}
+
+static inline void scratch_unlock(pngx_scratch_t *scratch) {
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_unlock(&scratch->mutex);
+#else
+  (void)scratch;
+#endif
+}
+
+pngx_scratch_t *pngx_scratch_create(void) {
+  pngx_scratch_t *scratch;
+
+  scratch = (pngx_scratch_t *)calloc(1, sizeof(pngx_scratch_t));
+  if (!scratch) {
+    return NULL;
+  }
+
+#if COLOPRESSO_ENABLE_THREADS
+  if (colopresso_mutex_init(&scratch->mutex, NULL) != 0) {
+    free(scratch);
+    return NULL;
+  }
+#endif
+
+  return scratch;
+}
+
+void pngx_scratch_destroy(pngx_scratch_t *scratch) {
+  uint32_t slot;
+
+  if (!scratch) {
+    return;
+  }
+
+  for (slot = 0; slot < PNGX_SCRATCH_SLOT_COUNT; ++slot) {
+    free(scratch->data[slot]);
+  }
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_mutex_destroy(&scratch->mutex);
+#endif
+  free(scratch);
+}
+
+void pngx_scratch_begin(pngx_scratch_t *scratch) {
+  if (!scratch) {
+    return;
+  }
+
+  scratch_lock(scratch);
+  memset(scratch->lent, 0, sizeof(scratch->lent));
+  scratch->allocations = 0;
+  scratch_unlock(scratch);
+}
+
+uint32_t pngx_scratch_allocations(pngx_scratch_t *scratch) {
+  uint32_t allocations;
+
+  if (!scratch) {
+    return 0;
+  }
+
+  scratch_lock(scratch);
+  allocations = scratch->allocations;
+  scratch_unlock(scratch);
+
+  return allocations;
+}
+
+void *pngx_scratch_acquire(pngx_scratch_t *scratch, pngx_scratch_slot_t slot, size_t size) {
+  void *buffer;
+
+  if (size == 0) {
+    size = 1;
+  }
+
+  if (!scratch || slot >= PNGX_SCRATCH_SLOT_COUNT) {
+    return malloc(size);
+  }
+
+  scratch_lock(scratch);
+  if (scratch->lent[slot]) {
+    ++scratch->allocations;
+    scratch_unlock(scratch);
+    return malloc(size);
+  }
+
+  /* The old contents are never needed, so a plain malloc replaces the buffer rather than a realloc that would copy it. */
+  if (scratch->capacity[slot] < size) {
+    buffer = malloc(size);
+    if (!buffer) {
+      scratch_unlock(scratch);
+      return NULL;
+    }
+    free(scratch->data[slot]);
+    scratch->data[slot] = buffer;
+    scratch->capacity[slot] = size;
+    ++scratch->allocations;
+  }
+  scratch->lent[slot] = true;
+  buffer = scratch->data[slot];
+  scratch_unlock(scratch);
+
+  return buffer;
+}
+
+void pngx_scratch_release(pngx_scratch_t *scratch, pngx_scratch_slot_t slot, void *buffer) {
+  if (!buffer) {
+    return;
+  }
+
+  if (scratch && slot < PNGX_SCRATCH_SLOT_COUNT) {
+    scratch_lock(scratch);
+    if (buffer == scratch->data[slot]) {
+      scratch->lent[slot] = false;
+      scratch_unlock(scratch);
+      return;
+    }
+    scratch_unlock(scratch);
+  }
+
+  free(buffer);
+}
+
+bool load_rgba_image_scratch(const uint8_t *png_data, size_t png_size, pngx_scratch_t *scratch, pngx_rgba_image_t *image) {
+  png_source_info_t source_info = {0};
+  uint8_t *buffer;
+  size_t capacity;
+  cpres_error_t status;
+
+  if (!scratch || !png_data || png_size == 0 || !image) {
+    return load_rgba_image(png_data, png_size, image);
+  }
+
+  scratch_lock(scratch);
+  if (scratch->lent[PNGX_SCRATCH_SOURCE_RGBA]) {
+    ++scratch->allocations;
+    scratch_unlock(scratch);
+    return load_rgba_image(png_data, png_size, image);
+  }
+  scratch->lent[PNGX_SCRATCH_SOURCE_RGBA] = true;
+  buffer = (uint8_t *)scratch->data[PNGX_SCRATCH_SOURCE_RGBA];
+  capacity = scratch->capacity[PNGX_SCRATCH_SOURCE_RGBA];
+  scratch_unlock(scratch);
+
+  rgba_image_reset(image);
+  status = png_decode_from_memory_reuse(png_data, png_size, &buffer, &capacity, &image->width, &image->height, &source_info);
+
+  /* The decoder only grows the buffer, and keeps it on failure, so the pool takes it back either way. */
+  scratch_lock(scratch);
+  if (capacity != scratch->capacity[PNGX_SCRATCH_SOURCE_RGBA]) {
+    ++scratch->allocations;
+  }
+  scratch->data[PNGX_SCRATCH_SOURCE_RGBA] = buffer;
+  scratch->capacity[PNGX_SCRATCH_SOURCE_RGBA] = capacity;
+  if (status != CPRES_OK) {
+    scratch->lent[PNGX_SCRATCH_SOURCE_RGBA] = false;
+  }
+  scratch_unlock(scratch);
+
+  if (status != CPRES_OK) {
+    colopresso_log(CPRES_LOG_LEVEL_WARNING, "PNGX: Failed to decode PNG (%d)", (int)status);
+    image->width = 0;
+    image->height = 0;
+    return false;
+  }
+
+  image->rgba = buffer;
+  image->borrowed = true;
+  image->source_bit_depth = source_info.bit_depth;
+  image->source_color_type = source_info.color_type;
+  image->source_has_trns = source_info.has_trns;
   image->pixel_count = (size_t)image->width * (size_t)image->height;
 
   return true;
@@ -389,6 +629,98 @@ void snap_rgba_image_to_bits(uint32_t thread_count, uint8_t *rgba, size_t pixel_
 #endif
 }
 
+static void dither_band_worker(void *context, uint32_t start, uint32_t end) {
+  dither_band_ctx_t *ctx = (dither_band_ctx_t *)context;
+  uint32_t band, first_y, row_count;
+  size_t row_stride, warmup_size;
+  uint8_t *scratch;
+  float *err_curr, *err_next;
+
+  if (!ctx || start >= end) {
+    return;
+  }
+
+  row_stride = (size_t)ctx->width * PNGX_RGBA_CHANNELS;
+  warmup_size = row_stride * PNGX_DITHER_BAND_WARMUP_ROWS;
+  err_curr = (float *)calloc(row_stride, sizeof(float));
+  err_next = (float *)calloc(row_stride, sizeof(float));
+  scratch = (uint8_t *)malloc(warmup_size);
+  if (!err_curr || !err_next || !scratch) {
+    colopresso_atomic_store_i32(&ctx->stopped, 1);
+    free(err_curr);
+    free(err_next);
+    free(scratch);
+    return;
+  }
+
+  for (band = start; band < end && colopresso_atomic_load_i32(&ctx->stopped) == 0; ++band) {
+    first_y = band * PNGX_DITHER_BAND_ROWS;
+    row_count = (ctx->height - first_y < PNGX_DITHER_BAND_ROWS) ? ctx->height - first_y : PNGX_DITHER_BAND_ROWS;
+    memset(err_curr, 0, row_stride * sizeof(float));
+
+    if (band > 0) {
+      memcpy(scratch, ctx->warmup + (size_t)(band - 1) * warmup_size, warmup_size);
+      if (!ctx->fn(ctx->context, scratch, first_y - PNGX_DITHER_BAND_WARMUP_ROWS, PNGX_DITHER_BAND_WARMUP_ROWS, true, &err_curr, &err_next)) {
+        colopresso_atomic_store_i32(&ctx->stopped, 1);
+        break;
+      }
+    }
+
+    if (!ctx->fn(ctx->context, ctx->rgba + (size_t)first_y * row_stride, first_y, row_count, false, &err_curr, &err_next)) {
+      colopresso_atomic_store_i32(&ctx->stopped, 1);
+      break;
+    }
+  }
+
+  free(err_curr);
+  free(err_next);
+  free(scratch);
+}
+
+bool dither_rows_in_bands(uint32_t thread_count, uint8_t *rgba, png_uint_32 width, png_uint_32 height, pngx_dither_rows_fn fn, void *context) {
+  dither_band_ctx_t ctx;
+  uint32_t band_count, band;
+  size_t row_stride, warmup_size;
+  uint8_t *warmup = NULL;
+
+  if (!rgba || !fn || width == 0 || height == 0) {
+    return false;
+  }
+
+  row_stride = (size_t)width * PNGX_RGBA_CHANNELS;
+  warmup_size = row_stride * PNGX_DITHER_BAND_WARMUP_ROWS;
+  band_count = (uint32_t)(((size_t)height + PNGX_DITHER_BAND_ROWS - 1) / PNGX_DITHER_BAND_ROWS);
+
+  /* Bands overwrite their rows in place, so the warm-up rows are copied out before any band starts. */
+  if (band_count > 1) {
+    warmup = (uint8_t *)malloc((size_t)(band_count - 1) * warmup_size);
+    if (!warmup) {
+      return false;
+    }
+    for (band = 1; band < band_count; ++band) {
+      memcpy(warmup + (size_t)(band - 1) * warmup_size, rgba + ((size_t)band * PNGX_DITHER_BAND_ROWS - PNGX_DITHER_BAND_WARMUP_ROWS) * row_stride, warmup_size);
+    }
+  }
+
+  ctx.rgba = rgba;
+  ctx.warmup = warmup;
+  ctx.width = width;
+  ctx.height = height;
+  ctx.fn = fn;
+  ctx.context = context;
+  ctx.stopped = 0;
+
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_parallel_for(thread_count, band_count, dither_band_worker, &ctx);
+#else
+  dither_band_worker(&ctx, 0, band_count);
+#endif
+
+  free(warmup);
+
+  return colopresso_atomic_load_i32(&ctx.stopped) == 0;
+}
+
 uint32_t color_distance_sq(const cpres_rgba_color_t *lhs, const cpres_rgba_color_t *rhs) {
   uint32_t lhs_packed, rhs_packed;
 
@@ -402,82 +734,400 @@ uint32_t color_distance_sq(const cpres_rgba_color_t *lhs, const cpres_rgba_color
   return simd_color_distance_sq_u32(lhs_packed, rhs_packed);
 }
 
-float estimate_bitdepth_dither_level(const uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_per_channel) {
-  png_uint_32 y, x;
-  uint8_t r, g, b, a;
-  size_t pixel_count, gradient_samples, opaque_pixels, translucent_pixels, base, right, below;
-  float base_level, target, right_luma, below_luma, luma, normalized_gradient, opaque_ratio, translucent_ratio, min_luma, max_luma, coverage, gradient_span;
-  double gradient_accum;
+typedef struct {
+  uint32_t color;
+  uint32_t index;
+} palette_item_t;
 
-  if (!rgba || width == 0 || height == 0) {
-    return clamp_float(COLOPRESSO_PNGX_DEFAULT_LOSSY_DITHER_LEVEL, 0.0f, 1.0f);
+static inline uint8_t palette_channel(uint32_t color, uint8_t axis) { return (uint8_t)(color >> (axis * 8u)); }
+
+static int compare_palette_item_index(const void *lhs, const void *rhs) {
+  const palette_item_t *a = (const palette_item_t *)lhs, *b = (const palette_item_t *)rhs;
+
+  return a->index < b->index ? -1 : (a->index > b->index ? 1 : 0);
+}
+
+/* Counting sort on one 8-bit channel; O(n) per level keeps the whole build at O(n log n) even for 32768-entry reduced palettes. */
+static void palette_items_sort_axis(palette_item_t *items, palette_item_t *scratch, size_t count, uint8_t axis) {
+  size_t offsets[256], total = 0, bucket, i;
+
+  memset(offsets, 0, sizeof(offsets));
+  for (i = 0; i < count; ++i) {
+    ++offsets[palette_channel(items[i].color, axis)];
+  }
+  for (i = 0; i < 256; ++i) {
+    bucket = offsets[i];
+    offsets[i] = total;
+    total += bucket;
+  }
+  for (i = 0; i < count; ++i) {
+    scratch[offsets[palette_channel(items[i].color, axis)]++] = items[i];
   }
 
-  pixel_count = (size_t)width * (size_t)height;
-  gradient_accum = 0.0;
-  gradient_samples = 0;
-  opaque_pixels = 0;
-  translucent_pixels = 0;
-  min_luma = 255.0f;
-  max_luma = 0.0f;
-
-  for (y = 0; y < height; ++y) {
-    for (x = 0; x < width; ++x) {
-      base = (((size_t)y * (size_t)width) + (size_t)x) * 4;
-      r = rgba[base + 0];
-      g = rgba[base + 1];
-      b = rgba[base + 2];
-      a = rgba[base + 3];
-      luma = calc_luma(r, g, b);
-
-      if (luma < min_luma) {
-        min_luma = luma;
-      }
-      if (luma > max_luma) {
-        max_luma = luma;
-      }
+  memcpy(items, scratch, sizeof(palette_item_t) * count);
+}
+
+static int32_t palette_index_build_node(pngx_palette_index_t *index, palette_item_t *items, palette_item_t *scratch, size_t start, size_t end) {
+  uint8_t lo[4] = {255, 255, 255, 255}, hi[4] = {0, 0, 0, 0}, axis = 0, value, c;
+  pngx_palette_node_t *node;
+  int32_t node_id, left, right;
+  size_t i, mid;
+
+  node_id = (int32_t)index->node_count++;
+  node = &index->nodes[node_id];
+  node->start = (uint32_t)start;
+  node->end = (uint32_t)end;
+  node->left = -1;
+  node->right = -1;
+  node->axis = 0;
+  node->left_max = 0;
+  node->right_min = 0;
+
+  /* Leaves keep their entries in palette order, so the lowest position the SIMD scan reports on a tie is also the lowest palette index. */
+  if (end - start <= PNGX_COMMON_PALETTE_INDEX_LEAF_SIZE) {
+    qsort(items + start, end - start, sizeof(palette_item_t), compare_palette_item_index);
+    return node_id;
+  }
+
+  for (i = start; i < end; ++i) {
+    for (c = 0; c < 4; ++c) {
+      value = palette_channel(items[i].color, c);
+      lo[c] = value < lo[c] ? value : lo[c];
+      hi[c] = value > hi[c] ? value : hi[c];
+    }
+  }
+  for (c = 1; c < 4; ++c) {
+    if (hi[c] - lo[c] > hi[axis] - lo[axis]) {
+      axis = c;
+    }
+  }
+
+  /* Nothing left to split on: every entry is the same colour. */
+  if (hi[axis] <= lo[axis]) {
+    qsort(items + start, end - start, sizeof(palette_item_t), compare_palette_item_index);
+    return node_id;
+  }
 
-      if (a > PNGX_COMMON_DITHER_ALPHA_OPAQUE_THRESHOLD) {
-        ++opaque_pixels;
-      } else if (a > PNGX_COMMON_DITHER_ALPHA_TRANSLUCENT_THRESHOLD) {
-        ++translucent_pixels;
+  palette_items_sort_axis(items + start, scratch, end - start, axis);
+  mid = start + (end - start) / 2;
+  node->axis = axis;
+  node->left_max = palette_channel(items[mid - 1].color, axis);
+  node->right_min = palette_channel(items[mid].color, axis);
+
+  left = palette_index_build_node(index, items, scratch, start, mid);
+  right = palette_index_build_node(index, items, scratch, mid, end);
+  index->nodes[node_id].left = left;
+  index->nodes[node_id].right = right;
+
+  return node_id;
+}
+
+bool palette_index_build(pngx_palette_index_t *index, const uint32_t *colors, size_t count) {
+  palette_item_t *items = NULL, *scratch = NULL;
+  size_t i, node_capacity;
+  bool success = false;
+
+  if (!index) {
+    return false;
+  }
+
+  memset(index, 0, sizeof(*index));
+  if (!colors || count == 0 || count > UINT32_MAX) {
+    return false;
+  }
+
+  /* Every split leaves at least LEAF_SIZE / 2 entries on each side, which bounds the leaf count and therefore the node count. */
+  node_capacity = (count / (PNGX_COMMON_PALETTE_INDEX_LEAF_SIZE / 2) + 1) * 2;
+  items = (palette_item_t *)malloc(sizeof(palette_item_t) * count);
+  scratch = (palette_item_t *)malloc(sizeof(palette_item_t) * count);
+  index->order = (uint32_t *)malloc(sizeof(uint32_t) * count);
+  index->nodes = (pngx_palette_node_t *)malloc(sizeof(pngx_palette_node_t) * node_capacity);
+  if (!items || !scratch || !index->order || !index->nodes) {
+    goto cleanup;
+  }
+
+  for (i = 0; i < count; ++i) {
+    items[i].color = colors[i];
+    items[i].index = (uint32_t)i;
+  }
+
+  palette_index_build_node(index, items, scratch, 0, count);
+
+  for (i = 0; i < count; ++i) {
+    index->order[i] = items[i].color;
+  }
+  if (!simd_palette_init(&index->planes, index->order, count)) {
+    goto cleanup;
+  }
+  for (i = 0; i < count; ++i) {
+    index->order[i] = items[i].index;
+  }
+
+  index->count = count;
+  success = true;
+
+cleanup:
+  free(items);
+  free(scratch);
+  if (!success) {
+    palette_index_free(index);
+  }
+
+  return success;
+}
+
+uint32_t palette_index_nearest(const pngx_palette_index_t *index, uint32_t color) {
+  const pngx_palette_node_t *node;
+  uint32_t stack_node[PNGX_COMMON_PALETTE_INDEX_STACK_DEPTH], stack_bound[PNGX_COMMON_PALETTE_INDEX_STACK_DEPTH], best_dist = UINT32_MAX, best = 0, dist, bound, left_bound, right_gap,
+      right_bound, left_gap;
+  size_t top = 0, pos;
+  uint8_t q;
+
+  if (!index || !index->nodes || index->count == 0) {
+    return 0;
+  }
+
+  stack_node[top] = 0;
+  stack_bound[top++] = 0;
+
+  while (top > 0) {
+    --top;
+    node = &index->nodes[stack_node[top]];
+    bound = stack_bound[top];
+
+    /* Equal bounds are still visited: a subtree at exactly best_dist may hold a lower palette index. */
+    if (bound > best_dist) {
+      continue;
+    }
+
+    if (node->left < 0) {
+      pos = simd_palette_nearest(&index->planes, node->start, node->end, color, &dist);
+      if (dist < best_dist || (dist == best_dist && index->order[pos] < best)) {
+        best_dist = dist;
+        best = index->order[pos];
       }
+      continue;
+    }
 
-      if (x + 1 < width) {
-        right = base + 4;
-        right_luma = calc_luma(rgba[right + 0], rgba[right + 1], rgba[right + 2]);
-        gradient_accum += absf(right_luma - luma);
-        ++gradient_samples;
+    q = palette_channel(color, node->axis);
+    left_gap = q > node->left_max ? (uint32_t)(q - node->left_max) : 0;
+    right_gap = q < node->right_min ? (uint32_t)(node->right_min - q) : 0;
+    left_bound = left_gap * left_gap > bound ? left_gap * left_gap : bound;
+    right_bound = right_gap * right_gap > bound ? right_gap * right_gap : bound;
+
+    /* Push the far side first so the near side is searched first and tightens best_dist. */
+    if (left_gap <= right_gap) {
+      stack_node[top] = (uint32_t)node->right;
+      stack_bound[top++] = right_bound;
+      stack_node[top] = (uint32_t)node->left;
+      stack_bound[top++] = left_bound;
+    } else {
+      stack_node[top] = (uint32_t)node->left;
+      stack_bound[top++] = left_bound;
+      stack_node[top] = (uint32_t)node->right;
+      stack_bound[top++] = right_bound;
+    }
+  }
+
+  return best;
+}
+
+void palette_index_free(pngx_palette_index_t *index) {
+  if (!index) {
+    return;
+  }
+
+  simd_palette_free(&index->planes);
+  free(index->order);
+  free(index->nodes);
+  index->order = NULL;
+  index->nodes = NULL;
+  index->node_count = 0;
+  index->count = 0;
+}
+
+static inline void fill_luma_row(const uint8_t *row, png_uint_32 width, float *luma) {
+  png_uint_32 x;
+
+  for (x = 0; x < width; ++x) {
+    luma[x] = calc_luma(row[x * 4 + 0], row[x * 4 + 1], row[x * 4 + 2]);
+  }
+}
+
+static void image_analysis_worker(void *context, uint32_t start, uint32_t end) {
+  image_analysis_ctx_t *ctx = (image_analysis_ctx_t *)context;
+  image_analysis_slice_t *part;
+  const uint8_t *row;
+  uint32_t slice, y, last_y, x;
+  size_t row_stride;
+  uint8_t a;
+  float luma, *luma_curr, *luma_next, *luma_tmp;
+
+  if (!ctx || start >= end) {
+    return;
+  }
+
+  luma_curr = (float *)malloc(sizeof(float) * ctx->width);
+  luma_next = (float *)malloc(sizeof(float) * ctx->width);
+  if (!luma_curr || !luma_next) {
+    colopresso_atomic_store_i32(&ctx->failed, 1);
+    free(luma_curr);
+    free(luma_next);
+    return;
+  }
+
+  row_stride = (size_t)ctx->width * PNGX_RGBA_CHANNELS;
+  for (slice = start; slice < end; ++slice) {
+    part = &ctx->slices[slice];
+    y = slice * PNGX_ANALYSIS_SLICE_ROWS;
+    last_y = (ctx->height - y < PNGX_ANALYSIS_SLICE_ROWS) ? ctx->height : y + PNGX_ANALYSIS_SLICE_ROWS;
+    memset(part, 0, sizeof(*part));
+    part->luma_min = 255.0f;
+    part->luma_max = 0.0f;
+
+    fill_luma_row(ctx->rgba + (size_t)y * row_stride, ctx->width, luma_curr);
+    for (; y < last_y; ++y) {
+      row = ctx->rgba + (size_t)y * row_stride;
+      if (y + 1 < ctx->height) {
+        fill_luma_row(row + row_stride, ctx->width, luma_next);
       }
 
-      if (y + 1 < height) {
-        below = (((size_t)(y + 1) * (size_t)width) + (size_t)x) * 4;
-        below_luma = calc_luma(rgba[below + 0], rgba[below + 1], rgba[below + 2]);
-        gradient_accum += absf(below_luma - luma);
-        ++gradient_samples;
+      for (x = 0; x < ctx->width; ++x) {
+        luma = luma_curr[x];
+        a = row[(size_t)x * 4 + 3];
+
+        if (luma < part->luma_min) {
+          part->luma_min = luma;
+        }
+        if (luma > part->luma_max) {
+          part->luma_max = luma;
+        }
+
+        if (a > PNGX_COMMON_DITHER_ALPHA_OPAQUE_THRESHOLD) {
+          ++part->opaque_pixels;
+        } else if (a > PNGX_COMMON_DITHER_ALPHA_TRANSLUCENT_THRESHOLD) {
+          ++part->translucent_pixels;
+        }
+        if (a < 255) {
+          ++part->non_opaque_pixels;
+        }
+        part->alpha_used[a] = true;
+
+        if (x + 1 < ctx->width) {
+          part->gradient_accum += absf(luma_curr[x + 1] - luma);
+        }
+        if (y + 1 < ctx->height) {
+          part->gradient_accum += absf(luma_next[x] - luma);
+        }
       }
+
+      luma_tmp = luma_curr;
+      luma_curr = luma_next;
+      luma_next = luma_tmp;
     }
   }
 
-  if (gradient_samples == 0) {
-    gradient_samples = 1;
+  free(luma_curr);
+  free(luma_next);
+}
+
+bool analyze_image(uint32_t thread_count, const uint8_t *rgba, png_uint_32 width, png_uint_32 height, pngx_image_analysis_t *analysis) {
+  image_analysis_ctx_t ctx;
+  uint32_t slice_count, slice, level;
+  bool alpha_used[256];
+
+  if (!analysis) {
+    return false;
   }
 
-  normalized_gradient = (float)(gradient_accum / ((double)gradient_samples * 255.0));
-  opaque_ratio = (pixel_count > 0) ? (float)((double)opaque_pixels / (double)pixel_count) : 0.0f;
-  translucent_ratio = (pixel_count > 0) ? (float)((double)translucent_pixels / (double)pixel_count) : 0.0f;
+  memset(analysis, 0, sizeof(*analysis));
+  if (!rgba || width == 0 || height == 0) {
+    return false;
+  }
 
-  coverage = (max_luma - min_luma) / 255.0f;
-  if (coverage < 0.0f) {
-    coverage = 0.0f;
-  } else if (coverage > 1.0f) {
-    coverage = 1.0f;
+  slice_count = (uint32_t)(((size_t)height + PNGX_ANALYSIS_SLICE_ROWS - 1) / PNGX_ANALYSIS_SLICE_ROWS);
+  ctx.rgba = rgba;
+  ctx.width = width;
+  ctx.height = height;
+  ctx.failed = 0;
+  ctx.slices = (image_analysis_slice_t *)malloc(sizeof(image_analysis_slice_t) * slice_count);
+  if (!ctx.slices) {
+    return false;
   }
 
-  gradient_span = coverage / ((normalized_gradient > PNGX_COMMON_DITHER_GRADIENT_MIN) ? normalized_gradient : PNGX_COMMON_DITHER_GRADIENT_MIN);
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_parallel_for(thread_count, slice_count, image_analysis_worker, &ctx);
+#else
+  (void)thread_count;
+  image_analysis_worker(&ctx, 0, slice_count);
+#endif
+
+  if (colopresso_atomic_load_i32(&ctx.failed) != 0) {
+    free(ctx.slices);
+    return false;
+  }
 
-  base_level = PNGX_COMMON_DITHER_BASE_LEVEL;
-  target = base_level;
+  /* Slices are folded in row order, so the record never depends on how they were spread over threads. */
+  memset(alpha_used, 0, sizeof(alpha_used));
+  analysis->luma_min = 255.0f;
+  analysis->luma_max = 0.0f;
+  for (slice = 0; slice < slice_count; ++slice) {
+    analysis->gradient_accum += ctx.slices[slice].gradient_accum;
+    analysis->opaque_pixels += ctx.slices[slice].opaque_pixels;
+    analysis->translucent_pixels += ctx.slices[slice].translucent_pixels;
+    analysis->non_opaque_pixels += ctx.slices[slice].non_opaque_pixels;
+    if (ctx.slices[slice].luma_min < analysis->luma_min) {
+      analysis->luma_min = ctx.slices[slice].luma_min;
+    }
+    if (ctx.slices[slice].luma_max > analysis->luma_max) {
+      analysis->luma_max = ctx.slices[slice].luma_max;
+    }
+    for (level = 0; level < 256; ++level) {
+      alpha_used[level] = alpha_used[level] || ctx.slices[slice].alpha_used[level];
+    }
+  }
+  free(ctx.slices);
+
+  for (level = 0; level < 256; ++level) {
+    if (alpha_used[level]) {
+      ++analysis->alpha_levels;
+    }
+  }
+  analysis->pixel_count = (size_t)width * (size_t)height;
+  analysis->gradient_samples = (size_t)(width - 1) * (size_t)height + (size_t)width * (size_t)(height - 1);
+
+  return true;
+}
+
+static inline void analysis_dither_inputs(const pngx_image_analysis_t *analysis, float *normalized_gradient, float *opaque_ratio, float *translucent_ratio, float *coverage, float *gradient_span) {
+  size_t gradient_samples;
+
+  gradient_samples = (analysis->gradient_samples > 0) ? analysis->gradient_samples : 1;
+
+  *normalized_gradient = (float)(analysis->gradient_accum / ((double)gradient_samples * 255.0));
+  *opaque_ratio = (float)((double)analysis->opaque_pixels / (double)analysis->pixel_count);
+  *translucent_ratio = (float)((double)analysis->translucent_pixels / (double)analysis->pixel_count);
+
+  *coverage = (analysis->luma_max - analysis->luma_min) / 255.0f;
+  if (*coverage < 0.0f) {
+    *coverage = 0.0f;
+  } else if (*coverage > 1.0f) {
+    *coverage = 1.0f;
+  }
+
+  *gradient_span = *coverage / ((*normalized_gradient > PNGX_COMMON_DITHER_GRADIENT_MIN) ? *normalized_gradient : PNGX_COMMON_DITHER_GRADIENT_MIN);
+}
+
+float dither_level_from_analysis(const pngx_image_analysis_t *analysis, uint8_t bits_per_channel) {
+  float normalized_gradient, opaque_ratio, translucent_ratio, coverage, gradient_span, target;
+
+  if (!analysis || analysis->pixel_count == 0) {
+    return clamp_float(COLOPRESSO_PNGX_DEFAULT_LOSSY_DITHER_LEVEL, 0.0f, 1.0f);
+  }
+
+  analysis_dither_inputs(analysis, &normalized_gradient, &opaque_ratio, &translucent_ratio, &coverage, &gradient_span);
+
+  target = PNGX_COMMON_DITHER_BASE_LEVEL;
 
   if (normalized_gradient > 0.35f) {
     target += PNGX_COMMON_DITHER_HIGH_GRADIENT_BOOST;
@@ -518,79 +1168,14 @@ float estimate_bitdepth_dither_level(const uint8_t *rgba, png_uint_32 width, png
   return clamp_float(target, PNGX_COMMON_DITHER_MIN, PNGX_COMMON_DITHER_MAX);
 }
 
-float estimate_bitdepth_dither_level_limited4444(const uint8_t *rgba, png_uint_32 width, png_uint_32 height) {
-  uint8_t r, g, b, a;
-  size_t pixel_count, gradient_samples, opaque_pixels, translucent_pixels, base, right, below;
-  float right_luma, below_luma, luma, normalized_gradient, opaque_ratio, translucent_ratio, min_luma, max_luma, coverage, gradient_span, target;
-  double gradient_accum;
-  png_uint_32 y, x;
+float dither_level_limited4444_from_analysis(const pngx_image_analysis_t *analysis) {
+  float normalized_gradient, opaque_ratio, translucent_ratio, coverage, gradient_span, target;
 
-  if (!rgba || width == 0 || height == 0) {
+  if (!analysis || analysis->pixel_count == 0) {
     return 0.0f;
   }
 
-  pixel_count = (size_t)width * (size_t)height;
-  gradient_accum = 0.0;
-  gradient_samples = 0;
-  opaque_pixels = 0;
-  translucent_pixels = 0;
-  min_luma = 255.0f;
-  max_luma = 0.0f;
-
-  for (y = 0; y < height; ++y) {
-    for (x = 0; x < width; ++x) {
-      base = (((size_t)y * (size_t)width) + (size_t)x) * 4;
-      r = rgba[base + 0];
-      g = rgba[base + 1];
-      b = rgba[base + 2];
-      a = rgba[base + 3];
-      luma = calc_luma(r, g, b);
-
-      if (luma < min_luma) {
-        min_luma = luma;
-      }
-      if (luma > max_luma) {
-        max_luma = luma;
-      }
-
-      if (a > PNGX_COMMON_DITHER_ALPHA_OPAQUE_THRESHOLD) {
-        ++opaque_pixels;
-      } else if (a > PNGX_COMMON_DITHER_ALPHA_TRANSLUCENT_THRESHOLD) {
-        ++translucent_pixels;
-      }
-
-      if (x + 1 < width) {
-        right = base + 4;
-        right_luma = calc_luma(rgba[right + 0], rgba[right + 1], rgba[right + 2]);
-        gradient_accum += absf(right_luma - luma);
-        ++gradient_samples;
-      }
-
-      if (y + 1 < height) {
-        below = (((size_t)(y + 1) * (size_t)width) + (size_t)x) * 4;
-        below_luma = calc_luma(rgba[below + 0], rgba[below + 1], rgba[below + 2]);
-        gradient_accum += absf(below_luma - luma);
-        ++gradient_samples;
-      }
-    }
-  }
-
-  if (gradient_samples == 0) {
-    gradient_samples = 1;
-  }
-
-  normalized_gradient = (float)(gradient_accum / ((double)gradient_samples * 255.0));
-  opaque_ratio = (pixel_count > 0) ? (float)((double)opaque_pixels / (double)pixel_count) : 0.0f;
-  translucent_ratio = (pixel_count > 0) ? (float)((double)translucent_pixels / (double)pixel_count) : 0.0f;
-
-  coverage = (max_luma - min_luma) / 255.0f;
-  if (coverage < 0.0f) {
-    coverage = 0.0f;
-  } else if (coverage > 1.0f) {
-    coverage = 1.0f;
-  }
-
-  gradient_span = coverage / ((normalized_gradient > PNGX_COMMON_DITHER_GRADIENT_MIN) ? normalized_gradient : PNGX_COMMON_DITHER_GRADIENT_MIN);
+  analysis_dither_inputs(analysis, &normalized_gradient, &opaque_ratio, &translucent_ratio, &coverage, &gradient_span);
 
   target = 0.0f;
 
@@ -609,6 +1194,15 @@ float estimate_bitdepth_dither_level_limited4444(const uint8_t *rgba, png_uint_3
   return clamp_float(target, 0.0f, 1.0f);
 }
 
+float estimate_bitdepth_dither_level(const uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_per_channel) {
+  pngx_image_analysis_t analysis;
+
+  /* A failed analysis leaves a zeroed record, which falls back to the default level. */
+  analyze_image(1, rgba, width, height, &analysis);
+
+  return dither_level_from_analysis(&analysis, bits_per_channel);
+}
+
 void build_fixed_palette(const pngx_options_t *source_opts, pngx_quant_support_t *support, pngx_options_t *patched_opts) {
   size_t user_count, derived_count, total_cap, i, j;
   bool duplicate;
@@ -714,198 +1308,266 @@ float resolve_quant_dither(const pngx_options_t *opts, const pngx_image_stats_t
   return resolved;
 }
 
-bool prepare_quant_support(const pngx_rgba_image_t *image, const pngx_options_t *opts, pngx_quant_support_t *support, pngx_image_stats_t *stats) {
-  chroma_bucket_t *buckets = NULL, *bucket_entry;
-  uint32_t x, y, range, sample;
-  uint16_t *importance_work = NULL, raw_min, raw_max;
-  uint8_t r, g, b, a, value;
-  size_t pixel_index, base, next_row_base, opaque_pixels, translucent_pixels, vibrant_pixels;
-  float gradient_sum, saturation_sum, luma, gradient, saturation, importance, alpha_factor, anchor_score, right_luma, below_luma, importance_mix, *luma_row_curr = NULL, *luma_row_next = NULL,
-                                                                                                                                                  *luma_row_tmp;
-  bool need_map, need_buckets;
+static inline void fill_normalized_luma_row(const uint8_t *row, uint32_t width, float *luma) {
+  uint32_t x;
 
-  if (!image || !opts || !support || !stats || image->pixel_count == 0) {
-    return false;
-  }
-
-  raw_min = UINT16_MAX;
-  raw_max = 0;
-  need_map = opts->saliency_map_enable || opts->postprocess_smooth_enable;
-  need_buckets = opts->chroma_anchor_enable;
-  gradient_sum = 0.0f;
-  saturation_sum = 0.0f;
-  opaque_pixels = 0;
-  translucent_pixels = 0;
-  vibrant_pixels = 0;
-  if (need_map) {
-    importance_work = (uint16_t *)malloc(sizeof(uint16_t) * image->pixel_count);
-    if (!importance_work) {
-      return false;
-    }
+  for (x = 0; x < width; ++x) {
+    luma[x] = calc_luma(row[x * 4 + 0], row[x * 4 + 1], row[x * 4 + 2]) / 255.0f;
   }
+}
 
-  if (need_buckets) {
-    buckets = (chroma_bucket_t *)calloc(PNGX_CHROMA_BUCKET_COUNT, sizeof(chroma_bucket_t));
-    if (!buckets) {
-      if (importance_work) {
-        free(importance_work);
-      }
+static void prepare_support_worker(void *context, uint32_t start, uint32_t end) {
+  prepare_support_ctx_t *ctx = (prepare_support_ctx_t *)context;
+  const pngx_rgba_image_t *image;
+  const pngx_options_t *opts;
+  prepare_slice_t *part;
+  chroma_bucket_t *buckets, *bucket_entry;
+  uint32_t slice, x, y, last_y;
+  uint16_t *importance_work;
+  uint8_t r, g, b, a;
+  size_t pixel_index, base, row_stride;
+  float luma, gradient, saturation, importance, alpha_factor, anchor_score, importance_mix, *luma_row_curr, *luma_row_next, *luma_row_tmp;
 
-      return false;
-    }
+  if (!ctx || start >= end) {
+    return;
   }
 
+  image = ctx->image;
+  opts = ctx->opts;
+  importance_work = ctx->importance_work;
+  row_stride = (size_t)image->width * 4;
   luma_row_curr = (float *)malloc(sizeof(float) * image->width);
   luma_row_next = (float *)malloc(sizeof(float) * image->width);
   if (!luma_row_curr || !luma_row_next) {
-    free(importance_work);
-    free(buckets);
+    colopresso_atomic_store_i32(&ctx->failed, 1);
     free(luma_row_curr);
     free(luma_row_next);
-
-    return false;
-  }
-
-  for (x = 0; x < image->width; ++x) {
-    base = (size_t)x * 4;
-    luma_row_curr[x] = calc_luma(image->rgba[base + 0], image->rgba[base + 1], image->rgba[base + 2]) / 255.0f;
+    return;
   }
 
-  for (y = 0; y < image->height; ++y) {
-    if (y + 1 < image->height) {
-      next_row_base = ((size_t)(y + 1) * (size_t)image->width) * 4;
-      for (x = 0; x < image->width; ++x) {
-        base = next_row_base + (size_t)x * 4;
-        luma_row_next[x] = calc_luma(image->rgba[base + 0], image->rgba[base + 1], image->rgba[base + 2]) / 255.0f;
-      }
-    }
-
-    for (x = 0; x < image->width; ++x) {
-      base = (((size_t)y * (size_t)image->width) + (size_t)x) * 4;
-      r = image->rgba[base + 0];
-      g = image->rgba[base + 1];
-      b = image->rgba[base + 2];
-      a = image->rgba[base + 3];
-      luma = luma_row_curr[x];
-      gradient = 0.0f;
-      saturation = calc_saturation(r, g, b);
-      alpha_factor = (float)a / 255.0f;
-
-      if (x + 1 < image->width) {
-        right_luma = luma_row_curr[x + 1];
-        gradient += absf(right_luma - luma);
-      }
-
+  for (slice = start; slice < end; ++slice) {
+    part = &ctx->slices[slice];
+    buckets = ctx->buckets ? ctx->buckets + (size_t)slice * PNGX_CHROMA_BUCKET_COUNT : NULL;
+    y = slice * ctx->slice_rows;
+    last_y = (image->height - y < ctx->slice_rows) ? image->height : y + ctx->slice_rows;
+    part->gradient_sum = 0.0f;
+    part->saturation_sum = 0.0f;
+    part->gradient_max = 0.0f;
+    part->vibrant_pixels = 0;
+    part->raw_min = UINT16_MAX;
+    part->raw_max = 0;
+
+    fill_normalized_luma_row(image->rgba + (size_t)y * row_stride, image->width, luma_row_curr);
+    for (; y < last_y; ++y) {
       if (y + 1 < image->height) {
-        below_luma = luma_row_next[x];
-        gradient += absf(below_luma - luma);
-      }
-
-      gradient *= PNGX_COMMON_PREPARE_GRADIENT_SCALE;
-      if (gradient > 1.0f) {
-        gradient = 1.0f;
+        fill_normalized_luma_row(image->rgba + (size_t)(y + 1) * row_stride, image->width, luma_row_next);
       }
 
-      gradient_sum += gradient;
-      if (gradient > stats->gradient_max) {
-        stats->gradient_max = gradient;
-      }
-
-      saturation_sum += saturation;
+      for (x = 0; x < image->width; ++x) {
+        base = (size_t)y * row_stride + (size_t)x * 4;
+        r = image->rgba[base + 0];
+        g = image->rgba[base + 1];
+        b = image->rgba[base + 2];
+        a = image->rgba[base + 3];
+        luma = luma_row_curr[x];
+        gradient = 0.0f;
+        saturation = calc_saturation(r, g, b);
+        alpha_factor = (float)a / 255.0f;
+
+        if (x + 1 < image->width) {
+          gradient += absf(luma_row_curr[x + 1] - luma);
+        }
 
-      if (a > PNGX_COMMON_DITHER_ALPHA_OPAQUE_THRESHOLD) {
-        ++opaque_pixels;
-      } else if (a > PNGX_COMMON_DITHER_ALPHA_TRANSLUCENT_THRESHOLD) {
-        ++translucent_pixels;
-      }
+        if (y + 1 < image->height) {
+          gradient += absf(luma_row_next[x] - luma);
+        }
 
-      if (saturation > PNGX_COMMON_PREPARE_VIBRANT_SATURATION && gradient > PNGX_COMMON_PREPARE_VIBRANT_GRADIENT && a > PNGX_COMMON_PREPARE_VIBRANT_ALPHA) {
-        ++vibrant_pixels;
-      }
+        gradient *= PNGX_COMMON_PREPARE_GRADIENT_SCALE;
+        if (gradient > 1.0f) {
+          gradient = 1.0f;
+        }
 
-      importance = gradient;
+        part->gradient_sum += gradient;
+        if (gradient > part->gradient_max) {
+          part->gradient_max = gradient;
+        }
 
-      if (opts->chroma_weight_enable) {
-        importance += saturation * PNGX_COMMON_PREPARE_CHROMA_WEIGHT;
-      }
+        part->saturation_sum += saturation;
 
-      if (opts->gradient_boost_enable) {
-        if (gradient > PNGX_COMMON_PREPARE_BOOST_THRESHOLD) {
-          importance += PNGX_COMMON_PREPARE_BOOST_BASE + (gradient * PNGX_COMMON_PREPARE_BOOST_FACTOR);
-        } else if (gradient < PNGX_COMMON_PREPARE_CUT_THRESHOLD) {
-          importance *= PNGX_COMMON_PREPARE_CUT_FACTOR;
+        if (saturation > PNGX_COMMON_PREPARE_VIBRANT_SATURATION && gradient > PNGX_COMMON_PREPARE_VIBRANT_GRADIENT && a > PNGX_COMMON_PREPARE_VIBRANT_ALPHA) {
+          ++part->vibrant_pixels;
         }
-      }
 
-      if (alpha_factor < PNGX_COMMON_PREPARE_ALPHA_THRESHOLD) {
-        importance *= (PNGX_COMMON_PREPARE_ALPHA_BASE + alpha_factor * PNGX_COMMON_PREPARE_ALPHA_MULTIPLIER);
-      }
+        importance = gradient;
 
-      if (importance < 0.0f) {
-        importance = 0.0f;
-      } else if (importance > 1.0f) {
-        importance = 1.0f;
-      }
+        if (opts->chroma_weight_enable) {
+          importance += saturation * PNGX_COMMON_PREPARE_CHROMA_WEIGHT;
+        }
 
-      if (need_map && importance_work) {
-        pixel_index = ((size_t)y * (size_t)image->width) + (size_t)x;
-        importance_work[pixel_index] = (uint16_t)(importance * PNGX_IMPORTANCE_SCALE + 0.5f);
+        if (opts->gradient_boost_enable) {
+          if (gradient > PNGX_COMMON_PREPARE_BOOST_THRESHOLD) {
+            importance += PNGX_COMMON_PREPARE_BOOST_BASE + (gradient * PNGX_COMMON_PREPARE_BOOST_FACTOR);
+          } else if (gradient < PNGX_COMMON_PREPARE_CUT_THRESHOLD) {
+            importance *= PNGX_COMMON_PREPARE_CUT_FACTOR;
+          }
+        }
 
-        if (importance_work[pixel_index] < raw_min) {
-          raw_min = importance_work[pixel_index];
+        if (alpha_factor < PNGX_COMMON_PREPARE_ALPHA_THRESHOLD) {
+          importance *= (PNGX_COMMON_PREPARE_ALPHA_BASE + alpha_factor * PNGX_COMMON_PREPARE_ALPHA_MULTIPLIER);
         }
 
-        if (importance_work[pixel_index] > raw_max) {
-          raw_max = importance_work[pixel_index];
+        if (importance < 0.0f) {
+          importance = 0.0f;
+        } else if (importance > 1.0f) {
+          importance = 1.0f;
         }
-      }
 
-      if (need_buckets && buckets) {
-        if ((saturation > PNGX_COMMON_PREPARE_BUCKET_SATURATION || importance > PNGX_COMMON_PREPARE_BUCKET_IMPORTANCE) && a > PNGX_COMMON_PREPARE_BUCKET_ALPHA) {
-          importance_mix = (importance * PNGX_COMMON_PREPARE_MIX_IMPORTANCE) + (gradient * PNGX_COMMON_PREPARE_MIX_GRADIENT);
-          anchor_score = (saturation * PNGX_COMMON_PREPARE_ANCHOR_SATURATION) + (importance_mix * PNGX_COMMON_PREPARE_ANCHOR_MIX);
-          if (importance > PNGX_COMMON_PREPARE_ANCHOR_IMPORTANCE_THRESHOLD) {
-            anchor_score += PNGX_COMMON_PREPARE_ANCHOR_IMPORTANCE_BONUS;
+        if (importance_work) {
+          pixel_index = ((size_t)y * (size_t)image->width) + (size_t)x;
+          importance_work[pixel_index] = (uint16_t)(importance * PNGX_IMPORTANCE_SCALE + 0.5f);
+
+          if (importance_work[pixel_index] < part->raw_min) {
+            part->raw_min = importance_work[pixel_index];
           }
-          if (anchor_score > PNGX_COMMON_PREPARE_ANCHOR_SCORE_THRESHOLD) {
-            bucket_entry = &buckets[chroma_bucket_index(r, g, b)];
-            bucket_entry->r_sum += (uint64_t)r;
-            bucket_entry->g_sum += (uint64_t)g;
-            bucket_entry->b_sum += (uint64_t)b;
-            bucket_entry->a_sum += (uint64_t)a;
-            bucket_entry->count += 1;
-            bucket_entry->score += anchor_score;
-            bucket_entry->importance_accum += importance;
+
+          if (importance_work[pixel_index] > part->raw_max) {
+            part->raw_max = importance_work[pixel_index];
+          }
+        }
+
+        if (buckets) {
+          if ((saturation > PNGX_COMMON_PREPARE_BUCKET_SATURATION || importance > PNGX_COMMON_PREPARE_BUCKET_IMPORTANCE) && a > PNGX_COMMON_PREPARE_BUCKET_ALPHA) {
+            importance_mix = (importance * PNGX_COMMON_PREPARE_MIX_IMPORTANCE) + (gradient * PNGX_COMMON_PREPARE_MIX_GRADIENT);
+            anchor_score = (saturation * PNGX_COMMON_PREPARE_ANCHOR_SATURATION) + (importance_mix * PNGX_COMMON_PREPARE_ANCHOR_MIX);
+            if (importance > PNGX_COMMON_PREPARE_ANCHOR_IMPORTANCE_THRESHOLD) {
+              anchor_score += PNGX_COMMON_PREPARE_ANCHOR_IMPORTANCE_BONUS;
+            }
+            if (anchor_score > PNGX_COMMON_PREPARE_ANCHOR_SCORE_THRESHOLD) {
+              bucket_entry = &buckets[chroma_bucket_index(r, g, b)];
+              bucket_entry->r_sum += (uint64_t)r;
+              bucket_entry->g_sum += (uint64_t)g;
+              bucket_entry->b_sum += (uint64_t)b;
+              bucket_entry->a_sum += (uint64_t)a;
+              bucket_entry->count += 1;
+              bucket_entry->score += anchor_score;
+              bucket_entry->importance_accum += importance;
+            }
           }
         }
       }
-    }
 
-    luma_row_tmp = luma_row_curr;
-    luma_row_curr = luma_row_next;
-    luma_row_next = luma_row_tmp;
+      luma_row_tmp = luma_row_curr;
+      luma_row_curr = luma_row_next;
+      luma_row_next = luma_row_tmp;
+    }
   }
 
   free(luma_row_curr);
   free(luma_row_next);
+}
 
-  if (image->pixel_count > 0) {
-    stats->gradient_mean = gradient_sum / (float)image->pixel_count;
-    stats->saturation_mean = saturation_sum / (float)image->pixel_count;
-    stats->opaque_ratio = (float)opaque_pixels / (float)image->pixel_count;
-    stats->translucent_ratio = (float)translucent_pixels / (float)image->pixel_count;
-    stats->vibrant_ratio = (float)vibrant_pixels / (float)image->pixel_count;
+bool prepare_quant_support(const pngx_rgba_image_t *image, const pngx_image_analysis_t *analysis, const pngx_options_t *opts, pngx_quant_support_t *support, pngx_image_stats_t *stats) {
+  prepare_support_ctx_t ctx;
+  chroma_bucket_t *merged, *partial;
+  uint32_t range, sample, slice_count, slice;
+  uint16_t raw_min, raw_max;
+  uint8_t value;
+  size_t pixel_index, vibrant_pixels, i;
+  float gradient_sum, saturation_sum;
+  bool need_map, need_buckets;
+
+  if (!image || !analysis || !opts || !support || !stats || image->pixel_count == 0) {
+    return false;
+  }
+
+  need_map = opts->saliency_map_enable || opts->postprocess_smooth_enable;
+  need_buckets = opts->chroma_anchor_enable;
+
+  /* Slices depend on the image alone and are folded in row order, so every thread_count sums the floats in the same order. Tall images get taller slices to bound the per-slice buckets. */
+  ctx.slice_rows = PNGX_ANALYSIS_SLICE_ROWS;
+  if (image->height > PNGX_ANALYSIS_SLICE_ROWS * PNGX_PREPARE_MAX_SLICES) {
+    ctx.slice_rows = (uint32_t)(((size_t)image->height + PNGX_PREPARE_MAX_SLICES - 1) / PNGX_PREPARE_MAX_SLICES);
+  }
+  slice_count = (uint32_t)(((size_t)image->height + ctx.slice_rows - 1) / ctx.slice_rows);
+
+  ctx.image = image;
+  ctx.opts = opts;
+  ctx.importance_work = NULL;
+  ctx.buckets = NULL;
+  ctx.failed = 0;
+  ctx.slices = (prepare_slice_t *)malloc(sizeof(prepare_slice_t) * slice_count);
+  if (!ctx.slices) {
+    return false;
+  }
+
+  if (need_map) {
+    ctx.importance_work = (uint16_t *)pngx_scratch_acquire(opts->scratch, PNGX_SCRATCH_IMPORTANCE_WORK, sizeof(uint16_t) * image->pixel_count);
+    if (!ctx.importance_work) {
+      free(ctx.slices);
+      return false;
+    }
+  }
+
+  if (need_buckets) {
+    ctx.buckets = (chroma_bucket_t *)calloc((size_t)slice_count * PNGX_CHROMA_BUCKET_COUNT, sizeof(chroma_bucket_t));
+    if (!ctx.buckets) {
+      pngx_scratch_release(opts->scratch, PNGX_SCRATCH_IMPORTANCE_WORK, ctx.importance_work);
+      free(ctx.slices);
+      return false;
+    }
   }
-  if (need_map && importance_work && image->pixel_count > 0) {
+
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_parallel_for(opts->thread_count, slice_count, prepare_support_worker, &ctx);
+#else
+  prepare_support_worker(&ctx, 0, slice_count);
+#endif
+
+  if (colopresso_atomic_load_i32(&ctx.failed) != 0) {
+    pngx_scratch_release(opts->scratch, PNGX_SCRATCH_IMPORTANCE_WORK, ctx.importance_work);
+    free(ctx.buckets);
+    free(ctx.slices);
+    return false;
+  }
+
+  gradient_sum = 0.0f;
+  saturation_sum = 0.0f;
+  vibrant_pixels = 0;
+  raw_min = UINT16_MAX;
+  raw_max = 0;
+  for (slice = 0; slice < slice_count; ++slice) {
+    gradient_sum += ctx.slices[slice].gradient_sum;
+    saturation_sum += ctx.slices[slice].saturation_sum;
+    vibrant_pixels += ctx.slices[slice].vibrant_pixels;
+    if (ctx.slices[slice].gradient_max > stats->gradient_max) {
+      stats->gradient_max = ctx.slices[slice].gradient_max;
+    }
+    if (ctx.slices[slice].raw_min < raw_min) {
+      raw_min = ctx.slices[slice].raw_min;
+    }
+    if (ctx.slices[slice].raw_max > raw_max) {
+      raw_max = ctx.slices[slice].raw_max;
+    }
+  }
+  free(ctx.slices);
+
+  stats->gradient_mean = gradient_sum / (float)image->pixel_count;
+  stats->saturation_mean = saturation_sum / (float)image->pixel_count;
+  stats->opaque_ratio = (float)analysis->opaque_pixels / (float)image->pixel_count;
+  stats->translucent_ratio = (float)analysis->translucent_pixels / (float)image->pixel_count;
+  stats->vibrant_ratio = (float)vibrant_pixels / (float)image->pixel_count;
+
+  if (ctx.importance_work) {
     range = (uint32_t)(raw_max - raw_min);
     if (range == 0) {
       range = 1;
     }
 
-    support->importance_map = (uint8_t *)malloc(image->pixel_count);
+    support->importance_map = (uint8_t *)pngx_scratch_acquire(opts->scratch, PNGX_SCRATCH_IMPORTANCE_MAP, image->pixel_count);
     if (support->importance_map) {
+      support->scratch = opts->scratch;
       for (pixel_index = 0; pixel_index < image->pixel_count; ++pixel_index) {
-        sample = (uint32_t)(importance_work[pixel_index] - raw_min);
+        sample = (uint32_t)(ctx.importance_work[pixel_index] - raw_min);
         value = (uint8_t)((sample * 255) / range);
         if (value < PNGX_COMMON_PREPARE_MAP_MIN_VALUE) {
           value = (uint8_t)PNGX_COMMON_PREPARE_MAP_MIN_VALUE;
@@ -916,13 +1578,29 @@ bool prepare_quant_support(const pngx_rgba_image_t *image, const pngx_options_t
     }
   }
 
-  free(importance_work);
+  pngx_scratch_release(opts->scratch, PNGX_SCRATCH_IMPORTANCE_WORK, ctx.importance_work);
 
-  if (need_buckets && buckets) {
-    extract_chroma_anchors(support, buckets, PNGX_CHROMA_BUCKET_COUNT, image->pixel_count);
-  }
+  if (ctx.buckets) {
+    merged = ctx.buckets;
+    for (slice = 1; slice < slice_count; ++slice) {
+      partial = ctx.buckets + (size_t)slice * PNGX_CHROMA_BUCKET_COUNT;
+      for (i = 0; i < PNGX_CHROMA_BUCKET_COUNT; ++i) {
+        if (partial[i].count == 0) {
+          continue;
+        }
+        merged[i].r_sum += partial[i].r_sum;
+        merged[i].g_sum += partial[i].g_sum;
+        merged[i].b_sum += partial[i].b_sum;
+        merged[i].a_sum += partial[i].a_sum;
+        merged[i].count += partial[i].count;
+        merged[i].score += partial[i].score;
+        merged[i].importance_accum += partial[i].importance_accum;
+      }
+    }
 
-  free(buckets);
+    extract_chroma_anchors(support, merged, PNGX_CHROMA_BUCKET_COUNT, image->pixel_count);
+    free(ctx.buckets);
+  }
 
   return true;
 }
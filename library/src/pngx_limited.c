@@ -17,6 +17,14 @@
 #include "internal/log.h"
 #include "internal/pngx_common.h"
 
+typedef struct {
+  png_uint_32 width;
+  png_uint_32 height;
+  uint8_t bits_per_channel;
+  float dither_level;
+  const pngx_options_t *opts;
+} bitdepth_dither_ctx_t;
+
 static inline uint8_t lossy_type_bits(uint8_t lossy_type) {
   switch (lossy_type) {
   case PNGX_LOSSY_TYPE_LIMITED_RGBA4444:
@@ -26,18 +34,18 @@ static inline uint8_t lossy_type_bits(uint8_t lossy_type) {
   }
 }
 
-static inline void process_bitdepth_pixel(uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint32_t x, uint32_t y, uint8_t bits_per_channel, float dither_level, float *err_curr, float *err_next,
+static inline void process_bitdepth_pixel(uint8_t *row, png_uint_32 width, uint32_t x, bool has_next_row, uint8_t bits_per_channel, float dither_level, float *err_curr, float *err_next,
                                           bool left_to_right) {
   uint8_t channel, quantized;
-  size_t pixel_index = ((size_t)y * (size_t)width + (size_t)x) * PNGX_RGBA_CHANNELS, err_index = (size_t)x * PNGX_RGBA_CHANNELS;
+  size_t pixel_index = (size_t)x * PNGX_RGBA_CHANNELS, err_index = (size_t)x * PNGX_RGBA_CHANNELS;
   float value, error;
 
   for (channel = 0; channel < PNGX_RGBA_CHANNELS; ++channel) {
-    value = (float)rgba[pixel_index + channel] + err_curr[err_index + channel];
+    value = (float)row[pixel_index + channel] + err_curr[err_index + channel];
     quantized = quantize_channel_value(value, bits_per_channel);
     error = (value - (float)quantized) * dither_level;
 
-    rgba[pixel_index + channel] = quantized;
+    row[pixel_index + channel] = quantized;
 
     if (dither_level <= 0.0f || error == 0.0f) {
       continue;
@@ -47,7 +55,7 @@ static inline void process_bitdepth_pixel(uint8_t *rgba, png_uint_32 width, png_
       if (x + 1 < width) {
         err_curr[err_index + PNGX_RGBA_CHANNELS + channel] += error * (7.0f / 16.0f);
       }
-      if (y + 1 < height) {
+      if (has_next_row) {
         if (x > 0) {
           err_next[err_index - PNGX_RGBA_CHANNELS + channel] += error * (3.0f / 16.0f);
         }
@@ -60,7 +68,7 @@ static inline void process_bitdepth_pixel(uint8_t *rgba, png_uint_32 width, png_
       if (x > 0) {
         err_curr[err_index - PNGX_RGBA_CHANNELS + channel] += error * (7.0f / 16.0f);
       }
-      if (y + 1 < height) {
+      if (has_next_row) {
         if (x + 1 < width) {
           err_next[err_index + PNGX_RGBA_CHANNELS + channel] += error * (3.0f / 16.0f);
         }
@@ -73,11 +81,50 @@ static inline void process_bitdepth_pixel(uint8_t *rgba, png_uint_32 width, png_
   }
 }
 
-static inline void reduce_rgba_bitdepth_dither(uint32_t thread_count, uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_per_channel, float dither_level) {
-  uint32_t x, y;
+static bool dither_bitdepth_rows(void *context, uint8_t *rows, uint32_t first_y, uint32_t row_count, bool warmup, float **err_curr, float **err_next) {
+  bitdepth_dither_ctx_t *ctx = (bitdepth_dither_ctx_t *)context;
+  uint32_t i, x, y;
+  size_t row_stride = (size_t)ctx->width * PNGX_RGBA_CHANNELS;
+  uint8_t *row;
+  float *tmp;
+  bool has_next_row;
+
+  (void)warmup;
+
+  for (i = 0; i < row_count; ++i) {
+    if (pngx_cancelled(ctx->opts)) {
+      return false;
+    }
+
+    y = first_y + i;
+    row = rows + (size_t)i * row_stride;
+    has_next_row = y + 1 < ctx->height;
+    memset(*err_next, 0, row_stride * sizeof(float));
+    if ((y & 1) == 0) {
+      for (x = 0; x < ctx->width; ++x) {
+        process_bitdepth_pixel(row, ctx->width, x, has_next_row, ctx->bits_per_channel, ctx->dither_level, *err_curr, *err_next, true);
+      }
+    } else {
+      x = ctx->width;
+      while (x-- > 0) {
+        process_bitdepth_pixel(row, ctx->width, x, has_next_row, ctx->bits_per_channel, ctx->dither_level, *err_curr, *err_next, false);
+      }
+    }
+
+    tmp = *err_curr;
+    *err_curr = *err_next;
+    *err_next = tmp;
+  }
+
+  return true;
+}
+
+static inline void reduce_rgba_bitdepth_dither(uint32_t thread_count, uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_per_channel, float dither_level,
+                                               const pngx_options_t *opts) {
+  bitdepth_dither_ctx_t ctx;
+  pngx_scratch_t *scratch;
   size_t row_stride;
-  float *err_curr, *err_next, *tmp;
-  bool left_to_right;
+  float *err_rows, *err_curr, *err_next;
 
   if (!rgba || width == 0 || height == 0 || bits_per_channel >= PNGX_FULL_CHANNEL_BITS) {
     return;
@@ -88,40 +135,36 @@ static inline void reduce_rgba_bitdepth_dither(uint32_t thread_count, uint8_t *r
     return;
   }
 
+  ctx.width = width;
+  ctx.height = height;
+  ctx.bits_per_channel = bits_per_channel;
+  ctx.dither_level = dither_level;
+  ctx.opts = opts;
+
+  if (opts && opts->tiled_dither_enable) {
+    if (!dither_rows_in_bands(thread_count, rgba, width, height, dither_bitdepth_rows, &ctx) && !pngx_cancelled(opts)) {
+      snap_rgba_image_to_bits(thread_count, rgba, (size_t)width * (size_t)height, bits_per_channel, bits_per_channel);
+    }
+    return;
+  }
+
   row_stride = (size_t)width * PNGX_RGBA_CHANNELS;
-  err_curr = (float *)calloc(row_stride, sizeof(float));
-  err_next = (float *)calloc(row_stride, sizeof(float));
-  if (!err_curr || !err_next) {
-    free(err_curr);
-    free(err_next);
+  scratch = opts ? opts->scratch : NULL;
+  err_rows = (float *)pngx_scratch_acquire(scratch, PNGX_SCRATCH_DIFFUSION_ROWS, row_stride * 2 * sizeof(float));
+  if (!err_rows) {
     snap_rgba_image_to_bits(thread_count, rgba, (size_t)width * (size_t)height, bits_per_channel, bits_per_channel);
     return;
   }
+  memset(err_rows, 0, row_stride * 2 * sizeof(float));
+  err_curr = err_rows;
+  err_next = err_rows + row_stride;
 
-  for (y = 0; y < height; ++y) {
-    left_to_right = ((y & 1) == 0);
-    memset(err_next, 0, row_stride * sizeof(float));
-    if (left_to_right) {
-      for (x = 0; x < width; ++x) {
-        process_bitdepth_pixel(rgba, width, height, x, y, bits_per_channel, dither_level, err_curr, err_next, true);
-      }
-    } else {
-      x = width;
-      while (x-- > 0) {
-        process_bitdepth_pixel(rgba, width, height, x, y, bits_per_channel, dither_level, err_curr, err_next, false);
-      }
-    }
+  dither_bitdepth_rows(&ctx, rgba, 0, height, false, &err_curr, &err_next);
 
-    tmp = err_curr;
-    err_curr = err_next;
-    err_next = tmp;
-  }
-
-  free(err_curr);
-  free(err_next);
+  pngx_scratch_release(scratch, PNGX_SCRATCH_DIFFUSION_ROWS, err_rows);
 }
 
-static inline void reduce_rgba_bitdepth(uint32_t thread_count, uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_per_channel, float dither_level) {
+static inline void reduce_rgba_bitdepth(uint32_t thread_count, uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_per_channel, float dither_level, const pngx_options_t *opts) {
   if (!rgba || width == 0 || height == 0) {
     return;
   }
@@ -131,35 +174,40 @@ static inline void reduce_rgba_bitdepth(uint32_t thread_count, uint8_t *rgba, pn
   }
 
   if (dither_level > 0.0f) {
-    reduce_rgba_bitdepth_dither(thread_count, rgba, width, height, bits_per_channel, dither_level);
+    reduce_rgba_bitdepth_dither(thread_count, rgba, width, height, bits_per_channel, dither_level, opts);
   } else {
     snap_rgba_image_to_bits(thread_count, rgba, (size_t)width * (size_t)height, bits_per_channel, bits_per_channel);
   }
 }
 
-bool pngx_quantize_limited4444(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size) {
-  pngx_rgba_image_t image;
+bool pngx_quantize_limited4444_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size) {
+  pngx_image_analysis_t analysis;
   float resolved_dither;
   bool success;
 
-  if (!png_data || png_size == 0 || !opts || !out_data || !out_size) {
-    return false;
-  }
-
-  if (!load_rgba_image(png_data, png_size, &image)) {
+  if (!image || !image->rgba || !opts || !out_data || !out_size) {
+    rgba_image_reset(image);
     return false;
   }
 
   if (opts->lossy_dither_auto) {
-    resolved_dither = estimate_bitdepth_dither_level_limited4444(image.rgba, image.width, image.height);
+    /* A failed analysis is zeroed and resolves to no dithering. */
+    analyze_image(opts->thread_count, image->rgba, image->width, image->height, &analysis);
+    resolved_dither = dither_level_limited4444_from_analysis(&analysis);
   } else {
     resolved_dither = clamp_float(opts->lossy_dither_level, 0.0f, 1.0f);
   }
 
-  reduce_rgba_bitdepth(opts->thread_count, image.rgba, image.width, image.height, lossy_type_bits(opts->lossy_type), resolved_dither);
+  reduce_rgba_bitdepth(opts->thread_count, image->rgba, image->width, image->height, lossy_type_bits(opts->lossy_type), resolved_dither, opts);
+
+  /* A cancelled dither leaves the image half converted, so nothing is written from it. */
+  if (pngx_cancelled(opts)) {
+    rgba_image_reset(image);
+    return false;
+  }
 
-  success = create_rgba_png(image.rgba, image.pixel_count, image.width, image.height, out_data, out_size);
-  rgba_image_reset(&image);
+  success = create_quantized_rgba_png(image, opts, out_data, out_size);
+  rgba_image_reset(image);
 
   if (success) {
     const char *label = lossy_type_label(opts->lossy_type);
@@ -172,3 +220,17 @@ bool pngx_quantize_limited4444(const uint8_t *png_data, size_t png_size, const p
 
   return success;
 }
+
+bool pngx_quantize_limited4444(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size) {
+  pngx_rgba_image_t image;
+
+  if (!png_data || png_size == 0 || !opts || !out_data || !out_size) {
+    return false;
+  }
+
+  if (!load_rgba_image(png_data, png_size, &image)) {
+    return false;
+  }
+
+  return pngx_quantize_limited4444_image(&image, opts, out_data, out_size);
+}
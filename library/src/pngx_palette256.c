@@ -15,12 +15,14 @@
 #include <png.h>
 #include <zlib.h>
 
+#include "internal/cancel.h"
 #include "internal/log.h"
 #include "internal/pngx_common.h"
 #include "internal/threads.h"
 
 typedef struct {
   pngx_rgba_image_t image;
+  pngx_image_analysis_t analysis;
   pngx_quant_support_t support;
   pngx_image_stats_t stats;
   pngx_options_t tuned_opts;
@@ -40,140 +42,202 @@ typedef struct {
   float cutoff;
 } postprocess_indices_parallel_ctx_t;
 
-/* Global context for multi-step processing. Not thread-safe; must be called sequentially. */
+typedef struct {
+  uint8_t *rgba;
+  uint32_t width;
+  uint32_t height;
+  uint32_t strip_rows;
+  uint16_t max_distance;
+  uint8_t opaque_threshold;
+  uint8_t soft_limit;
+} alpha_bleed_ctx_t;
+
+/* Global context for the split prepare/finalize API. Not thread-safe; must be called sequentially. */
 static palette256_context_t g_palette256_ctx = {0};
 
-static inline void alpha_bleed_rgb_from_opaque(uint8_t *rgba, uint32_t width, uint32_t height, const pngx_options_t *opts) {
-  uint32_t *seed_rgb, x, y, best_rgb;
-  uint16_t *dist, best, d, max_distance;
-  uint8_t opaque_threshold, soft_limit;
-  size_t pixel_count, i, base, idx;
-  bool has_seed;
+static inline void palette256_context_reset(palette256_context_t *ctx) {
+  rgba_image_reset(&ctx->image);
+  quant_support_reset(&ctx->support);
+  memset(ctx, 0, sizeof(*ctx));
+}
 
-  if (!rgba || width == 0 || height == 0) {
-    return;
+/* One forward and one backward 8-neighbour sweep. With unit steps this is the exact chessboard distance to the nearest seed, so further sweeps would change nothing. */
+static inline void alpha_bleed_sweep(uint16_t *dist, uint32_t *seed_rgb, uint32_t width, uint32_t rows) {
+  uint32_t x, y, best_rgb;
+  uint16_t best;
+  size_t idx;
+
+  for (y = 0; y < rows; ++y) {
+    for (x = 0; x < width; ++x) {
+      idx = (size_t)y * (size_t)width + (size_t)x;
+      best = dist[idx];
+      best_rgb = seed_rgb[idx];
+
+      if (x > 0 && dist[idx - 1] != UINT16_MAX && (uint16_t)(dist[idx - 1] + 1) < best) {
+        best = (uint16_t)(dist[idx - 1] + 1);
+        best_rgb = seed_rgb[idx - 1];
+      }
+      if (y > 0 && dist[idx - (size_t)width] != UINT16_MAX && (uint16_t)(dist[idx - (size_t)width] + 1) < best) {
+        best = (uint16_t)(dist[idx - (size_t)width] + 1);
+        best_rgb = seed_rgb[idx - (size_t)width];
+      }
+      if (x > 0 && y > 0 && dist[idx - (size_t)width - 1] != UINT16_MAX && (uint16_t)(dist[idx - (size_t)width - 1] + 1) < best) {
+        best = (uint16_t)(dist[idx - (size_t)width - 1] + 1);
+        best_rgb = seed_rgb[idx - (size_t)width - 1];
+      }
+      if (x + 1 < width && y > 0 && dist[idx - (size_t)width + 1] != UINT16_MAX && (uint16_t)(dist[idx - (size_t)width + 1] + 1) < best) {
+        best = (uint16_t)(dist[idx - (size_t)width + 1] + 1);
+        best_rgb = seed_rgb[idx - (size_t)width + 1];
+      }
+
+      dist[idx] = best;
+      seed_rgb[idx] = best_rgb;
+    }
   }
 
-  if (!opts || !opts->palette256_alpha_bleed_enable) {
-    return;
+  for (y = rows; y-- > 0;) {
+    for (x = width; x-- > 0;) {
+      idx = (size_t)y * (size_t)width + (size_t)x;
+      best = dist[idx];
+      best_rgb = seed_rgb[idx];
+
+      if (x + 1 < width && dist[idx + 1] != UINT16_MAX && (uint16_t)(dist[idx + 1] + 1) < best) {
+        best = (uint16_t)(dist[idx + 1] + 1);
+        best_rgb = seed_rgb[idx + 1];
+      }
+      if (y + 1 < rows && dist[idx + (size_t)width] != UINT16_MAX && (uint16_t)(dist[idx + (size_t)width] + 1) < best) {
+        best = (uint16_t)(dist[idx + (size_t)width] + 1);
+        best_rgb = seed_rgb[idx + (size_t)width];
+      }
+      if (x + 1 < width && y + 1 < rows && dist[idx + (size_t)width + 1] != UINT16_MAX && (uint16_t)(dist[idx + (size_t)width + 1] + 1) < best) {
+        best = (uint16_t)(dist[idx + (size_t)width + 1] + 1);
+        best_rgb = seed_rgb[idx + (size_t)width + 1];
+      }
+      if (x > 0 && y + 1 < rows && dist[idx + (size_t)width - 1] != UINT16_MAX && (uint16_t)(dist[idx + (size_t)width - 1] + 1) < best) {
+        best = (uint16_t)(dist[idx + (size_t)width - 1] + 1);
+        best_rgb = seed_rgb[idx + (size_t)width - 1];
+      }
+
+      dist[idx] = best;
+      seed_rgb[idx] = best_rgb;
+    }
   }
+}
 
-  max_distance = opts->palette256_alpha_bleed_max_distance;
-  opaque_threshold = opts->palette256_alpha_bleed_opaque_threshold;
-  soft_limit = opts->palette256_alpha_bleed_soft_limit;
+/* Strips only write RGB of transparent or unseeded pixels and only read RGB of seeds, so neighbouring strips can share the rows in their windows. */
+static void alpha_bleed_worker(void *context, uint32_t start, uint32_t end) {
+  alpha_bleed_ctx_t *ctx = (alpha_bleed_ctx_t *)context;
+  uint32_t strip, x, y, first_y, last_y, window_first, window_last, window_rows, *seed_rgb;
+  uint16_t *dist, d;
+  uint8_t *pixel;
+  size_t window_capacity, i, idx;
+  bool has_seed;
 
-  if ((size_t)width > SIZE_MAX / (size_t)height) {
+  if (!ctx || start >= end) {
     return;
   }
-  pixel_count = (size_t)width * (size_t)height;
 
-  dist = (uint16_t *)malloc(sizeof(uint16_t) * pixel_count);
-  seed_rgb = (uint32_t *)malloc(sizeof(uint32_t) * pixel_count);
+  window_capacity = (size_t)ctx->strip_rows + 2 * (size_t)ctx->max_distance;
+  if (window_capacity > ctx->height) {
+    window_capacity = ctx->height;
+  }
+  window_capacity *= ctx->width;
+  dist = (uint16_t *)malloc(sizeof(uint16_t) * window_capacity);
+  seed_rgb = (uint32_t *)malloc(sizeof(uint32_t) * window_capacity);
   if (!dist || !seed_rgb) {
     free(dist);
     free(seed_rgb);
     return;
   }
 
-  has_seed = false;
-  for (i = 0; i < pixel_count; ++i) {
-    base = i * 4;
-    if (rgba[base + 3] == 0) {
-      rgba[base + 0] = 0;
-      rgba[base + 1] = 0;
-      rgba[base + 2] = 0;
+  for (strip = start; strip < end; ++strip) {
+    first_y = strip * ctx->strip_rows;
+    last_y = (ctx->height - first_y < ctx->strip_rows) ? ctx->height : first_y + ctx->strip_rows;
+    window_first = (first_y > ctx->max_distance) ? first_y - ctx->max_distance : 0;
+    window_last = (ctx->height - last_y > ctx->max_distance) ? last_y + ctx->max_distance : ctx->height;
+    window_rows = window_last - window_first;
+
+    has_seed = false;
+    for (i = 0; i < (size_t)window_rows * ctx->width; ++i) {
+      pixel = ctx->rgba + ((size_t)window_first * ctx->width + i) * 4;
+      if (pixel[3] >= ctx->opaque_threshold) {
+        dist[i] = 0;
+        seed_rgb[i] = (pixel[3] == 0) ? 0 : (((uint32_t)pixel[0] << 16) | ((uint32_t)pixel[1] << 8) | (uint32_t)pixel[2]);
+        has_seed = true;
+      } else {
+        dist[i] = UINT16_MAX;
+        seed_rgb[i] = 0;
+      }
     }
 
-    if (rgba[base + 3] >= opaque_threshold) {
-      dist[i] = 0;
-      seed_rgb[i] = ((uint32_t)rgba[base + 0] << 16) | ((uint32_t)rgba[base + 1] << 8) | (uint32_t)rgba[base + 2];
-      has_seed = true;
-    } else {
-      dist[i] = UINT16_MAX;
-      seed_rgb[i] = 0;
+    if (has_seed) {
+      alpha_bleed_sweep(dist, seed_rgb, ctx->width, window_rows);
     }
-  }
 
-  if (!has_seed) {
-    free(dist);
-    free(seed_rgb);
-    return;
-  }
-
-  for (i = 0; i < 3; ++i) {
-    for (y = 0; y < height; ++y) {
-      for (x = 0; x < width; ++x) {
-        idx = (size_t)y * (size_t)width + (size_t)x;
-        best = dist[idx];
-        best_rgb = seed_rgb[idx];
-
-        if (x > 0 && dist[idx - 1] != UINT16_MAX && (uint16_t)(dist[idx - 1] + 1) < best) {
-          best = (uint16_t)(dist[idx - 1] + 1);
-          best_rgb = seed_rgb[idx - 1];
-        }
-        if (y > 0 && dist[idx - (size_t)width] != UINT16_MAX && (uint16_t)(dist[idx - (size_t)width] + 1) < best) {
-          best = (uint16_t)(dist[idx - (size_t)width] + 1);
-          best_rgb = seed_rgb[idx - (size_t)width];
-        }
-        if (x > 0 && y > 0 && dist[idx - (size_t)width - 1] != UINT16_MAX && (uint16_t)(dist[idx - (size_t)width - 1] + 1) < best) {
-          best = (uint16_t)(dist[idx - (size_t)width - 1] + 1);
-          best_rgb = seed_rgb[idx - (size_t)width - 1];
-        }
-        if (x + 1 < width && y > 0 && dist[idx - (size_t)width + 1] != UINT16_MAX && (uint16_t)(dist[idx - (size_t)width + 1] + 1) < best) {
-          best = (uint16_t)(dist[idx - (size_t)width + 1] + 1);
-          best_rgb = seed_rgb[idx - (size_t)width + 1];
+    for (y = first_y; y < last_y; ++y) {
+      for (x = 0; x < ctx->width; ++x) {
+        idx = (size_t)(y - window_first) * (size_t)ctx->width + (size_t)x;
+        pixel = ctx->rgba + ((size_t)y * ctx->width + x) * 4;
+        if (pixel[3] == 0) {
+          pixel[0] = 0;
+          pixel[1] = 0;
+          pixel[2] = 0;
         }
 
-        dist[idx] = best;
-        seed_rgb[idx] = best_rgb;
+        d = dist[idx];
+        if (has_seed && pixel[3] <= ctx->soft_limit && d != 0 && d != UINT16_MAX && d <= ctx->max_distance) {
+          pixel[0] = (uint8_t)((seed_rgb[idx] >> 16) & 0xFFu);
+          pixel[1] = (uint8_t)((seed_rgb[idx] >> 8) & 0xFFu);
+          pixel[2] = (uint8_t)(seed_rgb[idx] & 0xFFu);
+        }
       }
     }
+  }
 
-    for (y = height; y-- > 0;) {
-      for (x = width; x-- > 0;) {
-        idx = (size_t)y * (size_t)width + (size_t)x;
-        best = dist[idx];
-        best_rgb = seed_rgb[idx];
+  free(dist);
+  free(seed_rgb);
+}
 
-        if (x + 1 < width && dist[idx + 1] != UINT16_MAX && (uint16_t)(dist[idx + 1] + 1) < best) {
-          best = (uint16_t)(dist[idx + 1] + 1);
-          best_rgb = seed_rgb[idx + 1];
-        }
-        if (y + 1 < height && dist[idx + (size_t)width] != UINT16_MAX && (uint16_t)(dist[idx + (size_t)width] + 1) < best) {
-          best = (uint16_t)(dist[idx + (size_t)width] + 1);
-          best_rgb = seed_rgb[idx + (size_t)width];
-        }
-        if (x + 1 < width && y + 1 < height && dist[idx + (size_t)width + 1] != UINT16_MAX && (uint16_t)(dist[idx + (size_t)width + 1] + 1) < best) {
-          best = (uint16_t)(dist[idx + (size_t)width + 1] + 1);
-          best_rgb = seed_rgb[idx + (size_t)width + 1];
-        }
-        if (x > 0 && y + 1 < height && dist[idx + (size_t)width - 1] != UINT16_MAX && (uint16_t)(dist[idx + (size_t)width - 1] + 1) < best) {
-          best = (uint16_t)(dist[idx + (size_t)width - 1] + 1);
-          best_rgb = seed_rgb[idx + (size_t)width - 1];
-        }
+static inline void alpha_bleed_rgb_from_opaque(uint8_t *rgba, uint32_t width, uint32_t height, const pngx_options_t *opts) {
+  alpha_bleed_ctx_t ctx;
+  uint32_t strip_count;
+  size_t strip_rows;
 
-        dist[idx] = best;
-        seed_rgb[idx] = best_rgb;
-      }
-    }
+  if (!rgba || width == 0 || height == 0) {
+    return;
   }
 
-  for (y = 0; y < height; ++y) {
-    for (x = 0; x < width; ++x) {
-      idx = (size_t)y * (size_t)width + (size_t)x;
-      d = dist[idx];
-      base = idx * 4;
+  if (!opts || !opts->palette256_alpha_bleed_enable) {
+    return;
+  }
 
-      if (rgba[base + 3] <= soft_limit && d != UINT16_MAX && d <= max_distance) {
-        rgba[base + 0] = (uint8_t)((seed_rgb[idx] >> 16) & 0xFFu);
-        rgba[base + 1] = (uint8_t)((seed_rgb[idx] >> 8) & 0xFFu);
-        rgba[base + 2] = (uint8_t)(seed_rgb[idx] & 0xFFu);
-      }
-    }
+  if ((size_t)width > SIZE_MAX / (size_t)height) {
+    return;
   }
 
-  free(dist);
-  free(seed_rgb);
+  ctx.rgba = rgba;
+  ctx.width = width;
+  ctx.height = height;
+  ctx.max_distance = opts->palette256_alpha_bleed_max_distance;
+  ctx.opaque_threshold = opts->palette256_alpha_bleed_opaque_threshold;
+  ctx.soft_limit = opts->palette256_alpha_bleed_soft_limit;
+
+  /* Only seeds within max_distance can reach a strip, so each strip sweeps a window of max_distance rows on either side. Strips are kept at least four times that tall to bound the overlap. */
+  strip_rows = (size_t)ctx.max_distance * 4;
+  if (strip_rows < PNGX_PALETTE256_ALPHA_BLEED_STRIP_ROWS) {
+    strip_rows = PNGX_PALETTE256_ALPHA_BLEED_STRIP_ROWS;
+  }
+  if (strip_rows > height) {
+    strip_rows = height;
+  }
+  ctx.strip_rows = (uint32_t)strip_rows;
+  strip_count = (uint32_t)(((size_t)height + strip_rows - 1) / strip_rows);
+
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_parallel_for(opts->thread_count, strip_count, alpha_bleed_worker, &ctx);
+#else
+  alpha_bleed_worker(&ctx, 0, strip_count);
+#endif
 }
 
 static inline void sanitize_transparent_palette(cpres_rgba_color_t *palette, size_t palette_len) {
@@ -406,7 +470,7 @@ static inline void postprocess_indices(uint32_t thread_count, uint8_t *indices,
 
   pixel_count = (size_t)width * (size_t)height;
 
-  reference = (uint8_t *)malloc(pixel_count);
+  reference = (uint8_t *)pngx_scratch_acquire(opts->scratch, PNGX_SCRATCH_INDEX_REFERENCE, pixel_count);
   if (!reference) {
     return;
   }
@@ -428,7 +492,7 @@ static inline void postprocess_indices(uint32_t thread_count, uint8_t *indices,
   postprocess_indices_parallel_worker(&ctx, 0, height);
 #endif
 
-  free(reference);
+  pngx_scratch_release(opts->scratch, PNGX_SCRATCH_INDEX_REFERENCE, reference);
 }
 
 static inline void fill_quant_params(PngxBridgeQuantParams *params, const pngx_options_t *opts, const uint8_t *importance_map, size_t importance_map_len) {
@@ -451,25 +515,8 @@ static inline void fill_quant_params(PngxBridgeQuantParams *params, const pngx_o
   params->fixed_colors = opts->protected_colors;
   params->fixed_colors_len = (size_t)((opts->protected_colors_count > 0) ? opts->protected_colors_count : 0);
   params->remap = true;
-}
-
-static inline void free_quant_output(PngxBridgeQuantOutput *output) {
-  if (!output) {
-    return;
-  }
-
-  if (output->palette) {
-    pngx_bridge_free((uint8_t *)output->palette);
-    output->palette = NULL;
-  }
-  output->palette_len = 0;
-
-  if (output->indices) {
-    pngx_bridge_free(output->indices);
-    output->indices = NULL;
-  }
-
-  output->indices_len = 0;
+  params->cancel_flag = cancel_token_flag(opts->cancel_token);
+  params->thread_count = opts->thread_count;
 }
 
 static inline bool init_write_struct(png_structp *png_ptr, png_infop *info_ptr) {
@@ -600,8 +647,8 @@ static inline png_bytep *build_row_pointers(const uint8_t *data, size_t row_stri
   return row_pointers;
 }
 
-extern bool pngx_create_palette_png(const uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len, uint32_t width, uint32_t height, uint8_t **out_data,
-                                    size_t *out_size) {
+static bool write_palette_png(const uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len, uint32_t width, uint32_t height, int compression_level,
+                              uint8_t **out_data, size_t *out_size) {
   png_color palette_data[256];
   png_byte alpha_data[256];
   png_structp png_ptr;
@@ -637,7 +684,7 @@ extern bool pngx_create_palette_png(const uint8_t *indices, size_t indices_len,
   }
 
   png_set_write_fn(png_ptr, &buffer, memory_write, NULL);
-  png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+  png_set_compression_level(png_ptr, compression_level);
   png_set_compression_strategy(png_ptr, Z_FILTERED);
   png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_ALL_FILTERS);
   png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
@@ -675,19 +722,22 @@ extern bool pngx_create_palette_png(const uint8_t *indices, size_t indices_len,
   return finalize_memory_png(&buffer, out_data, out_size);
 }
 
-extern bool create_rgba_png(const uint8_t *rgba, size_t pixel_count, uint32_t width, uint32_t height, uint8_t **out_data, size_t *out_size) {
+extern bool pngx_create_palette_png(const uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len, uint32_t width, uint32_t height, uint8_t **out_data,
+                                    size_t *out_size) {
+  return write_palette_png(indices, indices_len, palette, palette_len, width, height, Z_BEST_COMPRESSION, out_data, out_size);
+}
+
+extern bool create_rgba_png_strided(const uint8_t *rgba, size_t row_stride, uint32_t width, uint32_t height, int compression_level, uint8_t **out_data, size_t *out_size) {
   png_structp png_ptr;
   png_infop info_ptr;
   png_bytep *row_pointers;
   png_memory_buffer_t buffer;
-  size_t expected_pixels;
 
   if (!rgba || !out_data || !out_size || width == 0 || height == 0) {
     return false;
   }
 
-  expected_pixels = (size_t)width * (size_t)height;
-  if (pixel_count != expected_pixels) {
+  if (row_stride < (size_t)width * PNGX_RGBA_CHANNELS) {
     return false;
   }
 
@@ -708,13 +758,13 @@ extern bool create_rgba_png(const uint8_t *rgba, size_t pixel_count, uint32_t wi
   }
 
   png_set_write_fn(png_ptr, &buffer, memory_write, NULL);
-  png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+  png_set_compression_level(png_ptr, compression_level);
   png_set_compression_strategy(png_ptr, Z_FILTERED);
   png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_ALL_FILTERS);
   png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
   png_write_info(png_ptr, info_ptr);
 
-  row_pointers = build_row_pointers(rgba, (size_t)width * PNGX_RGBA_CHANNELS, height);
+  row_pointers = build_row_pointers(rgba, row_stride, height);
   if (!row_pointers) {
     png_error(png_ptr, "png row allocation failed");
 
@@ -730,174 +780,98 @@ extern bool create_rgba_png(const uint8_t *rgba, size_t pixel_count, uint32_t wi
   return finalize_memory_png(&buffer, out_data, out_size);
 }
 
-bool pngx_quantize_palette256(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality) {
-  PngxBridgeQuantParams params = {0}, fallback_params = {0};
-  PngxBridgeQuantOutput output = {0};
-  PngxBridgeQuantStatus status;
-  uint8_t *rgba, *importance_map, *fixed_colors, quality_min, quality_max;
-  uint32_t width, height, max_colors;
-  int32_t speed;
-  size_t pixel_count, importance_map_len, fixed_colors_len;
-  float dither_level;
-  bool relaxed_quality, success;
-
-  if (!png_data || png_size == 0 || !opts || !out_data || !out_size) {
-    return false;
-  }
-
-  if (quant_quality) {
-    *quant_quality = -1;
-  }
-
-  if (!pngx_palette256_prepare(png_data, png_size, opts, &rgba, &width, &height, &importance_map, &importance_map_len, &speed, &quality_min, &quality_max, &max_colors, &dither_level, &fixed_colors,
-                               &fixed_colors_len)) {
+extern bool create_rgba_png(const uint8_t *rgba, size_t pixel_count, uint32_t width, uint32_t height, uint8_t **out_data, size_t *out_size) {
+  if (width == 0 || height == 0 || pixel_count != (size_t)width * (size_t)height) {
     return false;
   }
 
-  pixel_count = (size_t)width * (size_t)height;
-
-  params.speed = speed;
-  params.quality_min = quality_min;
-  params.quality_max = quality_max;
-  params.max_colors = max_colors;
-  params.min_posterization = -1;
-  params.dithering_level = dither_level;
-  params.importance_map = importance_map;
-  params.importance_map_len = importance_map_len;
-  params.fixed_colors = (const cpres_rgba_color_t *)fixed_colors;
-  params.fixed_colors_len = fixed_colors_len;
-  params.remap = true;
-
-  output.quality = -1;
-  relaxed_quality = false;
-
-  status = pngx_bridge_quantize((const cpres_rgba_color_t *)rgba, pixel_count, width, height, &params, &output);
-  pngx_set_last_error((int)status);
-
-  if (status == PNGX_BRIDGE_QUANT_STATUS_QUALITY_TOO_LOW && params.quality_min > 0) {
-    fallback_params = params;
-    fallback_params.quality_min = 0;
-
-    if (fallback_params.quality_max < fallback_params.quality_min) {
-      fallback_params.quality_max = fallback_params.quality_min;
-    }
-
-    output.palette = NULL;
-    output.palette_len = 0;
-    output.indices = NULL;
-    output.indices_len = 0;
-    output.quality = -1;
-
-    status = pngx_bridge_quantize((const cpres_rgba_color_t *)rgba, pixel_count, width, height, &fallback_params, &output);
-    pngx_set_last_error((int)status);
-    if (status == PNGX_BRIDGE_QUANT_STATUS_OK) {
-      relaxed_quality = true;
-    }
-  }
-
-  if (status != PNGX_BRIDGE_QUANT_STATUS_OK) {
-    free_quant_output(&output);
-    pngx_palette256_cleanup();
-    if (status == PNGX_BRIDGE_QUANT_STATUS_QUALITY_TOO_LOW) {
-      colopresso_log(CPRES_LOG_LEVEL_WARNING, "PNGX: Quantization quality too low");
-    }
+  return create_rgba_png_strided(rgba, (size_t)width * PNGX_RGBA_CHANNELS, width, height, Z_BEST_COMPRESSION, out_data, out_size);
+}
 
+extern bool create_quantized_rgba_png(const pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size) {
+  if (!image || !opts) {
     return false;
   }
 
-  if (relaxed_quality) {
-    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Relaxed quantization quality floor");
-  }
-
-  if (quant_quality) {
-    *quant_quality = output.quality;
-  }
-
-  success = false;
-  if (output.indices && output.indices_len == pixel_count && output.palette && output.palette_len > 0 && output.palette_len <= 256) {
-    success = pngx_palette256_finalize(output.indices, output.indices_len, output.palette, output.palette_len, out_data, out_size);
-  } else {
-    pngx_palette256_cleanup();
-  }
-
-  free_quant_output(&output);
-
-  return success;
+  return create_rgba_png_strided(image->rgba, (size_t)image->width * PNGX_RGBA_CHANNELS, image->width, image->height, opts->lossless_deferred ? Z_BEST_SPEED : Z_BEST_COMPRESSION, out_data,
+                                 out_size);
 }
 
-bool pngx_palette256_prepare(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_rgba, uint32_t *out_width, uint32_t *out_height, uint8_t **out_importance_map,
-                             size_t *out_importance_map_len, int32_t *out_speed, uint8_t *out_quality_min, uint8_t *out_quality_max, uint32_t *out_max_colors, float *out_dither_level,
-                             uint8_t **out_fixed_colors, size_t *out_fixed_colors_len) {
+static bool palette256_context_prepare(palette256_context_t *ctx, pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_rgba, uint32_t *out_width, uint32_t *out_height,
+                                       uint8_t **out_importance_map, size_t *out_importance_map_len, int32_t *out_speed, uint8_t *out_quality_min, uint8_t *out_quality_max, uint32_t *out_max_colors,
+                                       float *out_dither_level, uint8_t **out_fixed_colors, size_t *out_fixed_colors_len) {
   float estimated_dither, gradient_dither_floor;
   PngxBridgeQuantParams params = {0};
 
-  if (!png_data || png_size == 0 || !opts || !out_rgba || !out_width || !out_height) {
+  if (!image || !image->rgba || !opts || !out_rgba || !out_width || !out_height) {
+    rgba_image_reset(image);
     return false;
   }
 
-  if (g_palette256_ctx.initialized) {
-    rgba_image_reset(&g_palette256_ctx.image);
-    quant_support_reset(&g_palette256_ctx.support);
-    memset(&g_palette256_ctx, 0, sizeof(g_palette256_ctx));
+  if (ctx->initialized) {
+    rgba_image_reset(&ctx->image);
+    quant_support_reset(&ctx->support);
+    memset(ctx, 0, sizeof(*ctx));
   }
 
-  if (!load_rgba_image(png_data, png_size, &g_palette256_ctx.image)) {
-    return false;
-  }
+  ctx->image = *image;
+  image->rgba = NULL;
+  rgba_image_reset(image);
 
-  alpha_bleed_rgb_from_opaque(g_palette256_ctx.image.rgba, g_palette256_ctx.image.width, g_palette256_ctx.image.height, opts);
+  alpha_bleed_rgb_from_opaque(ctx->image.rgba, ctx->image.width, ctx->image.height, opts);
 
-  image_stats_reset(&g_palette256_ctx.stats);
-  if (!prepare_quant_support(&g_palette256_ctx.image, opts, &g_palette256_ctx.support, &g_palette256_ctx.stats)) {
-    rgba_image_reset(&g_palette256_ctx.image);
-    quant_support_reset(&g_palette256_ctx.support);
+  image_stats_reset(&ctx->stats);
+  if (!analyze_image(opts->thread_count, ctx->image.rgba, ctx->image.width, ctx->image.height, &ctx->analysis) ||
+      !prepare_quant_support(&ctx->image, &ctx->analysis, opts, &ctx->support, &ctx->stats)) {
+    rgba_image_reset(&ctx->image);
+    quant_support_reset(&ctx->support);
     return false;
   }
 
-  g_palette256_ctx.tuned_opts = *opts;
-  g_palette256_ctx.prefer_uniform = opts->palette256_gradient_profile_enable ? is_smooth_gradient_profile(&g_palette256_ctx.stats, &g_palette256_ctx.tuned_opts) : false;
+  ctx->tuned_opts = *opts;
+  ctx->prefer_uniform = opts->palette256_gradient_profile_enable ? is_smooth_gradient_profile(&ctx->stats, &ctx->tuned_opts) : false;
 
-  if (g_palette256_ctx.prefer_uniform) {
-    g_palette256_ctx.tuned_opts.saliency_map_enable = false;
-    g_palette256_ctx.tuned_opts.chroma_anchor_enable = false;
-    g_palette256_ctx.tuned_opts.postprocess_smooth_enable = false;
+  if (ctx->prefer_uniform) {
+    ctx->tuned_opts.saliency_map_enable = false;
+    ctx->tuned_opts.chroma_anchor_enable = false;
+    ctx->tuned_opts.postprocess_smooth_enable = false;
   } else {
-    build_fixed_palette(opts, &g_palette256_ctx.support, &g_palette256_ctx.tuned_opts);
+    build_fixed_palette(opts, &ctx->support, &ctx->tuned_opts);
   }
 
-  g_palette256_ctx.resolved_dither = resolve_quant_dither(opts, &g_palette256_ctx.stats);
+  ctx->resolved_dither = resolve_quant_dither(opts, &ctx->stats);
 
   if (opts->lossy_dither_auto) {
-    estimated_dither = estimate_bitdepth_dither_level(g_palette256_ctx.image.rgba, g_palette256_ctx.image.width, g_palette256_ctx.image.height, 8);
-    if (estimated_dither > g_palette256_ctx.resolved_dither) {
-      g_palette256_ctx.resolved_dither = estimated_dither;
+    estimated_dither = dither_level_from_analysis(&ctx->analysis, 8);
+    if (estimated_dither > ctx->resolved_dither) {
+      ctx->resolved_dither = estimated_dither;
     }
   }
 
-  gradient_dither_floor = g_palette256_ctx.tuned_opts.palette256_gradient_profile_dither_floor;
+  gradient_dither_floor = ctx->tuned_opts.palette256_gradient_profile_dither_floor;
   if (gradient_dither_floor < 0.0f) {
     gradient_dither_floor = PNGX_PALETTE256_GRADIENT_PROFILE_DITHER_FLOOR;
   }
 
-  if (g_palette256_ctx.prefer_uniform && g_palette256_ctx.resolved_dither < gradient_dither_floor) {
-    g_palette256_ctx.resolved_dither = gradient_dither_floor;
+  if (ctx->prefer_uniform && ctx->resolved_dither < gradient_dither_floor) {
+    ctx->resolved_dither = gradient_dither_floor;
   }
 
-  g_palette256_ctx.tuned_opts.lossy_dither_level = g_palette256_ctx.resolved_dither;
+  ctx->tuned_opts.lossy_dither_level = ctx->resolved_dither;
 
-  fill_quant_params(&params, &g_palette256_ctx.tuned_opts, g_palette256_ctx.prefer_uniform ? NULL : g_palette256_ctx.support.importance_map,
-                    g_palette256_ctx.prefer_uniform ? 0 : g_palette256_ctx.support.importance_map_len);
-  params.dithering_level = g_palette256_ctx.resolved_dither;
-  tune_quant_params_for_image(&params, &g_palette256_ctx.tuned_opts, &g_palette256_ctx.stats);
+  fill_quant_params(&params, &ctx->tuned_opts, ctx->prefer_uniform ? NULL : ctx->support.importance_map,
+                    ctx->prefer_uniform ? 0 : ctx->support.importance_map_len);
+  params.dithering_level = ctx->resolved_dither;
+  tune_quant_params_for_image(&params, &ctx->tuned_opts, &ctx->stats);
 
-  *out_rgba = g_palette256_ctx.image.rgba;
-  *out_width = g_palette256_ctx.image.width;
-  *out_height = g_palette256_ctx.image.height;
+  *out_rgba = ctx->image.rgba;
+  *out_width = ctx->image.width;
+  *out_height = ctx->image.height;
 
   if (out_importance_map && out_importance_map_len) {
-    if (!g_palette256_ctx.prefer_uniform && g_palette256_ctx.support.importance_map) {
-      *out_importance_map = g_palette256_ctx.support.importance_map;
-      *out_importance_map_len = g_palette256_ctx.support.importance_map_len;
+    if (!ctx->prefer_uniform && ctx->support.importance_map) {
+      *out_importance_map = ctx->support.importance_map;
+      *out_importance_map_len = ctx->support.importance_map_len;
     } else {
       *out_importance_map = NULL;
       *out_importance_map_len = 0;
@@ -925,76 +899,287 @@ bool pngx_palette256_prepare(const uint8_t *png_data, size_t png_size, const png
     }
   }
 
-  g_palette256_ctx.initialized = true;
+  ctx->initialized = true;
   return true;
 }
 
-bool pngx_palette256_finalize(const uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len, uint8_t **out_data, size_t *out_size) {
-  uint8_t *mutable_indices;
-  cpres_rgba_color_t *mutable_palette;
-  bool success;
+/* Post-processes the caller's indices in place and hands them to out with the sanitized palette, so the quantizer's output buffer is what gets written. On success out
+ * owns indices. */
+static bool palette256_context_finish_indices(palette256_context_t *ctx, uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len,
+                                              pngx_indexed_image_t *out) {
+  bool success = false;
 
-  if (!g_palette256_ctx.initialized) {
+  if (!ctx->initialized) {
     return false;
   }
 
-  if (!indices || indices_len == 0 || !palette || palette_len == 0 || palette_len > 256 || !out_data || !out_size) {
-    rgba_image_reset(&g_palette256_ctx.image);
-    quant_support_reset(&g_palette256_ctx.support);
-    memset(&g_palette256_ctx, 0, sizeof(g_palette256_ctx));
+  if (!indices || indices_len == 0 || !palette || palette_len == 0 || palette_len > 256 || !out) {
+    palette256_context_reset(ctx);
 
     return false;
   }
 
-  if (indices_len != g_palette256_ctx.image.pixel_count) {
-    rgba_image_reset(&g_palette256_ctx.image);
-    quant_support_reset(&g_palette256_ctx.support);
-    memset(&g_palette256_ctx, 0, sizeof(g_palette256_ctx));
+  if (indices_len != ctx->image.pixel_count) {
+    palette256_context_reset(ctx);
 
     return false;
   }
 
-  mutable_palette = (cpres_rgba_color_t *)malloc(sizeof(cpres_rgba_color_t) * palette_len);
-  if (!mutable_palette) {
-    rgba_image_reset(&g_palette256_ctx.image);
-    quant_support_reset(&g_palette256_ctx.support);
-    memset(&g_palette256_ctx, 0, sizeof(g_palette256_ctx));
+  memcpy(out->palette, palette, sizeof(cpres_rgba_color_t) * palette_len);
+  sanitize_transparent_palette(out->palette, palette_len);
+
+  if (!pngx_cancelled(&ctx->tuned_opts)) {
+    postprocess_indices(ctx->tuned_opts.thread_count, indices, ctx->image.width, ctx->image.height, out->palette, palette_len, &ctx->support, &ctx->tuned_opts);
+    out->indices = indices;
+    out->indices_len = indices_len;
+    out->palette_len = palette_len;
+    out->width = ctx->image.width;
+    out->height = ctx->image.height;
+    success = true;
+  }
+
+  palette256_context_reset(ctx);
+
+  return success;
+}
+
+static bool palette256_context_finalize(palette256_context_t *ctx, const uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len, uint8_t **out_data,
+                                        size_t *out_size) {
+  pngx_indexed_image_t indexed;
+  uint8_t *mutable_indices;
+  bool success;
+
+  if (!ctx->initialized) {
+    return false;
+  }
+
+  if (!indices || indices_len == 0 || !out_data || !out_size) {
+    palette256_context_reset(ctx);
 
     return false;
   }
-  memcpy(mutable_palette, palette, sizeof(cpres_rgba_color_t) * palette_len);
-  sanitize_transparent_palette(mutable_palette, palette_len);
 
   mutable_indices = (uint8_t *)malloc(indices_len);
   if (!mutable_indices) {
-    free(mutable_palette);
-    rgba_image_reset(&g_palette256_ctx.image);
-    quant_support_reset(&g_palette256_ctx.support);
-    memset(&g_palette256_ctx, 0, sizeof(g_palette256_ctx));
+    palette256_context_reset(ctx);
     return false;
   }
 
   memcpy(mutable_indices, indices, indices_len);
 
-  postprocess_indices(g_palette256_ctx.tuned_opts.thread_count, mutable_indices, g_palette256_ctx.image.width, g_palette256_ctx.image.height, mutable_palette, palette_len, &g_palette256_ctx.support,
-                      &g_palette256_ctx.tuned_opts);
+  memset(&indexed, 0, sizeof(indexed));
+  if (!palette256_context_finish_indices(ctx, mutable_indices, indices_len, palette, palette_len, &indexed)) {
+    free(mutable_indices);
+    return false;
+  }
 
-  success = pngx_create_palette_png(mutable_indices, indices_len, mutable_palette, palette_len, g_palette256_ctx.image.width, g_palette256_ctx.image.height, out_data, out_size);
+  success = write_palette_png(indexed.indices, indexed.indices_len, indexed.palette, indexed.palette_len, indexed.width, indexed.height, Z_BEST_COMPRESSION, out_data, out_size);
 
-  free(mutable_indices);
-  free(mutable_palette);
+  pngx_indexed_image_reset(&indexed);
 
-  rgba_image_reset(&g_palette256_ctx.image);
-  quant_support_reset(&g_palette256_ctx.support);
-  memset(&g_palette256_ctx, 0, sizeof(g_palette256_ctx));
+  return success;
+}
+
+void pngx_indexed_image_reset(pngx_indexed_image_t *indexed) {
+  if (!indexed) {
+    return;
+  }
+
+  pngx_scratch_release(indexed->scratch, PNGX_SCRATCH_INDICES, indexed->indices);
+  indexed->indices = NULL;
+  indexed->indices_len = 0;
+  indexed->palette_len = 0;
+  indexed->scratch = NULL;
+}
+
+bool pngx_quantize_palette256_indexed(pngx_rgba_image_t *image, const pngx_options_t *opts, pngx_indexed_image_t *out, int *quant_quality) {
+  PngxBridgeQuantParams params = {0};
+  PngxBridgeQuantOutput output = {0};
+  PngxBridgeQuantStatus status;
+  palette256_context_t ctx = {0};
+  cpres_rgba_color_t palette[256];
+  uint8_t *rgba, *importance_map, *fixed_colors, *indices, quality_min, quality_max;
+  uint32_t width, height, max_colors;
+  int32_t speed;
+  size_t pixel_count, importance_map_len, fixed_colors_len;
+  float dither_level;
+
+  if (!image || !image->rgba || !opts || !out) {
+    rgba_image_reset(image);
+    return false;
+  }
+
+  memset(out, 0, sizeof(*out));
+  if (quant_quality) {
+    *quant_quality = -1;
+  }
+
+  if (!palette256_context_prepare(&ctx, image, opts, &rgba, &width, &height, &importance_map, &importance_map_len, &speed, &quality_min, &quality_max, &max_colors, &dither_level, &fixed_colors,
+                                  &fixed_colors_len)) {
+    return false;
+  }
+
+  pixel_count = (size_t)width * (size_t)height;
+
+  /* The bridge reads rgba in place and remaps straight into this buffer, which is then post-processed in place and handed to out. */
+  indices = (uint8_t *)pngx_scratch_acquire(opts->scratch, PNGX_SCRATCH_INDICES, pixel_count);
+  if (!indices) {
+    palette256_context_reset(&ctx);
+    return false;
+  }
+
+  /* One pass with no quality floor: imagequant reports the quality it reached, and a result under the requested floor is accepted as relaxed. Asking for the floor
+   * instead would make imagequant fail with QUALITY_TOO_LOW after the full histogram and palette search, and the retry without a floor would redo both. */
+  params.speed = speed;
+  params.quality_min = 0;
+  params.quality_max = quality_max;
+  params.max_colors = max_colors;
+  params.min_posterization = -1;
+  params.dithering_level = dither_level;
+  params.importance_map = importance_map;
+  params.importance_map_len = importance_map_len;
+  params.fixed_colors = (const cpres_rgba_color_t *)fixed_colors;
+  params.fixed_colors_len = fixed_colors_len;
+  params.remap = true;
+  params.cancel_flag = cancel_token_flag(opts->cancel_token);
+  params.thread_count = opts->thread_count;
+
+  output.palette = palette;
+  output.indices = indices;
+  output.indices_len = pixel_count;
+  output.quality = -1;
+
+  status = pngx_bridge_quantize_into((const cpres_rgba_color_t *)rgba, pixel_count, width, height, &params, &output);
+  pngx_set_last_error((int)status);
+
+  if (status != PNGX_BRIDGE_QUANT_STATUS_OK) {
+    pngx_scratch_release(opts->scratch, PNGX_SCRATCH_INDICES, indices);
+    palette256_context_reset(&ctx);
+    if (status == PNGX_BRIDGE_QUANT_STATUS_QUALITY_TOO_LOW) {
+      colopresso_log(CPRES_LOG_LEVEL_WARNING, "PNGX: Quantization quality too low");
+    } else if (status == PNGX_BRIDGE_QUANT_STATUS_CANCELLED) {
+      colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Quantization cancelled");
+    }
+
+    return false;
+  }
+
+  if (quality_min > 0 && output.quality >= 0 && output.quality < (int32_t)quality_min) {
+    colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Relaxed quantization quality floor (%d < %u)", (int)output.quality, (unsigned)quality_min);
+  }
+
+  if (quant_quality) {
+    *quant_quality = output.quality;
+  }
+
+  if (output.indices_len != pixel_count || output.palette_len == 0 || output.palette_len > 256) {
+    pngx_scratch_release(opts->scratch, PNGX_SCRATCH_INDICES, indices);
+    palette256_context_reset(&ctx);
+    return false;
+  }
+
+  if (!palette256_context_finish_indices(&ctx, indices, pixel_count, palette, output.palette_len, out)) {
+    pngx_scratch_release(opts->scratch, PNGX_SCRATCH_INDICES, indices);
+    return false;
+  }
+  out->scratch = opts->scratch;
+
+  return true;
+}
+
+/* Unless deferred, the indices go to oxipng as raw scanlines, which skips both a libpng encode here and oxipng's re-parse of it; libpng stays as the fallback. */
+bool pngx_palette256_write_indexed(const pngx_indexed_image_t *indexed, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, bool *out_optimized) {
+  bool success = false;
+
+  if (out_optimized) {
+    *out_optimized = false;
+  }
+
+  if (!indexed || !indexed->indices || !opts || !out_data || !out_size) {
+    return false;
+  }
+
+  if (!opts->lossless_deferred) {
+    success = pngx_run_indexed_optimization(indexed->indices, indexed->indices_len, indexed->palette, indexed->palette_len, indexed->width, indexed->height, opts, out_data, out_size);
+    if (out_optimized) {
+      *out_optimized = success;
+    }
+  }
+  if (!success && !pngx_cancelled(opts)) {
+    success = write_palette_png(indexed->indices, indexed->indices_len, indexed->palette, indexed->palette_len, indexed->width, indexed->height,
+                                opts->lossless_deferred ? Z_BEST_SPEED : Z_BEST_COMPRESSION, out_data, out_size);
+  }
+
+  return success;
+}
+
+bool pngx_quantize_palette256_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality) {
+  pngx_indexed_image_t indexed;
+  bool success;
+
+  if (!image || !image->rgba || !opts || !out_data || !out_size) {
+    rgba_image_reset(image);
+    return false;
+  }
+
+  if (!pngx_quantize_palette256_indexed(image, opts, &indexed, quant_quality)) {
+    return false;
+  }
+
+  success = pngx_palette256_write_indexed(&indexed, opts, out_data, out_size, NULL);
+  pngx_indexed_image_reset(&indexed);
 
   return success;
 }
 
+bool pngx_quantize_palette256(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_data, size_t *out_size, int *quant_quality) {
+  pngx_rgba_image_t image;
+
+  if (!png_data || png_size == 0 || !opts || !out_data || !out_size) {
+    return false;
+  }
+
+  if (quant_quality) {
+    *quant_quality = -1;
+  }
+
+  if (!load_rgba_image(png_data, png_size, &image)) {
+    return false;
+  }
+
+  return pngx_quantize_palette256_image(&image, opts, out_data, out_size, quant_quality);
+}
+
+bool pngx_palette256_prepare_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint8_t **out_rgba, uint32_t *out_width, uint32_t *out_height, uint8_t **out_importance_map,
+                                   size_t *out_importance_map_len, int32_t *out_speed, uint8_t *out_quality_min, uint8_t *out_quality_max, uint32_t *out_max_colors, float *out_dither_level,
+                                   uint8_t **out_fixed_colors, size_t *out_fixed_colors_len) {
+  return palette256_context_prepare(&g_palette256_ctx, image, opts, out_rgba, out_width, out_height, out_importance_map, out_importance_map_len, out_speed, out_quality_min, out_quality_max,
+                                    out_max_colors, out_dither_level, out_fixed_colors, out_fixed_colors_len);
+}
+
+bool pngx_palette256_prepare(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint8_t **out_rgba, uint32_t *out_width, uint32_t *out_height, uint8_t **out_importance_map,
+                             size_t *out_importance_map_len, int32_t *out_speed, uint8_t *out_quality_min, uint8_t *out_quality_max, uint32_t *out_max_colors, float *out_dither_level,
+                             uint8_t **out_fixed_colors, size_t *out_fixed_colors_len) {
+  pngx_rgba_image_t image;
+
+  if (!png_data || png_size == 0 || !opts || !out_rgba || !out_width || !out_height) {
+    return false;
+  }
+
+  if (!load_rgba_image(png_data, png_size, &image)) {
+    return false;
+  }
+
+  return pngx_palette256_prepare_image(&image, opts, out_rgba, out_width, out_height, out_importance_map, out_importance_map_len, out_speed, out_quality_min, out_quality_max, out_max_colors,
+                                       out_dither_level, out_fixed_colors, out_fixed_colors_len);
+}
+
+bool pngx_palette256_finalize(const uint8_t *indices, size_t indices_len, const cpres_rgba_color_t *palette, size_t palette_len, uint8_t **out_data, size_t *out_size) {
+  return palette256_context_finalize(&g_palette256_ctx, indices, indices_len, palette, palette_len, out_data, out_size);
+}
+
 void pngx_palette256_cleanup(void) {
   if (g_palette256_ctx.initialized) {
-    rgba_image_reset(&g_palette256_ctx.image);
-    quant_support_reset(&g_palette256_ctx.support);
-    memset(&g_palette256_ctx, 0, sizeof(g_palette256_ctx));
+    palette256_context_reset(&g_palette256_ctx);
   }
 }
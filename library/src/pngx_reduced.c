@@ -58,6 +58,11 @@ typedef struct {
   uint64_t total_weight;
 } color_box_t;
 
+typedef struct {
+  float priority;
+  uint32_t index;
+} color_box_heap_item_t;
+
 typedef struct {
   uint32_t color;
   uint32_t mapped_color;
@@ -100,33 +105,42 @@ typedef struct {
   size_t pixel_count;
 } pack_rgba_parallel_ctx_t;
 
-static int compare_entries_r(const void *lhs, const void *rhs) {
-  const color_entry_t *a = (const color_entry_t *)lhs, *b = (const color_entry_t *)rhs;
-  uint8_t av = (uint8_t)(a->color & 0xff), bv = (uint8_t)(b->color & 0xff);
-
-  return (av < bv) ? -1 : ((av > bv) ? 1 : 0);
-}
-
-static int compare_entries_g(const void *lhs, const void *rhs) {
-  const color_entry_t *a = (const color_entry_t *)lhs, *b = (const color_entry_t *)rhs;
-  uint8_t av = (uint8_t)((a->color >> 8) & 0xff), bv = (uint8_t)((b->color >> 8) & 0xff);
-
-  return (av < bv) ? -1 : ((av > bv) ? 1 : 0);
-}
-
-static int compare_entries_b(const void *lhs, const void *rhs) {
-  const color_entry_t *a = (const color_entry_t *)lhs, *b = (const color_entry_t *)rhs;
-  uint8_t av = (uint8_t)((a->color >> 16) & 0xff), bv = (uint8_t)((b->color >> 16) & 0xff);
-
-  return (av < bv) ? -1 : ((av > bv) ? 1 : 0);
-}
+/* Open-addressing color -> weight table; a zero weight marks an empty slot. */
+typedef struct {
+  uint32_t *colors;
+  uint64_t *weights;
+  uint8_t *bits; /* Max rgb bits << 4 | max alpha bits */
+  size_t capacity;
+  size_t count;
+} color_hash_t;
 
-static int compare_entries_a(const void *lhs, const void *rhs) {
-  const color_entry_t *a = (const color_entry_t *)lhs, *b = (const color_entry_t *)rhs;
-  uint8_t av = (uint8_t)((a->color >> 24) & 0xff), bv = (uint8_t)((b->color >> 24) & 0xff);
+typedef struct {
+  const uint8_t *rgba;
+  size_t pixel_count;
+  size_t slice_pixels;
+  color_hash_t *tables;
+  const pngx_quant_support_t *support;
+  const pngx_options_t *opts;
+  uint8_t bits_rgb;
+  uint8_t bits_alpha;
+  bool histogram; /* Grid-quantized samples with importance weights and bit hints instead of raw pixel counts */
+  volatile int32_t failed;
+} color_hash_parallel_ctx_t;
 
-  return (av < bv) ? -1 : ((av > bv) ? 1 : 0);
-}
+typedef struct {
+  png_uint_32 width;
+  png_uint_32 height;
+  uint8_t bits_rgb;
+  uint8_t bits_alpha;
+  uint8_t boost_bits_rgb;
+  uint8_t boost_bits_alpha;
+  float dither_level;
+  const uint8_t *importance_map;
+  size_t pixel_count;
+  uint8_t *bit_hint_map;
+  size_t bit_hint_len;
+  const pngx_options_t *opts;
+} custom_bitdepth_dither_ctx_t;
 
 static inline uint32_t compute_grid_capacity(uint8_t bits_rgb, uint8_t bits_alpha) {
   uint64_t capacity;
@@ -387,32 +401,62 @@ static inline float color_box_detail_bias(const color_entry_t *entries, const co
   return (float)accum_x2 / (float)(weight * 2);
 }
 
-static inline int select_box_to_split(const color_box_t *boxes, size_t box_count, const color_entry_t *entries, uint8_t base_bits_rgb, uint8_t base_bits_alpha) {
-  size_t i;
-  int best_index = -1;
-  float best_priority = -1.0f, detail_bias, span_score, weight_score, priority;
+static inline float color_box_priority(const color_entry_t *entries, const color_box_t *box, uint8_t base_bits_rgb, uint8_t base_bits_alpha) {
+  float detail_bias, span_score, weight_score;
 
-  if (!boxes || box_count == 0) {
-    return -1;
-  }
+  detail_bias = color_box_detail_bias(entries, box, base_bits_rgb, base_bits_alpha);
+  span_score = (float)color_box_max_span(box) / 255.0f;
+  weight_score = (box->total_weight > 0) ? logf((float)box->total_weight + 1.0f) : 0.0f;
 
-  for (i = 0; i < box_count; ++i) {
-    if (!color_box_splittable(&boxes[i])) {
-      continue;
+  return (span_score * PNGX_REDUCED_PRIORITY_SPAN_WEIGHT) + (detail_bias * PNGX_REDUCED_PRIORITY_DETAIL_WEIGHT) + (weight_score * PNGX_REDUCED_PRIORITY_MASS_WEIGHT);
+}
+
+/* Highest priority first, then the lowest box index, so pops follow the same order as a first-maximum scan over all boxes. */
+static inline bool color_box_heap_before(const color_box_heap_item_t *lhs, const color_box_heap_item_t *rhs) {
+  return lhs->priority > rhs->priority || (lhs->priority == rhs->priority && lhs->index < rhs->index);
+}
+
+static inline void color_box_heap_push(color_box_heap_item_t *heap, size_t *size, float priority, uint32_t index) {
+  color_box_heap_item_t item;
+  size_t pos = (*size)++, parent;
+
+  item.priority = priority;
+  item.index = index;
+  while (pos > 0) {
+    parent = (pos - 1) / 2;
+    if (!color_box_heap_before(&item, &heap[parent])) {
+      break;
     }
+    heap[pos] = heap[parent];
+    pos = parent;
+  }
+  heap[pos] = item;
+}
 
-    detail_bias = color_box_detail_bias(entries, &boxes[i], base_bits_rgb, base_bits_alpha);
-    span_score = (float)color_box_max_span(&boxes[i]) / 255.0f;
-    weight_score = (boxes[i].total_weight > 0) ? logf((float)boxes[i].total_weight + 1.0f) : 0.0f;
-    priority = (span_score * PNGX_REDUCED_PRIORITY_SPAN_WEIGHT) + (detail_bias * PNGX_REDUCED_PRIORITY_DETAIL_WEIGHT) + (weight_score * PNGX_REDUCED_PRIORITY_MASS_WEIGHT);
+static inline color_box_heap_item_t color_box_heap_pop(color_box_heap_item_t *heap, size_t *size) {
+  color_box_heap_item_t top = heap[0], last;
+  size_t pos = 0, child;
 
-    if (priority > best_priority) {
-      best_priority = priority;
-      best_index = (int)i;
+  last = heap[--(*size)];
+  while (true) {
+    child = pos * 2 + 1;
+    if (child >= *size) {
+      break;
+    }
+    if (child + 1 < *size && color_box_heap_before(&heap[child + 1], &heap[child])) {
+      ++child;
     }
+    if (!color_box_heap_before(&heap[child], &last)) {
+      break;
+    }
+    heap[pos] = heap[child];
+    pos = child;
+  }
+  if (*size > 0) {
+    heap[pos] = last;
   }
 
-  return best_index;
+  return top;
 }
 
 static inline size_t box_find_split_index(const color_entry_t *entries, const color_box_t *box) {
@@ -438,31 +482,31 @@ static inline size_t box_find_split_index(const color_entry_t *entries, const co
   return box->start + ((box->end - box->start) / 2);
 }
 
-static inline void sort_entries_by_axis(color_entry_t *entries, size_t count, int axis) {
-  if (!entries || count == 0) {
+/* Stable counting sort on one 8-bit channel: the order a stable comparison sort produces, in linear time. */
+static inline void sort_entries_by_axis(color_entry_t *entries, color_entry_t *scratch, size_t count, int axis) {
+  size_t offsets[256], i, sum = 0, bucket_count;
+  uint32_t shift = (axis >= 0 && axis <= 3) ? (uint32_t)axis * 8 : 0;
+
+  if (!entries || !scratch || count < 2) {
     return;
   }
 
-  switch (axis) {
-  case 0:
-    qsort(entries, count, sizeof(color_entry_t), compare_entries_r);
-    break;
-  case 1:
-    qsort(entries, count, sizeof(color_entry_t), compare_entries_g);
-    break;
-  case 2:
-    qsort(entries, count, sizeof(color_entry_t), compare_entries_b);
-    break;
-  case 3:
-    qsort(entries, count, sizeof(color_entry_t), compare_entries_a);
-    break;
-  default:
-    qsort(entries, count, sizeof(color_entry_t), compare_entries_r);
-    break;
+  memset(offsets, 0, sizeof(offsets));
+  for (i = 0; i < count; ++i) {
+    ++offsets[(entries[i].color >> shift) & 0xff];
+  }
+  for (i = 0; i < 256; ++i) {
+    bucket_count = offsets[i];
+    offsets[i] = sum;
+    sum += bucket_count;
+  }
+  for (i = 0; i < count; ++i) {
+    scratch[offsets[(entries[i].color >> shift) & 0xff]++] = entries[i];
   }
+  memcpy(entries, scratch, count * sizeof(color_entry_t));
 }
 
-static inline bool split_color_box(color_entry_t *entries, color_box_t *box, color_box_t *new_box) {
+static inline bool split_color_box(color_entry_t *entries, color_entry_t *scratch, color_box_t *box, color_box_t *new_box) {
   size_t split_index;
   int axis;
 
@@ -481,7 +525,7 @@ static inline bool split_color_box(color_entry_t *entries, color_box_t *box, col
     axis = 3;
   }
 
-  sort_entries_by_axis(entries + box->start, box->end - box->start, axis);
+  sort_entries_by_axis(entries + box->start, scratch, box->end - box->start, axis);
 
   split_index = box_find_split_index(entries, box);
   if (split_index <= box->start) {
@@ -571,10 +615,11 @@ static void color_remap_parallel_worker(void *context, uint32_t start, uint32_t
 static inline void refine_reduced_palette(color_entry_t *entries, size_t unlocked_count, const uint32_t *seed_palette, const uint8_t *palette_bits_rgb, const uint8_t *palette_bits_alpha,
                                           size_t palette_count) {
   const size_t max_iter = 3;
+  pngx_palette_index_t index;
   uint64_t *sum_r, *sum_g, *sum_b, *sum_a, *sum_w, w;
-  uint32_t *palette, color, best_dist, weight, dist, new_color;
+  uint32_t *palette, color, weight, new_color;
   uint8_t r, g, b, a, snap_bits_rgb, snap_bits_alpha, cr, cg, cb, ca;
-  size_t iter, best_index, candidate, i, p;
+  size_t iter, best_index, i, p;
   bool palette_changed;
 
   if (!entries || unlocked_count == 0 || !seed_palette || palette_count == 0 || palette_count > 4096) {
@@ -614,20 +659,14 @@ static inline void refine_reduced_palette(color_entry_t *entries, size_t unlocke
     memset(sum_a, 0, sizeof(uint64_t) * palette_count);
     memset(sum_w, 0, sizeof(uint64_t) * palette_count);
 
+    if (!palette_index_build(&index, palette, palette_count)) {
+      break;
+    }
+
     for (i = 0; i < unlocked_count; ++i) {
       color = entries[i].color;
-      best_dist = UINT32_MAX;
-      best_index = 0;
-      candidate = 0;
       weight = entries[i].count ? entries[i].count : 1;
-
-      for (candidate = 0; candidate < palette_count; ++candidate) {
-        dist = simd_color_distance_sq_u32(color, palette[candidate]);
-        if (dist < best_dist) {
-          best_dist = dist;
-          best_index = candidate;
-        }
-      }
+      best_index = palette_index_nearest(&index, color);
 
       unpack_rgba_u32(color, &cr, &cg, &cb, &ca);
 
@@ -638,6 +677,8 @@ static inline void refine_reduced_palette(color_entry_t *entries, size_t unlocke
       sum_w[best_index] += (uint64_t)weight;
     }
 
+    palette_index_free(&index);
+
     for (p = 0; p < palette_count; ++p) {
       w = sum_w[p];
       if (w == 0) {
@@ -662,20 +703,11 @@ static inline void refine_reduced_palette(color_entry_t *entries, size_t unlocke
     }
   }
 
-  for (i = 0; i < unlocked_count; ++i) {
-    color = entries[i].color;
-    best_dist = UINT32_MAX;
-    best_index = 0;
-
-    for (candidate = 0; candidate < palette_count; ++candidate) {
-      dist = simd_color_distance_sq_u32(color, palette[candidate]);
-      if (dist < best_dist) {
-        best_dist = dist;
-        best_index = candidate;
-      }
+  if (palette_index_build(&index, palette, palette_count)) {
+    for (i = 0; i < unlocked_count; ++i) {
+      entries[i].mapped_color = palette[palette_index_nearest(&index, entries[i].color)];
     }
-
-    entries[i].mapped_color = palette[best_index];
+    palette_index_free(&index);
   }
 
   free(sum_r);
@@ -687,95 +719,337 @@ static inline void refine_reduced_palette(color_entry_t *entries, size_t unlocke
   free(palette);
 }
 
-static inline bool build_color_histogram(const pngx_rgba_image_t *image, const pngx_options_t *opts, const pngx_quant_support_t *support, color_histogram_t *hist) {
-  const cpres_rgba_color_t *protected_colors = (opts && opts->protected_colors_count > 0) ? opts->protected_colors : NULL;
-  histogram_sample_t *samples = NULL;
-  color_entry_t tmp;
-  uint64_t weight_sum;
-  uint32_t protected_table[256], color;
-  uint8_t bits_rgb = 8, bits_alpha = 8, r, g, b, a, sample_bits_rgb, sample_bits_alpha, hint, hint_rgb, hint_alpha, max_bits_rgb, max_bits_alpha;
-  size_t pixel_count, i, unique_count, base, run, write, protected_count = (protected_colors && opts->protected_colors_count > 0) ? (size_t)opts->protected_colors_count : 0;
-  bool quantize_rgb = false, quantize_alpha = false;
+static inline void histogram_sample_at(const uint8_t *rgba, const pngx_quant_support_t *support, size_t index, uint8_t bits_rgb, uint8_t bits_alpha, histogram_sample_t *sample) {
+  uint8_t r, g, b, a, hint, hint_rgb, hint_alpha;
+  size_t base = index * 4;
 
-  if (!image || !image->rgba || !hist || image->pixel_count == 0) {
-    return false;
+  r = rgba[base + 0];
+  g = rgba[base + 1];
+  b = rgba[base + 2];
+  a = rgba[base + 3];
+  sample->rgb_bits = bits_rgb;
+  sample->alpha_bits = bits_alpha;
+
+  if (support && support->bit_hint_map && index < support->bit_hint_len) {
+    hint = support->bit_hint_map[index];
+    hint_rgb = hint >> 4;
+    hint_alpha = hint & 0x0fu;
+
+    if (hint_rgb >= COLOPRESSO_PNGX_REDUCED_BITS_MIN) {
+      sample->rgb_bits = clamp_reduced_bits(hint_rgb);
+    }
+
+    if (hint_alpha >= COLOPRESSO_PNGX_REDUCED_BITS_MIN) {
+      sample->alpha_bits = clamp_reduced_bits(hint_alpha);
+    }
   }
 
-  if (opts) {
-    bits_rgb = clamp_reduced_bits(opts->lossy_reduced_bits_rgb);
-    bits_alpha = clamp_reduced_bits(opts->lossy_reduced_alpha_bits);
+  if (bits_rgb < 8) {
+    r = quantize_bits(r, bits_rgb);
+    g = quantize_bits(g, bits_rgb);
+    b = quantize_bits(b, bits_rgb);
   }
 
-  quantize_rgb = bits_rgb < 8;
-  quantize_alpha = bits_alpha < 8;
+  if (bits_alpha < 8) {
+    a = quantize_bits(a, bits_alpha);
+  }
 
-  if (protected_count > 256) {
-    protected_count = 256;
+  sample->color = pack_rgba_u32(r, g, b, a);
+  sample->weight = histogram_importance_weight(support, index);
+}
+
+static inline size_t color_hash_slot(uint32_t color, size_t capacity) { return (size_t)(((uint64_t)color * 0x9e3779b97f4a7c15ull) >> 32) & (capacity - 1); }
+
+static inline uint8_t color_hash_merge_bits(uint8_t lhs, uint8_t rhs) {
+  uint8_t rgb = (lhs >> 4) > (rhs >> 4) ? (lhs >> 4) : (rhs >> 4), alpha = (lhs & 0x0fu) > (rhs & 0x0fu) ? (lhs & 0x0fu) : (rhs & 0x0fu);
+
+  return (uint8_t)((rgb << 4) | alpha);
+}
+
+static inline void color_hash_free(color_hash_t *hash) {
+  if (!hash) {
+    return;
   }
 
-  for (i = 0; i < protected_count; ++i) {
-    r = protected_colors[i].r;
-    g = protected_colors[i].g;
-    b = protected_colors[i].b;
-    a = protected_colors[i].a;
-    if (quantize_rgb) {
-      r = quantize_bits(r, bits_rgb);
-      g = quantize_bits(g, bits_rgb);
-      b = quantize_bits(b, bits_rgb);
+  free(hash->colors);
+  free(hash->weights);
+  free(hash->bits);
+  hash->colors = NULL;
+  hash->weights = NULL;
+  hash->bits = NULL;
+  hash->capacity = 0;
+  hash->count = 0;
+}
+
+static inline bool color_hash_init(color_hash_t *hash, size_t capacity) {
+  hash->colors = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+  hash->weights = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+  hash->bits = (uint8_t *)calloc(capacity, sizeof(uint8_t));
+  hash->capacity = capacity;
+  hash->count = 0;
+  if (!hash->colors || !hash->weights || !hash->bits) {
+    color_hash_free(hash);
+    return false;
+  }
+
+  return true;
+}
+
+static inline bool color_hash_grow(color_hash_t *hash) {
+  color_hash_t grown;
+  size_t i, slot;
+
+  if (!color_hash_init(&grown, hash->capacity * 2)) {
+    return false;
+  }
+
+  for (i = 0; i < hash->capacity; ++i) {
+    if (hash->weights[i] == 0) {
+      continue;
     }
-    if (quantize_alpha) {
-      a = quantize_bits(a, bits_alpha);
+
+    slot = color_hash_slot(hash->colors[i], grown.capacity);
+    while (grown.weights[slot] != 0) {
+      slot = (slot + 1) & (grown.capacity - 1);
     }
-    protected_table[i] = pack_rgba_u32(r, g, b, a);
+    grown.colors[slot] = hash->colors[i];
+    grown.weights[slot] = hash->weights[i];
+    grown.bits[slot] = hash->bits[i];
   }
+  grown.count = hash->count;
 
-  pixel_count = image->pixel_count;
+  color_hash_free(hash);
+  *hash = grown;
 
-  samples = (histogram_sample_t *)malloc(pixel_count * sizeof(histogram_sample_t));
-  if (!samples) {
+  return true;
+}
+
+/* Adds weight to color and reports its slot, which stays valid until the next new color is inserted. Fails once PNGX_REDUCED_COLOR_HASH_MAX_COLORS is exceeded. */
+static inline bool color_hash_add(color_hash_t *hash, uint32_t color, uint64_t weight, uint8_t bits, size_t *out_slot) {
+  size_t slot = color_hash_slot(color, hash->capacity);
+
+  while (hash->weights[slot] != 0) {
+    if (hash->colors[slot] == color) {
+      hash->weights[slot] += weight;
+      hash->bits[slot] = color_hash_merge_bits(hash->bits[slot], bits);
+      *out_slot = slot;
+      return true;
+    }
+    slot = (slot + 1) & (hash->capacity - 1);
+  }
+
+  if (hash->count >= PNGX_REDUCED_COLOR_HASH_MAX_COLORS) {
     return false;
   }
 
-  for (i = 0; i < pixel_count; ++i) {
-    base = i * 4;
-    r = image->rgba[base + 0];
-    g = image->rgba[base + 1];
-    b = image->rgba[base + 2];
-    a = image->rgba[base + 3];
-    sample_bits_rgb = bits_rgb;
-    sample_bits_alpha = bits_alpha;
-
-    if (support && support->bit_hint_map && i < support->bit_hint_len) {
-      hint = support->bit_hint_map[i];
-      hint_rgb = hint >> 4;
-      hint_alpha = hint & 0x0fu;
-
-      if (hint_rgb >= COLOPRESSO_PNGX_REDUCED_BITS_MIN) {
-        sample_bits_rgb = clamp_reduced_bits(hint_rgb);
+  if ((hash->count + 1) * 2 > hash->capacity) {
+    if (!color_hash_grow(hash)) {
+      return false;
+    }
+    return color_hash_add(hash, color, weight, bits, out_slot);
+  }
+
+  hash->colors[slot] = color;
+  hash->weights[slot] = weight;
+  hash->bits[slot] = bits;
+  ++hash->count;
+  *out_slot = slot;
+
+  return true;
+}
+
+static void color_hash_parallel_worker(void *context, uint32_t start, uint32_t end) {
+  color_hash_parallel_ctx_t *ctx = (color_hash_parallel_ctx_t *)context;
+  histogram_sample_t sample;
+  color_hash_t *table;
+  uint32_t slice, color, last_color = 0;
+  uint16_t weight;
+  uint8_t bits;
+  size_t i, first, last, base, slot = 0;
+  bool has_last;
+
+  if (!ctx || !ctx->rgba || !ctx->tables) {
+    return;
+  }
+
+  for (slice = start; slice < end; ++slice) {
+    table = &ctx->tables[slice];
+    if (!color_hash_init(table, PNGX_REDUCED_COLOR_HASH_INITIAL_CAPACITY)) {
+      colopresso_atomic_store_i32(&ctx->failed, 1);
+      return;
+    }
+
+    first = (size_t)slice * ctx->slice_pixels;
+    last = (first + ctx->slice_pixels < ctx->pixel_count) ? first + ctx->slice_pixels : ctx->pixel_count;
+    has_last = false;
+    for (i = first; i < last; ++i) {
+      if ((i & PNGX_CANCEL_POLL_MASK) == 0 && (colopresso_atomic_load_i32(&ctx->failed) != 0 || pngx_cancelled(ctx->opts))) {
+        colopresso_atomic_store_i32(&ctx->failed, 1);
+        return;
+      }
+
+      if (ctx->histogram) {
+        histogram_sample_at(ctx->rgba, ctx->support, i, ctx->bits_rgb, ctx->bits_alpha, &sample);
+        color = sample.color;
+        weight = sample.weight;
+        bits = (uint8_t)((sample.rgb_bits << 4) | (sample.alpha_bits & 0x0fu));
+      } else {
+        base = i * 4;
+        color = pack_rgba_u32(ctx->rgba[base + 0], ctx->rgba[base + 1], ctx->rgba[base + 2], ctx->rgba[base + 3]);
+        weight = 1;
+        bits = 0;
+      }
+
+      /* Runs of one color are common in flat regions; skip the probe for them. */
+      if (has_last && color == last_color) {
+        table->weights[slot] += weight;
+        table->bits[slot] = color_hash_merge_bits(table->bits[slot], bits);
+        continue;
       }
 
-      if (hint_alpha >= COLOPRESSO_PNGX_REDUCED_BITS_MIN) {
-        sample_bits_alpha = clamp_reduced_bits(hint_alpha);
+      if (!color_hash_add(table, color, weight, bits, &slot)) {
+        colopresso_atomic_store_i32(&ctx->failed, 1);
+        return;
       }
+      last_color = color;
+      has_last = true;
     }
+  }
+}
 
-    if (quantize_rgb) {
-      r = quantize_bits(r, bits_rgb);
-      g = quantize_bits(g, bits_rgb);
-      b = quantize_bits(b, bits_rgb);
+/* Counts colors into one table from per-slice tables built in parallel. Fails on cancellation, allocation failure or more than PNGX_REDUCED_COLOR_HASH_MAX_COLORS distinct colors; callers then
+ * fall back to sorting every pixel. */
+static inline bool color_hash_collect(uint32_t thread_count, const uint8_t *rgba, size_t pixel_count, bool histogram, uint8_t bits_rgb, uint8_t bits_alpha, const pngx_quant_support_t *support,
+                                      const pngx_options_t *opts, color_hash_t *out) {
+  color_hash_parallel_ctx_t ctx;
+  color_hash_t *tables;
+  uint32_t threads, slice_count, slice;
+  size_t i, slot;
+  bool success = true;
+
+  if (!rgba || pixel_count == 0 || pixel_count > UINT32_MAX || !out) {
+    return false;
+  }
+
+  threads = thread_count > 0 ? thread_count : cpres_get_default_thread_count();
+  if (threads == 0) {
+    threads = 1;
+  }
+
+  ctx.slice_pixels = (pixel_count + threads - 1) / threads;
+  if (ctx.slice_pixels < PNGX_REDUCED_COLOR_HASH_SLICE_PIXELS) {
+    ctx.slice_pixels = PNGX_REDUCED_COLOR_HASH_SLICE_PIXELS;
+  }
+  slice_count = (uint32_t)((pixel_count + ctx.slice_pixels - 1) / ctx.slice_pixels);
+
+  tables = (color_hash_t *)calloc(slice_count, sizeof(color_hash_t));
+  if (!tables) {
+    return false;
+  }
+
+  ctx.rgba = rgba;
+  ctx.pixel_count = pixel_count;
+  ctx.tables = tables;
+  ctx.support = support;
+  ctx.opts = opts;
+  ctx.bits_rgb = bits_rgb;
+  ctx.bits_alpha = bits_alpha;
+  ctx.histogram = histogram;
+  ctx.failed = 0;
+
+#if COLOPRESSO_ENABLE_THREADS
+  colopresso_parallel_for(thread_count, slice_count, color_hash_parallel_worker, &ctx);
+#else
+  color_hash_parallel_worker(&ctx, 0, slice_count);
+#endif
+
+  success = colopresso_atomic_load_i32(&ctx.failed) == 0;
+  for (slice = 1; success && slice < slice_count; ++slice) {
+    for (i = 0; i < tables[slice].capacity; ++i) {
+      if (tables[slice].weights[i] != 0 && !color_hash_add(&tables[0], tables[slice].colors[i], tables[slice].weights[i], tables[slice].bits[i], &slot)) {
+        success = false;
+        break;
+      }
     }
+  }
 
-    if (quantize_alpha) {
-      a = quantize_bits(a, bits_alpha);
+  for (slice = 1; slice < slice_count; ++slice) {
+    color_hash_free(&tables[slice]);
+  }
+  if (success) {
+    *out = tables[0];
+  } else {
+    color_hash_free(&tables[0]);
+  }
+  free(tables);
+
+  return success;
+}
+
+static inline int compare_entries_color(const void *lhs, const void *rhs) {
+  const color_entry_t *a = (const color_entry_t *)lhs, *b = (const color_entry_t *)rhs;
+
+  return a->color < b->color ? -1 : (a->color > b->color ? 1 : 0);
+}
+
+static inline bool histogram_from_hash(const color_hash_t *hash, const uint32_t *protected_table, size_t protected_count, color_histogram_t *hist) {
+  size_t i, unique_count = 0;
+
+  hist->entries = (color_entry_t *)malloc((hash->count > 0 ? hash->count : 1) * sizeof(color_entry_t));
+  if (!hist->entries) {
+    return false;
+  }
+
+  for (i = 0; i < hash->capacity; ++i) {
+    if (hash->weights[i] == 0) {
+      continue;
     }
 
-    samples[i].color = pack_rgba_u32(r, g, b, a);
-    samples[i].weight = histogram_importance_weight(support, i);
-    samples[i].rgb_bits = sample_bits_rgb;
-    samples[i].alpha_bits = sample_bits_alpha;
+    hist->entries[unique_count].color = hash->colors[i];
+    hist->entries[unique_count].count = (uint32_t)((hash->weights[i] > UINT32_MAX) ? UINT32_MAX : hash->weights[i]);
+    hist->entries[unique_count].mapped_color = hash->colors[i];
+    hist->entries[unique_count].locked = is_protected_color(hash->colors[i], protected_table, protected_count);
+    hist->entries[unique_count].detail_bits_rgb = clamp_reduced_bits((uint8_t)(hash->bits[i] >> 4));
+    hist->entries[unique_count].detail_bits_alpha = clamp_reduced_bits((uint8_t)(hash->bits[i] & 0x0fu));
+    ++unique_count;
+  }
+
+  /* Only the distinct colors are sorted, into the order the sample sort below produces. */
+  qsort(hist->entries, unique_count, sizeof(color_entry_t), compare_entries_color);
+  hist->count = unique_count;
+  hist->unlocked_count = 0;
+
+  return true;
+}
+
+static inline bool histogram_from_samples(const pngx_rgba_image_t *image, const pngx_options_t *opts, const pngx_quant_support_t *support, uint8_t bits_rgb, uint8_t bits_alpha,
+                                          const uint32_t *protected_table, size_t protected_count, color_histogram_t *hist) {
+  pngx_scratch_t *scratch = opts ? opts->scratch : NULL;
+  histogram_sample_t *samples = NULL;
+  uint64_t weight_sum;
+  uint32_t color;
+  uint8_t max_bits_rgb, max_bits_alpha;
+  size_t pixel_count = image->pixel_count, i, unique_count, run;
+
+  samples = (histogram_sample_t *)pngx_scratch_acquire(scratch, PNGX_SCRATCH_HISTOGRAM_SAMPLES, pixel_count * sizeof(histogram_sample_t));
+  if (!samples) {
+    return false;
+  }
+
+  for (i = 0; i < pixel_count; ++i) {
+    if ((i & PNGX_CANCEL_POLL_MASK) == 0 && pngx_cancelled(opts)) {
+      pngx_scratch_release(scratch, PNGX_SCRATCH_HISTOGRAM_SAMPLES, samples);
+      return false;
+    }
+
+    histogram_sample_at(image->rgba, support, i, bits_rgb, bits_alpha, &samples[i]);
   }
 
   qsort(samples, pixel_count, sizeof(histogram_sample_t), compare_histogram_sample);
+  if (pngx_cancelled(opts)) {
+    pngx_scratch_release(scratch, PNGX_SCRATCH_HISTOGRAM_SAMPLES, samples);
+    return false;
+  }
 
   unique_count = 0;
 
@@ -793,7 +1067,7 @@ static inline bool build_color_histogram(const pngx_rgba_image_t *image, const p
 
   hist->entries = (color_entry_t *)malloc(unique_count * sizeof(color_entry_t));
   if (!hist->entries) {
-    free(samples);
+    pngx_scratch_release(scratch, PNGX_SCRATCH_HISTOGRAM_SAMPLES, samples);
     return false;
   }
   hist->count = unique_count;
@@ -830,15 +1104,72 @@ static inline bool build_color_histogram(const pngx_rgba_image_t *image, const p
     i += run;
   }
 
-  free(samples);
+  pngx_scratch_release(scratch, PNGX_SCRATCH_HISTOGRAM_SAMPLES, samples);
+
+  return true;
+}
 
-  if (unique_count == 0) {
+static inline bool build_color_histogram(const pngx_rgba_image_t *image, const pngx_options_t *opts, const pngx_quant_support_t *support, color_histogram_t *hist) {
+  const cpres_rgba_color_t *protected_colors = (opts && opts->protected_colors_count > 0) ? opts->protected_colors : NULL;
+  color_hash_t hash;
+  color_entry_t tmp;
+  uint32_t protected_table[256];
+  uint8_t bits_rgb = 8, bits_alpha = 8, r, g, b, a;
+  size_t i, write, protected_count = (protected_colors && opts->protected_colors_count > 0) ? (size_t)opts->protected_colors_count : 0;
+  bool quantize_rgb = false, quantize_alpha = false, built;
+
+  if (!image || !image->rgba || !hist || image->pixel_count == 0) {
+    return false;
+  }
+
+  if (opts) {
+    bits_rgb = clamp_reduced_bits(opts->lossy_reduced_bits_rgb);
+    bits_alpha = clamp_reduced_bits(opts->lossy_reduced_alpha_bits);
+  }
+
+  quantize_rgb = bits_rgb < 8;
+  quantize_alpha = bits_alpha < 8;
+
+  if (protected_count > 256) {
+    protected_count = 256;
+  }
+
+  for (i = 0; i < protected_count; ++i) {
+    r = protected_colors[i].r;
+    g = protected_colors[i].g;
+    b = protected_colors[i].b;
+    a = protected_colors[i].a;
+    if (quantize_rgb) {
+      r = quantize_bits(r, bits_rgb);
+      g = quantize_bits(g, bits_rgb);
+      b = quantize_bits(b, bits_rgb);
+    }
+    if (quantize_alpha) {
+      a = quantize_bits(a, bits_alpha);
+    }
+    protected_table[i] = pack_rgba_u32(r, g, b, a);
+  }
+
+  if (color_hash_collect(opts ? opts->thread_count : 0, image->rgba, image->pixel_count, true, bits_rgb, bits_alpha, support, opts, &hash)) {
+    built = histogram_from_hash(&hash, protected_table, protected_count, hist);
+    color_hash_free(&hash);
+  } else if (pngx_cancelled(opts)) {
+    return false;
+  } else {
+    built = histogram_from_samples(image, opts, support, bits_rgb, bits_alpha, protected_table, protected_count, hist);
+  }
+
+  if (!built) {
+    return false;
+  }
+
+  if (hist->count == 0) {
     return true;
   }
 
   write = 0;
 
-  for (i = 0; i < unique_count; ++i) {
+  for (i = 0; i < hist->count; ++i) {
     if (!hist->entries[i].locked) {
       if (write != i) {
         tmp = hist->entries[write];
@@ -856,10 +1187,12 @@ static inline bool build_color_histogram(const pngx_rgba_image_t *image, const p
 static inline bool apply_reduced_rgba32_quantization(uint32_t thread_count, color_histogram_t *hist, pngx_rgba_image_t *image, uint32_t target_colors, uint8_t bits_rgb, uint8_t bits_alpha,
                                                      uint32_t *applied_colors) {
   color_box_t *boxes = NULL, new_box;
+  color_box_heap_item_t *heap = NULL;
+  color_entry_t *scratch = NULL;
   color_map_entry_t *map = NULL;
   uint32_t *palette_seed = NULL, actual_colors = 0, mapped, split_index;
   uint8_t *palette_bits_rgb = NULL, *palette_bits_alpha = NULL, r, g, b, a;
-  size_t box_count = 0, map_count, i, idx;
+  size_t box_count = 0, heap_size = 0, map_count, i, idx;
   color_remap_parallel_ctx_t remap_ctx;
 
   if (!hist || !image || target_colors == 0) {
@@ -887,7 +1220,12 @@ static inline bool apply_reduced_rgba32_quantization(uint32_t thread_count, colo
   }
 
   boxes = (color_box_t *)calloc(target_colors, sizeof(color_box_t));
-  if (!boxes) {
+  heap = (color_box_heap_item_t *)malloc(target_colors * sizeof(color_box_heap_item_t));
+  scratch = (color_entry_t *)malloc(hist->unlocked_count * sizeof(color_entry_t));
+  if (!boxes || !heap || !scratch) {
+    free(boxes);
+    free(heap);
+    free(scratch);
     return false;
   }
 
@@ -895,20 +1233,30 @@ static inline bool apply_reduced_rgba32_quantization(uint32_t thread_count, colo
   boxes[0].end = hist->unlocked_count;
   color_box_refresh(hist->entries, &boxes[0]);
   box_count = (boxes[0].end > boxes[0].start) ? 1 : 0;
+  if (box_count > 0 && color_box_splittable(&boxes[0])) {
+    color_box_heap_push(heap, &heap_size, color_box_priority(hist->entries, &boxes[0], bits_rgb, bits_alpha), 0);
+  }
 
-  while (box_count < target_colors) {
-    split_index = select_box_to_split(boxes, box_count, hist->entries, bits_rgb, bits_alpha);
-    if (split_index < 0) {
+  /* Only the two halves of a split change priority, so every other box keeps its heap slot. */
+  while (box_count < target_colors && heap_size > 0) {
+    split_index = color_box_heap_pop(heap, &heap_size).index;
+    if (!split_color_box(hist->entries, scratch, &boxes[split_index], &new_box)) {
       break;
     }
 
-    if (!split_color_box(hist->entries, &boxes[split_index], &new_box)) {
-      break;
+    boxes[box_count] = new_box;
+    if (color_box_splittable(&boxes[split_index])) {
+      color_box_heap_push(heap, &heap_size, color_box_priority(hist->entries, &boxes[split_index], bits_rgb, bits_alpha), split_index);
     }
-
-    boxes[box_count++] = new_box;
+    if (color_box_splittable(&boxes[box_count])) {
+      color_box_heap_push(heap, &heap_size, color_box_priority(hist->entries, &boxes[box_count], bits_rgb, bits_alpha), (uint32_t)box_count);
+    }
+    ++box_count;
   }
 
+  free(heap);
+  free(scratch);
+
   if (box_count == 0) {
     free(boxes);
 
@@ -1061,7 +1409,8 @@ static inline bool pack_sorted_rgba(const uint8_t *rgba, size_t pixel_count, uin
   return true;
 }
 
-static inline size_t count_unique_rgba(const uint8_t *rgba, size_t pixel_count) {
+static inline size_t count_unique_rgba(uint32_t thread_count, const uint8_t *rgba, size_t pixel_count) {
+  color_hash_t hash;
   uint32_t *packed;
   size_t i, unique = 0;
 
@@ -1069,6 +1418,13 @@ static inline size_t count_unique_rgba(const uint8_t *rgba, size_t pixel_count)
     return 0;
   }
 
+  if (color_hash_collect(thread_count, rgba, pixel_count, false, 8, 8, NULL, NULL, &hash)) {
+    unique = hash.count;
+    color_hash_free(&hash);
+
+    return unique;
+  }
+
   if (!pack_sorted_rgba(rgba, pixel_count, &packed)) {
     return 0;
   }
@@ -1084,8 +1440,15 @@ static inline size_t count_unique_rgba(const uint8_t *rgba, size_t pixel_count)
   return unique;
 }
 
-static inline bool build_color_frequency(const uint8_t *rgba, size_t pixel_count, color_freq_t **out_freq, size_t *out_count) {
+static inline int compare_freq_color(const void *lhs, const void *rhs) {
+  const color_freq_t *a = (const color_freq_t *)lhs, *b = (const color_freq_t *)rhs;
+
+  return a->color < b->color ? -1 : (a->color > b->color ? 1 : 0);
+}
+
+static inline bool build_color_frequency(uint32_t thread_count, const uint8_t *rgba, size_t pixel_count, color_freq_t **out_freq, size_t *out_count) {
   color_freq_t *freq, *shrunk;
+  color_hash_t hash;
   uint32_t *packed;
   size_t i, unique;
 
@@ -1093,6 +1456,30 @@ static inline bool build_color_frequency(const uint8_t *rgba, size_t pixel_count
     return false;
   }
 
+  if (color_hash_collect(thread_count, rgba, pixel_count, false, 8, 8, NULL, NULL, &hash)) {
+    freq = (color_freq_t *)malloc(sizeof(color_freq_t) * (hash.count > 0 ? hash.count : 1));
+    if (!freq) {
+      color_hash_free(&hash);
+      return false;
+    }
+
+    for (i = 0, unique = 0; i < hash.capacity; ++i) {
+      if (hash.weights[i] != 0) {
+        freq[unique].color = hash.colors[i];
+        freq[unique].count = (uint32_t)hash.weights[i];
+        ++unique;
+      }
+    }
+    color_hash_free(&hash);
+
+    /* Same color order as the pixel sort below, so find_freq_index keeps working. */
+    qsort(freq, unique, sizeof(color_freq_t), compare_freq_color);
+    *out_freq = freq;
+    *out_count = unique;
+
+    return true;
+  }
+
   if (!pack_sorted_rgba(rgba, pixel_count, &packed)) {
     return false;
   }
@@ -1172,13 +1559,14 @@ static inline int compare_freq_rank_desc(const void *lhs, const void *rhs) {
 static inline bool enforce_manual_reduced_limit(uint32_t thread_count, pngx_rgba_image_t *image, uint32_t manual_limit, uint8_t bits_rgb, uint8_t bits_alpha, uint32_t *applied_colors) {
   color_freq_t *freq = NULL;
   freq_rank_t *rank = NULL;
-  uint32_t *mapped = NULL, source, best_color, best_dist, candidate_color, distance, original;
-  size_t *keep_indices = NULL, freq_count = 0, keep_count, current_unique, unique_after, pixel_index, idx, best_keep, keep_idx, candidate_index, base, freq_index, i;
+  pngx_palette_index_t keep_index;
+  uint32_t *mapped = NULL, *keep_colors = NULL, original;
+  size_t freq_count = 0, keep_count, current_unique, unique_after, pixel_index, idx, base, freq_index, i;
   bool success = false;
 
   if (!image || !image->rgba || image->pixel_count == 0 || manual_limit == 0) {
     if (applied_colors && image && image->rgba) {
-      current_unique = count_unique_rgba(image->rgba, image->pixel_count);
+      current_unique = count_unique_rgba(thread_count, image->rgba, image->pixel_count);
 
       if (current_unique > UINT32_MAX) {
         current_unique = UINT32_MAX;
@@ -1192,7 +1580,7 @@ static inline bool enforce_manual_reduced_limit(uint32_t thread_count, pngx_rgba
 
   snap_rgba_image_to_bits(thread_count, image->rgba, image->pixel_count, bits_rgb, bits_alpha);
 
-  if (!build_color_frequency(image->rgba, image->pixel_count, &freq, &freq_count)) {
+  if (!build_color_frequency(thread_count, image->rgba, image->pixel_count, &freq, &freq_count)) {
     goto bailout;
   }
 
@@ -1223,8 +1611,8 @@ static inline bool enforce_manual_reduced_limit(uint32_t thread_count, pngx_rgba
 
   rank = (freq_rank_t *)malloc(sizeof(freq_rank_t) * freq_count);
   mapped = (uint32_t *)malloc(sizeof(uint32_t) * freq_count);
-  keep_indices = (size_t *)malloc(sizeof(size_t) * keep_count);
-  if (!rank || !mapped || !keep_indices) {
+  keep_colors = (uint32_t *)malloc(sizeof(uint32_t) * keep_count);
+  if (!rank || !mapped || !keep_colors) {
     goto bailout;
   }
 
@@ -1238,30 +1626,20 @@ static inline bool enforce_manual_reduced_limit(uint32_t thread_count, pngx_rgba
   qsort(rank, freq_count, sizeof(freq_rank_t), compare_freq_rank_desc);
 
   for (i = 0; i < keep_count; ++i) {
-    keep_indices[i] = rank[i].index;
+    keep_colors[i] = freq[rank[i].index].color;
+  }
+
+  if (!palette_index_build(&keep_index, keep_colors, keep_count)) {
+    goto bailout;
   }
 
   for (i = keep_count; i < freq_count; ++i) {
     idx = rank[i].index;
-    source = freq[idx].color;
-    best_keep = keep_indices[0];
-    best_color = freq[best_keep].color;
-    best_dist = simd_color_distance_sq_u32(source, best_color);
-
-    for (keep_idx = 1; keep_idx < keep_count; ++keep_idx) {
-      candidate_index = keep_indices[keep_idx];
-      candidate_color = freq[candidate_index].color;
-      distance = simd_color_distance_sq_u32(source, candidate_color);
-
-      if (distance < best_dist) {
-        best_dist = distance;
-        best_color = candidate_color;
-      }
-    }
-
-    mapped[idx] = best_color;
+    mapped[idx] = keep_colors[palette_index_nearest(&keep_index, freq[idx].color)];
   }
 
+  palette_index_free(&keep_index);
+
   for (pixel_index = 0; pixel_index < image->pixel_count; ++pixel_index) {
     base = pixel_index * 4;
     original = pack_rgba_u32(image->rgba[base + 0], image->rgba[base + 1], image->rgba[base + 2], image->rgba[base + 3]);
@@ -1279,7 +1657,7 @@ static inline bool enforce_manual_reduced_limit(uint32_t thread_count, pngx_rgba
 
   snap_rgba_image_to_bits(thread_count, image->rgba, image->pixel_count, bits_rgb, bits_alpha);
 
-  unique_after = count_unique_rgba(image->rgba, image->pixel_count);
+  unique_after = count_unique_rgba(thread_count, image->rgba, image->pixel_count);
   if (applied_colors) {
     if (unique_after > UINT32_MAX) {
       unique_after = UINT32_MAX;
@@ -1295,7 +1673,7 @@ bailout:
   free(freq);
   free(rank);
   free(mapped);
-  free(keep_indices);
+  free(keep_colors);
 
   return success;
 }
@@ -1348,15 +1726,12 @@ static void reduce_bitdepth_parallel_worker(void *context, uint32_t start, uint3
       ctx->bit_hint_map[i] = (uint8_t)((pixel_bits_rgb << 4) | (pixel_bits_alpha & 0x0fu));
     }
 
-    if (ctx->rgba[base + 3] > PNGX_REDUCED_ALPHA_NEAR_TRANSPARENT) {
-      if (pixel_bits_rgb < PNGX_FULL_CHANNEL_BITS) {
-        ctx->rgba[base + 0] = quantize_bits(ctx->rgba[base + 0], pixel_bits_rgb);
-        ctx->rgba[base + 1] = quantize_bits(ctx->rgba[base + 1], pixel_bits_rgb);
-        ctx->rgba[base + 2] = quantize_bits(ctx->rgba[base + 2], pixel_bits_rgb);
-      }
+    /* Near-transparent pixels keep their colour, which snapping at full depth leaves untouched. */
+    if (ctx->rgba[base + 3] <= PNGX_REDUCED_ALPHA_NEAR_TRANSPARENT) {
+      pixel_bits_rgb = PNGX_FULL_CHANNEL_BITS;
     }
-    if (pixel_bits_alpha < PNGX_FULL_CHANNEL_BITS) {
-      ctx->rgba[base + 3] = quantize_bits(ctx->rgba[base + 3], pixel_bits_alpha);
+    if (pixel_bits_rgb < PNGX_FULL_CHANNEL_BITS || pixel_bits_alpha < PNGX_FULL_CHANNEL_BITS) {
+      simd_snap_rgba_pixel(ctx->rgba + base, pixel_bits_rgb, pixel_bits_alpha);
     }
   }
 }
@@ -1387,18 +1762,18 @@ static inline void reduce_rgba_custom_bitdepth_simple(uint32_t thread_count, uin
 #endif
 }
 
-static inline void process_custom_bitdepth_pixel(uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint32_t x, uint32_t y, uint8_t base_bits_rgb, uint8_t base_bits_alpha, uint8_t boost_bits_rgb,
+static inline void process_custom_bitdepth_pixel(uint8_t *row, png_uint_32 width, uint32_t x, uint32_t y, bool has_next_row, uint8_t base_bits_rgb, uint8_t base_bits_alpha, uint8_t boost_bits_rgb,
                                                  uint8_t boost_bits_alpha, float base_dither, const uint8_t *importance_map, size_t pixel_count, float *err_curr, float *err_next, bool left_to_right,
                                                  uint8_t *bit_hint_map, size_t bit_hint_len) {
   uint8_t importance = 0, pixel_bits_rgb, pixel_bits_alpha, channel, bits, quantized;
-  size_t pixel_index = (size_t)y * (size_t)width + (size_t)x, rgba_index = pixel_index * PNGX_RGBA_CHANNELS, err_index = (size_t)x * PNGX_RGBA_CHANNELS;
+  size_t pixel_index = (size_t)y * (size_t)width + (size_t)x, rgba_index = (size_t)x * PNGX_RGBA_CHANNELS, err_index = (size_t)x * PNGX_RGBA_CHANNELS;
   float dither = base_dither, value, error, alpha_factor, dither_ch;
 
   if (importance_map && pixel_index < pixel_count) {
     importance = importance_map[pixel_index];
     dither *= importance_dither_scale(importance);
   }
-  alpha_factor = (float)rgba[rgba_index + 3] / 255.0f;
+  alpha_factor = (float)row[rgba_index + 3] / 255.0f;
 
   pixel_bits_rgb = resolve_pixel_bits(importance, base_bits_rgb, boost_bits_rgb);
   pixel_bits_alpha = resolve_pixel_bits(importance, base_bits_alpha, boost_bits_alpha);
@@ -1407,7 +1782,7 @@ static inline void process_custom_bitdepth_pixel(uint8_t *rgba, png_uint_32 widt
   }
 
   for (channel = 0; channel < PNGX_RGBA_CHANNELS; ++channel) {
-    if (channel != 3 && rgba[rgba_index + 3] <= PNGX_REDUCED_ALPHA_NEAR_TRANSPARENT) {
+    if (channel != 3 && row[rgba_index + 3] <= PNGX_REDUCED_ALPHA_NEAR_TRANSPARENT) {
       bits = PNGX_FULL_CHANNEL_BITS;
     } else {
       bits = (channel == 3) ? pixel_bits_alpha : pixel_bits_rgb;
@@ -1418,7 +1793,7 @@ static inline void process_custom_bitdepth_pixel(uint8_t *rgba, png_uint_32 widt
       continue;
     }
 
-    value = (float)rgba[rgba_index + channel] + err_curr[err_index + channel];
+    value = (float)row[rgba_index + channel] + err_curr[err_index + channel];
     quantized = quantize_channel_value(value, bits);
     error = (value - (float)quantized);
 
@@ -1433,7 +1808,7 @@ static inline void process_custom_bitdepth_pixel(uint8_t *rgba, png_uint_32 widt
 
     error *= dither_ch;
 
-    rgba[rgba_index + channel] = quantized;
+    row[rgba_index + channel] = quantized;
     err_curr[err_index + channel] = 0.0f;
 
     if (dither_ch <= 0.0f || error == 0.0f) {
@@ -1444,7 +1819,7 @@ static inline void process_custom_bitdepth_pixel(uint8_t *rgba, png_uint_32 widt
       if (x + 1 < width) {
         err_curr[err_index + PNGX_RGBA_CHANNELS + channel] += error * (7.0f / 16.0f);
       }
-      if (y + 1 < height) {
+      if (has_next_row) {
         if (x > 0) {
           err_next[err_index - PNGX_RGBA_CHANNELS + channel] += error * (3.0f / 16.0f);
         }
@@ -1457,7 +1832,7 @@ static inline void process_custom_bitdepth_pixel(uint8_t *rgba, png_uint_32 widt
       if (x > 0) {
         err_curr[err_index - PNGX_RGBA_CHANNELS + channel] += error * (7.0f / 16.0f);
       }
-      if (y + 1 < height) {
+      if (has_next_row) {
         if (x + 1 < width) {
           err_next[err_index + PNGX_RGBA_CHANNELS + channel] += error * (3.0f / 16.0f);
         }
@@ -1470,12 +1845,52 @@ static inline void process_custom_bitdepth_pixel(uint8_t *rgba, png_uint_32 widt
   }
 }
 
-static inline bool reduce_rgba_custom_bitdepth_dither(uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_rgb, uint8_t bits_alpha, uint8_t boost_bits_rgb, uint8_t boost_bits_alpha,
-                                                      float dither_level, const uint8_t *importance_map, size_t pixel_count, uint8_t *bit_hint_map, size_t bit_hint_len) {
-  uint32_t x, y;
+static bool dither_custom_bitdepth_rows(void *context, uint8_t *rows, uint32_t first_y, uint32_t row_count, bool warmup, float **err_curr, float **err_next) {
+  custom_bitdepth_dither_ctx_t *ctx = (custom_bitdepth_dither_ctx_t *)context;
+  uint32_t i, x, y;
+  size_t row_stride = (size_t)ctx->width * PNGX_RGBA_CHANNELS, bit_hint_len = warmup ? 0 : ctx->bit_hint_len;
+  uint8_t *row, *bit_hint_map = warmup ? NULL : ctx->bit_hint_map;
+  float *tmp;
+  bool has_next_row;
+
+  for (i = 0; i < row_count; ++i) {
+    if (pngx_cancelled(ctx->opts)) {
+      return false;
+    }
+
+    y = first_y + i;
+    row = rows + (size_t)i * row_stride;
+    has_next_row = y + 1 < ctx->height;
+    memset(*err_next, 0, row_stride * sizeof(float));
+    if ((y & 1) == 0) {
+      for (x = 0; x < ctx->width; ++x) {
+        process_custom_bitdepth_pixel(row, ctx->width, x, y, has_next_row, ctx->bits_rgb, ctx->bits_alpha, ctx->boost_bits_rgb, ctx->boost_bits_alpha, ctx->dither_level, ctx->importance_map,
+                                      ctx->pixel_count, *err_curr, *err_next, true, bit_hint_map, bit_hint_len);
+      }
+    } else {
+      x = ctx->width;
+      while (x-- > 0) {
+        process_custom_bitdepth_pixel(row, ctx->width, x, y, has_next_row, ctx->bits_rgb, ctx->bits_alpha, ctx->boost_bits_rgb, ctx->boost_bits_alpha, ctx->dither_level, ctx->importance_map,
+                                      ctx->pixel_count, *err_curr, *err_next, false, bit_hint_map, bit_hint_len);
+      }
+    }
+
+    tmp = *err_curr;
+    *err_curr = *err_next;
+    *err_next = tmp;
+  }
+
+  return true;
+}
+
+static inline bool reduce_rgba_custom_bitdepth_dither(uint32_t thread_count, uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_rgb, uint8_t bits_alpha, uint8_t boost_bits_rgb,
+                                                      uint8_t boost_bits_alpha, float dither_level, const uint8_t *importance_map, size_t pixel_count, uint8_t *bit_hint_map, size_t bit_hint_len,
+                                                      const pngx_options_t *opts) {
+  custom_bitdepth_dither_ctx_t ctx;
+  pngx_scratch_t *scratch;
   size_t row_stride;
-  float *err_curr, *err_next, *tmp;
-  bool left_to_right;
+  float *err_rows, *err_curr, *err_next;
+  bool completed;
 
   bits_rgb = clamp_reduced_bits(bits_rgb);
   bits_alpha = clamp_reduced_bits(bits_alpha);
@@ -1485,46 +1900,51 @@ static inline bool reduce_rgba_custom_bitdepth_dither(uint8_t *rgba, png_uint_32
     return true;
   }
 
-  row_stride = (size_t)width * PNGX_RGBA_CHANNELS;
-  err_curr = (float *)calloc(row_stride, sizeof(float));
-  err_next = (float *)calloc(row_stride, sizeof(float));
-  if (!err_curr || !err_next) {
-    free(err_curr);
-    free(err_next);
-    colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNGX: Reduced RGBA32 dither allocation failed");
+  ctx.width = width;
+  ctx.height = height;
+  ctx.bits_rgb = bits_rgb;
+  ctx.bits_alpha = bits_alpha;
+  ctx.boost_bits_rgb = boost_bits_rgb;
+  ctx.boost_bits_alpha = boost_bits_alpha;
+  ctx.dither_level = dither_level;
+  ctx.importance_map = importance_map;
+  ctx.pixel_count = pixel_count;
+  ctx.bit_hint_map = bit_hint_map;
+  ctx.bit_hint_len = bit_hint_len;
+  ctx.opts = opts;
+
+  if (opts && opts->tiled_dither_enable) {
+    if (dither_rows_in_bands(thread_count, rgba, width, height, dither_custom_bitdepth_rows, &ctx)) {
+      return true;
+    }
+    if (!pngx_cancelled(opts)) {
+      colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNGX: Reduced RGBA32 dither allocation failed");
+    }
 
     return false;
   }
 
-  for (y = 0; y < height; ++y) {
-    left_to_right = ((y & 1) == 0);
-    memset(err_next, 0, row_stride * sizeof(float));
-    if (left_to_right) {
-      for (x = 0; x < width; ++x) {
-        process_custom_bitdepth_pixel(rgba, width, height, x, y, bits_rgb, bits_alpha, boost_bits_rgb, boost_bits_alpha, dither_level, importance_map, pixel_count, err_curr, err_next, true,
-                                      bit_hint_map, bit_hint_len);
-      }
-    } else {
-      x = width;
-      while (x-- > 0) {
-        process_custom_bitdepth_pixel(rgba, width, height, x, y, bits_rgb, bits_alpha, boost_bits_rgb, boost_bits_alpha, dither_level, importance_map, pixel_count, err_curr, err_next, false,
-                                      bit_hint_map, bit_hint_len);
-      }
-    }
+  row_stride = (size_t)width * PNGX_RGBA_CHANNELS;
+  scratch = opts ? opts->scratch : NULL;
+  err_rows = (float *)pngx_scratch_acquire(scratch, PNGX_SCRATCH_DIFFUSION_ROWS, row_stride * 2 * sizeof(float));
+  if (!err_rows) {
+    colopresso_log(CPRES_LOG_LEVEL_ERROR, "PNGX: Reduced RGBA32 dither allocation failed");
 
-    tmp = err_curr;
-    err_curr = err_next;
-    err_next = tmp;
+    return false;
   }
+  memset(err_rows, 0, row_stride * 2 * sizeof(float));
+  err_curr = err_rows;
+  err_next = err_rows + row_stride;
 
-  free(err_curr);
-  free(err_next);
+  completed = dither_custom_bitdepth_rows(&ctx, rgba, 0, height, false, &err_curr, &err_next);
 
-  return true;
+  pngx_scratch_release(scratch, PNGX_SCRATCH_DIFFUSION_ROWS, err_rows);
+
+  return completed;
 }
 
 static inline bool reduce_rgba_custom_bitdepth(uint32_t thread_count, uint8_t *rgba, png_uint_32 width, png_uint_32 height, uint8_t bits_rgb, uint8_t bits_alpha, float dither_level,
-                                               const uint8_t *importance_map, size_t importance_map_len, pngx_quant_support_t *support) {
+                                               const uint8_t *importance_map, size_t importance_map_len, pngx_quant_support_t *support, const pngx_options_t *opts) {
   uint8_t boost_bits_rgb, boost_bits_alpha, *bit_hint_map = NULL;
   size_t bit_hint_len = 0, pixel_count, hint_len;
   bool need_rgb, need_alpha;
@@ -1564,7 +1984,7 @@ static inline bool reduce_rgba_custom_bitdepth(uint32_t thread_count, uint8_t *r
   }
 
   if (dither_level > 0.0f) {
-    if (!reduce_rgba_custom_bitdepth_dither(rgba, width, height, bits_rgb, bits_alpha, boost_bits_rgb, boost_bits_alpha, dither_level, importance_map, pixel_count, bit_hint_map, bit_hint_len)) {
+    if (!reduce_rgba_custom_bitdepth_dither(thread_count, rgba, width, height, bits_rgb, bits_alpha, boost_bits_rgb, boost_bits_alpha, dither_level, importance_map, pixel_count, bit_hint_map, bit_hint_len, opts)) {
       return false;
     }
   } else {
@@ -1575,39 +1995,6 @@ static inline bool reduce_rgba_custom_bitdepth(uint32_t thread_count, uint8_t *r
   return true;
 }
 
-static inline uint32_t collect_alpha_levels(const pngx_rgba_image_t *image, float *non_opaque_ratio) {
-  uint32_t unique = 0, non_opaque = 0;
-  uint8_t alpha;
-  size_t i;
-  bool level_used[256] = {false};
-
-  if (!image || !image->rgba || image->pixel_count == 0) {
-    if (non_opaque_ratio) {
-      *non_opaque_ratio = 0.0f;
-    }
-
-    return 0;
-  }
-
-  for (i = 0; i < image->pixel_count; ++i) {
-    alpha = image->rgba[i * 4 + 3];
-    if (!level_used[alpha]) {
-      level_used[alpha] = true;
-      ++unique;
-    }
-
-    if (alpha < 255) {
-      ++non_opaque;
-    }
-  }
-
-  if (non_opaque_ratio) {
-    *non_opaque_ratio = (image->pixel_count > 0) ? ((float)non_opaque / (float)image->pixel_count) : 0.0f;
-  }
-
-  return unique;
-}
-
 static inline uint8_t bits_for_level_count(uint32_t levels) {
   uint32_t capacity = 1;
   uint8_t bits = 1;
@@ -1624,7 +2011,7 @@ static inline uint8_t bits_for_level_count(uint32_t levels) {
   return clamp_reduced_bits(bits);
 }
 
-static inline void tune_reduced_bitdepth(const pngx_rgba_image_t *image, const pngx_image_stats_t *stats, uint8_t *bits_rgb, uint8_t *bits_alpha) {
+static inline void tune_reduced_bitdepth(const pngx_image_analysis_t *analysis, const pngx_image_stats_t *stats, uint8_t *bits_rgb, uint8_t *bits_alpha) {
   uint32_t alpha_levels;
   uint8_t tuned_rgb, tuned_alpha, level_bits, next_alpha;
   float gradient, saturation, vibrant, opaque, translucent, non_opaque_ratio;
@@ -1651,8 +2038,8 @@ static inline void tune_reduced_bitdepth(const pngx_rgba_image_t *image, const p
     }
   }
 
-  non_opaque_ratio = 0.0f;
-  alpha_levels = collect_alpha_levels(image, &non_opaque_ratio);
+  alpha_levels = analysis ? analysis->alpha_levels : 0;
+  non_opaque_ratio = (alpha_levels > 0) ? ((float)analysis->non_opaque_pixels / (float)analysis->pixel_count) : 0.0f;
   if (alpha_levels > 0) {
     level_bits = bits_for_level_count(alpha_levels);
     if (alpha_levels <= PNGX_REDUCED_ALPHA_LEVEL_LIMIT_FEW && non_opaque_ratio < PNGX_REDUCED_ALPHA_RATIO_FEW && tuned_alpha > level_bits) {
@@ -1706,7 +2093,7 @@ static inline bool apply_reduced_rgba32_prepass(pngx_rgba_image_t *image, const
     }
   }
 
-  return reduce_rgba_custom_bitdepth(opts->thread_count, image->rgba, image->width, image->height, bits_rgb, bits_alpha, dither, importance, importance_len, support);
+  return reduce_rgba_custom_bitdepth(opts->thread_count, image->rgba, image->width, image->height, bits_rgb, bits_alpha, dither, importance, importance_len, support, opts);
 }
 
 static inline void head_heap_sift_up(uint64_t *heap, size_t index) {
@@ -2133,22 +2520,19 @@ static inline uint32_t resolve_reduced_rgba32_target(const color_histogram_t *hi
   return target;
 }
 
-bool pngx_quantize_reduced_rgba32(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint32_t *resolved_target, uint32_t *applied_colors, uint8_t **out_data, size_t *out_size) {
+bool pngx_quantize_reduced_rgba32_image(pngx_rgba_image_t *image, const pngx_options_t *opts, uint32_t *resolved_target, uint32_t *applied_colors, uint8_t **out_data, size_t *out_size) {
   uint32_t target = 0, actual = 0, manual_limit = 0, auto_trim_limit = 0, grid_cap;
   uint8_t bits_rgb, bits_alpha;
   size_t grid_unique, passthrough_threshold;
   bool wrote, manual_target = false, success, auto_target, grid_passthrough, auto_trim_applied = false;
-  pngx_rgba_image_t image;
+  pngx_image_analysis_t analysis;
   pngx_quant_support_t support = {0};
   pngx_image_stats_t stats;
   pngx_options_t tuned_opts;
   color_histogram_t histogram;
 
-  if (!png_data || png_size == 0 || !opts || !out_data || !out_size) {
-    return false;
-  }
-
-  if (!load_rgba_image(png_data, png_size, &image)) {
+  if (!image || !image->rgba || !opts || !out_data || !out_size) {
+    rgba_image_reset(image);
     return false;
   }
 
@@ -2159,16 +2543,16 @@ bool pngx_quantize_reduced_rgba32(const uint8_t *png_data, size_t png_size, cons
 
   image_stats_reset(&stats);
 
-  if (!prepare_quant_support(&image, &tuned_opts, &support, &stats)) {
-    rgba_image_reset(&image);
+  if (!analyze_image(opts->thread_count, image->rgba, image->width, image->height, &analysis) || !prepare_quant_support(image, &analysis, &tuned_opts, &support, &stats)) {
+    rgba_image_reset(image);
     return false;
   }
 
-  tune_reduced_bitdepth(&image, &stats, &tuned_opts.lossy_reduced_bits_rgb, &tuned_opts.lossy_reduced_alpha_bits);
-  if (!apply_reduced_rgba32_prepass(&image, &tuned_opts, &support, &stats)) {
+  tune_reduced_bitdepth(&analysis, &stats, &tuned_opts.lossy_reduced_bits_rgb, &tuned_opts.lossy_reduced_alpha_bits);
+  if (!apply_reduced_rgba32_prepass(image, &tuned_opts, &support, &stats)) {
     color_histogram_reset(&histogram);
     quant_support_reset(&support);
-    rgba_image_reset(&image);
+    rgba_image_reset(image);
 
     return false;
   }
@@ -2187,7 +2571,7 @@ bool pngx_quantize_reduced_rgba32(const uint8_t *png_data, size_t png_size, cons
     }
   }
 
-  grid_unique = count_unique_rgba(image.rgba, image.pixel_count);
+  grid_unique = count_unique_rgba(opts->thread_count, image->rgba, image->pixel_count);
   grid_cap = compute_grid_capacity(bits_rgb, bits_alpha);
   auto_target = (opts->lossy_reduced_colors <= 0);
   grid_passthrough = false;
@@ -2208,7 +2592,7 @@ bool pngx_quantize_reduced_rgba32(const uint8_t *png_data, size_t png_size, cons
 
   if (grid_passthrough) {
     wrote = false;
-    snap_rgba_image_to_bits(opts->thread_count, image.rgba, image.pixel_count, bits_rgb, bits_alpha);
+    snap_rgba_image_to_bits(opts->thread_count, image->rgba, image->pixel_count, bits_rgb, bits_alpha);
 
     if (resolved_target) {
       *resolved_target = (uint32_t)grid_unique;
@@ -2218,42 +2602,42 @@ bool pngx_quantize_reduced_rgba32(const uint8_t *png_data, size_t png_size, cons
       *applied_colors = (uint32_t)grid_unique;
     }
 
-    wrote = create_rgba_png(image.rgba, image.pixel_count, image.width, image.height, out_data, out_size);
+    wrote = create_quantized_rgba_png(image, opts, out_data, out_size);
     if (wrote) {
       colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Reduced RGBA32 grid passthrough kept %zu colors (capacity=%u)", grid_unique, grid_cap);
     }
 
     quant_support_reset(&support);
-    rgba_image_reset(&image);
+    rgba_image_reset(image);
 
     return wrote;
   }
 
-  if (!build_color_histogram(&image, &tuned_opts, &support, &histogram)) {
+  if (!build_color_histogram(image, &tuned_opts, &support, &histogram)) {
     quant_support_reset(&support);
-    rgba_image_reset(&image);
+    rgba_image_reset(image);
 
     return false;
   }
 
-  target = resolve_reduced_rgba32_target(&histogram, image.pixel_count, opts->lossy_reduced_colors, bits_rgb, bits_alpha, &stats);
+  target = resolve_reduced_rgba32_target(&histogram, image->pixel_count, opts->lossy_reduced_colors, bits_rgb, bits_alpha, &stats);
   if (histogram.unlocked_count == 0 || target == 0) {
     actual = (uint32_t)histogram.count;
-    snap_rgba_image_to_bits(opts->thread_count, image.rgba, image.pixel_count, bits_rgb, bits_alpha);
+    snap_rgba_image_to_bits(opts->thread_count, image->rgba, image->pixel_count, bits_rgb, bits_alpha);
   } else {
-    if (!apply_reduced_rgba32_quantization(opts->thread_count, &histogram, &image, target, bits_rgb, bits_alpha, &actual)) {
+    if (!apply_reduced_rgba32_quantization(opts->thread_count, &histogram, image, target, bits_rgb, bits_alpha, &actual)) {
       color_histogram_reset(&histogram);
       quant_support_reset(&support);
-      rgba_image_reset(&image);
+      rgba_image_reset(image);
 
       return false;
     }
   }
 
   if (!manual_target) {
-    auto_trim_limit = compute_auto_trim_limit(&histogram, image.pixel_count, actual, bits_rgb, bits_alpha, &stats);
+    auto_trim_limit = compute_auto_trim_limit(&histogram, image->pixel_count, actual, bits_rgb, bits_alpha, &stats);
     if (auto_trim_limit > 0 && auto_trim_limit < actual) {
-      if (enforce_manual_reduced_limit(opts->thread_count, &image, auto_trim_limit, bits_rgb, bits_alpha, &actual)) {
+      if (enforce_manual_reduced_limit(opts->thread_count, image, auto_trim_limit, bits_rgb, bits_alpha, &actual)) {
         auto_trim_applied = true;
         colopresso_log(CPRES_LOG_LEVEL_DEBUG, "PNGX: Reduced RGBA32 auto trim applied %u -> %u colors", target, auto_trim_limit);
       } else {
@@ -2266,16 +2650,16 @@ bool pngx_quantize_reduced_rgba32(const uint8_t *png_data, size_t png_size, cons
   }
 
   if (manual_target) {
-    if (!enforce_manual_reduced_limit(opts->thread_count, &image, manual_limit, bits_rgb, bits_alpha, &actual)) {
+    if (!enforce_manual_reduced_limit(opts->thread_count, image, manual_limit, bits_rgb, bits_alpha, &actual)) {
       color_histogram_reset(&histogram);
       quant_support_reset(&support);
-      rgba_image_reset(&image);
+      rgba_image_reset(image);
 
       return false;
     }
   }
 
-  success = create_rgba_png(image.rgba, image.pixel_count, image.width, image.height, out_data, out_size);
+  success = !pngx_cancelled(opts) && create_quantized_rgba_png(image, opts, out_data, out_size);
 
   if (resolved_target) {
     if (manual_target) {
@@ -2295,7 +2679,21 @@ bool pngx_quantize_reduced_rgba32(const uint8_t *png_data, size_t png_size, cons
 
   color_histogram_reset(&histogram);
   quant_support_reset(&support);
-  rgba_image_reset(&image);
+  rgba_image_reset(image);
 
   return success;
 }
+
+bool pngx_quantize_reduced_rgba32(const uint8_t *png_data, size_t png_size, const pngx_options_t *opts, uint32_t *resolved_target, uint32_t *applied_colors, uint8_t **out_data, size_t *out_size) {
+  pngx_rgba_image_t image;
+
+  if (!png_data || png_size == 0 || !opts || !out_data || !out_size) {
+    return false;
+  }
+
+  if (!load_rgba_image(png_data, png_size, &image)) {
+    return false;
+  }
+
+  return pngx_quantize_reduced_rgba32_image(&image, opts, resolved_target, applied_colors, out_data, out_size);
+}
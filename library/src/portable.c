@@ -26,6 +26,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/utime.h>
 
 char *optarg = NULL;
 int optind = 1;
@@ -138,6 +139,80 @@ int colopresso_mutex_destroy(colopresso_mutex_t *mutex) {
   return 0;
 }
 
+int colopresso_cond_init(colopresso_cond_t *cond, const void *attr) {
+  (void)attr;
+
+  if (!cond) {
+    return EINVAL;
+  }
+
+  InitializeConditionVariable(cond);
+  return 0;
+}
+
+int colopresso_cond_wait(colopresso_cond_t *cond, colopresso_mutex_t *mutex) {
+  if (!cond || !mutex) {
+    return EINVAL;
+  }
+
+  if (!SleepConditionVariableCS(cond, mutex, INFINITE)) {
+    return EINVAL;
+  }
+
+  return 0;
+}
+
+int colopresso_cond_signal(colopresso_cond_t *cond) {
+  if (!cond) {
+    return EINVAL;
+  }
+
+  WakeConditionVariable(cond);
+  return 0;
+}
+
+int colopresso_cond_broadcast(colopresso_cond_t *cond) {
+  if (!cond) {
+    return EINVAL;
+  }
+
+  WakeAllConditionVariable(cond);
+  return 0;
+}
+
+int colopresso_cond_destroy(colopresso_cond_t *cond) {
+  if (!cond) {
+    return EINVAL;
+  }
+
+  return 0;
+}
+
+static BOOL CALLBACK cpres_once_wrapper(PINIT_ONCE once, PVOID parameter, PVOID *context) {
+  void (*init_routine)(void) = (void (*)(void))parameter;
+
+  (void)once;
+  (void)context;
+
+  if (init_routine) {
+    init_routine();
+  }
+
+  return TRUE;
+}
+
+int colopresso_once(colopresso_once_t *once, void (*init_routine)(void)) {
+  if (!once || !init_routine) {
+    return EINVAL;
+  }
+
+  if (!InitOnceExecuteOnce(once, cpres_once_wrapper, (PVOID)init_routine, NULL)) {
+    return EINVAL;
+  }
+
+  return 0;
+}
+
 static const struct option *match_long_option(const char *name, size_t name_len, const struct option *longopts, int *index_out) {
   int i;
 
@@ -321,7 +396,10 @@ struct tm *gmtime_r(const time_t *timer, struct tm *buf) {
 
 #else
 
+#include <dirent.h>
+#include <errno.h>
 #include <stdlib.h>
+#include <utime.h>
 
 #endif
 
@@ -375,6 +453,40 @@ const char *colopresso_extract_extension(const char *path) {
   return dot;
 }
 
+double colopresso_get_monotonic_seconds(void) {
+#ifdef _WIN32
+  LARGE_INTEGER frequency, counter;
+
+  if (!QueryPerformanceFrequency(&frequency) || !QueryPerformanceCounter(&counter) || frequency.QuadPart == 0) {
+    return (double)GetTickCount64() / 1000.0;
+  }
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return (double)time(NULL);
+  }
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+int32_t colopresso_atomic_load_i32(const volatile int32_t *ptr) {
+#ifdef _WIN32
+  return (int32_t)InterlockedCompareExchange((volatile LONG *)ptr, 0, 0);
+#else
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void colopresso_atomic_store_i32(volatile int32_t *ptr, int32_t value) {
+#ifdef _WIN32
+  InterlockedExchange((volatile LONG *)ptr, (LONG)value);
+#else
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
 void colopresso_tm_set_gmt_offset(struct tm *tm) {
   if (!tm) {
     return;
@@ -415,6 +527,143 @@ bool colopresso_ftello(FILE *fp, uint64_t *position_out) {
   return true;
 }
 
+bool colopresso_is_directory(const char *path) {
+#ifdef _WIN32
+  DWORD attributes;
+
+  if (!path) {
+    return false;
+  }
+
+  attributes = GetFileAttributesA(path);
+  return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+  struct stat st;
+
+  if (!path || stat(path, &st) != 0) {
+    return false;
+  }
+
+  return S_ISDIR(st.st_mode);
+#endif
+}
+
+bool colopresso_make_directory(const char *path) {
+  if (!path || path[0] == '\0') {
+    return false;
+  }
+
+#ifdef _WIN32
+  if (CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS) {
+    return colopresso_is_directory(path);
+  }
+  return false;
+#else
+  if (mkdir(path, 0777) == 0) {
+    return true;
+  }
+  return errno == EEXIST && colopresso_is_directory(path);
+#endif
+}
+
+bool colopresso_read_directory(const char *path, colopresso_dir_callback_t callback, void *user_data) {
+#ifdef _WIN32
+  WIN32_FIND_DATAA find_data;
+  HANDLE handle;
+  char pattern[MAX_PATH];
+  bool success = true;
+
+  if (!path || !callback) {
+    return false;
+  }
+
+  if (snprintf(pattern, sizeof(pattern), "%s\\*", path) >= (int)sizeof(pattern)) {
+    return false;
+  }
+
+  handle = FindFirstFileA(pattern, &find_data);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  do {
+    if (strcmp(find_data.cFileName, ".") == 0 || strcmp(find_data.cFileName, "..") == 0) {
+      continue;
+    }
+    if (!callback(find_data.cFileName, (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0, user_data)) {
+      success = false;
+      break;
+    }
+  } while (FindNextFileA(handle, &find_data));
+
+  FindClose(handle);
+
+  return success;
+#else
+  DIR *dir;
+  struct dirent *entry;
+  struct stat st;
+  char *child;
+  size_t path_len, name_len;
+  bool is_directory, success = true;
+
+  if (!path || !callback) {
+    return false;
+  }
+
+  dir = opendir(path);
+  if (!dir) {
+    return false;
+  }
+
+  path_len = strlen(path);
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+
+    name_len = strlen(entry->d_name);
+    child = (char *)malloc(path_len + name_len + 2);
+    if (!child) {
+      success = false;
+      break;
+    }
+    snprintf(child, path_len + name_len + 2, "%s/%s", path, entry->d_name);
+    is_directory = stat(child, &st) == 0 && S_ISDIR(st.st_mode);
+    free(child);
+
+    if (!callback(entry->d_name, is_directory, user_data)) {
+      success = false;
+      break;
+    }
+  }
+
+  closedir(dir);
+
+  return success;
+#endif
+}
+
+bool colopresso_touch_file(const char *path) {
+  if (!path) {
+    return false;
+  }
+
+#ifdef _WIN32
+  return _utime(path, NULL) == 0;
+#else
+  return utime(path, NULL) == 0;
+#endif
+}
+
+uint32_t colopresso_get_process_id(void) {
+#ifdef _WIN32
+  return (uint32_t)GetCurrentProcessId();
+#else
+  return (uint32_t)getpid();
+#endif
+}
+
 #endif
 
 /* LCOV_EXCL_STOP */
@@ -0,0 +1,138 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <string.h>
+
+#include "internal/sha256.h"
+
+static const uint32_t kSha256RoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74,
+    0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d,
+    0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e,
+    0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t sha256_rotr(uint32_t value, uint32_t bits) { return (value >> bits) | (value << (32 - bits)); }
+
+static inline void sha256_transform(uint32_t state[8], const uint8_t block[64]) {
+  uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+  int i;
+
+  for (i = 0; i < 16; ++i) {
+    w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) | ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+  }
+  for (i = 16; i < 64; ++i) {
+    w[i] = w[i - 16] + (sha256_rotr(w[i - 15], 7) ^ sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3)) + w[i - 7] +
+           (sha256_rotr(w[i - 2], 17) ^ sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10));
+  }
+
+  a = state[0];
+  b = state[1];
+  c = state[2];
+  d = state[3];
+  e = state[4];
+  f = state[5];
+  g = state[6];
+  h = state[7];
+
+  for (i = 0; i < 64; ++i) {
+    t1 = h + (sha256_rotr(e, 6) ^ sha256_rotr(e, 11) ^ sha256_rotr(e, 25)) + ((e & f) ^ (~e & g)) + kSha256RoundConstants[i] + w[i];
+    t2 = (sha256_rotr(a, 2) ^ sha256_rotr(a, 13) ^ sha256_rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+void colopresso_sha256_init(colopresso_sha256_t *ctx) {
+  ctx->state[0] = 0x6a09e667;
+  ctx->state[1] = 0xbb67ae85;
+  ctx->state[2] = 0x3c6ef372;
+  ctx->state[3] = 0xa54ff53a;
+  ctx->state[4] = 0x510e527f;
+  ctx->state[5] = 0x9b05688c;
+  ctx->state[6] = 0x1f83d9ab;
+  ctx->state[7] = 0x5be0cd19;
+  ctx->length = 0;
+  ctx->buffer_len = 0;
+}
+
+void colopresso_sha256_update(colopresso_sha256_t *ctx, const void *data, size_t len) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  size_t take;
+
+  ctx->length += (uint64_t)len;
+
+  if (ctx->buffer_len > 0) {
+    take = 64 - ctx->buffer_len;
+    if (take > len) {
+      take = len;
+    }
+    memcpy(ctx->buffer + ctx->buffer_len, bytes, take);
+    ctx->buffer_len += take;
+    bytes += take;
+    len -= take;
+    if (ctx->buffer_len < 64) {
+      return;
+    }
+    sha256_transform(ctx->state, ctx->buffer);
+    ctx->buffer_len = 0;
+  }
+
+  while (len >= 64) {
+    sha256_transform(ctx->state, bytes);
+    bytes += 64;
+    len -= 64;
+  }
+
+  if (len > 0) {
+    memcpy(ctx->buffer, bytes, len);
+    ctx->buffer_len = len;
+  }
+}
+
+void colopresso_sha256_final(colopresso_sha256_t *ctx, uint8_t digest[COLOPRESSO_SHA256_DIGEST_SIZE]) {
+  uint64_t bit_length = ctx->length * 8;
+  int i;
+
+  ctx->buffer[ctx->buffer_len++] = 0x80;
+  if (ctx->buffer_len > 56) {
+    memset(ctx->buffer + ctx->buffer_len, 0, 64 - ctx->buffer_len);
+    sha256_transform(ctx->state, ctx->buffer);
+    ctx->buffer_len = 0;
+  }
+  memset(ctx->buffer + ctx->buffer_len, 0, 56 - ctx->buffer_len);
+  for (i = 0; i < 8; ++i) {
+    ctx->buffer[56 + i] = (uint8_t)(bit_length >> (56 - i * 8));
+  }
+  sha256_transform(ctx->state, ctx->buffer);
+
+  for (i = 0; i < 8; ++i) {
+    digest[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+    digest[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+    digest[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+    digest[i * 4 + 3] = (uint8_t)ctx->state[i];
+  }
+}
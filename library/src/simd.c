@@ -9,6 +9,11 @@
  * Developed with AI (LLM) code assistance. See `NOTICE` for details.
  */
 
+#include <stdlib.h>
+#include <string.h>
+
+#include <colopresso/portable.h>
+
 #include "internal/simd.h"
 
 #if defined(CPRES_SIMD_SSE41) || defined(CPRES_SIMD_SSE2)
@@ -76,3 +81,677 @@ uint32_t simd_color_distance_sq_u32(uint32_t lhs, uint32_t rhs) {
   return color_distance_sq_scalar(lhs, rhs);
 #endif
 }
+
+/* quantize_bits as a float pipeline. levels is 2^bits - 1, or 255 for bits >= 8, where every step below is exact and the input comes back unchanged. The vector kernels
+ * run the same single-precision operations in the same order, and IEEE division is correctly rounded on every target, so all of them match quantize_bits bit for bit. */
+static inline float snap_levels(uint8_t bits) { return bits >= 8 ? 255.0f : (float)((1u << (bits < 1 ? 1 : bits)) - 1u); }
+
+static inline uint8_t snap_channel_scalar(uint8_t value, float levels) {
+  float rounded = (float)((int32_t)((float)value * levels / 255.0f + 0.5f));
+
+  return (uint8_t)(rounded * 255.0f / levels + 0.5f);
+}
+
+static inline void snap_pixel_scalar(uint8_t *pixel, float levels_rgb, float levels_alpha) {
+  pixel[0] = snap_channel_scalar(pixel[0], levels_rgb);
+  pixel[1] = snap_channel_scalar(pixel[1], levels_rgb);
+  pixel[2] = snap_channel_scalar(pixel[2], levels_rgb);
+  pixel[3] = snap_channel_scalar(pixel[3], levels_alpha);
+}
+
+#if defined(CPRES_SIMD_X86_DISPATCH)
+#define SNAP_KERNEL_SSE41 1
+#define SNAP_KERNEL_AVX2 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_TARGET_SSE41
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#if defined(CPRES_SIMD_SSE41)
+#define SNAP_KERNEL_SSE41 1
+#endif
+#if defined(CPRES_SIMD_AVX2)
+#define SNAP_KERNEL_AVX2 1
+#endif
+#define SIMD_TARGET_SSE41
+#define SIMD_TARGET_AVX2
+#endif
+
+#if defined(CPRES_SIMD_SSE41) || defined(CPRES_SIMD_SSE2)
+
+#define SNAP_KERNEL_SSE_BLOCK 16
+
+static inline __m128 snap_ps_sse(__m128 value, __m128 levels) {
+  const __m128 k255 = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+  __m128 rounded = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(_mm_div_ps(_mm_mul_ps(value, levels), k255), half)));
+
+  return _mm_add_ps(_mm_div_ps(_mm_mul_ps(rounded, k255), levels), half);
+}
+
+static inline __m128i snap_epi32_sse(__m128i value, __m128 levels) { return _mm_cvttps_epi32(snap_ps_sse(_mm_cvtepi32_ps(value), levels)); }
+
+/* Four pixels per 16 bytes; every float lane lines up with one channel, so levels is simply {rgb, rgb, rgb, alpha}. */
+static inline __m128i snap_4px_sse(__m128i pixels, __m128 levels) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_unpacklo_epi8(pixels, zero), hi = _mm_unpackhi_epi8(pixels, zero), q0, q1, q2, q3;
+
+  q0 = snap_epi32_sse(_mm_unpacklo_epi16(lo, zero), levels);
+  q1 = snap_epi32_sse(_mm_unpackhi_epi16(lo, zero), levels);
+  q2 = snap_epi32_sse(_mm_unpacklo_epi16(hi, zero), levels);
+  q3 = snap_epi32_sse(_mm_unpackhi_epi16(hi, zero), levels);
+
+  return _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3));
+}
+
+static size_t snap_block_sse(uint8_t *rgba, size_t pixel_count, float levels_rgb, float levels_alpha) {
+  const __m128 levels = _mm_setr_ps(levels_rgb, levels_rgb, levels_rgb, levels_alpha);
+  __m128i *block;
+  size_t i;
+  int j;
+
+  for (i = 0; i + SNAP_KERNEL_SSE_BLOCK <= pixel_count; i += SNAP_KERNEL_SSE_BLOCK) {
+    block = (__m128i *)(rgba + i * 4);
+    for (j = 0; j < 4; ++j) {
+      _mm_storeu_si128(block + j, snap_4px_sse(_mm_loadu_si128(block + j), levels));
+    }
+  }
+
+  return i;
+}
+
+static void snap_pixel_sse(uint8_t *pixel, float levels_rgb, float levels_alpha) {
+  const __m128 levels = _mm_setr_ps(levels_rgb, levels_rgb, levels_rgb, levels_alpha);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i q;
+  int32_t word;
+
+  memcpy(&word, pixel, sizeof(word));
+  q = snap_epi32_sse(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(word), zero), zero), levels);
+  word = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(q, q), zero));
+  memcpy(pixel, &word, sizeof(word));
+}
+
+#endif
+
+#if defined(SNAP_KERNEL_SSE41)
+
+/* SSE4.1 only shortens the widening: pmovzxbd and packusdw replace the two unpack levels, the float pipeline is the SSE2 one. */
+static inline SIMD_TARGET_SSE41 __m128i snap_4px_sse41(__m128i pixels, __m128 levels) {
+  __m128i q0 = snap_epi32_sse(_mm_cvtepu8_epi32(pixels), levels), q1 = snap_epi32_sse(_mm_cvtepu8_epi32(_mm_srli_si128(pixels, 4)), levels);
+  __m128i q2 = snap_epi32_sse(_mm_cvtepu8_epi32(_mm_srli_si128(pixels, 8)), levels), q3 = snap_epi32_sse(_mm_cvtepu8_epi32(_mm_srli_si128(pixels, 12)), levels);
+
+  return _mm_packus_epi16(_mm_packus_epi32(q0, q1), _mm_packus_epi32(q2, q3));
+}
+
+static SIMD_TARGET_SSE41 size_t snap_block_sse41(uint8_t *rgba, size_t pixel_count, float levels_rgb, float levels_alpha) {
+  const __m128 levels = _mm_setr_ps(levels_rgb, levels_rgb, levels_rgb, levels_alpha);
+  __m128i *block;
+  size_t i;
+  int j;
+
+  for (i = 0; i + SNAP_KERNEL_SSE_BLOCK <= pixel_count; i += SNAP_KERNEL_SSE_BLOCK) {
+    block = (__m128i *)(rgba + i * 4);
+    for (j = 0; j < 4; ++j) {
+      _mm_storeu_si128(block + j, snap_4px_sse41(_mm_loadu_si128(block + j), levels));
+    }
+  }
+
+  return i;
+}
+
+static SIMD_TARGET_SSE41 void snap_pixel_sse41(uint8_t *pixel, float levels_rgb, float levels_alpha) {
+  const __m128 levels = _mm_setr_ps(levels_rgb, levels_rgb, levels_rgb, levels_alpha);
+  __m128i q;
+  int32_t word;
+
+  memcpy(&word, pixel, sizeof(word));
+  q = snap_epi32_sse(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(word)), levels);
+  q = _mm_packus_epi32(q, q);
+  word = _mm_cvtsi128_si32(_mm_packus_epi16(q, q));
+  memcpy(pixel, &word, sizeof(word));
+}
+
+#endif
+
+#if defined(SNAP_KERNEL_AVX2)
+
+#define SNAP_KERNEL_AVX2_BLOCK 32
+
+static inline SIMD_TARGET_AVX2 __m256i snap_2px_avx2(const uint8_t *pixels, __m256 levels) {
+  const __m256 k255 = _mm256_set1_ps(255.0f), half = _mm256_set1_ps(0.5f);
+  __m256 value = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)pixels))), rounded;
+
+  rounded = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(value, levels), k255), half)));
+
+  return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(rounded, k255), levels), half));
+}
+
+/* Eight pixels per 32 bytes. The in-lane packs leave the four 2-pixel groups interleaved across the 128-bit halves, which the final dword permute undoes. */
+static inline SIMD_TARGET_AVX2 void snap_8px_avx2(uint8_t *pixels, __m256 levels) {
+  __m256i ab = _mm256_packs_epi32(snap_2px_avx2(pixels, levels), snap_2px_avx2(pixels + 8, levels));
+  __m256i cd = _mm256_packs_epi32(snap_2px_avx2(pixels + 16, levels), snap_2px_avx2(pixels + 24, levels));
+
+  _mm256_storeu_si256((__m256i *)pixels, _mm256_permutevar8x32_epi32(_mm256_packus_epi16(ab, cd), _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)));
+}
+
+static SIMD_TARGET_AVX2 size_t snap_block_avx2(uint8_t *rgba, size_t pixel_count, float levels_rgb, float levels_alpha) {
+  const __m256 levels = _mm256_setr_ps(levels_rgb, levels_rgb, levels_rgb, levels_alpha, levels_rgb, levels_rgb, levels_rgb, levels_alpha);
+  size_t i;
+
+  for (i = 0; i + SNAP_KERNEL_AVX2_BLOCK <= pixel_count; i += SNAP_KERNEL_AVX2_BLOCK) {
+    snap_8px_avx2(rgba + i * 4, levels);
+    snap_8px_avx2(rgba + i * 4 + 32, levels);
+    snap_8px_avx2(rgba + i * 4 + 64, levels);
+    snap_8px_avx2(rgba + i * 4 + 96, levels);
+  }
+
+  return i;
+}
+
+/* A single pixel fills only one SSE register; the SSE4.1 body is already the shortest form, encoded with VEX here. */
+static SIMD_TARGET_AVX2 void snap_pixel_avx2(uint8_t *pixel, float levels_rgb, float levels_alpha) { snap_pixel_sse41(pixel, levels_rgb, levels_alpha); }
+
+#endif
+
+#if defined(CPRES_SIMD_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+
+/* vdivq_f32 is AArch64-only; 32-bit NEON builds keep the scalar path rather than trade exactness for a reciprocal estimate. */
+#define SNAP_KERNEL_NEON 1
+#define SNAP_KERNEL_NEON_BLOCK 16
+
+static inline uint32x4_t snap_u32_neon(uint32x4_t value, float32x4_t levels) {
+  const float32x4_t k255 = vdupq_n_f32(255.0f), half = vdupq_n_f32(0.5f);
+  float32x4_t rounded = vcvtq_f32_s32(vcvtq_s32_f32(vaddq_f32(vdivq_f32(vmulq_f32(vcvtq_f32_u32(value), levels), k255), half)));
+
+  return vcvtq_u32_f32(vaddq_f32(vdivq_f32(vmulq_f32(rounded, k255), levels), half));
+}
+
+static inline uint8x16_t snap_4px_neon(uint8x16_t pixels, float32x4_t levels) {
+  uint16x8_t lo = vmovl_u8(vget_low_u8(pixels)), hi = vmovl_u8(vget_high_u8(pixels));
+  uint16x8_t q01 = vcombine_u16(vmovn_u32(snap_u32_neon(vmovl_u16(vget_low_u16(lo)), levels)), vmovn_u32(snap_u32_neon(vmovl_u16(vget_high_u16(lo)), levels)));
+  uint16x8_t q23 = vcombine_u16(vmovn_u32(snap_u32_neon(vmovl_u16(vget_low_u16(hi)), levels)), vmovn_u32(snap_u32_neon(vmovl_u16(vget_high_u16(hi)), levels)));
+
+  return vcombine_u8(vmovn_u16(q01), vmovn_u16(q23));
+}
+
+static size_t snap_block_neon(uint8_t *rgba, size_t pixel_count, float levels_rgb, float levels_alpha) {
+  const float levels_lanes[4] = {levels_rgb, levels_rgb, levels_rgb, levels_alpha};
+  const float32x4_t levels = vld1q_f32(levels_lanes);
+  uint8_t *block;
+  size_t i;
+  int j;
+
+  for (i = 0; i + SNAP_KERNEL_NEON_BLOCK <= pixel_count; i += SNAP_KERNEL_NEON_BLOCK) {
+    block = rgba + i * 4;
+    for (j = 0; j < 4; ++j) {
+      vst1q_u8(block + j * 16, snap_4px_neon(vld1q_u8(block + j * 16), levels));
+    }
+  }
+
+  return i;
+}
+
+static void snap_pixel_neon(uint8_t *pixel, float levels_rgb, float levels_alpha) {
+  const float levels_lanes[4] = {levels_rgb, levels_rgb, levels_rgb, levels_alpha};
+  uint32_t word;
+  uint16x4_t q;
+
+  memcpy(&word, pixel, sizeof(word));
+  q = vmovn_u32(snap_u32_neon(vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(word))))), vld1q_f32(levels_lanes)));
+  word = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(q, q))), 0);
+  memcpy(pixel, &word, sizeof(word));
+}
+
+#elif defined(CPRES_SIMD_WASM128)
+
+#define SNAP_KERNEL_WASM_BLOCK 16
+
+static inline v128_t snap_i32_wasm(v128_t value, v128_t levels) {
+  const v128_t k255 = wasm_f32x4_splat(255.0f), half = wasm_f32x4_splat(0.5f);
+  v128_t rounded = wasm_f32x4_convert_i32x4(wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_add(wasm_f32x4_div(wasm_f32x4_mul(wasm_f32x4_convert_i32x4(value), levels), k255), half)));
+
+  return wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_add(wasm_f32x4_div(wasm_f32x4_mul(rounded, k255), levels), half));
+}
+
+static inline v128_t snap_4px_wasm(v128_t pixels, v128_t levels) {
+  v128_t lo = wasm_u16x8_extend_low_u8x16(pixels), hi = wasm_u16x8_extend_high_u8x16(pixels);
+  v128_t q01 = wasm_i16x8_narrow_i32x4(snap_i32_wasm(wasm_u32x4_extend_low_u16x8(lo), levels), snap_i32_wasm(wasm_u32x4_extend_high_u16x8(lo), levels));
+  v128_t q23 = wasm_i16x8_narrow_i32x4(snap_i32_wasm(wasm_u32x4_extend_low_u16x8(hi), levels), snap_i32_wasm(wasm_u32x4_extend_high_u16x8(hi), levels));
+
+  return wasm_u8x16_narrow_i16x8(q01, q23);
+}
+
+static size_t snap_block_wasm(uint8_t *rgba, size_t pixel_count, float levels_rgb, float levels_alpha) {
+  const v128_t levels = wasm_f32x4_make(levels_rgb, levels_rgb, levels_rgb, levels_alpha);
+  uint8_t *block;
+  size_t i;
+  int j;
+
+  for (i = 0; i + SNAP_KERNEL_WASM_BLOCK <= pixel_count; i += SNAP_KERNEL_WASM_BLOCK) {
+    block = rgba + i * 4;
+    for (j = 0; j < 4; ++j) {
+      wasm_v128_store(block + j * 16, snap_4px_wasm(wasm_v128_load(block + j * 16), levels));
+    }
+  }
+
+  return i;
+}
+
+static void snap_pixel_wasm(uint8_t *pixel, float levels_rgb, float levels_alpha) {
+  const v128_t levels = wasm_f32x4_make(levels_rgb, levels_rgb, levels_rgb, levels_alpha);
+  int32_t word;
+  v128_t q;
+
+  memcpy(&word, pixel, sizeof(word));
+  q = snap_i32_wasm(wasm_u32x4_extend_low_u16x8(wasm_u16x8_extend_low_u8x16(wasm_i32x4_splat(word))), levels);
+  q = wasm_i16x8_narrow_i32x4(q, q);
+  word = wasm_i32x4_extract_lane(wasm_u8x16_narrow_i16x8(q, q), 0);
+  memcpy(pixel, &word, sizeof(word));
+}
+
+#endif
+
+/* Palette searches read the paired-channel planes of simd_palette_t: each 32-bit lane holds two 16-bit channels, so one multiply-add per plane yields dr^2 + dg^2 and db^2 + da^2 for a
+ * whole entry, and distances (at most 4 * 255^2) stay comfortably inside int32. Lanes keep the first index that reached their minimum and the fold takes the lowest index among the lanes
+ * holding the overall minimum, so every kernel returns exactly what a scalar first-minimum scan returns. The fold stays in registers; a per-lane scalar loop mispredicts on nearly every
+ * query and costs more than the scan itself on small palettes. */
+static inline uint32_t pair_rg(uint32_t color) { return (color & 0xFFu) | ((color & 0xFF00u) << 8); }
+
+static inline uint32_t pair_ba(uint32_t color) { return ((color >> 16) & 0xFFu) | ((color >> 8) & 0xFF0000u); }
+
+static inline uint32_t pair_distance_sq(uint32_t lhs, uint32_t rhs) {
+  int32_t lo = (int32_t)(lhs & 0xFFFFu) - (int32_t)(rhs & 0xFFFFu), hi = (int32_t)(lhs >> 16) - (int32_t)(rhs >> 16);
+
+  return (uint32_t)(lo * lo + hi * hi);
+}
+
+/* Scalar tail after the vector loop; best_dist and best_index carry the folded vector result, or UINT32_MAX and end when there was none. */
+static inline size_t nearest_finish(uint32_t best_dist, size_t best_index, const simd_palette_t *palette, size_t i, size_t end, uint32_t color, uint32_t *out_dist) {
+  uint32_t q_rg = pair_rg(color), q_ba = pair_ba(color), dist;
+
+  for (; i < end; ++i) {
+    dist = pair_distance_sq(palette->rg[i], q_rg) + pair_distance_sq(palette->ba[i], q_ba);
+    if (dist < best_dist) {
+      best_dist = dist;
+      best_index = i;
+    }
+  }
+
+  if (out_dist) {
+    *out_dist = best_dist;
+  }
+
+  return best_index;
+}
+
+static size_t nearest_scalar(const simd_palette_t *palette, size_t start, size_t end, uint32_t color, uint32_t *out_dist) { return nearest_finish(UINT32_MAX, end, palette, start, end, color, out_dist); }
+
+#if defined(CPRES_SIMD_SSE41) || defined(CPRES_SIMD_SSE2)
+
+static inline __m128i min_epi32_sse(__m128i lhs, __m128i rhs) {
+  __m128i greater = _mm_cmpgt_epi32(lhs, rhs);
+
+  return _mm_or_si128(_mm_and_si128(greater, rhs), _mm_andnot_si128(greater, lhs));
+}
+
+/* Minimum of the four lanes broadcast to every lane; SSE2 has no pminsd, hence the compare-and-select. */
+static inline __m128i hmin_epi32_sse(__m128i value) {
+  value = min_epi32_sse(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+  return min_epi32_sse(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+static size_t nearest_sse(const simd_palette_t *palette, size_t start, size_t end, uint32_t color, uint32_t *out_dist) {
+  const __m128i q_rg = _mm_set1_epi32((int)pair_rg(color)), q_ba = _mm_set1_epi32((int)pair_ba(color)), step = _mm_set1_epi32(4);
+  __m128i best = _mm_set1_epi32(INT32_MAX), best_index = _mm_setzero_si128(), index = _mm_add_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32((int)start)), d_rg, d_ba, dist, closer,
+          holds_min;
+  size_t i;
+
+  for (i = start; i + 4 <= end; i += 4) {
+    d_rg = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(palette->rg + i)), q_rg);
+    d_ba = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(palette->ba + i)), q_ba);
+    dist = _mm_add_epi32(_mm_madd_epi16(d_rg, d_rg), _mm_madd_epi16(d_ba, d_ba));
+    closer = _mm_cmplt_epi32(dist, best);
+    best = _mm_or_si128(_mm_and_si128(closer, dist), _mm_andnot_si128(closer, best));
+    best_index = _mm_or_si128(_mm_and_si128(closer, index), _mm_andnot_si128(closer, best_index));
+    index = _mm_add_epi32(index, step);
+  }
+
+  if (i == start) {
+    return nearest_finish(UINT32_MAX, end, palette, i, end, color, out_dist);
+  }
+
+  dist = hmin_epi32_sse(best);
+  holds_min = _mm_cmpeq_epi32(best, dist);
+  best_index = hmin_epi32_sse(_mm_or_si128(_mm_and_si128(holds_min, best_index), _mm_andnot_si128(holds_min, _mm_set1_epi32(INT32_MAX))));
+
+  return nearest_finish((uint32_t)_mm_cvtsi128_si32(dist), (size_t)_mm_cvtsi128_si32(best_index), palette, i, end, color, out_dist);
+}
+
+#endif
+
+#if defined(SNAP_KERNEL_AVX2)
+
+static SIMD_TARGET_AVX2 size_t nearest_avx2(const simd_palette_t *palette, size_t start, size_t end, uint32_t color, uint32_t *out_dist) {
+  const __m256i q_rg = _mm256_set1_epi32((int)pair_rg(color)), q_ba = _mm256_set1_epi32((int)pair_ba(color)), step = _mm256_set1_epi32(8);
+  __m256i best = _mm256_set1_epi32(INT32_MAX), best_index = _mm256_setzero_si256(), index = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)start)), d_rg, d_ba,
+          dist, closer;
+  size_t i;
+
+  for (i = start; i + 8 <= end; i += 8) {
+    d_rg = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i *)(palette->rg + i)), q_rg);
+    d_ba = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i *)(palette->ba + i)), q_ba);
+    dist = _mm256_add_epi32(_mm256_madd_epi16(d_rg, d_rg), _mm256_madd_epi16(d_ba, d_ba));
+    closer = _mm256_cmpgt_epi32(best, dist);
+    best = _mm256_blendv_epi8(best, dist, closer);
+    best_index = _mm256_blendv_epi8(best_index, index, closer);
+    index = _mm256_add_epi32(index, step);
+  }
+
+  if (i == start) {
+    return nearest_finish(UINT32_MAX, end, palette, i, end, color, out_dist);
+  }
+
+  dist = _mm256_min_epi32(best, _mm256_permute2x128_si256(best, best, 1));
+  dist = _mm256_min_epi32(dist, _mm256_shuffle_epi32(dist, _MM_SHUFFLE(1, 0, 3, 2)));
+  dist = _mm256_min_epi32(dist, _mm256_shuffle_epi32(dist, _MM_SHUFFLE(2, 3, 0, 1)));
+  best_index = _mm256_blendv_epi8(_mm256_set1_epi32(INT32_MAX), best_index, _mm256_cmpeq_epi32(best, dist));
+  best_index = _mm256_min_epi32(best_index, _mm256_permute2x128_si256(best_index, best_index, 1));
+  best_index = _mm256_min_epi32(best_index, _mm256_shuffle_epi32(best_index, _MM_SHUFFLE(1, 0, 3, 2)));
+  best_index = _mm256_min_epi32(best_index, _mm256_shuffle_epi32(best_index, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return nearest_finish((uint32_t)_mm256_cvtsi256_si32(dist), (size_t)_mm256_cvtsi256_si32(best_index), palette, i, end, color, out_dist);
+}
+
+#endif
+
+#if defined(SNAP_KERNEL_NEON)
+
+static size_t nearest_neon(const simd_palette_t *palette, size_t start, size_t end, uint32_t color, uint32_t *out_dist) {
+  const int32_t lanes[4] = {0, 1, 2, 3};
+  const int16x8_t q_rg = vreinterpretq_s16_u32(vdupq_n_u32(pair_rg(color))), q_ba = vreinterpretq_s16_u32(vdupq_n_u32(pair_ba(color)));
+  int32x4_t best = vdupq_n_s32(INT32_MAX), best_index = vdupq_n_s32(0), index = vaddq_s32(vld1q_s32(lanes), vdupq_n_s32((int32_t)start)), dist;
+  int16x8_t d_rg, d_ba;
+  uint32x4_t closer;
+  int32_t min_dist;
+  size_t i;
+
+  for (i = start; i + 4 <= end; i += 4) {
+    d_rg = vsubq_s16(vreinterpretq_s16_u32(vld1q_u32(palette->rg + i)), q_rg);
+    d_ba = vsubq_s16(vreinterpretq_s16_u32(vld1q_u32(palette->ba + i)), q_ba);
+    dist = vaddq_s32(vpaddq_s32(vmull_s16(vget_low_s16(d_rg), vget_low_s16(d_rg)), vmull_high_s16(d_rg, d_rg)),
+                     vpaddq_s32(vmull_s16(vget_low_s16(d_ba), vget_low_s16(d_ba)), vmull_high_s16(d_ba, d_ba)));
+    closer = vcltq_s32(dist, best);
+    best = vbslq_s32(closer, dist, best);
+    best_index = vbslq_s32(closer, index, best_index);
+    index = vaddq_s32(index, vdupq_n_s32(4));
+  }
+
+  if (i == start) {
+    return nearest_finish(UINT32_MAX, end, palette, i, end, color, out_dist);
+  }
+
+  min_dist = vminvq_s32(best);
+
+  return nearest_finish((uint32_t)min_dist, (size_t)vminvq_s32(vbslq_s32(vceqq_s32(best, vdupq_n_s32(min_dist)), best_index, vdupq_n_s32(INT32_MAX))), palette, i, end, color, out_dist);
+}
+
+#endif
+
+#if defined(CPRES_SIMD_WASM128)
+
+static size_t nearest_wasm(const simd_palette_t *palette, size_t start, size_t end, uint32_t color, uint32_t *out_dist) {
+  const v128_t q_rg = wasm_i32x4_splat((int32_t)pair_rg(color)), q_ba = wasm_i32x4_splat((int32_t)pair_ba(color)), step = wasm_i32x4_splat(4);
+  v128_t best = wasm_i32x4_splat(INT32_MAX), best_index = wasm_i32x4_splat(0), index = wasm_i32x4_add(wasm_i32x4_make(0, 1, 2, 3), wasm_i32x4_splat((int32_t)start)), d_rg, d_ba, dist, closer;
+  size_t i;
+
+  for (i = start; i + 4 <= end; i += 4) {
+    d_rg = wasm_i16x8_sub(wasm_v128_load(palette->rg + i), q_rg);
+    d_ba = wasm_i16x8_sub(wasm_v128_load(palette->ba + i), q_ba);
+    dist = wasm_i32x4_add(wasm_i32x4_dot_i16x8(d_rg, d_rg), wasm_i32x4_dot_i16x8(d_ba, d_ba));
+    closer = wasm_i32x4_lt(dist, best);
+    best = wasm_v128_bitselect(dist, best, closer);
+    best_index = wasm_v128_bitselect(index, best_index, closer);
+    index = wasm_i32x4_add(index, step);
+  }
+
+  if (i == start) {
+    return nearest_finish(UINT32_MAX, end, palette, i, end, color, out_dist);
+  }
+
+  dist = wasm_i32x4_min(best, wasm_i32x4_shuffle(best, best, 2, 3, 0, 1));
+  dist = wasm_i32x4_min(dist, wasm_i32x4_shuffle(dist, dist, 1, 0, 3, 2));
+  best_index = wasm_v128_bitselect(best_index, wasm_i32x4_splat(INT32_MAX), wasm_i32x4_eq(best, dist));
+  best_index = wasm_i32x4_min(best_index, wasm_i32x4_shuffle(best_index, best_index, 2, 3, 0, 1));
+  best_index = wasm_i32x4_min(best_index, wasm_i32x4_shuffle(best_index, best_index, 1, 0, 3, 2));
+
+  return nearest_finish((uint32_t)wasm_i32x4_extract_lane(dist, 0), (size_t)wasm_i32x4_extract_lane(best_index, 0), palette, i, end, color, out_dist);
+}
+
+#endif
+
+typedef struct {
+  size_t (*block)(uint8_t *rgba, size_t pixel_count, float levels_rgb, float levels_alpha);
+  void (*pixel)(uint8_t *pixel, float levels_rgb, float levels_alpha);
+  size_t (*nearest)(const simd_palette_t *palette, size_t start, size_t end, uint32_t color, uint32_t *out_dist);
+} simd_kernels_t;
+
+static size_t snap_block_none(uint8_t *rgba, size_t pixel_count, float levels_rgb, float levels_alpha) {
+  (void)rgba;
+  (void)pixel_count;
+  (void)levels_rgb;
+  (void)levels_alpha;
+
+  return 0;
+}
+
+/* Indexed by cpres_simd_level_t. Levels this build has no kernel for fall back to scalar, which covers 32-bit NEON. */
+static const simd_kernels_t kKernels[] = {
+    {snap_block_none, snap_pixel_scalar, nearest_scalar},
+#if defined(CPRES_SIMD_SSE41) || defined(CPRES_SIMD_SSE2)
+    {snap_block_sse, snap_pixel_sse, nearest_sse},
+#else
+    {snap_block_none, snap_pixel_scalar, nearest_scalar},
+#endif
+#if defined(SNAP_KERNEL_SSE41)
+    {snap_block_sse41, snap_pixel_sse41, nearest_sse},
+#else
+    {snap_block_none, snap_pixel_scalar, nearest_scalar},
+#endif
+#if defined(SNAP_KERNEL_AVX2)
+    {snap_block_avx2, snap_pixel_avx2, nearest_avx2},
+#else
+    {snap_block_none, snap_pixel_scalar, nearest_scalar},
+#endif
+#if defined(SNAP_KERNEL_NEON)
+    {snap_block_neon, snap_pixel_neon, nearest_neon},
+#else
+    {snap_block_none, snap_pixel_scalar, nearest_scalar},
+#endif
+#if defined(CPRES_SIMD_WASM128)
+    {snap_block_wasm, snap_pixel_wasm, nearest_wasm},
+#else
+    {snap_block_none, snap_pixel_scalar, nearest_scalar},
+#endif
+};
+
+static volatile int32_t g_detected_level = -1;
+static volatile int32_t g_active_level = -1;
+
+static cpres_simd_level_t detect_level(void) {
+#if defined(CPRES_SIMD_X86_DISPATCH) && defined(_MSC_VER)
+  int info[4], max_leaf;
+  bool sse41, os_avx;
+
+  __cpuid(info, 0);
+  max_leaf = info[0];
+  __cpuid(info, 1);
+  sse41 = (info[2] & (1 << 19)) != 0;
+  /* OSXSAVE and AVX, then XCR0 to confirm the OS saves the YMM state across context switches. */
+  os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+  if (os_avx && max_leaf >= 7) {
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 5)) != 0) {
+      return CPRES_SIMD_LEVEL_AVX2;
+    }
+  }
+
+  return sse41 ? CPRES_SIMD_LEVEL_SSE41 : CPRES_SIMD_LEVEL_SSE2;
+#elif defined(CPRES_SIMD_X86_DISPATCH)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return CPRES_SIMD_LEVEL_AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return CPRES_SIMD_LEVEL_SSE41;
+  }
+
+  return CPRES_SIMD_LEVEL_SSE2;
+#elif defined(CPRES_SIMD_AVX2)
+  return CPRES_SIMD_LEVEL_AVX2;
+#elif defined(CPRES_SIMD_SSE41)
+  return CPRES_SIMD_LEVEL_SSE41;
+#elif defined(CPRES_SIMD_SSE2)
+  return CPRES_SIMD_LEVEL_SSE2;
+#elif defined(CPRES_SIMD_NEON)
+  return CPRES_SIMD_LEVEL_NEON;
+#elif defined(CPRES_SIMD_WASM128)
+  return CPRES_SIMD_LEVEL_WASM128;
+#else
+  return CPRES_SIMD_LEVEL_NONE;
+#endif
+}
+
+cpres_simd_level_t simd_detected_level(void) {
+  int32_t level = colopresso_atomic_load_i32(&g_detected_level);
+
+  /* Detection is idempotent, so two threads racing here store the same value. */
+  if (level < 0) {
+    level = (int32_t)detect_level();
+    colopresso_atomic_store_i32(&g_detected_level, level);
+  }
+
+  return (cpres_simd_level_t)level;
+}
+
+static inline int32_t active_level(void) {
+  int32_t level = colopresso_atomic_load_i32(&g_active_level);
+
+  if (level < 0) {
+    level = (int32_t)simd_detected_level();
+    colopresso_atomic_store_i32(&g_active_level, level);
+  }
+
+  return level;
+}
+
+bool simd_force_level(cpres_simd_level_t level) {
+  cpres_simd_level_t detected = simd_detected_level();
+  bool supported = level == CPRES_SIMD_LEVEL_NONE || level == detected;
+
+#if defined(CPRES_SIMD_X86_DISPATCH)
+  supported = supported || (level >= CPRES_SIMD_LEVEL_SSE2 && level <= detected);
+#endif
+
+  if (!supported) {
+    return false;
+  }
+
+  colopresso_atomic_store_i32(&g_active_level, (int32_t)level);
+  return true;
+}
+
+extern const char *cpres_simd_level_string(cpres_simd_level_t level) {
+  switch (level) {
+  case CPRES_SIMD_LEVEL_SSE2:
+    return "sse2";
+  case CPRES_SIMD_LEVEL_SSE41:
+    return "sse4.1";
+  case CPRES_SIMD_LEVEL_AVX2:
+    return "avx2";
+  case CPRES_SIMD_LEVEL_NEON:
+    return "neon";
+  case CPRES_SIMD_LEVEL_WASM128:
+    return "wasm128";
+  case CPRES_SIMD_LEVEL_NONE:
+  default:
+    return "scalar";
+  }
+}
+
+extern cpres_simd_level_t cpres_get_simd_level(void) { return (cpres_simd_level_t)active_level(); }
+
+void simd_snap_rgba_bits(uint8_t *rgba, size_t pixel_count, uint8_t bits_rgb, uint8_t bits_alpha) {
+  float levels_rgb = snap_levels(bits_rgb), levels_alpha = snap_levels(bits_alpha);
+  size_t i;
+
+  if (!rgba) {
+    return;
+  }
+
+  i = kKernels[active_level()].block(rgba, pixel_count, levels_rgb, levels_alpha);
+  for (; i < pixel_count; ++i) {
+    snap_pixel_scalar(rgba + i * 4, levels_rgb, levels_alpha);
+  }
+}
+
+void simd_snap_rgba_pixel(uint8_t *pixel, uint8_t bits_rgb, uint8_t bits_alpha) { kKernels[active_level()].pixel(pixel, snap_levels(bits_rgb), snap_levels(bits_alpha)); }
+
+bool simd_palette_init(simd_palette_t *palette, const uint32_t *colors, size_t count) {
+  size_t i;
+
+  if (!palette) {
+    return false;
+  }
+
+  palette->rg = NULL;
+  palette->ba = NULL;
+  palette->count = 0;
+  if (!colors || count == 0) {
+    return count == 0;
+  }
+
+  palette->rg = (uint32_t *)malloc(sizeof(uint32_t) * count);
+  palette->ba = (uint32_t *)malloc(sizeof(uint32_t) * count);
+  if (!palette->rg || !palette->ba) {
+    simd_palette_free(palette);
+    return false;
+  }
+
+  for (i = 0; i < count; ++i) {
+    palette->rg[i] = pair_rg(colors[i]);
+    palette->ba[i] = pair_ba(colors[i]);
+  }
+  palette->count = count;
+
+  return true;
+}
+
+void simd_palette_free(simd_palette_t *palette) {
+  if (!palette) {
+    return;
+  }
+
+  free(palette->rg);
+  free(palette->ba);
+  palette->rg = NULL;
+  palette->ba = NULL;
+  palette->count = 0;
+}
+
+size_t simd_palette_nearest(const simd_palette_t *palette, size_t start, size_t end, uint32_t color, uint32_t *out_dist) {
+  if (!palette || end > palette->count) {
+    end = palette ? palette->count : 0;
+  }
+
+  if (start >= end) {
+    if (out_dist) {
+      *out_dist = UINT32_MAX;
+    }
+    return end;
+  }
+
+  return kKernels[active_level()].nearest(palette, start, end, color, out_dist);
+}
@@ -19,23 +19,167 @@
 
 #include <stdlib.h>
 
-typedef struct {
+#define THREAD_POOL_MAX_WORKERS 256
+#define THREAD_POOL_CHUNKS_PER_THREAD 4
+
+typedef struct thread_pool_job {
   parallel_func_t func;
   void *context;
-  uint32_t start_index;
-  uint32_t end_index;
-} thread_work_t;
+  uint32_t total_items;
+  uint32_t chunk_size;
+  uint32_t next_index;
+  uint32_t completed_items;
+  uint32_t participants;
+  uint32_t max_participants;
+  struct thread_pool_job *next;
+} thread_pool_job_t;
+
+typedef struct {
+  colopresso_mutex_t mutex;
+  colopresso_cond_t work_cond;
+  colopresso_cond_t done_cond;
+  colopresso_thread_t *threads;
+  uint32_t worker_count;
+  uint32_t worker_capacity;
+  thread_pool_job_t *head;
+  thread_pool_job_t *tail;
+  bool shutdown;
+} thread_pool_t;
+
+static thread_pool_t g_thread_pool;
+static colopresso_once_t g_thread_pool_once = COLOPRESSO_ONCE_INIT;
+
+static void thread_pool_init_once(void) {
+  colopresso_mutex_init(&g_thread_pool.mutex, NULL);
+  colopresso_cond_init(&g_thread_pool.work_cond, NULL);
+  colopresso_cond_init(&g_thread_pool.done_cond, NULL);
+  g_thread_pool.threads = NULL;
+  g_thread_pool.worker_count = 0;
+  g_thread_pool.worker_capacity = 0;
+  g_thread_pool.head = NULL;
+  g_thread_pool.tail = NULL;
+  g_thread_pool.shutdown = false;
+}
+
+static inline void thread_pool_unlink_job(thread_pool_job_t *job) {
+  thread_pool_job_t *prev = NULL, *cur;
+
+  for (cur = g_thread_pool.head; cur; prev = cur, cur = cur->next) {
+    if (cur != job) {
+      continue;
+    }
+    if (prev) {
+      prev->next = cur->next;
+    } else {
+      g_thread_pool.head = cur->next;
+    }
+    if (g_thread_pool.tail == cur) {
+      g_thread_pool.tail = prev;
+    }
+    cur->next = NULL;
+    return;
+  }
+}
+
+static inline bool thread_pool_claim_chunk(thread_pool_job_t *job, uint32_t *start, uint32_t *end) {
+  uint32_t remaining;
+
+  if (job->next_index >= job->total_items) {
+    return false;
+  }
+
+  remaining = job->total_items - job->next_index;
+  *start = job->next_index;
+  *end = *start + (remaining < job->chunk_size ? remaining : job->chunk_size);
+  job->next_index = *end;
+
+  if (job->next_index >= job->total_items) {
+    thread_pool_unlink_job(job);
+  }
 
-static void *thread_worker(void *arg) {
-  thread_work_t *work = (thread_work_t *)arg;
+  return true;
+}
+
+static inline void thread_pool_complete_chunk(thread_pool_job_t *job, uint32_t start, uint32_t end) {
+  job->completed_items += end - start;
+  if (job->completed_items >= job->total_items) {
+    colopresso_cond_broadcast(&g_thread_pool.done_cond);
+  }
+}
+
+static inline thread_pool_job_t *thread_pool_find_job(void) {
+  thread_pool_job_t *job;
+
+  for (job = g_thread_pool.head; job; job = job->next) {
+    if (job->next_index < job->total_items && job->participants < job->max_participants) {
+      return job;
+    }
+  }
+
+  return NULL;
+}
+
+static void *thread_pool_worker(void *arg) {
+  thread_pool_job_t *job;
+  uint32_t start, end;
+
+  (void)arg;
+
+  colopresso_mutex_lock(&g_thread_pool.mutex);
+  for (;;) {
+    job = NULL;
+    while (!g_thread_pool.shutdown && (job = thread_pool_find_job()) == NULL) {
+      colopresso_cond_wait(&g_thread_pool.work_cond, &g_thread_pool.mutex);
+    }
+    if (g_thread_pool.shutdown) {
+      break;
+    }
 
-  if (work && work->func) {
-    work->func(work->context, work->start_index, work->end_index);
+    ++job->participants;
+    while (!g_thread_pool.shutdown && thread_pool_claim_chunk(job, &start, &end)) {
+      colopresso_mutex_unlock(&g_thread_pool.mutex);
+      job->func(job->context, start, end);
+      colopresso_mutex_lock(&g_thread_pool.mutex);
+      thread_pool_complete_chunk(job, start, end);
+    }
+    --job->participants;
   }
+  colopresso_mutex_unlock(&g_thread_pool.mutex);
 
   return NULL;
 }
 
+static inline void thread_pool_ensure_workers(uint32_t wanted) {
+  colopresso_thread_t *threads;
+  int rc;
+
+  if (g_thread_pool.shutdown) {
+    return;
+  }
+
+  if (wanted > THREAD_POOL_MAX_WORKERS) {
+    wanted = THREAD_POOL_MAX_WORKERS;
+  }
+
+  if (wanted > g_thread_pool.worker_capacity) {
+    threads = (colopresso_thread_t *)realloc(g_thread_pool.threads, sizeof(colopresso_thread_t) * wanted);
+    if (!threads) {
+      return;
+    }
+    g_thread_pool.threads = threads;
+    g_thread_pool.worker_capacity = wanted;
+  }
+
+  while (g_thread_pool.worker_count < wanted) {
+    rc = colopresso_thread_create(&g_thread_pool.threads[g_thread_pool.worker_count], NULL, thread_pool_worker, NULL);
+    if (rc != 0) {
+      colopresso_log(CPRES_LOG_LEVEL_WARNING, "Threads: colopresso_thread_create failed (rc=%d) - continuing with %u pool workers", rc, g_thread_pool.worker_count);
+      return;
+    }
+    ++g_thread_pool.worker_count;
+  }
+}
+
 uint32_t cpres_get_default_thread_count(void) {
   uint32_t cpu_count = colopresso_get_cpu_count();
   uint32_t half = (uint32_t)(cpu_count / 2);
@@ -47,12 +191,39 @@ uint32_t cpres_get_max_thread_count(void) { return colopresso_get_cpu_count(); }
 
 bool cpres_is_threads_enabled(void) { return true; }
 
-bool colopresso_parallel_for(uint32_t use_threads, uint32_t total_items, parallel_func_t func, void *context) {
+void cpres_thread_pool_shutdown(void) {
   colopresso_thread_t *threads;
-  thread_work_t *works;
-  uint32_t thread_count, chunk_size, remainder, start, end, i;
-  int rc;
-  bool success = true;
+  uint32_t worker_count, i;
+
+  colopresso_once(&g_thread_pool_once, thread_pool_init_once);
+
+  colopresso_mutex_lock(&g_thread_pool.mutex);
+  if (g_thread_pool.worker_count == 0) {
+    colopresso_mutex_unlock(&g_thread_pool.mutex);
+    return;
+  }
+  threads = g_thread_pool.threads;
+  worker_count = g_thread_pool.worker_count;
+  g_thread_pool.threads = NULL;
+  g_thread_pool.worker_count = 0;
+  g_thread_pool.worker_capacity = 0;
+  g_thread_pool.shutdown = true;
+  colopresso_cond_broadcast(&g_thread_pool.work_cond);
+  colopresso_mutex_unlock(&g_thread_pool.mutex);
+
+  for (i = 0; i < worker_count; ++i) {
+    colopresso_thread_join(threads[i], NULL);
+  }
+  free(threads);
+
+  colopresso_mutex_lock(&g_thread_pool.mutex);
+  g_thread_pool.shutdown = false;
+  colopresso_mutex_unlock(&g_thread_pool.mutex);
+}
+
+bool colopresso_parallel_for(uint32_t use_threads, uint32_t total_items, parallel_func_t func, void *context) {
+  thread_pool_job_t job;
+  uint32_t thread_count, chunk_count, start, end;
 
   if (!func || total_items == 0) {
     return false;
@@ -68,51 +239,45 @@ bool colopresso_parallel_for(uint32_t use_threads, uint32_t total_items, paralle
     return true;
   }
 
-  threads = (colopresso_thread_t *)malloc(sizeof(colopresso_thread_t) * thread_count);
-  works = (thread_work_t *)malloc(sizeof(thread_work_t) * thread_count);
-  if (!threads || !works) {
-    free(threads);
-    free(works);
-    func(context, 0, total_items);
+  colopresso_once(&g_thread_pool_once, thread_pool_init_once);
 
-    return true;
+  chunk_count = thread_count * THREAD_POOL_CHUNKS_PER_THREAD;
+  if (chunk_count > total_items) {
+    chunk_count = total_items;
   }
 
-  chunk_size = total_items / thread_count;
-  remainder = total_items % thread_count;
-  start = 0;
-
-  for (i = 0; i < thread_count; ++i) {
-    end = start + chunk_size;
-    if (i < remainder) {
-      ++end;
-    }
-
-    works[i].func = func;
-    works[i].context = context;
-    works[i].start_index = start;
-    works[i].end_index = end;
-
-    rc = colopresso_thread_create(&threads[i], NULL, thread_worker, &works[i]);
-    if (rc != 0) {
-      colopresso_log(CPRES_LOG_LEVEL_WARNING, "Threads: colopresso_thread_create failed (rc=%d) - falling back to inline execution", rc);
-      works[i].func(works[i].context, works[i].start_index, works[i].end_index);
-      threads[i] = (colopresso_thread_t)NULL;
-    }
-
-    start = end;
+  job.func = func;
+  job.context = context;
+  job.total_items = total_items;
+  job.chunk_size = (total_items + chunk_count - 1) / chunk_count;
+  job.next_index = 0;
+  job.completed_items = 0;
+  job.participants = 1;
+  job.max_participants = thread_count;
+  job.next = NULL;
+
+  colopresso_mutex_lock(&g_thread_pool.mutex);
+  thread_pool_ensure_workers(thread_count - 1);
+  if (g_thread_pool.tail) {
+    g_thread_pool.tail->next = &job;
+  } else {
+    g_thread_pool.head = &job;
   }
-
-  for (i = 0; i < thread_count; ++i) {
-    if (threads[i] != (colopresso_thread_t)NULL) {
-      colopresso_thread_join(threads[i], NULL);
-    }
+  g_thread_pool.tail = &job;
+  colopresso_cond_broadcast(&g_thread_pool.work_cond);
+
+  while (thread_pool_claim_chunk(&job, &start, &end)) {
+    colopresso_mutex_unlock(&g_thread_pool.mutex);
+    func(context, start, end);
+    colopresso_mutex_lock(&g_thread_pool.mutex);
+    thread_pool_complete_chunk(&job, start, end);
   }
+  while (job.completed_items < job.total_items) {
+    colopresso_cond_wait(&g_thread_pool.done_cond, &g_thread_pool.mutex);
+  }
+  colopresso_mutex_unlock(&g_thread_pool.mutex);
 
-  free(threads);
-  free(works);
-
-  return success;
+  return true;
 }
 
 #else
@@ -120,6 +285,7 @@ bool colopresso_parallel_for(uint32_t use_threads, uint32_t total_items, paralle
 uint32_t cpres_get_default_thread_count(void) { return 1; }
 uint32_t cpres_get_max_thread_count(void) { return 1; }
 bool cpres_is_threads_enabled(void) { return false; }
+void cpres_thread_pool_shutdown(void) {}
 
 bool colopresso_parallel_for(uint32_t use_threads, uint32_t total_items, parallel_func_t func, void *context) {
   if (!func || total_items == 0) {
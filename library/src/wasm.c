@@ -20,10 +20,11 @@ typedef enum {
   PNGX_BRIDGE_RESULT_GENERIC_ERROR = 1,
   PNGX_BRIDGE_RESULT_INVALID_INPUT = 2,
   PNGX_BRIDGE_RESULT_OPTIMIZATION_FAILED = 3,
+  PNGX_BRIDGE_RESULT_CANCELLED = 4,
   PNGX_BRIDGE_RESULT_WASM_SEPARATION = 100
 } PngxBridgeResult;
 
-typedef enum { PNGX_BRIDGE_QUANT_OK = 0, PNGX_BRIDGE_QUANT_QUALITY_TOO_LOW = 1, PNGX_BRIDGE_QUANT_ERROR = 2, PNGX_BRIDGE_QUANT_WASM_SEPARATION = 100 } PngxBridgeQuantStatus;
+typedef enum { PNGX_BRIDGE_QUANT_OK = 0, PNGX_BRIDGE_QUANT_QUALITY_TOO_LOW = 1, PNGX_BRIDGE_QUANT_ERROR = 2, PNGX_BRIDGE_QUANT_CANCELLED = 3, PNGX_BRIDGE_QUANT_WASM_SEPARATION = 100 } PngxBridgeQuantStatus;
 
 typedef struct {
   uint8_t r, g, b, a;
@@ -33,6 +34,8 @@ typedef struct {
   int32_t optimization_level;
   bool strip_safe;
   bool optimize_alpha;
+  const int32_t *cancel_flag;
+  uint32_t thread_count;
 } PngxBridgeLosslessOptions;
 
 typedef struct {
@@ -47,6 +50,8 @@ typedef struct {
   size_t importance_map_len;
   const cpres_rgba_color_t *fixed_colors;
   size_t fixed_colors_len;
+  const int32_t *cancel_flag;
+  uint32_t thread_count;
 } PngxBridgeQuantParams;
 
 typedef struct {
@@ -68,16 +73,44 @@ PngxBridgeResult pngx_bridge_optimize_lossless(const uint8_t *input_data, size_t
   return PNGX_BRIDGE_RESULT_WASM_SEPARATION;
 }
 
-PngxBridgeQuantStatus pngx_bridge_quantize(const cpres_rgba_color_t *pixels, size_t pixel_count, uint32_t width, uint32_t height, const PngxBridgeQuantParams *params, PngxBridgeQuantOutput *output) {
+PngxBridgeResult pngx_bridge_optimize_indexed(const uint8_t *indices, size_t indices_len, uint32_t width, uint32_t height, const cpres_rgba_color_t *palette, size_t palette_len, uint8_t **output_data,
+                                              size_t *output_size, const PngxBridgeLosslessOptions *options) {
+  (void)indices;
+  (void)indices_len;
+  (void)width;
+  (void)height;
+  (void)palette;
+  (void)palette_len;
+  (void)options;
+  if (output_data)
+    *output_data = NULL;
+  if (output_size)
+    *output_size = 0;
+  return PNGX_BRIDGE_RESULT_WASM_SEPARATION;
+}
+
+PngxBridgeResult pngx_bridge_optimize_rgba(const uint8_t *rgba, uint32_t width, uint32_t height, size_t stride, uint8_t **output_data, size_t *output_size, const PngxBridgeLosslessOptions *options) {
+  (void)rgba;
+  (void)width;
+  (void)height;
+  (void)stride;
+  (void)options;
+  if (output_data)
+    *output_data = NULL;
+  if (output_size)
+    *output_size = 0;
+  return PNGX_BRIDGE_RESULT_WASM_SEPARATION;
+}
+
+PngxBridgeQuantStatus pngx_bridge_quantize_into(const cpres_rgba_color_t *pixels, size_t pixel_count, uint32_t width, uint32_t height, const PngxBridgeQuantParams *params,
+                                                PngxBridgeQuantOutput *output) {
   (void)pixels;
   (void)pixel_count;
   (void)width;
   (void)height;
   (void)params;
   if (output) {
-    output->palette = NULL;
     output->palette_len = 0;
-    output->indices = NULL;
     output->indices_len = 0;
     output->quality = -1;
   }
@@ -20,6 +20,7 @@
 
 #include <colopresso.h>
 
+#include "internal/cancel.h"
 #include "internal/log.h"
 #include "internal/webp.h"
 
@@ -57,31 +58,191 @@ static void apply_webp_config(WebPConfig *webp_config, const cpres_config_t *con
   webp_config->lossless = config->webp_lossless;
 }
 
+bool webp_prepare_config(WebPConfig *webp_config, const cpres_config_t *config) {
+  if (!webp_config || !config) {
+    return false;
+  }
+
+  memset(webp_config, 0, sizeof(*webp_config));
+
+  if (!WebPConfigPreset(webp_config, WEBP_PRESET_DEFAULT, config->webp_quality)) {
+    return false;
+  }
+
+  apply_webp_config(webp_config, config);
+
+  return WebPValidateConfig(webp_config) != 0;
+}
+
 cpres_error_t webp_encode_rgba_to_memory(uint8_t *rgba_data, uint32_t width, uint32_t height, uint8_t **webp_data, size_t *webp_size, const cpres_config_t *config) {
   WebPConfig webp_config;
-  WebPPicture picture;
-  WebPMemoryWriter writer;
 
   if (!rgba_data || !webp_data || !webp_size || !config) {
     return CPRES_ERROR_INVALID_PARAMETER;
   }
 
-  memset(&webp_config, 0, sizeof(webp_config));
-  memset(&picture, 0, sizeof(picture));
-  memset(&writer, 0, sizeof(writer));
-
   colopresso_log(CPRES_LOG_LEVEL_DEBUG, "Starting WebP encoding to memory - %dx%d pixels", width, height);
 
-  if (!WebPConfigPreset(&webp_config, WEBP_PRESET_DEFAULT, config->webp_quality)) {
+  if (!webp_prepare_config(&webp_config, config)) {
     return CPRES_ERROR_INVALID_PARAMETER;
   }
 
-  apply_webp_config(&webp_config, config);
+  return webp_encode_rgba_with_config(rgba_data, width, height, width * 4, webp_data, webp_size, &webp_config, config);
+}
+
+typedef struct {
+  cpres_write_callback_t write;
+  void *user_data;
+  size_t written;
+  bool write_failed;
+} webp_stream_t;
+
+typedef struct {
+  uint8_t *data;
+  size_t size;
+  size_t capacity;
+} webp_buffer_t;
+
+static int webp_stream_write(const uint8_t *data, size_t data_size, const WebPPicture *picture) {
+  webp_stream_t *stream = (webp_stream_t *)picture->custom_ptr;
+
+  if (data_size == 0) {
+    return 1;
+  }
+
+  if (!stream->write(data, data_size, stream->user_data)) {
+    stream->write_failed = true;
+    return 0;
+  }
+
+  stream->written += data_size;
+
+  return 1;
+}
+
+static int webp_progress_hook(int percent, const WebPPicture *picture) {
+  const cpres_config_t *config = (const cpres_config_t *)picture->user_data;
+
+  if (cancel_requested(config)) {
+    return 0;
+  }
+
+  cancel_report_progress(config->progress_callback, config->progress_user_data, (float)percent / 100.0f);
+
+  return 1;
+}
+
+static bool webp_buffer_append(const uint8_t *data, size_t size, void *user_data) {
+  webp_buffer_t *buffer = (webp_buffer_t *)user_data;
+  uint8_t *grown;
+  size_t capacity;
+
+  if (size > SIZE_MAX - buffer->size) {
+    return false;
+  }
+
+  if (buffer->size + size > buffer->capacity) {
+    capacity = buffer->capacity ? buffer->capacity : 64 * 1024;
+    while (capacity < buffer->size + size) {
+      capacity = capacity > SIZE_MAX / 2 ? buffer->size + size : capacity * 2;
+    }
+
+    grown = (uint8_t *)realloc(buffer->data, capacity);
+    if (!grown) {
+      return false;
+    }
+
+    buffer->data = grown;
+    buffer->capacity = capacity;
+  }
+
+  memcpy(buffer->data + buffer->size, data, size);
+  buffer->size += size;
+
+  return true;
+}
+
+static cpres_error_t webp_encode_picture_to_writer(WebPPicture *picture, cpres_write_callback_t write, void *user_data, size_t *written_size, const WebPConfig *webp_config,
+                                                   const cpres_config_t *config) {
+  webp_stream_t stream;
+
+  stream.write = write;
+  stream.user_data = user_data;
+  stream.written = 0;
+  stream.write_failed = false;
+  picture->writer = webp_stream_write;
+  picture->custom_ptr = &stream;
+
+  /* libwebp calls the hook between its analysis, token and entropy passes, which is where a cancel takes effect. */
+  if (config && (config->cancel_token || config->progress_callback)) {
+    picture->progress_hook = webp_progress_hook;
+    picture->user_data = (void *)config;
+  }
+
+  if (cancel_requested(config)) {
+    return CPRES_ERROR_CANCELLED;
+  }
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "Starting WebP encoding (stream)...");
+
+  if (!WebPEncode(webp_config, picture)) {
+    webp_set_last_error(picture->error_code);
+    if (picture->error_code == VP8_ENC_ERROR_USER_ABORT && cancel_requested(config)) {
+      colopresso_log(CPRES_LOG_LEVEL_DEBUG, "WebP encoding cancelled after %zu bytes", stream.written);
+      return CPRES_ERROR_CANCELLED;
+    }
+    if (stream.write_failed) {
+      colopresso_log(CPRES_LOG_LEVEL_ERROR, "WebP encoding aborted by writer after %zu bytes", stream.written);
+      return CPRES_ERROR_IO;
+    }
+    colopresso_log(CPRES_LOG_LEVEL_ERROR, "WebP encoding failed - error code: %d", picture->error_code);
+    return CPRES_ERROR_ENCODE_FAILED;
+  }
+  webp_set_last_error(0);
+
+  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "WebP encoding successful - size: %zu bytes", stream.written);
+
+  if (written_size) {
+    *written_size = stream.written;
+  }
+
+  return CPRES_OK;
+}
+
+static cpres_error_t webp_finish_buffer(cpres_error_t error, webp_buffer_t *buffer, uint8_t **webp_data, size_t *webp_size) {
+  uint8_t *shrunk;
 
-  if (!WebPValidateConfig(&webp_config)) {
+  if (error != CPRES_OK) {
+    free(buffer->data);
+    return error == CPRES_ERROR_IO ? CPRES_ERROR_OUT_OF_MEMORY : error;
+  }
+
+  if (!buffer->data) {
+    return CPRES_ERROR_ENCODE_FAILED;
+  }
+
+  shrunk = (uint8_t *)realloc(buffer->data, buffer->size);
+  *webp_data = shrunk ? shrunk : buffer->data;
+  *webp_size = buffer->size;
+
+  return CPRES_OK;
+}
+
+cpres_error_t webp_encode_rgba_to_writer(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, cpres_write_callback_t write, void *user_data, size_t *written_size,
+                                         const WebPConfig *webp_config, const cpres_config_t *config) {
+  WebPPicture picture;
+  cpres_error_t error;
+
+  if (!rgba_data || !write || !webp_config) {
     return CPRES_ERROR_INVALID_PARAMETER;
   }
 
+  if (written_size) {
+    *written_size = 0;
+  }
+
+  memset(&picture, 0, sizeof(picture));
+
   if (!WebPPictureInit(&picture)) {
     return CPRES_ERROR_OUT_OF_MEMORY;
   }
@@ -90,40 +251,108 @@ cpres_error_t webp_encode_rgba_to_memory(uint8_t *rgba_data, uint32_t width, uin
   picture.height = (int)height;
   picture.use_argb = 1;
 
-  if (!WebPPictureImportRGBA(&picture, rgba_data, width * 4)) {
+  if (!WebPPictureImportRGBA(&picture, rgba_data, (int)stride)) {
     WebPPictureFree(&picture);
     return CPRES_ERROR_ENCODE_FAILED;
   }
 
-  WebPMemoryWriterInit(&writer);
-  picture.writer = WebPMemoryWrite;
-  picture.custom_ptr = &writer;
+  error = webp_encode_picture_to_writer(&picture, write, user_data, written_size, webp_config, config);
+  WebPPictureFree(&picture);
 
-  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "Starting WebP encoding (memory)...");
+  return error;
+}
 
-  if (!WebPEncode(&webp_config, &picture)) {
-    webp_set_last_error(picture.error_code);
-    colopresso_log(CPRES_LOG_LEVEL_ERROR, "WebP encoding failed - error code: %d", picture.error_code);
-    WebPMemoryWriterClear(&writer);
-    WebPPictureFree(&picture);
-    return CPRES_ERROR_ENCODE_FAILED;
+cpres_error_t webp_encode_rgba_with_config(const uint8_t *rgba_data, uint32_t width, uint32_t height, uint32_t stride, uint8_t **webp_data, size_t *webp_size, const WebPConfig *webp_config,
+                                           const cpres_config_t *config) {
+  webp_buffer_t buffer;
+  cpres_error_t error;
+
+  if (!rgba_data || !webp_data || !webp_size || !webp_config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
   }
-  webp_set_last_error(0);
 
-  colopresso_log(CPRES_LOG_LEVEL_DEBUG, "WebP encoding successful - size: %zu bytes", writer.size);
+  /* Grow a single buffer as the encoder emits bytes, rather than letting WebPMemoryWriter build one and copying it out again. */
+  memset(&buffer, 0, sizeof(buffer));
 
-  *webp_data = (uint8_t *)malloc(writer.size);
-  if (!*webp_data) {
-    WebPMemoryWriterClear(&writer);
-    WebPPictureFree(&picture);
+  error = webp_encode_rgba_to_writer(rgba_data, width, height, stride, webp_buffer_append, &buffer, NULL, webp_config, config);
+
+  return webp_finish_buffer(error, &buffer, webp_data, webp_size);
+}
+
+static cpres_error_t webp_rows_begin(void *context, png_uint_32 width, png_uint_32 height) {
+  WebPPicture *picture = (WebPPicture *)context;
+
+  if (!WebPPictureInit(picture)) {
     return CPRES_ERROR_OUT_OF_MEMORY;
   }
 
-  memcpy(*webp_data, writer.mem, writer.size);
-  *webp_size = writer.size;
+  picture->width = (int)width;
+  picture->height = (int)height;
+  picture->use_argb = 1;
 
-  WebPMemoryWriterClear(&writer);
-  WebPPictureFree(&picture);
+  return WebPPictureAlloc(picture) ? CPRES_OK : CPRES_ERROR_OUT_OF_MEMORY;
+}
+
+static cpres_error_t webp_rows_import(void *context, const uint8_t *rgba, png_uint_32 first_row, png_uint_32 row_count) {
+  WebPPicture *picture = (WebPPicture *)context;
+  const uint8_t *src;
+  uint32_t *dst;
+  png_uint_32 y;
+  int x;
+
+  /* Same packing WebPPictureImportRGBA uses for use_argb pictures, so the encoded bytes match the buffered path. */
+  for (y = 0; y < row_count; ++y) {
+    src = rgba + (size_t)y * (size_t)picture->width * 4;
+    dst = picture->argb + (size_t)(first_row + y) * (size_t)picture->argb_stride;
+    for (x = 0; x < picture->width; ++x, src += 4) {
+      dst[x] = ((uint32_t)src[3] << 24) | ((uint32_t)src[0] << 16) | ((uint32_t)src[1] << 8) | (uint32_t)src[2];
+    }
+  }
 
   return CPRES_OK;
 }
+
+cpres_error_t webp_encode_png_rows_to_writer(const png_row_input_t *input, cpres_write_callback_t write, void *user_data, size_t *written_size, const WebPConfig *webp_config,
+                                             const cpres_config_t *config) {
+  WebPPicture picture;
+  png_row_sink_t sink;
+  cpres_error_t error;
+
+  if (!input || !write || !webp_config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  if (written_size) {
+    *written_size = 0;
+  }
+
+  memset(&picture, 0, sizeof(picture));
+  sink.begin = webp_rows_begin;
+  sink.rows = webp_rows_import;
+  sink.context = &picture;
+
+  /* Rows land directly in the picture's ARGB plane, so no full RGBA copy of the image is ever held. */
+  error = png_decode_rows(input, &sink);
+  if (error == CPRES_OK) {
+    error = webp_encode_picture_to_writer(&picture, write, user_data, written_size, webp_config, config);
+  }
+
+  WebPPictureFree(&picture);
+
+  return error;
+}
+
+cpres_error_t webp_encode_png_rows_to_memory(const png_row_input_t *input, uint8_t **webp_data, size_t *webp_size, const WebPConfig *webp_config, const cpres_config_t *config) {
+  webp_buffer_t buffer;
+  cpres_error_t error;
+
+  if (!input || !webp_data || !webp_size || !webp_config) {
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  memset(&buffer, 0, sizeof(buffer));
+
+  error = webp_encode_png_rows_to_writer(input, webp_buffer_append, &buffer, NULL, webp_config, config);
+
+  return webp_finish_buffer(error, &buffer, webp_data, webp_size);
+}
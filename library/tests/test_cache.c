@@ -0,0 +1,242 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <colopresso.h>
+#include <colopresso/portable.h>
+
+#include <unity.h>
+
+#include "test.h"
+
+#define TEST_CACHE_DIR "test_cache_dir"
+
+static cpres_config_t g_config;
+
+#ifndef COLOPRESSO_DISABLE_FILE_OPS
+static bool remove_cache_entry(const char *name, bool is_directory, void *user_data) {
+  char path[512];
+
+  (void)user_data;
+
+  if (!is_directory && snprintf(path, sizeof(path), "%s/%s", TEST_CACHE_DIR, name) > 0) {
+    remove(path);
+  }
+
+  return true;
+}
+
+static void clear_cache_dir(void) {
+  if (colopresso_is_directory(TEST_CACHE_DIR)) {
+    colopresso_read_directory(TEST_CACHE_DIR, remove_cache_entry, NULL);
+  }
+}
+#endif
+
+void setUp(void) {
+  cpres_config_init_defaults(&g_config);
+  g_config.pngx_level = 1;
+#ifndef COLOPRESSO_DISABLE_FILE_OPS
+  clear_cache_dir();
+#endif
+}
+
+void tearDown(void) {
+#ifndef COLOPRESSO_DISABLE_FILE_OPS
+  clear_cache_dir();
+#endif
+  release_cached_example_png();
+}
+
+#ifndef COLOPRESSO_DISABLE_FILE_OPS
+void test_cache_miss_then_hit(void) {
+  cpres_cache_t *cache = NULL;
+  cpres_cache_stats_t stats;
+  const uint8_t *png_data = NULL;
+  uint8_t *first = NULL, *second = NULL;
+  size_t png_size = 0, first_size = 0, second_size = 0;
+  cpres_error_t first_error, second_error;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for cache test");
+
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_cache_open(TEST_CACHE_DIR, 0, &cache));
+
+  first_error = cpres_cache_encode_memory(cache, CPRES_FORMAT_PNGX, png_data, png_size, &first, &first_size, &g_config);
+  second_error = cpres_cache_encode_memory(cache, CPRES_FORMAT_PNGX, png_data, png_size, &second, &second_size, &g_config);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, first_error);
+  TEST_ASSERT_EQUAL_INT(first_error, second_error);
+  TEST_ASSERT_EQUAL_size_t(first_size, second_size);
+  TEST_ASSERT_EQUAL_MEMORY(first, second, first_size);
+
+  cpres_cache_get_stats(cache, &stats);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.hits);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.misses);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.stores);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.entries);
+
+  cpres_free(first);
+  cpres_free(second);
+  cpres_cache_close(cache);
+}
+
+void test_cache_persists_across_open(void) {
+  cpres_cache_t *cache = NULL;
+  cpres_cache_stats_t stats;
+  const uint8_t *png_data = NULL;
+  uint8_t *data = NULL;
+  size_t png_size = 0, size = 0;
+  cpres_error_t result;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for cache test");
+
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_cache_open(TEST_CACHE_DIR, 0, &cache));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_cache_encode_memory(cache, CPRES_FORMAT_PNGX, png_data, png_size, &data, &size, &g_config));
+  cpres_free(data);
+  cpres_cache_close(cache);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_cache_open(TEST_CACHE_DIR, 0, &cache));
+  TEST_ASSERT_TRUE(cpres_cache_lookup(cache, CPRES_FORMAT_PNGX, png_data, png_size, &g_config, &result, &data, &size));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, result);
+  TEST_ASSERT_NOT_NULL(data);
+  cpres_free(data);
+
+  g_config.pngx_level = 2;
+  TEST_ASSERT_FALSE(cpres_cache_lookup(cache, CPRES_FORMAT_PNGX, png_data, png_size, &g_config, &result, &data, &size));
+  TEST_ASSERT_FALSE(cpres_cache_lookup(cache, CPRES_FORMAT_WEBP, png_data, png_size, &g_config, &result, &data, &size));
+
+  cpres_cache_get_stats(cache, &stats);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.hits);
+  TEST_ASSERT_EQUAL_UINT64(2, stats.misses);
+
+  cpres_cache_close(cache);
+}
+
+void test_cache_evicts_least_recently_used(void) {
+  cpres_cache_t *cache = NULL;
+  cpres_cache_stats_t stats;
+  uint8_t inputs[3][16], payload[100], *data = NULL;
+  size_t size = 0, i;
+  cpres_error_t result;
+
+  memset(payload, 0x5A, sizeof(payload));
+  for (i = 0; i < 3; ++i) {
+    memset(inputs[i], (int)(i + 1), sizeof(inputs[i]));
+  }
+
+  /* Room for two entries of header + payload, but not three. */
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_cache_open(TEST_CACHE_DIR, 400, &cache));
+  TEST_ASSERT_TRUE(cpres_cache_store(cache, CPRES_FORMAT_PNGX, inputs[0], sizeof(inputs[0]), &g_config, CPRES_OK, payload, sizeof(payload)));
+  TEST_ASSERT_TRUE(cpres_cache_store(cache, CPRES_FORMAT_PNGX, inputs[1], sizeof(inputs[1]), &g_config, CPRES_OK, payload, sizeof(payload)));
+
+  TEST_ASSERT_TRUE(cpres_cache_lookup(cache, CPRES_FORMAT_PNGX, inputs[0], sizeof(inputs[0]), &g_config, &result, &data, &size));
+  cpres_free(data);
+
+  TEST_ASSERT_TRUE(cpres_cache_store(cache, CPRES_FORMAT_PNGX, inputs[2], sizeof(inputs[2]), &g_config, CPRES_OK, payload, sizeof(payload)));
+
+  cpres_cache_get_stats(cache, &stats);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.evictions);
+  TEST_ASSERT_EQUAL_UINT64(2, stats.entries);
+  TEST_ASSERT_TRUE(stats.bytes <= stats.max_bytes);
+
+  TEST_ASSERT_TRUE(cpres_cache_lookup(cache, CPRES_FORMAT_PNGX, inputs[0], sizeof(inputs[0]), &g_config, &result, &data, &size));
+  TEST_ASSERT_EQUAL_size_t(sizeof(payload), size);
+  cpres_free(data);
+  TEST_ASSERT_FALSE(cpres_cache_lookup(cache, CPRES_FORMAT_PNGX, inputs[1], sizeof(inputs[1]), &g_config, &result, &data, &size));
+
+  cpres_cache_close(cache);
+}
+
+void test_cache_remembers_output_not_smaller(void) {
+  cpres_cache_t *cache = NULL;
+  uint8_t input[16], *data = NULL;
+  size_t size = 0;
+  cpres_error_t result;
+
+  memset(input, 0x11, sizeof(input));
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_cache_open(TEST_CACHE_DIR, 0, &cache));
+  TEST_ASSERT_TRUE(cpres_cache_store(cache, CPRES_FORMAT_WEBP, input, sizeof(input), &g_config, CPRES_ERROR_OUTPUT_NOT_SMALLER, NULL, 1234));
+  TEST_ASSERT_FALSE(cpres_cache_store(cache, CPRES_FORMAT_WEBP, input, sizeof(input), &g_config, CPRES_ERROR_ENCODE_FAILED, NULL, 0));
+
+  TEST_ASSERT_TRUE(cpres_cache_lookup(cache, CPRES_FORMAT_WEBP, input, sizeof(input), &g_config, &result, &data, &size));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_OUTPUT_NOT_SMALLER, result);
+  TEST_ASSERT_NULL(data);
+  TEST_ASSERT_EQUAL_size_t(1234, size);
+
+  cpres_cache_close(cache);
+}
+
+void test_cache_bypassed_with_time_budget(void) {
+  cpres_cache_t *cache = NULL;
+  cpres_cache_stats_t stats;
+  uint8_t input[16], payload[32], *data = NULL;
+  size_t size = 0;
+  cpres_error_t result;
+
+  memset(input, 0x22, sizeof(input));
+  memset(payload, 0x5A, sizeof(payload));
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_cache_open(TEST_CACHE_DIR, 0, &cache));
+  TEST_ASSERT_TRUE(cpres_cache_store(cache, CPRES_FORMAT_PNGX, input, sizeof(input), &g_config, CPRES_OK, payload, sizeof(payload)));
+
+  g_config.time_budget_ms = 100;
+  TEST_ASSERT_FALSE(cpres_cache_lookup(cache, CPRES_FORMAT_PNGX, input, sizeof(input), &g_config, &result, &data, &size));
+  TEST_ASSERT_NULL(data);
+  TEST_ASSERT_FALSE(cpres_cache_store(cache, CPRES_FORMAT_WEBP, input, sizeof(input), &g_config, CPRES_OK, payload, sizeof(payload)));
+
+  cpres_cache_get_stats(cache, &stats);
+  TEST_ASSERT_EQUAL_UINT64(0, stats.hits);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.stores);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.entries);
+
+  cpres_cache_close(cache);
+}
+
+void test_cache_invalid_parameters(void) {
+  cpres_cache_t *cache = NULL;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_cache_open(NULL, 0, &cache));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_cache_open("", 0, &cache));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_cache_open(TEST_CACHE_DIR, 0, NULL));
+  cpres_cache_close(NULL);
+}
+#endif
+
+void test_cache_dummy(void) { TEST_ASSERT_TRUE(true); }
+
+int main(void) {
+  UNITY_BEGIN();
+
+#ifndef COLOPRESSO_DISABLE_FILE_OPS
+  RUN_TEST(test_cache_miss_then_hit);
+  RUN_TEST(test_cache_persists_across_open);
+  RUN_TEST(test_cache_evicts_least_recently_used);
+  RUN_TEST(test_cache_remembers_output_not_smaller);
+  RUN_TEST(test_cache_bypassed_with_time_budget);
+  RUN_TEST(test_cache_invalid_parameters);
+#endif
+
+  RUN_TEST(test_cache_dummy);
+
+  return UNITY_END();
+}
@@ -0,0 +1,184 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <colopresso.h>
+
+#include <unity.h>
+
+#include "test.h"
+
+typedef struct {
+  uint32_t calls;
+  float first;
+  float last;
+  bool in_range;
+  bool monotonic;
+} test_progress_t;
+
+static cpres_config_t g_config;
+
+void setUp(void) {
+  cpres_config_init_defaults(&g_config);
+  g_config.webp_method = 0;
+  g_config.avif_speed = 10;
+}
+
+void tearDown(void) { release_cached_example_png(); }
+
+static void record_progress(float progress, void *user_data) {
+  test_progress_t *record = (test_progress_t *)user_data;
+
+  if (record->calls == 0) {
+    record->first = progress;
+  } else if (progress < record->last) {
+    record->monotonic = false;
+  }
+  if (progress < 0.0f || progress > 1.0f) {
+    record->in_range = false;
+  }
+  record->last = progress;
+  ++record->calls;
+}
+
+void test_cancel_token_lifecycle(void) {
+  cpres_cancel_token_t *token;
+
+  token = cpres_cancel_token_create();
+  TEST_ASSERT_NOT_NULL(token);
+  TEST_ASSERT_FALSE(cpres_cancel_token_is_cancelled(token));
+
+  cpres_cancel_token_cancel(token);
+  TEST_ASSERT_TRUE(cpres_cancel_token_is_cancelled(token));
+  cpres_cancel_token_cancel(token);
+  TEST_ASSERT_TRUE(cpres_cancel_token_is_cancelled(token));
+
+  cpres_cancel_token_reset(token);
+  TEST_ASSERT_FALSE(cpres_cancel_token_is_cancelled(token));
+
+  cpres_cancel_token_destroy(token);
+
+  TEST_ASSERT_FALSE(cpres_cancel_token_is_cancelled(NULL));
+  cpres_cancel_token_cancel(NULL);
+  cpres_cancel_token_reset(NULL);
+  cpres_cancel_token_destroy(NULL);
+}
+
+static void assert_cancelled_encode(cpres_format_t format) {
+  const uint8_t *png_data;
+  uint8_t *out = NULL;
+  size_t png_size = 0, out_size = 0;
+  cpres_cancel_token_t *token;
+  cpres_error_t error;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for cancel test");
+
+  token = cpres_cancel_token_create();
+  TEST_ASSERT_NOT_NULL(token);
+  cpres_cancel_token_cancel(token);
+  g_config.cancel_token = token;
+
+  if (format == CPRES_FORMAT_WEBP) {
+    error = cpres_encode_webp_memory(png_data, png_size, &out, &out_size, &g_config);
+  } else if (format == CPRES_FORMAT_AVIF) {
+    error = cpres_encode_avif_memory(png_data, png_size, &out, &out_size, &g_config);
+  } else {
+    error = cpres_encode_pngx_memory(png_data, png_size, &out, &out_size, &g_config);
+  }
+
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_CANCELLED, error);
+  TEST_ASSERT_NULL(out);
+  TEST_ASSERT_EQUAL_size_t(0, out_size);
+
+  cpres_cancel_token_destroy(token);
+}
+
+void test_cancel_webp_before_start(void) { assert_cancelled_encode(CPRES_FORMAT_WEBP); }
+
+void test_cancel_avif_before_start(void) { assert_cancelled_encode(CPRES_FORMAT_AVIF); }
+
+void test_cancel_pngx_before_start(void) { assert_cancelled_encode(CPRES_FORMAT_PNGX); }
+
+void test_cancel_webp_memory_limited_before_start(void) {
+  g_config.memory_limited = true;
+  assert_cancelled_encode(CPRES_FORMAT_WEBP);
+}
+
+void test_cancel_uncancelled_token_encodes(void) {
+  const uint8_t *png_data;
+  uint8_t *out = NULL;
+  size_t png_size = 0, out_size = 0;
+  cpres_cancel_token_t *token;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for cancel test");
+
+  token = cpres_cancel_token_create();
+  TEST_ASSERT_NOT_NULL(token);
+  g_config.cancel_token = token;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_webp_memory(png_data, png_size, &out, &out_size, &g_config));
+  TEST_ASSERT_NOT_NULL(out);
+  TEST_ASSERT_GREATER_THAN_size_t(0, out_size);
+
+  cpres_free(out);
+  cpres_cancel_token_destroy(token);
+}
+
+void test_progress_webp_reports_completion(void) {
+  const uint8_t *png_data;
+  uint8_t *out = NULL;
+  size_t png_size = 0, out_size = 0;
+  test_progress_t record;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for progress test");
+
+  memset(&record, 0, sizeof(record));
+  record.in_range = true;
+  record.monotonic = true;
+  g_config.progress_callback = record_progress;
+  g_config.progress_user_data = &record;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_webp_memory(png_data, png_size, &out, &out_size, &g_config));
+  TEST_ASSERT_GREATER_THAN_UINT32(0, record.calls);
+  TEST_ASSERT_TRUE(record.in_range);
+  TEST_ASSERT_TRUE(record.monotonic);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, record.last);
+
+  cpres_free(out);
+}
+
+void test_cancel_error_string(void) {
+  TEST_ASSERT_EQUAL_INT(10, CPRES_ERROR_CANCELLED);
+  TEST_ASSERT_EQUAL_STRING("Encoding cancelled", cpres_error_string(CPRES_ERROR_CANCELLED));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_cancel_token_lifecycle);
+  RUN_TEST(test_cancel_webp_before_start);
+  RUN_TEST(test_cancel_avif_before_start);
+  RUN_TEST(test_cancel_pngx_before_start);
+  RUN_TEST(test_cancel_webp_memory_limited_before_start);
+  RUN_TEST(test_cancel_uncancelled_token_encodes);
+  RUN_TEST(test_progress_webp_reports_completion);
+  RUN_TEST(test_cancel_error_string);
+
+  return UNITY_END();
+}
@@ -0,0 +1,274 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <colopresso.h>
+#include <colopresso/portable.h>
+
+#include <unity.h>
+
+#include "test.h"
+
+static cpres_config_t g_config;
+
+void setUp(void) { cpres_config_init_defaults(&g_config); }
+
+void tearDown(void) { release_cached_example_png(); }
+
+/* IHDR is always the first chunk, right after the 8-byte signature. */
+static inline uint32_t png_header_u32(const uint8_t *png_data, size_t offset) {
+  return ((uint32_t)png_data[offset] << 24) | ((uint32_t)png_data[offset + 1] << 16) | ((uint32_t)png_data[offset + 2] << 8) | (uint32_t)png_data[offset + 3];
+}
+
+void test_effort_without_budget_keeps_config(void) {
+  cpres_effort_t effort;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_WEBP, 4096, 4096, &g_config, &effort));
+  TEST_ASSERT_FALSE(effort.scaled);
+  TEST_ASSERT_EQUAL_INT(g_config.webp_method, effort.webp_method);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, effort.estimated_ms);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_AVIF, 4096, 4096, &g_config, &effort));
+  TEST_ASSERT_FALSE(effort.scaled);
+  TEST_ASSERT_EQUAL_INT(g_config.avif_speed, effort.avif_speed);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_PNGX, 4096, 4096, &g_config, &effort));
+  TEST_ASSERT_FALSE(effort.scaled);
+  TEST_ASSERT_EQUAL_INT(g_config.pngx_level, effort.pngx_level);
+  TEST_ASSERT_EQUAL_INT(g_config.pngx_lossy_speed, effort.pngx_lossy_speed);
+}
+
+void test_effort_tight_budget_lowers_effort(void) {
+  cpres_effort_t effort;
+
+  g_config.time_budget_ms = 50;
+  g_config.webp_method = 6;
+  g_config.avif_speed = 0;
+  g_config.pngx_level = 6;
+  g_config.pngx_lossy_speed = 1;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_WEBP, 4096, 4096, &g_config, &effort));
+  TEST_ASSERT_TRUE(effort.scaled);
+  TEST_ASSERT_TRUE(effort.webp_method < 6);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_AVIF, 4096, 4096, &g_config, &effort));
+  TEST_ASSERT_TRUE(effort.scaled);
+  TEST_ASSERT_TRUE(effort.avif_speed > 0);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_PNGX, 4096, 4096, &g_config, &effort));
+  TEST_ASSERT_TRUE(effort.scaled);
+  TEST_ASSERT_TRUE(effort.pngx_level < 6);
+  TEST_ASSERT_TRUE(effort.pngx_lossy_speed > 1);
+}
+
+void test_effort_scales_with_image_size(void) {
+  cpres_effort_t small, large;
+
+  g_config.time_budget_ms = 500;
+  g_config.avif_speed = 0;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_AVIF, 64, 64, &g_config, &small));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_AVIF, 8192, 8192, &g_config, &large));
+
+  TEST_ASSERT_FALSE(small.scaled);
+  TEST_ASSERT_EQUAL_INT(0, small.avif_speed);
+  TEST_ASSERT_TRUE(large.avif_speed > small.avif_speed);
+}
+
+void test_effort_encode_with_budget(void) {
+  const uint8_t *png_data = NULL;
+  uint8_t *out = NULL;
+  size_t png_size = 0, out_size = 0;
+  cpres_error_t error;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for effort test");
+
+  g_config.time_budget_ms = 1;
+  error = cpres_encode_webp_memory(png_data, png_size, &out, &out_size, &g_config);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  TEST_ASSERT_NOT_NULL(out);
+  TEST_ASSERT_GREATER_THAN_size_t(0, out_size);
+
+  cpres_free(out);
+}
+
+void test_effort_normalizes_like_encoders(void) {
+  cpres_effort_t effort;
+
+  g_config.webp_method = 9;
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_resolve_effort(CPRES_FORMAT_WEBP, 64, 64, &g_config, &effort));
+
+  g_config.avif_speed = 42;
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_AVIF, 64, 64, &g_config, &effort));
+  TEST_ASSERT_FALSE(effort.scaled);
+  TEST_ASSERT_EQUAL_INT(10, effort.avif_speed);
+
+  g_config.avif_speed = -3;
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_AVIF, 64, 64, &g_config, &effort));
+  TEST_ASSERT_FALSE(effort.scaled);
+  TEST_ASSERT_EQUAL_INT(0, effort.avif_speed);
+
+  g_config.pngx_level = 99;
+  g_config.pngx_lossy_speed = 0;
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_PNGX, 64, 64, &g_config, &effort));
+  TEST_ASSERT_FALSE(effort.scaled);
+  TEST_ASSERT_EQUAL_INT(COLOPRESSO_PNGX_DEFAULT_LEVEL, effort.pngx_level);
+  TEST_ASSERT_EQUAL_INT(COLOPRESSO_PNGX_DEFAULT_LOSSY_SPEED, effort.pngx_lossy_speed);
+}
+
+void test_effort_report_without_budget(void) {
+  const uint8_t *png_data = NULL;
+  uint8_t *out = NULL;
+  size_t png_size = 0, out_size = 0;
+  cpres_effort_t report;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for effort test");
+
+  memset(&report, 0xff, sizeof(report));
+  g_config.effort_report = &report;
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_webp_memory(png_data, png_size, &out, &out_size, &g_config));
+  cpres_free(out);
+
+  TEST_ASSERT_FALSE(report.scaled);
+  TEST_ASSERT_EQUAL_INT(g_config.webp_method, report.webp_method);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, report.estimated_ms);
+}
+
+void test_effort_report_pngx_never_above_plan(void) {
+  const uint8_t *png_data = NULL;
+  uint8_t *out = NULL;
+  size_t png_size = 0, out_size = 0;
+  cpres_effort_t planned, report;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for effort test");
+  TEST_ASSERT_GREATER_THAN_size_t(24, png_size);
+
+  g_config.time_budget_ms = 1;
+  g_config.pngx_level = 6;
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_PNGX, png_header_u32(png_data, 16), png_header_u32(png_data, 20), &g_config, &planned));
+
+  memset(&report, 0, sizeof(report));
+  g_config.effort_report = &report;
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_pngx_memory(png_data, png_size, &out, &out_size, &g_config));
+  cpres_free(out);
+
+  /* The wall clock can only lower what the plan picked, never raise it. */
+  TEST_ASSERT_TRUE(report.scaled);
+  TEST_ASSERT_TRUE(report.pngx_level <= planned.pngx_level);
+  TEST_ASSERT_EQUAL_INT(planned.pngx_lossy_speed, report.pngx_lossy_speed);
+}
+
+typedef struct {
+  double stall_until;
+  int palette_level;
+  bool replanned_before_palette;
+} replan_log_t;
+
+static replan_log_t g_replan_log;
+
+static void replan_log_callback(colopresso_log_level_t level, const char *message) {
+  unsigned palette_level;
+
+  (void)level;
+  if (!message) {
+    return;
+  }
+
+  if (sscanf(message, "PNGX: Palette output at level %u", &palette_level) == 1) {
+    g_replan_log.palette_level = (int)palette_level;
+  } else if (g_replan_log.palette_level < 0 && strstr(message, "of the budget left for") && strstr(message, "lowers level")) {
+    g_replan_log.replanned_before_palette = true;
+  }
+}
+
+/* Deliberately breaks the never-block rule: stalling once quantization is done uses up the budget before the indexed oxipng pass. */
+static void replan_stall_progress(float progress, void *user_data) {
+  (void)user_data;
+  if (progress >= 0.5f && progress < 1.0f) {
+    while (colopresso_get_monotonic_seconds() < g_replan_log.stall_until) {
+    }
+  }
+}
+
+void test_effort_palette_replans_before_indexed_pass(void) {
+  const uint8_t *png_data = NULL;
+  uint8_t *out = NULL;
+  size_t png_size = 0, out_size = 0;
+  cpres_effort_t planned, report;
+  cpres_error_t error;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "128x128.png not found for effort test");
+
+  g_config.time_budget_ms = 200;
+  g_config.pngx_level = 5;
+  g_config.pngx_lossy_enable = true;
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_PALETTE256;
+  g_config.pngx_threads = 1;
+  g_config.pngx_parallel_branches = false;
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_PNGX, png_header_u32(png_data, 16), png_header_u32(png_data, 20), &g_config, &planned));
+  TEST_ASSERT_EQUAL_INT(5, planned.pngx_level);
+
+  memset(&report, 0, sizeof(report));
+  memset(&g_replan_log, 0, sizeof(g_replan_log));
+  g_replan_log.palette_level = -1;
+  g_replan_log.stall_until = colopresso_get_monotonic_seconds() + 0.3;
+  g_config.effort_report = &report;
+  g_config.progress_callback = replan_stall_progress;
+  cpres_set_log_callback(replan_log_callback);
+  error = cpres_encode_pngx_memory(png_data, png_size, &out, &out_size, &g_config);
+  cpres_set_log_callback(NULL);
+  if (error == CPRES_OK) {
+    cpres_free(out);
+  }
+
+  /* The palette's own oxipng pass is the one the re-plan lowered, and the report names that level. */
+  TEST_ASSERT_TRUE(error == CPRES_OK || error == CPRES_ERROR_OUTPUT_NOT_SMALLER);
+  TEST_ASSERT_TRUE(g_replan_log.replanned_before_palette);
+  TEST_ASSERT_EQUAL_INT(0, g_replan_log.palette_level);
+  TEST_ASSERT_TRUE(report.scaled);
+  TEST_ASSERT_EQUAL_INT(0, report.pngx_level);
+}
+
+void test_effort_invalid_parameters(void) {
+  cpres_effort_t effort;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_resolve_effort(CPRES_FORMAT_WEBP, 16, 16, NULL, &effort));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_resolve_effort(CPRES_FORMAT_WEBP, 16, 16, &g_config, NULL));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_resolve_effort(CPRES_FORMAT_WEBP, 0, 16, &g_config, &effort));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_FORMAT, cpres_resolve_effort((cpres_format_t)99, 16, 16, &g_config, &effort));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_effort_without_budget_keeps_config);
+  RUN_TEST(test_effort_tight_budget_lowers_effort);
+  RUN_TEST(test_effort_scales_with_image_size);
+  RUN_TEST(test_effort_encode_with_budget);
+  RUN_TEST(test_effort_normalizes_like_encoders);
+  RUN_TEST(test_effort_report_without_budget);
+  RUN_TEST(test_effort_report_pngx_never_above_plan);
+  RUN_TEST(test_effort_palette_replans_before_indexed_pass);
+  RUN_TEST(test_effort_invalid_parameters);
+
+  return UNITY_END();
+}
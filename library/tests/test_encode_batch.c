@@ -0,0 +1,362 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <colopresso.h>
+
+#include <unity.h>
+
+#include "../src/internal/threads.h"
+#include "test.h"
+
+#define BATCH_TEST_ITEMS 6
+#define BATCH_MIXED_THREAD_JOBS 4
+
+typedef struct {
+  uint32_t calls;
+  uint32_t per_index[BATCH_TEST_ITEMS];
+  cpres_error_t errors[BATCH_TEST_ITEMS];
+  size_t sizes[BATCH_TEST_ITEMS];
+  uint8_t *data[BATCH_TEST_ITEMS];
+  cpres_effort_t efforts[BATCH_TEST_ITEMS];
+  bool keep_data;
+  bool inconsistent;
+} batch_test_state_t;
+
+typedef struct {
+  const uint8_t *png_data;
+  size_t png_size;
+  cpres_config_t configs[BATCH_MIXED_THREAD_JOBS];
+  uint8_t *data[BATCH_MIXED_THREAD_JOBS];
+  size_t sizes[BATCH_MIXED_THREAD_JOBS];
+  cpres_error_t errors[BATCH_MIXED_THREAD_JOBS];
+} mixed_threads_ctx_t;
+
+static cpres_config_t g_config;
+
+void setUp(void) {
+  cpres_config_init_defaults(&g_config);
+  g_config.pngx_level = 1;
+}
+
+void tearDown(void) { release_cached_example_png(); }
+
+static void batch_test_callback(size_t index, const cpres_batch_item_t *item, const cpres_batch_result_t *result, void *callback_data) {
+  batch_test_state_t *state = (batch_test_state_t *)callback_data;
+
+  /* Runs on a worker thread; record and assert from the test body instead. */
+  ++state->calls;
+  if (!item || !result || index >= BATCH_TEST_ITEMS) {
+    state->inconsistent = true;
+    return;
+  }
+
+  ++state->per_index[index];
+  state->errors[index] = result->error;
+  state->sizes[index] = result->size;
+  state->efforts[index] = result->effort;
+  if ((result->error == CPRES_OK) != (result->data != NULL)) {
+    state->inconsistent = true;
+  }
+
+  if (state->keep_data) {
+    state->data[index] = result->data;
+  } else {
+    cpres_free(result->data);
+  }
+}
+
+static void mixed_threads_worker(void *context, uint32_t start_index, uint32_t end_index) {
+  mixed_threads_ctx_t *ctx = (mixed_threads_ctx_t *)context;
+  uint32_t i;
+
+  for (i = start_index; i < end_index && i < BATCH_MIXED_THREAD_JOBS; ++i) {
+    ctx->errors[i] = cpres_encode_pngx_memory(ctx->png_data, ctx->png_size, &ctx->data[i], &ctx->sizes[i], &ctx->configs[i]);
+  }
+}
+
+/* One job per thread budget: palette256 on a single thread (imagequant is only bit-exact within one pool size), lossless-only and limited4444 on wider pools, one of them
+ * also splitting its budget across parallel branches. */
+static void mixed_threads_configs(cpres_config_t *configs) {
+  uint32_t i;
+
+  for (i = 0; i < BATCH_MIXED_THREAD_JOBS; ++i) {
+    configs[i] = g_config;
+    configs[i].pngx_threads = (int)(i + 1);
+  }
+  configs[1].pngx_lossy_enable = false;
+  configs[2].pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+  configs[2].pngx_parallel_branches = true;
+  configs[3].pngx_lossy_enable = false;
+}
+
+void test_batch_encode_mixed_formats(void) {
+  cpres_batch_item_t items[BATCH_TEST_ITEMS];
+  batch_test_state_t state;
+  const uint8_t *png_data = NULL;
+  size_t png_size = 0, i;
+  cpres_error_t error;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for batch test");
+
+  memset(&state, 0, sizeof(state));
+  for (i = 0; i < BATCH_TEST_ITEMS; ++i) {
+    items[i].png_data = png_data;
+    items[i].png_size = png_size;
+    items[i].format = (cpres_format_t)(i % 3);
+    items[i].config = &g_config;
+    items[i].user_data = NULL;
+  }
+
+  error = cpres_encode_batch(items, BATCH_TEST_ITEMS, 4, batch_test_callback, &state);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  TEST_ASSERT_EQUAL_UINT32(BATCH_TEST_ITEMS, state.calls);
+  TEST_ASSERT_FALSE(state.inconsistent);
+  for (i = 0; i < BATCH_TEST_ITEMS; ++i) {
+    TEST_ASSERT_EQUAL_UINT32(1, state.per_index[i]);
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, state.errors[i]);
+    TEST_ASSERT_GREATER_THAN_size_t(0, state.sizes[i]);
+  }
+}
+
+void test_batch_encode_matches_single_encode(void) {
+  cpres_batch_item_t items[BATCH_TEST_ITEMS];
+  batch_test_state_t state;
+  const uint8_t *png_data = NULL;
+  uint8_t *single_data = NULL;
+  size_t png_size = 0, single_size = 0, i;
+  cpres_error_t error;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for batch test");
+
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+
+  error = cpres_encode_pngx_memory(png_data, png_size, &single_data, &single_size, &g_config);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  cpres_free(single_data);
+
+  memset(&state, 0, sizeof(state));
+  for (i = 0; i < BATCH_TEST_ITEMS; ++i) {
+    items[i].png_data = png_data;
+    items[i].png_size = png_size;
+    items[i].format = CPRES_FORMAT_PNGX;
+    items[i].config = &g_config;
+    items[i].user_data = NULL;
+  }
+
+  error = cpres_encode_batch(items, BATCH_TEST_ITEMS, 0, batch_test_callback, &state);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  TEST_ASSERT_EQUAL_UINT32(BATCH_TEST_ITEMS, state.calls);
+  TEST_ASSERT_FALSE(state.inconsistent);
+  for (i = 0; i < BATCH_TEST_ITEMS; ++i) {
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, state.errors[i]);
+    TEST_ASSERT_EQUAL_size_t(single_size, state.sizes[i]);
+  }
+}
+
+void test_concurrent_mixed_pngx_threads_match_serial(void) {
+  mixed_threads_ctx_t ctx;
+  uint8_t *serial_data[BATCH_MIXED_THREAD_JOBS];
+  size_t serial_sizes[BATCH_MIXED_THREAD_JOBS];
+  uint32_t i;
+  cpres_error_t error;
+
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.png_data = get_cached_tiny_example_png(&ctx.png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(ctx.png_data, "example.png not found for batch test");
+  mixed_threads_configs(ctx.configs);
+
+  for (i = 0; i < BATCH_MIXED_THREAD_JOBS; ++i) {
+    serial_data[i] = NULL;
+    serial_sizes[i] = 0;
+    error = cpres_encode_pngx_memory(ctx.png_data, ctx.png_size, &serial_data[i], &serial_sizes[i], &ctx.configs[i]);
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  }
+
+  /* Each job asks the bridge for its own pool size; none may end up on another job's pool or change what it produces. */
+  colopresso_parallel_for(BATCH_MIXED_THREAD_JOBS, BATCH_MIXED_THREAD_JOBS, mixed_threads_worker, &ctx);
+
+  for (i = 0; i < BATCH_MIXED_THREAD_JOBS; ++i) {
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, ctx.errors[i]);
+    TEST_ASSERT_EQUAL_size_t(serial_sizes[i], ctx.sizes[i]);
+    TEST_ASSERT_EQUAL_MEMORY(serial_data[i], ctx.data[i], serial_sizes[i]);
+    cpres_free(serial_data[i]);
+    cpres_free(ctx.data[i]);
+  }
+}
+
+void test_batch_encode_mixed_threads_match_serial(void) {
+  cpres_batch_item_t items[BATCH_TEST_ITEMS];
+  cpres_config_t configs[BATCH_TEST_ITEMS];
+  batch_test_state_t state;
+  const uint8_t *png_data = NULL;
+  uint8_t *serial_data[BATCH_TEST_ITEMS];
+  size_t png_size = 0, serial_sizes[BATCH_TEST_ITEMS], i;
+  cpres_error_t error;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for batch test");
+
+  /* Lossless and limited4444 output does not depend on the thread count, so whatever budget the batch hands each job must still reproduce a serial encode. */
+  memset(&state, 0, sizeof(state));
+  state.keep_data = true;
+  for (i = 0; i < BATCH_TEST_ITEMS; ++i) {
+    configs[i] = g_config;
+    configs[i].pngx_threads = 1;
+    if (i % 2 == 0) {
+      configs[i].pngx_lossy_enable = false;
+    } else {
+      configs[i].pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+    }
+
+    serial_data[i] = NULL;
+    serial_sizes[i] = 0;
+    error = cpres_encode_pngx_memory(png_data, png_size, &serial_data[i], &serial_sizes[i], &configs[i]);
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+
+    items[i].png_data = png_data;
+    items[i].png_size = png_size;
+    items[i].format = CPRES_FORMAT_PNGX;
+    items[i].config = &configs[i];
+    items[i].user_data = NULL;
+  }
+
+  /* Seven threads over six jobs: the tail of the batch hands its idle threads to the last jobs, so pngx_threads differs between jobs. */
+  error = cpres_encode_batch(items, BATCH_TEST_ITEMS, 7, batch_test_callback, &state);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  TEST_ASSERT_EQUAL_UINT32(BATCH_TEST_ITEMS, state.calls);
+  TEST_ASSERT_FALSE(state.inconsistent);
+  for (i = 0; i < BATCH_TEST_ITEMS; ++i) {
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, state.errors[i]);
+    TEST_ASSERT_EQUAL_size_t(serial_sizes[i], state.sizes[i]);
+    TEST_ASSERT_EQUAL_MEMORY(serial_data[i], state.data[i], serial_sizes[i]);
+    cpres_free(serial_data[i]);
+    cpres_free(state.data[i]);
+  }
+}
+
+void test_batch_encode_reports_effort(void) {
+  cpres_batch_item_t items[BATCH_TEST_ITEMS];
+  batch_test_state_t state;
+  cpres_config_t budget_config;
+  cpres_effort_t planned;
+  const uint8_t *png_data = NULL;
+  size_t png_size = 0, i;
+  uint32_t width, height;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for batch test");
+  TEST_ASSERT_GREATER_THAN_size_t(24, png_size);
+  width = ((uint32_t)png_data[16] << 24) | ((uint32_t)png_data[17] << 16) | ((uint32_t)png_data[18] << 8) | (uint32_t)png_data[19];
+  height = ((uint32_t)png_data[20] << 24) | ((uint32_t)png_data[21] << 16) | ((uint32_t)png_data[22] << 8) | (uint32_t)png_data[23];
+
+  /* Odd items run without a budget and must still report the effort they used. */
+  budget_config = g_config;
+  budget_config.webp_method = 6;
+  budget_config.time_budget_ms = 1;
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_resolve_effort(CPRES_FORMAT_WEBP, width, height, &budget_config, &planned));
+  TEST_ASSERT_TRUE(planned.webp_method < 6);
+
+  memset(&state, 0, sizeof(state));
+  for (i = 0; i < BATCH_TEST_ITEMS; ++i) {
+    items[i].png_data = png_data;
+    items[i].png_size = png_size;
+    items[i].format = CPRES_FORMAT_WEBP;
+    items[i].config = i % 2 == 0 ? &budget_config : &g_config;
+    items[i].user_data = NULL;
+  }
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_batch(items, BATCH_TEST_ITEMS, 3, batch_test_callback, &state));
+  TEST_ASSERT_FALSE(state.inconsistent);
+  TEST_ASSERT_NULL(g_config.effort_report);
+  for (i = 0; i < BATCH_TEST_ITEMS; ++i) {
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, state.errors[i]);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, state.efforts[i].estimated_ms);
+    if (i % 2 == 0) {
+      TEST_ASSERT_TRUE(state.efforts[i].scaled);
+      TEST_ASSERT_EQUAL_INT(planned.webp_method, state.efforts[i].webp_method);
+    } else {
+      TEST_ASSERT_FALSE(state.efforts[i].scaled);
+      TEST_ASSERT_EQUAL_INT(g_config.webp_method, state.efforts[i].webp_method);
+    }
+  }
+}
+
+void test_batch_encode_reports_item_errors(void) {
+  cpres_batch_item_t items[2];
+  batch_test_state_t state;
+  const uint8_t *png_data = NULL;
+  uint8_t garbage[16];
+  size_t png_size = 0;
+  cpres_error_t error;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for batch test");
+
+  memset(garbage, 0xAB, sizeof(garbage));
+  memset(&state, 0, sizeof(state));
+
+  items[0].png_data = garbage;
+  items[0].png_size = sizeof(garbage);
+  items[0].format = CPRES_FORMAT_WEBP;
+  items[0].config = NULL;
+  items[0].user_data = NULL;
+  items[1].png_data = png_data;
+  items[1].png_size = png_size;
+  items[1].format = (cpres_format_t)99;
+  items[1].config = NULL;
+  items[1].user_data = NULL;
+
+  error = cpres_encode_batch(items, 2, 2, batch_test_callback, &state);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  TEST_ASSERT_EQUAL_UINT32(2, state.calls);
+  TEST_ASSERT_FALSE(state.inconsistent);
+  TEST_ASSERT_NOT_EQUAL(CPRES_OK, state.errors[0]);
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_FORMAT, state.errors[1]);
+}
+
+void test_batch_encode_invalid_parameters(void) {
+  cpres_batch_item_t item;
+  batch_test_state_t state;
+
+  memset(&item, 0, sizeof(item));
+  memset(&state, 0, sizeof(state));
+
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_batch(NULL, 1, 1, batch_test_callback, &state));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_batch(&item, 1, 1, NULL, &state));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_batch(&item, 0, 1, batch_test_callback, &state));
+  TEST_ASSERT_EQUAL_UINT32(0, state.calls);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_batch_encode_mixed_formats);
+  RUN_TEST(test_batch_encode_matches_single_encode);
+  RUN_TEST(test_concurrent_mixed_pngx_threads_match_serial);
+  RUN_TEST(test_batch_encode_mixed_threads_match_serial);
+  RUN_TEST(test_batch_encode_reports_effort);
+  RUN_TEST(test_batch_encode_reports_item_errors);
+  RUN_TEST(test_batch_encode_invalid_parameters);
+
+  return UNITY_END();
+}
@@ -73,9 +73,11 @@ void test_pngx_limited_rgba4444_auto_dither_estimation(void) {
   const uint8_t rgba[16] = {
       0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255,
   };
+  pngx_image_analysis_t analysis;
   float dither = 0.0f;
 
-  dither = estimate_bitdepth_dither_level_limited4444(rgba, 2, 2);
+  TEST_ASSERT_TRUE(analyze_image(1, rgba, 2, 2, &analysis));
+  dither = dither_level_limited4444_from_analysis(&analysis);
 
   TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.05f, dither);
 }
@@ -146,6 +148,38 @@ void test_pngx_limited_rgba4444_color_usage_limits(void) {
   free(png_data);
 }
 
+void test_pngx_limited_rgba4444_tiled_dither_independent_of_threads(void) {
+  size_t png_size = 0, serial_size = 0, parallel_size = 0;
+  uint8_t *png_data = NULL, *serial_data = NULL, *parallel_data = NULL, *serial_rgba = NULL, *parallel_rgba = NULL;
+  png_uint_32 serial_width = 0, serial_height = 0, parallel_width = 0, parallel_height = 0;
+  cpres_error_t error = CPRES_OK;
+
+  png_data = load_test_asset_png("128x128.png", &png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "128x128.png not found for tiled dither test");
+
+  g_config.pngx_tiled_dither_enable = true;
+  g_config.pngx_threads = 1;
+  TEST_ASSERT_TRUE(run_bitdepth_quantization_only(png_data, png_size, CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444, 1.0f, &serial_data, &serial_size));
+  g_config.pngx_threads = 4;
+  TEST_ASSERT_TRUE(run_bitdepth_quantization_only(png_data, png_size, CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444, 1.0f, &parallel_data, &parallel_size));
+
+  error = png_decode_from_memory(serial_data, serial_size, &serial_rgba, &serial_width, &serial_height);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  error = png_decode_from_memory(parallel_data, parallel_size, &parallel_rgba, &parallel_width, &parallel_height);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+
+  TEST_ASSERT_EQUAL_UINT32(serial_width, parallel_width);
+  TEST_ASSERT_EQUAL_UINT32(serial_height, parallel_height);
+  TEST_ASSERT_EQUAL_MEMORY(serial_rgba, parallel_rgba, (size_t)serial_width * (size_t)serial_height * 4);
+  assert_channel_levels_within_bits(parallel_rgba, (size_t)parallel_width * (size_t)parallel_height, 4);
+
+  free(serial_rgba);
+  free(parallel_rgba);
+  cpres_free(serial_data);
+  cpres_free(parallel_data);
+  free(png_data);
+}
+
 void test_pngx_limited_rgba4444_with_rgba64_png(void) {
   size_t png_size = 0, pngx_size = 0;
   uint8_t *png_data = NULL, *pngx_data = NULL;
@@ -174,6 +208,7 @@ int main(void) {
   RUN_TEST(test_pngx_limited_rgba4444_auto_dither_estimation);
   RUN_TEST(test_pngx_limited_rgba4444_bitdepth_reduction);
   RUN_TEST(test_pngx_limited_rgba4444_color_usage_limits);
+  RUN_TEST(test_pngx_limited_rgba4444_tiled_dither_independent_of_threads);
   RUN_TEST(test_pngx_limited_rgba4444_with_rgba64_png);
 
   return UNITY_END();
@@ -19,9 +19,54 @@
 
 #include <unity.h>
 
+#include "../src/internal/pngx.h"
 #include "test.h"
 
+#define SEARCH_LOG_MAX_LABELS 8
+
+typedef struct {
+  char pruned[SEARCH_LOG_MAX_LABELS][32];
+  char optimized[SEARCH_LOG_MAX_LABELS][32];
+  uint32_t pruned_count;
+  uint32_t optimized_count;
+} search_log_t;
+
 static cpres_config_t g_config;
+static search_log_t g_search_log;
+
+/* Copies the "<type>/<colors>" label that follows prefix, up to the parenthesized sizes. */
+static bool search_log_label(const char *message, const char *prefix, char *label, size_t label_size) {
+  size_t prefix_len = strlen(prefix), len;
+  const char *end;
+
+  if (strncmp(message, prefix, prefix_len) != 0) {
+    return false;
+  }
+
+  end = strstr(message + prefix_len, " (");
+  len = end ? (size_t)(end - (message + prefix_len)) : strlen(message + prefix_len);
+  if (len >= label_size) {
+    len = label_size - 1;
+  }
+  memcpy(label, message + prefix_len, len);
+  label[len] = '\0';
+
+  return true;
+}
+
+static void search_log_callback(colopresso_log_level_t level, const char *message) {
+  (void)level;
+  if (!message) {
+    return;
+  }
+
+  if (g_search_log.pruned_count < SEARCH_LOG_MAX_LABELS && search_log_label(message, "PNGX: Search pruned ", g_search_log.pruned[g_search_log.pruned_count], sizeof(g_search_log.pruned[0]))) {
+    ++g_search_log.pruned_count;
+  } else if (g_search_log.optimized_count < SEARCH_LOG_MAX_LABELS &&
+             search_log_label(message, "PNGX: Search optimizing ", g_search_log.optimized[g_search_log.optimized_count], sizeof(g_search_log.optimized[0]))) {
+    ++g_search_log.optimized_count;
+  }
+}
 
 void setUp(void) {
   cpres_config_init_defaults(&g_config);
@@ -249,6 +294,123 @@ void test_pngx_memory_with_threads_setting(void) {
   cpres_free(pngx_out);
 }
 
+void test_pngx_memory_with_parallel_branches(void) {
+  const uint8_t *png_data = NULL;
+  size_t png_size = 0, pngx_size = 0;
+  uint8_t *pngx_out = NULL;
+  cpres_error_t error = CPRES_OK;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for PNGX parallel branches test");
+
+  g_config.pngx_threads = 4;
+  g_config.pngx_parallel_branches = true;
+
+  error = cpres_encode_pngx_memory(png_data, png_size, &pngx_out, &pngx_size, &g_config);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  TEST_ASSERT_NOT_NULL(pngx_out);
+  TEST_ASSERT_GREATER_THAN_size_t(0, pngx_size);
+  TEST_ASSERT_LESS_THAN_size_t(png_size, pngx_size);
+
+  cpres_free(pngx_out);
+}
+
+void test_pngx_memory_parallel_branches_differ_only_by_prune(void) {
+  const uint8_t *png_data = NULL;
+  size_t png_size = 0, serial_size = 0, lossless_size = 0, parallel_size = 0;
+  uint8_t *serial_out = NULL, *lossless_out = NULL, *parallel_out = NULL;
+  cpres_error_t error = CPRES_OK;
+  bool same_as_serial, same_as_lossless;
+  int run;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for PNGX parallel branches test");
+
+  /* Two threads serially match the two each branch gets out of four, so the quantized candidate itself comes out the same. */
+  g_config.pngx_threads = 2;
+  error = cpres_encode_pngx_memory(png_data, png_size, &serial_out, &serial_size, &g_config);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+
+  g_config.pngx_lossy_enable = false;
+  error = cpres_encode_pngx_memory(png_data, png_size, &lossless_out, &lossless_size, &g_config);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+
+  /* Whether the prune fires depends on which branch finishes first; either way the only possible difference is keeping the lossless result instead. */
+  g_config.pngx_lossy_enable = true;
+  g_config.pngx_threads = 4;
+  g_config.pngx_parallel_branches = true;
+  for (run = 0; run < 4; ++run) {
+    error = cpres_encode_pngx_memory(png_data, png_size, &parallel_out, &parallel_size, &g_config);
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+
+    same_as_serial = parallel_size == serial_size && memcmp(parallel_out, serial_out, serial_size) == 0;
+    same_as_lossless = parallel_size == lossless_size && memcmp(parallel_out, lossless_out, lossless_size) == 0;
+    TEST_ASSERT_TRUE(same_as_serial || same_as_lossless);
+
+    cpres_free(parallel_out);
+    parallel_out = NULL;
+  }
+
+  cpres_free(serial_out);
+  cpres_free(lossless_out);
+}
+
+void test_pngx_memory_with_search(void) {
+  static const cpres_pngx_lossy_type_t single_types[] = {CPRES_PNGX_LOSSY_TYPE_PALETTE256, CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444, CPRES_PNGX_LOSSY_TYPE_REDUCED_RGBA32};
+  const uint8_t *png_data = NULL;
+  size_t png_size = 0, search_size = 0, lossless_size = 0, single_size = 0, i;
+  uint8_t *search_out = NULL, *lossless_out = NULL, *single_out = NULL;
+  uint32_t p, o;
+  cpres_error_t error = CPRES_OK;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for PNGX search test");
+
+  /* One thread keeps imagequant bit-exact between a search candidate and the matching single-type encode. */
+  g_config.pngx_threads = 1;
+  g_config.pngx_lossy_enable = false;
+  error = cpres_encode_pngx_memory(png_data, png_size, &lossless_out, &lossless_size, &g_config);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+
+  g_config.pngx_lossy_enable = true;
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+  g_config.pngx_search_enable = true;
+  memset(&g_search_log, 0, sizeof(g_search_log));
+  cpres_set_log_callback(search_log_callback);
+  error = cpres_encode_pngx_memory(png_data, png_size, &search_out, &search_size, &g_config);
+  cpres_set_log_callback(NULL);
+
+  /* The search result still competes with the lossless one, even with an RGBA lossy type configured. */
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  TEST_ASSERT_NOT_NULL(search_out);
+  TEST_ASSERT_GREATER_THAN_size_t(0, search_size);
+  TEST_ASSERT_TRUE(search_size <= lossless_size);
+
+  /* Only survivors get the oxipng pass: nothing pruned is optimized afterwards. */
+  TEST_ASSERT_GREATER_THAN_UINT32(0, g_search_log.optimized_count);
+  TEST_ASSERT_TRUE(g_search_log.optimized_count + g_search_log.pruned_count <= PNGX_SEARCH_MAX_CANDIDATES);
+  for (p = 0; p < g_search_log.pruned_count; ++p) {
+    for (o = 0; o < g_search_log.optimized_count; ++o) {
+      TEST_ASSERT_TRUE_MESSAGE(strcmp(g_search_log.pruned[p], g_search_log.optimized[o]) != 0, g_search_log.pruned[p]);
+    }
+  }
+
+  /* Every single type is one of the candidates, so none of them may beat the search. */
+  g_config.pngx_search_enable = false;
+  for (i = 0; i < sizeof(single_types) / sizeof(single_types[0]); ++i) {
+    g_config.pngx_lossy_type = single_types[i];
+    error = cpres_encode_pngx_memory(png_data, png_size, &single_out, &single_size, &g_config);
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+    TEST_ASSERT_TRUE_MESSAGE(search_size <= single_size, "search output larger than a single lossy type");
+    cpres_free(single_out);
+    single_out = NULL;
+  }
+
+  cpres_free(search_out);
+  cpres_free(lossless_out);
+}
+
 void test_pngx_memory_with_valid_png(void) {
   const uint8_t *png_data = NULL;
   uint8_t *pngx_data = NULL;
@@ -312,6 +474,9 @@ int main(void) {
   RUN_TEST(test_pngx_memory_with_null_png_data);
   RUN_TEST(test_pngx_memory_with_null_size_ptr);
   RUN_TEST(test_pngx_memory_with_threads_setting);
+  RUN_TEST(test_pngx_memory_with_parallel_branches);
+  RUN_TEST(test_pngx_memory_parallel_branches_differ_only_by_prune);
+  RUN_TEST(test_pngx_memory_with_search);
   RUN_TEST(test_pngx_memory_with_valid_png);
   RUN_TEST(test_pngx_memory_with_rgba64_png);
   RUN_TEST(test_pngx_memory_with_zero_size);
@@ -21,6 +21,7 @@
 
 #include "../src/internal/png.h"
 #include "../src/internal/pngx_common.h"
+#include "../src/internal/threads.h"
 
 #include "test.h"
 
@@ -143,6 +144,123 @@ void test_pngx_estimate_bitdepth_dither_level_single_pixel(void) {
   TEST_ASSERT_TRUE(dither >= 0.0f && dither <= 1.0f);
 }
 
+void test_pngx_analyze_image_independent_of_threads(void) {
+  const png_uint_32 width = 37, height = 211;
+  pngx_image_analysis_t serial, threaded;
+  uint8_t *rgba;
+  size_t i;
+
+  rgba = (uint8_t *)malloc((size_t)width * height * 4);
+  TEST_ASSERT_NOT_NULL(rgba);
+  for (i = 0; i < (size_t)width * height; ++i) {
+    rgba[i * 4 + 0] = (uint8_t)(i * 7);
+    rgba[i * 4 + 1] = (uint8_t)(i / width);
+    rgba[i * 4 + 2] = (uint8_t)(i * 13 + 5);
+    rgba[i * 4 + 3] = (i % 5 == 0) ? 0 : ((i % 3 == 0) ? 128 : 255);
+  }
+
+  TEST_ASSERT_TRUE(analyze_image(1, rgba, width, height, &serial));
+  TEST_ASSERT_TRUE(analyze_image(4, rgba, width, height, &threaded));
+
+  TEST_ASSERT_EQUAL_size_t((size_t)width * height, serial.pixel_count);
+  TEST_ASSERT_EQUAL_UINT32(3, serial.alpha_levels);
+  TEST_ASSERT_EQUAL_size_t(serial.pixel_count - serial.opaque_pixels, serial.non_opaque_pixels);
+  TEST_ASSERT_EQUAL_size_t(serial.opaque_pixels, threaded.opaque_pixels);
+  TEST_ASSERT_EQUAL_size_t(serial.translucent_pixels, threaded.translucent_pixels);
+  TEST_ASSERT_EQUAL_size_t(serial.non_opaque_pixels, threaded.non_opaque_pixels);
+  TEST_ASSERT_EQUAL_size_t(serial.gradient_samples, threaded.gradient_samples);
+  TEST_ASSERT_TRUE(serial.gradient_accum == threaded.gradient_accum);
+  TEST_ASSERT_TRUE(serial.luma_min == threaded.luma_min && serial.luma_max == threaded.luma_max);
+  TEST_ASSERT_EQUAL_UINT32(serial.alpha_levels, threaded.alpha_levels);
+  TEST_ASSERT_TRUE(dither_level_from_analysis(&threaded, 8) == estimate_bitdepth_dither_level(rgba, width, height, 8));
+
+  free(rgba);
+}
+
+void test_pngx_prepare_quant_support_independent_of_threads(void) {
+  pngx_rgba_image_t image;
+  pngx_image_analysis_t analysis;
+  pngx_options_t opts;
+  pngx_quant_support_t serial = {0}, threaded = {0};
+  pngx_image_stats_t serial_stats, threaded_stats;
+  size_t i;
+
+  memset(&image, 0, sizeof(image));
+  image.width = 53;
+  image.height = 301;
+  image.pixel_count = (size_t)image.width * image.height;
+  image.rgba = (uint8_t *)malloc(image.pixel_count * 4);
+  TEST_ASSERT_NOT_NULL(image.rgba);
+  for (i = 0; i < image.pixel_count; ++i) {
+    image.rgba[i * 4 + 0] = (uint8_t)((i % image.width) * 4);
+    image.rgba[i * 4 + 1] = (uint8_t)(i * 31 / 7);
+    image.rgba[i * 4 + 2] = (uint8_t)(255 - (i / image.width));
+    image.rgba[i * 4 + 3] = (i % 11 == 0) ? 96 : 255;
+  }
+
+  g_config.pngx_saliency_map_enable = true;
+  g_config.pngx_chroma_anchor_enable = true;
+  pngx_fill_pngx_options(&opts, &g_config);
+  TEST_ASSERT_TRUE(analyze_image(1, image.rgba, image.width, image.height, &analysis));
+
+  opts.thread_count = 1;
+  image_stats_reset(&serial_stats);
+  TEST_ASSERT_TRUE(prepare_quant_support(&image, &analysis, &opts, &serial, &serial_stats));
+  opts.thread_count = 4;
+  image_stats_reset(&threaded_stats);
+  TEST_ASSERT_TRUE(prepare_quant_support(&image, &analysis, &opts, &threaded, &threaded_stats));
+
+  TEST_ASSERT_TRUE(memcmp(&serial_stats, &threaded_stats, sizeof(serial_stats)) == 0);
+  TEST_ASSERT_NOT_NULL(serial.importance_map);
+  TEST_ASSERT_EQUAL_size_t(serial.importance_map_len, threaded.importance_map_len);
+  TEST_ASSERT_EQUAL_MEMORY(serial.importance_map, threaded.importance_map, serial.importance_map_len);
+  TEST_ASSERT_EQUAL_size_t(serial.derived_colors_len, threaded.derived_colors_len);
+  if (serial.derived_colors_len > 0) {
+    TEST_ASSERT_EQUAL_MEMORY(serial.derived_colors, threaded.derived_colors, sizeof(cpres_rgba_color_t) * serial.derived_colors_len);
+  }
+
+  quant_support_reset(&serial);
+  quant_support_reset(&threaded);
+  free(image.rgba);
+}
+
+typedef struct {
+  volatile uint32_t mismatches;
+  colopresso_mutex_t mutex;
+} last_error_ctx_t;
+
+static void last_error_worker(void *context, uint32_t start_index, uint32_t end_index) {
+  last_error_ctx_t *ctx = (last_error_ctx_t *)context;
+  uint32_t i, spin;
+  volatile uint32_t sink = 0;
+
+  for (i = start_index; i < end_index; ++i) {
+    pngx_set_last_error((int)i + 1);
+    for (spin = 0; spin < 2000; ++spin) {
+      sink += spin;
+    }
+    if (pngx_get_last_error() != (int)i + 1) {
+      colopresso_mutex_lock(&ctx->mutex);
+      ctx->mismatches += 1;
+      colopresso_mutex_unlock(&ctx->mutex);
+    }
+  }
+  (void)sink;
+}
+
+void test_pngx_last_error_is_per_thread(void) {
+  last_error_ctx_t ctx;
+
+  ctx.mismatches = 0;
+  colopresso_mutex_init(&ctx.mutex, NULL);
+
+  /* Every item reads back what it set even while other pool threads are setting their own. */
+  TEST_ASSERT_TRUE(colopresso_parallel_for(4, 4096, last_error_worker, &ctx));
+  TEST_ASSERT_EQUAL_UINT32(0, ctx.mismatches);
+
+  colopresso_mutex_destroy(&ctx.mutex);
+}
+
 int main(void) {
   UNITY_BEGIN();
 
@@ -158,6 +276,9 @@ int main(void) {
   RUN_TEST(test_pngx_estimate_bitdepth_dither_level_low_bits);
   RUN_TEST(test_pngx_estimate_bitdepth_dither_level_translucent);
   RUN_TEST(test_pngx_estimate_bitdepth_dither_level_single_pixel);
+  RUN_TEST(test_pngx_analyze_image_independent_of_threads);
+  RUN_TEST(test_pngx_prepare_quant_support_independent_of_threads);
+  RUN_TEST(test_pngx_last_error_is_per_thread);
 
   return UNITY_END();
 }
@@ -18,6 +18,7 @@
 #include <png.h>
 
 #include <colopresso.h>
+#include <colopresso/portable.h>
 
 #include <unity.h>
 
@@ -756,6 +757,282 @@ void test_pngx_palette256_profile_defaults_are_accepted_when_negative(void) {
   free(png_data);
 }
 
+void test_pngx_palette256_indexed_optimization_matches_palette_png(void) {
+  const uint32_t width = 37, height = 23, palette_len = 40;
+  cpres_rgba_color_t palette[40];
+  png_uint_32 indexed_width = 0, indexed_height = 0, fallback_width = 0, fallback_height = 0;
+  uint8_t *indices = NULL, *indexed_png = NULL, *fallback_png = NULL, *indexed_rgba = NULL, *fallback_rgba = NULL;
+  size_t indexed_size = 0, fallback_size = 0, pixel_count = (size_t)width * height;
+  pngx_options_t opts;
+  uint32_t i, x, y;
+
+  /* Every entry is used and fully transparent ones are black, so oxipng has nothing it may legitimately drop or recolor. */
+  for (i = 0; i < palette_len; ++i) {
+    palette[i].r = (uint8_t)(i * 6);
+    palette[i].g = (uint8_t)(255 - i * 5);
+    palette[i].b = (uint8_t)(i * 37);
+    palette[i].a = i % 5 == 0 ? (uint8_t)(i * 4) : 255;
+  }
+  palette[0].r = palette[0].g = palette[0].b = 0;
+
+  indices = (uint8_t *)malloc(pixel_count);
+  TEST_ASSERT_NOT_NULL(indices);
+  for (y = 0; y < height; ++y) {
+    for (x = 0; x < width; ++x) {
+      indices[(size_t)y * width + x] = (uint8_t)((x * 7 + y * 3) % palette_len);
+    }
+  }
+
+  g_config.pngx_optimize_alpha = false;
+  memset(&opts, 0, sizeof(opts));
+  pngx_fill_pngx_options(&opts, &g_config);
+
+  pngx_set_last_error(-1);
+  TEST_ASSERT_TRUE(pngx_run_indexed_optimization(indices, pixel_count, palette, palette_len, width, height, &opts, &indexed_png, &indexed_size));
+  TEST_ASSERT_EQUAL_INT(PNGX_BRIDGE_RESULT_SUCCESS, pngx_get_last_error());
+  TEST_ASSERT_TRUE(pngx_create_palette_png(indices, pixel_count, palette, palette_len, width, height, &fallback_png, &fallback_size));
+
+  TEST_ASSERT_TRUE(indexed_size <= fallback_size);
+  TEST_ASSERT_EQUAL_INT(parse_png_palette_count(fallback_png, fallback_size), parse_png_palette_count(indexed_png, indexed_size));
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, png_decode_from_memory(indexed_png, indexed_size, &indexed_rgba, &indexed_width, &indexed_height));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, png_decode_from_memory(fallback_png, fallback_size, &fallback_rgba, &fallback_width, &fallback_height));
+  TEST_ASSERT_EQUAL_UINT32(fallback_width, indexed_width);
+  TEST_ASSERT_EQUAL_UINT32(fallback_height, indexed_height);
+  TEST_ASSERT_EQUAL_MEMORY(fallback_rgba, indexed_rgba, pixel_count * 4);
+
+  /* A failure is reported like the other bridge calls instead of only returning false. */
+  cpres_free(indexed_png);
+  indexed_png = NULL;
+  TEST_ASSERT_FALSE(pngx_run_indexed_optimization(indices, pixel_count, palette, palette_len, width + 1, height, &opts, &indexed_png, &indexed_size));
+  TEST_ASSERT_EQUAL_INT(PNGX_BRIDGE_RESULT_INVALID_INPUT, pngx_get_last_error());
+  TEST_ASSERT_NULL(indexed_png);
+
+  cpres_free(indexed_rgba);
+  cpres_free(fallback_rgba);
+  cpres_free(fallback_png);
+  free(indices);
+}
+
+static void fill_quantize_test_pixels(cpres_rgba_color_t *pixels, uint32_t width, uint32_t height) {
+  uint32_t x, y;
+  cpres_rgba_color_t *pixel;
+
+  for (y = 0; y < height; ++y) {
+    for (x = 0; x < width; ++x) {
+      pixel = &pixels[(size_t)y * width + x];
+      pixel->r = (uint8_t)(x * 255 / (width > 1 ? width - 1 : 1));
+      pixel->g = (uint8_t)(y * 255 / (height > 1 ? height - 1 : 1));
+      pixel->b = (uint8_t)((x * 13 + y * 29) & 0xFF);
+      pixel->a = (x + y) % 7 == 0 ? (uint8_t)(x * 9) : 255;
+    }
+  }
+}
+
+static void assert_quantize_into_layouts_match(uint32_t width, uint32_t height) {
+  const size_t slack = 8;
+  size_t pixel_count = (size_t)width * height, i;
+  cpres_rgba_color_t *packed = NULL, packed_palette[256], shifted_palette[256];
+  const cpres_rgba_color_t *shifted = NULL;
+  uint8_t *shifted_storage = NULL, *packed_indices = NULL, *shifted_indices = NULL;
+  PngxBridgeQuantParams params;
+  PngxBridgeQuantOutput packed_output, shifted_output;
+
+  packed = (cpres_rgba_color_t *)malloc(pixel_count * sizeof(cpres_rgba_color_t));
+  shifted_storage = (uint8_t *)malloc(pixel_count * sizeof(cpres_rgba_color_t) + 1);
+  packed_indices = (uint8_t *)malloc(pixel_count);
+  shifted_indices = (uint8_t *)malloc(pixel_count + slack);
+  TEST_ASSERT_NOT_NULL(packed);
+  TEST_ASSERT_NOT_NULL(shifted_storage);
+  TEST_ASSERT_NOT_NULL(packed_indices);
+  TEST_ASSERT_NOT_NULL(shifted_indices);
+
+  /* The packed copy is what the removed owned-buffer entry point quantized; the shifted copy is read in place at an odd address. */
+  fill_quantize_test_pixels(packed, width, height);
+  memcpy(shifted_storage + 1, packed, pixel_count * sizeof(cpres_rgba_color_t));
+  shifted = (const cpres_rgba_color_t *)(shifted_storage + 1);
+  memset(shifted_indices, 0xA5, pixel_count + slack);
+
+  memset(&params, 0, sizeof(params));
+  params.speed = 3;
+  params.quality_min = 0;
+  params.quality_max = 100;
+  params.max_colors = 24;
+  params.dithering_level = 0.5f;
+  params.remap = true;
+  params.thread_count = 1;
+
+  memset(&packed_output, 0, sizeof(packed_output));
+  packed_output.palette = packed_palette;
+  packed_output.indices = packed_indices;
+  packed_output.indices_len = pixel_count;
+  memset(&shifted_output, 0, sizeof(shifted_output));
+  shifted_output.palette = shifted_palette;
+  shifted_output.indices = shifted_indices;
+  shifted_output.indices_len = pixel_count + slack;
+
+  TEST_ASSERT_EQUAL_INT(PNGX_BRIDGE_QUANT_STATUS_OK, pngx_bridge_quantize_into(packed, pixel_count, width, height, &params, &packed_output));
+  TEST_ASSERT_EQUAL_INT(PNGX_BRIDGE_QUANT_STATUS_OK, pngx_bridge_quantize_into(shifted, pixel_count, width, height, &params, &shifted_output));
+
+  TEST_ASSERT_TRUE(packed_output.palette_len > 0 && packed_output.palette_len <= params.max_colors);
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)packed_output.palette_len, (uint32_t)shifted_output.palette_len);
+  TEST_ASSERT_EQUAL_MEMORY(packed_palette, shifted_palette, packed_output.palette_len * sizeof(cpres_rgba_color_t));
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)pixel_count, (uint32_t)packed_output.indices_len);
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)pixel_count, (uint32_t)shifted_output.indices_len);
+  TEST_ASSERT_EQUAL_MEMORY(packed_indices, shifted_indices, pixel_count);
+  TEST_ASSERT_EQUAL_INT(packed_output.quality, shifted_output.quality);
+  TEST_ASSERT_TRUE(packed_output.quality >= 0 && packed_output.quality <= 100);
+
+  for (i = 0; i < pixel_count; ++i) {
+    TEST_ASSERT_TRUE(packed_indices[i] < packed_output.palette_len);
+  }
+  /* Only pixel_count bytes are written even when the caller's buffer is larger. */
+  for (i = pixel_count; i < pixel_count + slack; ++i) {
+    TEST_ASSERT_EQUAL_UINT8(0xA5, shifted_indices[i]);
+  }
+
+  /* Without remap only the quality is reported and the output buffers are left alone. */
+  params.remap = false;
+  memset(&shifted_output, 0, sizeof(shifted_output));
+  TEST_ASSERT_EQUAL_INT(PNGX_BRIDGE_QUANT_STATUS_OK, pngx_bridge_quantize_into(shifted, pixel_count, width, height, &params, &shifted_output));
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)shifted_output.palette_len);
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)shifted_output.indices_len);
+  TEST_ASSERT_EQUAL_INT(packed_output.quality, shifted_output.quality);
+
+  free(shifted_indices);
+  free(packed_indices);
+  free(shifted_storage);
+  free(packed);
+}
+
+void test_pngx_palette256_quantize_into_matches_across_pixel_layouts(void) {
+  assert_quantize_into_layouts_match(37, 23);
+  assert_quantize_into_layouts_match(1, 17);
+  assert_quantize_into_layouts_match(5, 1);
+}
+
+void test_pngx_palette256_quantize_into_rejects_mismatched_buffers(void) {
+  const uint32_t width = 9, height = 7;
+  cpres_rgba_color_t pixels[63], palette[256];
+  uint8_t indices[63];
+  PngxBridgeQuantParams params;
+  PngxBridgeQuantOutput output;
+
+  fill_quantize_test_pixels(pixels, width, height);
+  memset(&params, 0, sizeof(params));
+  params.speed = 3;
+  params.quality_max = 100;
+  params.max_colors = 16;
+  params.remap = true;
+  params.thread_count = 1;
+
+  memset(&output, 0, sizeof(output));
+  output.palette = palette;
+  output.indices = indices;
+  output.indices_len = sizeof(indices);
+  TEST_ASSERT_EQUAL_INT(PNGX_BRIDGE_QUANT_STATUS_ERROR, pngx_bridge_quantize_into(pixels, sizeof(indices), width + 1, height, &params, &output));
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)output.palette_len);
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)output.indices_len);
+  TEST_ASSERT_EQUAL_INT(-1, output.quality);
+
+  output.indices_len = sizeof(indices) - 1;
+  TEST_ASSERT_EQUAL_INT(PNGX_BRIDGE_QUANT_STATUS_ERROR, pngx_bridge_quantize_into(pixels, sizeof(indices), width, height, &params, &output));
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)output.indices_len);
+
+  output.indices_len = sizeof(indices);
+  output.indices = NULL;
+  TEST_ASSERT_EQUAL_INT(PNGX_BRIDGE_QUANT_STATUS_ERROR, pngx_bridge_quantize_into(pixels, sizeof(indices), width, height, &params, &output));
+}
+
+#if COLOPRESSO_ENABLE_THREADS
+
+typedef struct {
+  volatile bool lossless_finished;
+  volatile bool pruned;
+} prune_log_t;
+
+static prune_log_t g_prune_log;
+
+static void prune_log_callback(colopresso_log_level_t level, const char *message) {
+  (void)level;
+  if (!message) {
+    return;
+  }
+
+  if (strncmp(message, "PNGX: Lossless branch finished", 30) == 0) {
+    g_prune_log.lossless_finished = true;
+  } else if (strncmp(message, "PNGX: Dropped quantized candidate", 33) == 0) {
+    g_prune_log.pruned = true;
+  }
+}
+
+/* Deliberately breaks the never-block rule: holding the lossy branch once quantization is done lets the concurrent lossless branch finish first. */
+static void prune_wait_progress(float progress, void *user_data) {
+  double give_up = colopresso_get_monotonic_seconds() + 30.0;
+
+  (void)user_data;
+  if (progress >= 0.5f && progress < 1.0f) {
+    while (!g_prune_log.lossless_finished && colopresso_get_monotonic_seconds() < give_up) {
+    }
+  }
+}
+
+void test_pngx_palette256_parallel_branches_prune_before_indexed_pass(void) {
+  const uint32_t width = 256, height = 256;
+  uint8_t *rgba = NULL, *png = NULL, *lossless_out = NULL, *parallel_out = NULL;
+  size_t png_size = 0, lossless_size = 0, parallel_size = 0;
+  cpres_error_t lossless_error, parallel_error;
+  uint32_t x, y;
+
+  /* A smooth gradient filters down to almost nothing losslessly, while its dithered palette is noise: far more than the prune ratio apart. */
+  rgba = (uint8_t *)malloc((size_t)width * height * 4);
+  TEST_ASSERT_NOT_NULL(rgba);
+  for (y = 0; y < height; ++y) {
+    for (x = 0; x < width; ++x) {
+      rgba[((size_t)y * width + x) * 4 + 0] = (uint8_t)x;
+      rgba[((size_t)y * width + x) * 4 + 1] = (uint8_t)y;
+      rgba[((size_t)y * width + x) * 4 + 2] = (uint8_t)((x + y) / 2);
+      rgba[((size_t)y * width + x) * 4 + 3] = 255;
+    }
+  }
+  TEST_ASSERT_TRUE(create_png_rgba_memory(rgba, width, height, &png, &png_size));
+
+  g_config.pngx_threads = 4;
+  g_config.pngx_lossy_enable = false;
+  lossless_error = cpres_encode_pngx_memory(png, png_size, &lossless_out, &lossless_size, &g_config);
+
+  g_config.pngx_lossy_enable = true;
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_PALETTE256;
+  g_config.pngx_lossy_dither_level = 1.0f;
+  g_config.pngx_adaptive_dither_enable = false;
+  g_config.pngx_postprocess_smooth_enable = false;
+  g_config.pngx_palette256_gradient_profile_enable = false;
+  g_config.pngx_parallel_branches = true;
+  g_config.progress_callback = prune_wait_progress;
+  memset(&g_prune_log, 0, sizeof(g_prune_log));
+  cpres_set_log_callback(prune_log_callback);
+  parallel_error = cpres_encode_pngx_memory(png, png_size, &parallel_out, &parallel_size, &g_config);
+  cpres_set_log_callback(NULL);
+
+  /* The palette never reached oxipng, so the result is exactly the lossless-only one. */
+  TEST_ASSERT_TRUE(g_prune_log.lossless_finished);
+  TEST_ASSERT_TRUE(g_prune_log.pruned);
+  TEST_ASSERT_EQUAL_INT(lossless_error, parallel_error);
+  if (parallel_error == CPRES_OK) {
+    TEST_ASSERT_EQUAL_size_t(lossless_size, parallel_size);
+    TEST_ASSERT_EQUAL_MEMORY(lossless_out, parallel_out, lossless_size);
+    cpres_free(parallel_out);
+  }
+  if (lossless_error == CPRES_OK) {
+    cpres_free(lossless_out);
+  }
+
+  free(png);
+  free(rgba);
+}
+
+#endif
+
 void test_pngx_palette256_error_path_triggers_memory_buffer_reset(void) {
   cpres_error_t error = CPRES_OK;
   uint8_t *pngx_data = NULL;
@@ -780,6 +1057,12 @@ int main(void) {
   RUN_TEST(test_pngx_palette256_gradient_profile_prefer_uniform_path);
   RUN_TEST(test_pngx_palette256_tune_quant_params_clamps_speed_and_quality);
   RUN_TEST(test_pngx_palette256_profile_defaults_are_accepted_when_negative);
+  RUN_TEST(test_pngx_palette256_indexed_optimization_matches_palette_png);
+  RUN_TEST(test_pngx_palette256_quantize_into_matches_across_pixel_layouts);
+  RUN_TEST(test_pngx_palette256_quantize_into_rejects_mismatched_buffers);
+#if COLOPRESSO_ENABLE_THREADS
+  RUN_TEST(test_pngx_palette256_parallel_branches_prune_before_indexed_pass);
+#endif
 
   return UNITY_END();
 }
@@ -597,6 +597,43 @@ void test_pngx_reduced_rgba32_all_colors_protected_results_in_no_unlocked_entrie
   g_config.pngx_protected_colors_count = 0;
 }
 
+void test_pngx_reduced_rgba32_tiled_dither_independent_of_threads(void) {
+  size_t png_size = 0, serial_size = 0, parallel_size = 0;
+  uint8_t *png_data = NULL, *serial_data = NULL, *parallel_data = NULL, *serial_rgba = NULL, *parallel_rgba = NULL;
+  png_uint_32 serial_width = 0, serial_height = 0, parallel_width = 0, parallel_height = 0;
+  cpres_error_t error = CPRES_OK;
+
+  png_data = load_test_asset_png("example_reduce.png", &png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example_reduce.png not found for Reduced RGBA32 tiled dither test");
+
+  g_config.pngx_lossy_enable = true;
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_REDUCED_RGBA32;
+  g_config.pngx_lossy_dither_level = 0.8f;
+  g_config.pngx_tiled_dither_enable = true;
+
+  g_config.pngx_threads = 1;
+  error = cpres_encode_pngx_memory(png_data, png_size, &serial_data, &serial_size, &g_config);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  g_config.pngx_threads = 4;
+  error = cpres_encode_pngx_memory(png_data, png_size, &parallel_data, &parallel_size, &g_config);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+
+  error = png_decode_from_memory(serial_data, serial_size, &serial_rgba, &serial_width, &serial_height);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+  error = png_decode_from_memory(parallel_data, parallel_size, &parallel_rgba, &parallel_width, &parallel_height);
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, error);
+
+  TEST_ASSERT_EQUAL_UINT32(serial_width, parallel_width);
+  TEST_ASSERT_EQUAL_UINT32(serial_height, parallel_height);
+  TEST_ASSERT_EQUAL_MEMORY(serial_rgba, parallel_rgba, (size_t)serial_width * (size_t)serial_height * 4);
+
+  free(serial_rgba);
+  free(parallel_rgba);
+  cpres_free(serial_data);
+  cpres_free(parallel_data);
+  free(png_data);
+}
+
 int main(void) {
   UNITY_BEGIN();
 
@@ -609,6 +646,7 @@ int main(void) {
   RUN_TEST(test_pngx_reduced_rgba32_all_colors_protected_results_in_no_unlocked_entries);
   RUN_TEST(test_pngx_reduced_rgba32_auto_trim_applies_on_head_dominant_long_tail_image);
   RUN_TEST(test_pngx_reduced_rgba32_gentle_cut_path_executes_for_1024_unique_colors);
+  RUN_TEST(test_pngx_reduced_rgba32_tiled_dither_independent_of_threads);
 
   return UNITY_END();
 }
@@ -0,0 +1,155 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <png.h>
+
+#include <colopresso.h>
+
+#include <unity.h>
+
+#include "test.h"
+
+#define RGBA_TEST_WIDTH 48
+#define RGBA_TEST_HEIGHT 32
+#define RGBA_TEST_PADDING 20
+
+typedef cpres_error_t (*rgba_encode_fn_t)(const uint8_t *, uint32_t, uint32_t, uint32_t, uint8_t **, size_t *, const cpres_config_t *);
+
+static cpres_config_t g_config;
+static uint8_t g_packed[RGBA_TEST_WIDTH * 4 * RGBA_TEST_HEIGHT];
+static uint8_t g_padded[(RGBA_TEST_WIDTH * 4 + RGBA_TEST_PADDING) * RGBA_TEST_HEIGHT];
+
+void setUp(void) {
+  const uint32_t padded_stride = RGBA_TEST_WIDTH * 4 + RGBA_TEST_PADDING;
+  uint8_t *pixel;
+  uint32_t x, y;
+
+  cpres_config_init_defaults(&g_config);
+  g_config.pngx_level = 1;
+
+  /* Padding bytes are filled with noise so any read past a row's pixels shows up in the output. */
+  for (y = 0; y < RGBA_TEST_HEIGHT; ++y) {
+    memset(g_padded + (size_t)y * padded_stride, (int)(0x5A ^ y), padded_stride);
+    for (x = 0; x < RGBA_TEST_WIDTH; ++x) {
+      pixel = g_packed + ((size_t)y * RGBA_TEST_WIDTH + x) * 4;
+      pixel[0] = (uint8_t)(x * 5);
+      pixel[1] = (uint8_t)(y * 7);
+      pixel[2] = (uint8_t)((x + y) * 3);
+      pixel[3] = (uint8_t)(x < RGBA_TEST_WIDTH / 2 ? 255 : 128 + y);
+    }
+    memcpy(g_padded + (size_t)y * padded_stride, g_packed + (size_t)y * RGBA_TEST_WIDTH * 4, RGBA_TEST_WIDTH * 4);
+  }
+}
+
+void tearDown(void) {}
+
+static void assert_stride_is_honoured(rgba_encode_fn_t encode) {
+  uint8_t *packed_data = NULL, *padded_data = NULL;
+  size_t packed_size = 0, padded_size = 0;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, encode(g_packed, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, 0, &packed_data, &packed_size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, encode(g_padded, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, RGBA_TEST_WIDTH * 4 + RGBA_TEST_PADDING, &padded_data, &padded_size, &g_config));
+
+  TEST_ASSERT_NOT_NULL(packed_data);
+  TEST_ASSERT_GREATER_THAN_size_t(0, packed_size);
+  TEST_ASSERT_EQUAL_size_t(packed_size, padded_size);
+  TEST_ASSERT_EQUAL_MEMORY(packed_data, padded_data, packed_size);
+
+  cpres_free(packed_data);
+  cpres_free(padded_data);
+}
+
+void test_encode_webp_rgba_stride(void) {
+  g_config.webp_lossless = true;
+  assert_stride_is_honoured(cpres_encode_webp_rgba);
+}
+
+void test_encode_avif_rgba_stride(void) {
+  g_config.avif_lossless = true;
+  assert_stride_is_honoured(cpres_encode_avif_rgba);
+}
+
+void test_encode_pngx_rgba_stride(void) {
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+  assert_stride_is_honoured(cpres_encode_pngx_rgba);
+}
+
+void test_encode_pngx_rgba_leaves_input_untouched(void) {
+  uint8_t before[sizeof(g_packed)], *data = NULL;
+  size_t size = 0;
+
+  memcpy(before, g_packed, sizeof(g_packed));
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_REDUCED_RGBA32;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_pngx_rgba(g_packed, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, 0, &data, &size, &g_config));
+  TEST_ASSERT_EQUAL_MEMORY(before, g_packed, sizeof(g_packed));
+
+  cpres_free(data);
+}
+
+void test_encode_pngx_rgba_lossless_keeps_pixels(void) {
+  png_image image;
+  uint8_t decoded[sizeof(g_packed)], *data = NULL;
+  size_t size = 0;
+
+  g_config.pngx_lossy_enable = false;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_pngx_rgba(g_padded, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, RGBA_TEST_WIDTH * 4 + RGBA_TEST_PADDING, &data, &size, &g_config));
+  TEST_ASSERT_NOT_NULL(data);
+
+  memset(&image, 0, sizeof(image));
+  image.version = PNG_IMAGE_VERSION;
+  TEST_ASSERT_TRUE(png_image_begin_read_from_memory(&image, data, size));
+  TEST_ASSERT_EQUAL_UINT32(RGBA_TEST_WIDTH, image.width);
+  TEST_ASSERT_EQUAL_UINT32(RGBA_TEST_HEIGHT, image.height);
+  image.format = PNG_FORMAT_RGBA;
+  TEST_ASSERT_TRUE(png_image_finish_read(&image, NULL, decoded, 0, NULL));
+  TEST_ASSERT_EQUAL_MEMORY(g_packed, decoded, sizeof(g_packed));
+
+  cpres_free(data);
+}
+
+void test_encode_rgba_invalid_parameters(void) {
+  uint8_t *data = NULL;
+  size_t size = 0;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_webp_rgba(NULL, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, 0, &data, &size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_webp_rgba(g_packed, 0, RGBA_TEST_HEIGHT, 0, &data, &size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_avif_rgba(g_packed, RGBA_TEST_WIDTH, 0, 0, &data, &size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_avif_rgba(g_packed, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, RGBA_TEST_WIDTH * 4 - 1, &data, &size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_pngx_rgba(g_packed, 70000, 1, 0, &data, &size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_pngx_rgba(g_packed, 1, 70000, 0, &data, &size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_webp_rgba(g_packed, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, (uint32_t)INT_MAX + 1u, &data, &size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_avif_rgba(g_packed, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, UINT32_MAX, &data, &size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_pngx_rgba(g_packed, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, 0, NULL, &size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_pngx_rgba(g_packed, RGBA_TEST_WIDTH, RGBA_TEST_HEIGHT, 0, &data, &size, NULL));
+  TEST_ASSERT_NULL(data);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_encode_webp_rgba_stride);
+  RUN_TEST(test_encode_avif_rgba_stride);
+  RUN_TEST(test_encode_pngx_rgba_stride);
+  RUN_TEST(test_encode_pngx_rgba_leaves_input_untouched);
+  RUN_TEST(test_encode_pngx_rgba_lossless_keeps_pixels);
+  RUN_TEST(test_encode_rgba_invalid_parameters);
+
+  return UNITY_END();
+}
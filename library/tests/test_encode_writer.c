@@ -0,0 +1,144 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <colopresso.h>
+
+#include <unity.h>
+
+#include "test.h"
+
+typedef struct {
+  uint8_t *data;
+  size_t size;
+  uint32_t calls;
+  uint32_t call_limit;
+  bool limit_calls;
+} writer_sink_t;
+
+typedef cpres_error_t (*memory_encode_fn_t)(const uint8_t *, size_t, uint8_t **, size_t *, const cpres_config_t *);
+typedef cpres_error_t (*writer_encode_fn_t)(const uint8_t *, size_t, cpres_write_callback_t, void *, size_t *, const cpres_config_t *);
+
+static cpres_config_t g_config;
+
+void setUp(void) {
+  cpres_config_init_defaults(&g_config);
+  g_config.pngx_level = 1;
+}
+
+void tearDown(void) { release_cached_example_png(); }
+
+static bool sink_write(const uint8_t *data, size_t size, void *user_data) {
+  writer_sink_t *sink = (writer_sink_t *)user_data;
+  uint8_t *grown;
+
+  if (sink->limit_calls && sink->calls >= sink->call_limit) {
+    return false;
+  }
+
+  grown = (uint8_t *)realloc(sink->data, sink->size + size);
+  if (!grown) {
+    return false;
+  }
+
+  memcpy(grown + sink->size, data, size);
+  sink->data = grown;
+  sink->size += size;
+  ++sink->calls;
+
+  return true;
+}
+
+static void assert_writer_matches_memory(memory_encode_fn_t encode_memory, writer_encode_fn_t encode_writer, bool tiny) {
+  writer_sink_t sink;
+  const uint8_t *png_data = NULL;
+  uint8_t *memory_data = NULL;
+  size_t png_size = 0, memory_size = 0, written = 0;
+
+  png_data = tiny ? get_cached_tiny_example_png(&png_size) : get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for writer test");
+
+  memset(&sink, 0, sizeof(sink));
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, encode_memory(png_data, png_size, &memory_data, &memory_size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, encode_writer(png_data, png_size, sink_write, &sink, &written, &g_config));
+
+  TEST_ASSERT_GREATER_THAN_UINT32(0, sink.calls);
+  TEST_ASSERT_EQUAL_size_t(memory_size, written);
+  TEST_ASSERT_EQUAL_size_t(memory_size, sink.size);
+  TEST_ASSERT_EQUAL_MEMORY(memory_data, sink.data, memory_size);
+
+  cpres_free(memory_data);
+  free(sink.data);
+}
+
+void test_webp_writer_matches_memory(void) { assert_writer_matches_memory(cpres_encode_webp_memory, cpres_encode_webp_to_writer, false); }
+
+void test_avif_writer_matches_memory(void) { assert_writer_matches_memory(cpres_encode_avif_memory, cpres_encode_avif_to_writer, false); }
+
+void test_pngx_writer_matches_memory(void) {
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+  assert_writer_matches_memory(cpres_encode_pngx_memory, cpres_encode_pngx_to_writer, true);
+}
+
+void test_writer_failure_aborts_encode(void) {
+  writer_sink_t sink;
+  const uint8_t *png_data = NULL;
+  size_t png_size = 0, written = 1;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for writer test");
+
+  /* WebP streams its container in several pieces; refusing the second one must stop the encoder. */
+  memset(&sink, 0, sizeof(sink));
+  sink.limit_calls = true;
+  sink.call_limit = 1;
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_IO, cpres_encode_webp_to_writer(png_data, png_size, sink_write, &sink, &written, &g_config));
+  TEST_ASSERT_EQUAL_UINT32(1, sink.calls);
+  free(sink.data);
+
+  memset(&sink, 0, sizeof(sink));
+  sink.limit_calls = true;
+  sink.call_limit = 0;
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_IO, cpres_encode_avif_to_writer(png_data, png_size, sink_write, &sink, &written, &g_config));
+  TEST_ASSERT_EQUAL_size_t(0, written);
+  TEST_ASSERT_NULL(sink.data);
+}
+
+void test_writer_invalid_parameters(void) {
+  writer_sink_t sink;
+  uint8_t byte = 0;
+
+  memset(&sink, 0, sizeof(sink));
+
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_webp_to_writer(NULL, 1, sink_write, &sink, NULL, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_avif_to_writer(&byte, 0, sink_write, &sink, NULL, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_pngx_to_writer(&byte, 1, NULL, &sink, NULL, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encode_pngx_to_writer(&byte, 1, sink_write, &sink, NULL, NULL));
+  TEST_ASSERT_EQUAL_UINT32(0, sink.calls);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_webp_writer_matches_memory);
+  RUN_TEST(test_avif_writer_matches_memory);
+  RUN_TEST(test_pngx_writer_matches_memory);
+  RUN_TEST(test_writer_failure_aborts_encode);
+  RUN_TEST(test_writer_invalid_parameters);
+
+  return UNITY_END();
+}
@@ -0,0 +1,204 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <colopresso.h>
+
+#include <unity.h>
+
+#include "test.h"
+
+static cpres_config_t g_config;
+
+void setUp(void) {
+  cpres_config_init_defaults(&g_config);
+  g_config.pngx_level = 1;
+}
+
+void tearDown(void) { release_cached_example_png(); }
+
+void test_encoder_webp_matches_one_shot(void) {
+  cpres_encoder_t *encoder = NULL;
+  const uint8_t *png_data = NULL;
+  uint8_t *single_data = NULL, *reused_data = NULL;
+  size_t png_size = 0, single_size = 0, reused_size = 0;
+  int i;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for encoder test");
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_webp_memory(png_data, png_size, &single_data, &single_size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_create(CPRES_FORMAT_WEBP, &g_config, &encoder));
+  TEST_ASSERT_NOT_NULL(encoder);
+
+  for (i = 0; i < 3; ++i) {
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_encode(encoder, png_data, png_size, &reused_data, &reused_size));
+    TEST_ASSERT_EQUAL_size_t(single_size, reused_size);
+    TEST_ASSERT_EQUAL_MEMORY(single_data, reused_data, single_size);
+    cpres_free(reused_data);
+    reused_data = NULL;
+  }
+
+  cpres_encoder_destroy(encoder);
+  cpres_free(single_data);
+}
+
+void test_encoder_pngx_matches_one_shot(void) {
+  cpres_encoder_t *encoder = NULL;
+  const uint8_t *png_data = NULL;
+  uint8_t *single_data = NULL, *reused_data = NULL;
+  size_t png_size = 0, single_size = 0, reused_size = 0;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for encoder test");
+
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_LIMITED_RGBA4444;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encode_pngx_memory(png_data, png_size, &single_data, &single_size, &g_config));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_create(CPRES_FORMAT_PNGX, &g_config, &encoder));
+
+  /* The encoder owns a copy of the config; later changes by the caller must not leak in. */
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_PALETTE256;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_encode(encoder, png_data, png_size, &reused_data, &reused_size));
+  TEST_ASSERT_EQUAL_size_t(single_size, reused_size);
+  TEST_ASSERT_EQUAL_MEMORY(single_data, reused_data, single_size);
+
+  cpres_free(reused_data);
+  cpres_free(single_data);
+  cpres_encoder_destroy(encoder);
+}
+
+static void assert_pngx_encoder_reuses_scratch(void) {
+  cpres_encoder_t *encoder = NULL;
+  test_log_capture_t capture;
+  const uint8_t *png_data = NULL;
+  uint8_t *first_data = NULL, *reused_data = NULL;
+  size_t png_size = 0, first_size = 0, reused_size = 0;
+  int i;
+
+  png_data = get_cached_tiny_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for encoder test");
+
+  g_config.pngx_threads = 1;
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_create(CPRES_FORMAT_PNGX, &g_config, &encoder));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_encode(encoder, png_data, png_size, &first_data, &first_size));
+
+  /* Once the first call has sized the scratch, later calls on the same input must not allocate again. */
+  for (i = 0; i < 2; ++i) {
+    test_log_capture_begin(&capture);
+    TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_encode(encoder, png_data, png_size, &reused_data, &reused_size));
+    test_log_capture_end();
+
+    TEST_ASSERT_EQUAL_size_t(first_size, reused_size);
+    TEST_ASSERT_EQUAL_MEMORY(first_data, reused_data, first_size);
+    TEST_ASSERT_TRUE(capture.called);
+    TEST_ASSERT_NOT_NULL(strstr(capture.message, "made 0 new allocation(s)"));
+    cpres_free(reused_data);
+    reused_data = NULL;
+  }
+
+  cpres_free(first_data);
+  cpres_encoder_destroy(encoder);
+}
+
+void test_encoder_pngx_palette256_reuses_scratch(void) {
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_PALETTE256;
+  g_config.pngx_saliency_map_enable = true;
+  g_config.pngx_postprocess_smooth_enable = true;
+
+  assert_pngx_encoder_reuses_scratch();
+}
+
+void test_encoder_pngx_reduced_reuses_scratch(void) {
+  g_config.pngx_lossy_type = CPRES_PNGX_LOSSY_TYPE_REDUCED_RGBA32;
+  g_config.pngx_lossy_dither_level = 0.6f;
+
+  assert_pngx_encoder_reuses_scratch();
+}
+
+void test_encoder_default_config(void) {
+  cpres_encoder_t *encoder = NULL;
+  const uint8_t *png_data = NULL;
+  uint8_t *data = NULL;
+  size_t png_size = 0, size = 0;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for encoder test");
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_create(CPRES_FORMAT_AVIF, NULL, &encoder));
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_encode(encoder, png_data, png_size, &data, &size));
+  TEST_ASSERT_NOT_NULL(data);
+  TEST_ASSERT_GREATER_THAN_size_t(0, size);
+
+  cpres_free(data);
+  cpres_encoder_destroy(encoder);
+}
+
+void test_encoder_survives_bad_input(void) {
+  cpres_encoder_t *encoder = NULL;
+  const uint8_t *png_data = NULL;
+  uint8_t garbage[16], *data = NULL;
+  size_t png_size = 0, size = 0;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for encoder test");
+
+  memset(garbage, 0xAB, sizeof(garbage));
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_create(CPRES_FORMAT_WEBP, &g_config, &encoder));
+  TEST_ASSERT_NOT_EQUAL(CPRES_OK, cpres_encoder_encode(encoder, garbage, sizeof(garbage), &data, &size));
+  TEST_ASSERT_NULL(data);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_encode(encoder, png_data, png_size, &data, &size));
+  TEST_ASSERT_NOT_NULL(data);
+
+  cpres_free(data);
+  cpres_encoder_destroy(encoder);
+}
+
+void test_encoder_invalid_parameters(void) {
+  cpres_encoder_t *encoder = NULL;
+  uint8_t byte = 0, *data = NULL;
+  size_t size = 0;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encoder_create(CPRES_FORMAT_WEBP, &g_config, NULL));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_FORMAT, cpres_encoder_create((cpres_format_t)99, &g_config, &encoder));
+  TEST_ASSERT_NULL(encoder);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, cpres_encoder_create(CPRES_FORMAT_PNGX, &g_config, &encoder));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encoder_encode(NULL, &byte, 1, &data, &size));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encoder_encode(encoder, NULL, 1, &data, &size));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encoder_encode(encoder, &byte, 0, &data, &size));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, cpres_encoder_encode(encoder, &byte, 1, NULL, &size));
+
+  cpres_encoder_destroy(encoder);
+  cpres_encoder_destroy(NULL);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_encoder_webp_matches_one_shot);
+  RUN_TEST(test_encoder_pngx_matches_one_shot);
+  RUN_TEST(test_encoder_pngx_palette256_reuses_scratch);
+  RUN_TEST(test_encoder_pngx_reduced_reuses_scratch);
+  RUN_TEST(test_encoder_default_config);
+  RUN_TEST(test_encoder_survives_bad_input);
+  RUN_TEST(test_encoder_invalid_parameters);
+
+  return UNITY_END();
+}
@@ -0,0 +1,304 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <png.h>
+
+#include <colopresso.h>
+
+#include <unity.h>
+
+#include "../src/internal/png.h"
+#include "test.h"
+
+typedef struct {
+  uint8_t *data;
+  size_t size;
+  size_t capacity;
+} test_png_mem_buffer_t;
+
+typedef struct {
+  uint8_t *rgba;
+  png_uint_32 width;
+  png_uint_32 height;
+  png_uint_32 next_row;
+  uint32_t strips;
+  uint32_t fail_after;
+  bool out_of_order;
+} test_row_collector_t;
+
+static cpres_config_t g_config;
+
+void setUp(void) {
+  cpres_config_init_defaults(&g_config);
+  g_config.webp_method = 0;
+  g_config.avif_speed = 10;
+}
+
+void tearDown(void) { release_cached_example_png(); }
+
+static void png_flush_cb(png_structp png_ptr) { (void)png_ptr; }
+
+static void png_write_cb(png_structp png_ptr, png_bytep data, png_size_t length) {
+  test_png_mem_buffer_t *buf;
+  uint8_t *new_data;
+  size_t new_capacity;
+
+  buf = (test_png_mem_buffer_t *)png_get_io_ptr(png_ptr);
+  if (buf->size + length > buf->capacity) {
+    new_capacity = buf->capacity == 0 ? 1024 : buf->capacity;
+    while (new_capacity < buf->size + length) {
+      new_capacity *= 2;
+    }
+    new_data = (uint8_t *)realloc(buf->data, new_capacity);
+    if (!new_data) {
+      png_error(png_ptr, "out of memory");
+      return;
+    }
+    buf->data = new_data;
+    buf->capacity = new_capacity;
+  }
+
+  memcpy(buf->data + buf->size, data, length);
+  buf->size += length;
+}
+
+static bool build_gradient_png(png_uint_32 width, png_uint_32 height, int interlace, uint8_t **out_png, size_t *out_size) {
+  test_png_mem_buffer_t buf;
+  png_structp png_ptr;
+  png_infop info_ptr;
+  png_bytep row;
+  png_uint_32 x, y;
+  int pass;
+
+  memset(&buf, 0, sizeof(buf));
+
+  row = (png_bytep)malloc((size_t)width * 4);
+  if (!row) {
+    return false;
+  }
+
+  png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+  if (!info_ptr) {
+    png_destroy_write_struct(&png_ptr, NULL);
+    free(row);
+    return false;
+  }
+
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    free(buf.data);
+    free(row);
+    return false;
+  }
+
+  png_set_write_fn(png_ptr, &buf, png_write_cb, png_flush_cb);
+  png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGBA, interlace, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png_ptr, info_ptr);
+
+  /* png_write_row handles the Adam7 passes itself once set_interlace_handling has been called. */
+  for (pass = png_set_interlace_handling(png_ptr); pass > 0; --pass) {
+    for (y = 0; y < height; ++y) {
+      for (x = 0; x < width; ++x) {
+        row[x * 4 + 0] = (png_byte)(x * 255 / width);
+        row[x * 4 + 1] = (png_byte)(y * 255 / height);
+        row[x * 4 + 2] = (png_byte)((x + y) & 0xFF);
+        row[x * 4 + 3] = (png_byte)(255 - ((x * y) & 0x3F));
+      }
+      png_write_row(png_ptr, row);
+    }
+  }
+
+  png_write_end(png_ptr, info_ptr);
+  png_destroy_write_struct(&png_ptr, &info_ptr);
+  free(row);
+
+  *out_png = buf.data;
+  *out_size = buf.size;
+
+  return true;
+}
+
+static cpres_error_t collector_begin(void *context, png_uint_32 width, png_uint_32 height) {
+  test_row_collector_t *collector = (test_row_collector_t *)context;
+
+  collector->rgba = (uint8_t *)malloc((size_t)width * height * 4);
+  if (!collector->rgba) {
+    return CPRES_ERROR_OUT_OF_MEMORY;
+  }
+  collector->width = width;
+  collector->height = height;
+
+  return CPRES_OK;
+}
+
+static cpres_error_t collector_rows(void *context, const uint8_t *rgba, png_uint_32 first_row, png_uint_32 row_count) {
+  test_row_collector_t *collector = (test_row_collector_t *)context;
+
+  if (collector->fail_after > 0 && collector->strips >= collector->fail_after) {
+    return CPRES_ERROR_ENCODE_FAILED;
+  }
+
+  if (first_row != collector->next_row || row_count == 0 || row_count > PNG_ROW_STRIP_ROWS || first_row + row_count > collector->height) {
+    collector->out_of_order = true;
+    return CPRES_ERROR_INVALID_PARAMETER;
+  }
+
+  memcpy(collector->rgba + (size_t)first_row * collector->width * 4, rgba, (size_t)row_count * collector->width * 4);
+  collector->next_row += row_count;
+  ++collector->strips;
+
+  return CPRES_OK;
+}
+
+static void assert_rows_match_full_decode(const uint8_t *png_data, size_t png_size) {
+  test_row_collector_t collector;
+  png_row_input_t input;
+  png_row_sink_t sink;
+  png_uint_32 width = 0, height = 0;
+  uint8_t *full = NULL;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, png_decode_from_memory(png_data, png_size, &full, &width, &height));
+
+  memset(&collector, 0, sizeof(collector));
+  input.png_data = png_data;
+  input.png_size = png_size;
+  input.path = NULL;
+  sink.begin = collector_begin;
+  sink.rows = collector_rows;
+  sink.context = &collector;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, png_decode_rows(&input, &sink));
+  TEST_ASSERT_FALSE(collector.out_of_order);
+  TEST_ASSERT_EQUAL_UINT32(width, collector.width);
+  TEST_ASSERT_EQUAL_UINT32(height, collector.height);
+  TEST_ASSERT_EQUAL_UINT32(height, collector.next_row);
+  TEST_ASSERT_EQUAL_UINT32((height + PNG_ROW_STRIP_ROWS - 1) / PNG_ROW_STRIP_ROWS, collector.strips);
+  TEST_ASSERT_EQUAL_MEMORY(full, collector.rgba, (size_t)width * height * 4);
+
+  free(collector.rgba);
+  free(full);
+}
+
+void test_png_decode_rows_matches_full_decode(void) {
+  const uint8_t *png_data;
+  size_t png_size = 0;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for memory-limited test");
+
+  assert_rows_match_full_decode(png_data, png_size);
+}
+
+void test_png_decode_rows_interlaced_falls_back(void) {
+  uint8_t *png_data = NULL;
+  size_t png_size = 0;
+
+  TEST_ASSERT_TRUE(build_gradient_png(97, 150, PNG_INTERLACE_ADAM7, &png_data, &png_size));
+  assert_rows_match_full_decode(png_data, png_size);
+  free(png_data);
+
+  TEST_ASSERT_TRUE(build_gradient_png(97, 150, PNG_INTERLACE_NONE, &png_data, &png_size));
+  assert_rows_match_full_decode(png_data, png_size);
+  free(png_data);
+}
+
+void test_png_decode_rows_stops_on_sink_error(void) {
+  test_row_collector_t collector;
+  png_row_input_t input;
+  png_row_sink_t sink;
+  uint8_t *png_data = NULL;
+  size_t png_size = 0;
+
+  TEST_ASSERT_TRUE(build_gradient_png(64, 300, PNG_INTERLACE_NONE, &png_data, &png_size));
+
+  memset(&collector, 0, sizeof(collector));
+  collector.fail_after = 2;
+  input.png_data = png_data;
+  input.png_size = png_size;
+  input.path = NULL;
+  sink.begin = collector_begin;
+  sink.rows = collector_rows;
+  sink.context = &collector;
+
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_ENCODE_FAILED, png_decode_rows(&input, &sink));
+  TEST_ASSERT_EQUAL_UINT32(2, collector.strips);
+
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, png_decode_rows(NULL, &sink));
+  TEST_ASSERT_EQUAL_INT(CPRES_ERROR_INVALID_PARAMETER, png_decode_rows(&input, NULL));
+
+  free(collector.rgba);
+  free(png_data);
+}
+
+static void assert_memory_limited_matches(cpres_format_t format) {
+  const uint8_t *png_data;
+  uint8_t *buffered = NULL, *streamed = NULL;
+  size_t png_size = 0, buffered_size = 0, streamed_size = 0;
+  cpres_error_t buffered_error, streamed_error;
+
+  png_data = get_cached_example_png(&png_size);
+  TEST_ASSERT_NOT_NULL_MESSAGE(png_data, "example.png not found for memory-limited test");
+
+  if (format == CPRES_FORMAT_WEBP) {
+    buffered_error = cpres_encode_webp_memory(png_data, png_size, &buffered, &buffered_size, &g_config);
+    g_config.memory_limited = true;
+    streamed_error = cpres_encode_webp_memory(png_data, png_size, &streamed, &streamed_size, &g_config);
+  } else {
+    buffered_error = cpres_encode_avif_memory(png_data, png_size, &buffered, &buffered_size, &g_config);
+    g_config.memory_limited = true;
+    streamed_error = cpres_encode_avif_memory(png_data, png_size, &streamed, &streamed_size, &g_config);
+  }
+
+  TEST_ASSERT_EQUAL_INT(CPRES_OK, buffered_error);
+  TEST_ASSERT_EQUAL_INT(buffered_error, streamed_error);
+  TEST_ASSERT_EQUAL_size_t(buffered_size, streamed_size);
+  TEST_ASSERT_EQUAL_MEMORY(buffered, streamed, buffered_size);
+
+  cpres_free(buffered);
+  cpres_free(streamed);
+}
+
+void test_webp_memory_limited_matches_buffered(void) { assert_memory_limited_matches(CPRES_FORMAT_WEBP); }
+
+void test_avif_memory_limited_matches_buffered(void) { assert_memory_limited_matches(CPRES_FORMAT_AVIF); }
+
+void test_memory_limited_rejects_invalid_png(void) {
+  uint8_t garbage[64], *out = NULL;
+  size_t out_size = 0;
+
+  memset(garbage, 0xCD, sizeof(garbage));
+  g_config.memory_limited = true;
+
+  TEST_ASSERT_NOT_EQUAL(CPRES_OK, cpres_encode_webp_memory(garbage, sizeof(garbage), &out, &out_size, &g_config));
+  TEST_ASSERT_NULL(out);
+  TEST_ASSERT_NOT_EQUAL(CPRES_OK, cpres_encode_avif_memory(garbage, sizeof(garbage), &out, &out_size, &g_config));
+  TEST_ASSERT_NULL(out);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_png_decode_rows_matches_full_decode);
+  RUN_TEST(test_png_decode_rows_interlaced_falls_back);
+  RUN_TEST(test_png_decode_rows_stops_on_sink_error);
+  RUN_TEST(test_webp_memory_limited_matches_buffered);
+  RUN_TEST(test_avif_memory_limited_matches_buffered);
+  RUN_TEST(test_memory_limited_rejects_invalid_png);
+
+  return UNITY_END();
+}
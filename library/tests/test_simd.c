@@ -0,0 +1,306 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <colopresso.h>
+
+#include <unity.h>
+
+#include "../src/internal/pngx_common.h"
+#include "../src/internal/simd.h"
+
+/* Long enough to cover every channel value in every lane position plus a tail the block kernels leave to the scalar path. */
+#define TEST_SNAP_PIXELS (256 * 4 + 37)
+
+static const cpres_simd_level_t kLevels[] = {CPRES_SIMD_LEVEL_NONE, CPRES_SIMD_LEVEL_SSE2, CPRES_SIMD_LEVEL_SSE41, CPRES_SIMD_LEVEL_AVX2, CPRES_SIMD_LEVEL_NEON, CPRES_SIMD_LEVEL_WASM128};
+
+#define TEST_SIMD_LEVEL_COUNT (sizeof(kLevels) / sizeof(kLevels[0]))
+
+void setUp(void) {}
+
+void tearDown(void) { simd_force_level(simd_detected_level()); }
+
+static void fill_pattern(uint8_t *rgba, size_t pixel_count) {
+  size_t i;
+
+  for (i = 0; i < pixel_count * 4; ++i) {
+    rgba[i] = (uint8_t)((i / 4) + (i % 4) * 67);
+  }
+}
+
+static void snap_reference(uint8_t *rgba, size_t pixel_count, uint8_t bits_rgb, uint8_t bits_alpha) {
+  size_t i;
+
+  for (i = 0; i < pixel_count; ++i) {
+    rgba[i * 4 + 0] = quantize_bits(rgba[i * 4 + 0], bits_rgb);
+    rgba[i * 4 + 1] = quantize_bits(rgba[i * 4 + 1], bits_rgb);
+    rgba[i * 4 + 2] = quantize_bits(rgba[i * 4 + 2], bits_rgb);
+    rgba[i * 4 + 3] = quantize_bits(rgba[i * 4 + 3], bits_alpha);
+  }
+}
+
+void test_simd_level_reports_detected(void) {
+  cpres_simd_level_t detected = simd_detected_level();
+
+  TEST_ASSERT_EQUAL_INT(detected, cpres_get_simd_level());
+  TEST_ASSERT_NOT_NULL(cpres_simd_level_string(detected));
+
+  TEST_ASSERT_TRUE(simd_force_level(CPRES_SIMD_LEVEL_NONE));
+  TEST_ASSERT_EQUAL_INT(CPRES_SIMD_LEVEL_NONE, cpres_get_simd_level());
+  TEST_ASSERT_EQUAL_STRING("scalar", cpres_simd_level_string(CPRES_SIMD_LEVEL_NONE));
+
+  TEST_ASSERT_TRUE(simd_force_level(detected));
+  TEST_ASSERT_EQUAL_INT(detected, cpres_get_simd_level());
+}
+
+void test_simd_force_level_rejects_unsupported(void) {
+  cpres_simd_level_t detected = simd_detected_level();
+  size_t l;
+
+  for (l = 0; l < TEST_SIMD_LEVEL_COUNT; ++l) {
+    if (!simd_force_level(kLevels[l])) {
+      TEST_ASSERT_NOT_EQUAL(detected, kLevels[l]);
+      TEST_ASSERT_EQUAL_INT(detected, cpres_get_simd_level());
+    }
+  }
+}
+
+void test_simd_snap_matches_scalar_for_every_depth(void) {
+  uint8_t expected[TEST_SNAP_PIXELS * 4], actual[TEST_SNAP_PIXELS * 4];
+  uint8_t bits_rgb, bits_alpha;
+  char message[64];
+  size_t l;
+
+  for (l = 0; l < TEST_SIMD_LEVEL_COUNT; ++l) {
+    if (!simd_force_level(kLevels[l])) {
+      continue;
+    }
+
+    for (bits_rgb = 0; bits_rgb <= 9; ++bits_rgb) {
+      for (bits_alpha = 0; bits_alpha <= 9; ++bits_alpha) {
+        fill_pattern(expected, TEST_SNAP_PIXELS);
+        memcpy(actual, expected, sizeof(actual));
+
+        snap_reference(expected, TEST_SNAP_PIXELS, bits_rgb, bits_alpha);
+        simd_snap_rgba_bits(actual, TEST_SNAP_PIXELS, bits_rgb, bits_alpha);
+
+        snprintf(message, sizeof(message), "%s kernel, bits %u/%u", cpres_simd_level_string(kLevels[l]), (unsigned)bits_rgb, (unsigned)bits_alpha);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, actual, sizeof(actual), message);
+      }
+    }
+  }
+}
+
+void test_simd_snap_handles_short_and_unaligned_runs(void) {
+  uint8_t storage[(64 + 1) * 4 + 1], expected[64 * 4], *actual = storage + 1;
+  size_t count, l;
+
+  for (l = 0; l < TEST_SIMD_LEVEL_COUNT; ++l) {
+    if (!simd_force_level(kLevels[l])) {
+      continue;
+    }
+
+    for (count = 0; count <= 64; ++count) {
+      fill_pattern(expected, count);
+      memcpy(actual, expected, count * 4);
+      actual[count * 4] = 0xA5;
+
+      snap_reference(expected, count, 4, 3);
+      simd_snap_rgba_bits(actual, count, 4, 3);
+
+      TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, actual, count * 4, cpres_simd_level_string(kLevels[l]));
+      TEST_ASSERT_EQUAL_HEX8(0xA5, actual[count * 4]);
+    }
+  }
+}
+
+void test_simd_snap_pixel_matches_scalar(void) {
+  uint8_t expected[4], actual[4];
+  uint8_t bits_rgb, bits_alpha;
+  uint32_t value;
+  size_t l;
+
+  for (l = 0; l < TEST_SIMD_LEVEL_COUNT; ++l) {
+    if (!simd_force_level(kLevels[l])) {
+      continue;
+    }
+
+    for (bits_rgb = 0; bits_rgb <= 9; ++bits_rgb) {
+      for (bits_alpha = 0; bits_alpha <= 9; ++bits_alpha) {
+        for (value = 0; value < 256; ++value) {
+          expected[0] = (uint8_t)value;
+          expected[1] = (uint8_t)(255 - value);
+          expected[2] = (uint8_t)(value * 7);
+          expected[3] = (uint8_t)(value * 13);
+          memcpy(actual, expected, sizeof(actual));
+
+          snap_reference(expected, 1, bits_rgb, bits_alpha);
+          simd_snap_rgba_pixel(actual, bits_rgb, bits_alpha);
+
+          TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, actual, sizeof(actual), cpres_simd_level_string(kLevels[l]));
+        }
+      }
+    }
+  }
+}
+
+static uint32_t next_random(uint32_t *state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state;
+}
+
+/* coarse limits channels to a few levels so palettes are full of equal distances and the tie-breaking is exercised. */
+static void fill_palette(uint32_t *colors, size_t count, uint32_t seed, bool coarse) {
+  uint32_t state = seed, value;
+  size_t i;
+
+  for (i = 0; i < count; ++i) {
+    value = next_random(&state);
+    colors[i] = coarse ? (value & 0xC0C0C0C0u) : value;
+  }
+}
+
+static size_t nearest_reference(const uint32_t *colors, size_t count, uint32_t color, uint32_t *out_dist) {
+  uint32_t best_dist = UINT32_MAX, dist;
+  size_t best = 0, i;
+
+  for (i = 0; i < count; ++i) {
+    dist = simd_color_distance_sq_u32(color, colors[i]);
+    if (dist < best_dist) {
+      best_dist = dist;
+      best = i;
+    }
+  }
+
+  *out_dist = best_dist;
+  return best;
+}
+
+void test_simd_palette_nearest_matches_scan(void) {
+  static const size_t sizes[] = {1, 3, 4, 5, 8, 9, 15, 16, 17, 31, 33, 100, 257};
+  simd_palette_t palette;
+  uint32_t colors[257], query, expected_dist, actual_dist, state = 0x2468ace0u;
+  size_t s, q, l, expected, actual;
+  int pass;
+  bool coarse;
+
+  for (l = 0; l < TEST_SIMD_LEVEL_COUNT; ++l) {
+    if (!simd_force_level(kLevels[l])) {
+      continue;
+    }
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+      for (pass = 0; pass < 2; ++pass) {
+        coarse = pass == 1;
+        fill_palette(colors, sizes[s], (uint32_t)(sizes[s] * 31u), coarse);
+        TEST_ASSERT_TRUE(simd_palette_init(&palette, colors, sizes[s]));
+
+        for (q = 0; q < 64; ++q) {
+          query = coarse ? (next_random(&state) & 0xE0E0E0E0u) : next_random(&state);
+          expected = nearest_reference(colors, sizes[s], query, &expected_dist);
+          actual = simd_palette_nearest(&palette, 0, sizes[s], query, &actual_dist);
+
+          TEST_ASSERT_EQUAL_size_t_MESSAGE(expected, actual, cpres_simd_level_string(kLevels[l]));
+          TEST_ASSERT_EQUAL_UINT32(expected_dist, actual_dist);
+        }
+
+        /* Sub-ranges start off the vector alignment, as k-d tree leaves do. */
+        if (sizes[s] > 2) {
+          query = next_random(&state);
+          expected = 1 + nearest_reference(colors + 1, sizes[s] - 2, query, &expected_dist);
+          actual = simd_palette_nearest(&palette, 1, sizes[s] - 1, query, &actual_dist);
+          TEST_ASSERT_EQUAL_size_t(expected, actual);
+          TEST_ASSERT_EQUAL_UINT32(expected_dist, actual_dist);
+        }
+
+        simd_palette_free(&palette);
+      }
+    }
+  }
+}
+
+void test_palette_index_matches_scan(void) {
+  static const size_t sizes[] = {1, 2, 32, 33, 65, 500, 4096, 32768};
+  pngx_palette_index_t index;
+  uint32_t *colors, query, expected_dist, state = 0x13579bdfu;
+  size_t s, q, expected;
+  int pass;
+  bool coarse;
+
+  colors = (uint32_t *)malloc(sizeof(uint32_t) * 32768);
+  TEST_ASSERT_NOT_NULL(colors);
+
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    for (pass = 0; pass < 2; ++pass) {
+      coarse = pass == 1;
+      fill_palette(colors, sizes[s], (uint32_t)(sizes[s] * 131u + 7u), coarse);
+      TEST_ASSERT_TRUE(palette_index_build(&index, colors, sizes[s]));
+
+      for (q = 0; q < 256; ++q) {
+        query = (q & 1) ? colors[next_random(&state) % sizes[s]] : next_random(&state);
+        if (coarse) {
+          query &= 0xE0E0E0E0u;
+        }
+        expected = nearest_reference(colors, sizes[s], query, &expected_dist);
+
+        TEST_ASSERT_EQUAL_UINT32((uint32_t)expected, palette_index_nearest(&index, query));
+      }
+
+      palette_index_free(&index);
+    }
+  }
+
+  TEST_ASSERT_FALSE(palette_index_build(&index, colors, 0));
+  palette_index_free(&index);
+
+  free(colors);
+}
+
+void test_snap_rgba_image_to_bits_matches_scalar(void) {
+  uint8_t *expected, *actual;
+  size_t pixel_count = 4096 + 13;
+
+  expected = (uint8_t *)malloc(pixel_count * 4);
+  actual = (uint8_t *)malloc(pixel_count * 4);
+  TEST_ASSERT_NOT_NULL(expected);
+  TEST_ASSERT_NOT_NULL(actual);
+
+  fill_pattern(expected, pixel_count);
+  memcpy(actual, expected, pixel_count * 4);
+
+  snap_reference(expected, pixel_count, 4, 4);
+  snap_rgba_image_to_bits(4, actual, pixel_count, 4, 4);
+
+  TEST_ASSERT_EQUAL_MEMORY(expected, actual, pixel_count * 4);
+
+  free(expected);
+  free(actual);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_simd_level_reports_detected);
+  RUN_TEST(test_simd_force_level_rejects_unsupported);
+  RUN_TEST(test_simd_snap_matches_scalar_for_every_depth);
+  RUN_TEST(test_simd_snap_handles_short_and_unaligned_runs);
+  RUN_TEST(test_simd_snap_pixel_matches_scalar);
+  RUN_TEST(test_simd_palette_nearest_matches_scan);
+  RUN_TEST(test_palette_index_matches_scan);
+  RUN_TEST(test_snap_rgba_image_to_bits_matches_scalar);
+
+  return UNITY_END();
+}
@@ -143,6 +143,40 @@ void test_thread_parallel_for_large_item_count(void) {
   colopresso_mutex_destroy(&ctx.mutex);
 }
 
+void test_thread_parallel_for_reuses_pool_across_calls(void) {
+  parallel_test_ctx_t ctx = {0, 0};
+  uint32_t i;
+  bool result = true;
+
+  colopresso_mutex_init(&ctx.mutex, NULL);
+  for (i = 0; i < 200; ++i) {
+    result = colopresso_parallel_for(4, 64, parallel_test_worker, &ctx) && result;
+  }
+
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT32(200 * 64, ctx.total_items);
+  colopresso_mutex_destroy(&ctx.mutex);
+}
+
+void test_thread_pool_shutdown_and_restart(void) {
+  parallel_test_ctx_t ctx = {0, 0};
+  bool result;
+
+  colopresso_mutex_init(&ctx.mutex, NULL);
+  result = colopresso_parallel_for(4, 100, parallel_test_worker, &ctx);
+  TEST_ASSERT_TRUE(result);
+
+  cpres_thread_pool_shutdown();
+  cpres_thread_pool_shutdown();
+
+  result = colopresso_parallel_for(4, 100, parallel_test_worker, &ctx);
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT32(200, ctx.total_items);
+
+  cpres_thread_pool_shutdown();
+  colopresso_mutex_destroy(&ctx.mutex);
+}
+
 #endif
 
 void test_thread_dummy(void) { TEST_ASSERT_TRUE(true); }
@@ -161,6 +195,8 @@ int main(void) {
   RUN_TEST(test_thread_parallel_for_default_threads);
   RUN_TEST(test_thread_parallel_for_more_threads_than_items);
   RUN_TEST(test_thread_parallel_for_large_item_count);
+  RUN_TEST(test_thread_parallel_for_reuses_pool_across_calls);
+  RUN_TEST(test_thread_pool_shutdown_and_restart);
 #endif
 
   RUN_TEST(test_thread_dummy);
@@ -0,0 +1,238 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <colopresso.h>
+#include <colopresso/portable.h>
+
+#include "../src/internal/threads.h"
+
+#define DEFAULT_ITERATIONS 2000
+#define DEFAULT_ITEMS 1024
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_BOLD "\033[1m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_CYAN "\033[36m"
+#define COLOR_YELLOW "\033[33m"
+
+typedef struct {
+  volatile uint32_t *sink;
+} dispatch_ctx_t;
+
+static void dispatch_noop_worker(void *context, uint32_t start_index, uint32_t end_index) {
+  dispatch_ctx_t *ctx = (dispatch_ctx_t *)context;
+  uint32_t i, acc = 0;
+
+  for (i = start_index; i < end_index; ++i) {
+    acc += i;
+  }
+
+  ctx->sink[start_index] = acc;
+}
+
+static double get_time_us(void) {
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+
+  return (double)tv.tv_sec * 1000000.0 + (double)tv.tv_usec;
+}
+
+static inline bool parse_u32_value(const char *value, uint32_t *out) {
+  char *endptr = NULL;
+  unsigned long parsed;
+
+  if (!value || !out) {
+    return false;
+  }
+
+  errno = 0;
+  parsed = strtoul(value, &endptr, 10);
+  if (errno != 0 || endptr == value || *endptr != '\0' || parsed == 0 || parsed > UINT32_MAX) {
+    return false;
+  }
+
+  *out = (uint32_t)parsed;
+  return true;
+}
+
+static void print_usage(const char *program_name) {
+  printf("Usage: %s [--threads N] [--iterations N] [--items N]\n", program_name ? program_name : "dispatch");
+}
+
+#if COLOPRESSO_ENABLE_THREADS
+
+typedef struct {
+  parallel_func_t func;
+  void *context;
+  uint32_t start_index;
+  uint32_t end_index;
+} spawn_work_t;
+
+static void *spawn_worker(void *arg) {
+  spawn_work_t *work = (spawn_work_t *)arg;
+
+  work->func(work->context, work->start_index, work->end_index);
+
+  return NULL;
+}
+
+static bool spawn_parallel_for(uint32_t thread_count, uint32_t total_items, parallel_func_t func, void *context) {
+  colopresso_thread_t threads[64];
+  spawn_work_t works[64];
+  uint32_t chunk_size, remainder, start = 0, end, i;
+
+  if (thread_count > 64) {
+    thread_count = 64;
+  }
+  if (thread_count > total_items) {
+    thread_count = total_items;
+  }
+
+  chunk_size = total_items / thread_count;
+  remainder = total_items % thread_count;
+
+  for (i = 0; i < thread_count; ++i) {
+    end = start + chunk_size + (i < remainder ? 1 : 0);
+    works[i].func = func;
+    works[i].context = context;
+    works[i].start_index = start;
+    works[i].end_index = end;
+    if (colopresso_thread_create(&threads[i], NULL, spawn_worker, &works[i]) != 0) {
+      return false;
+    }
+    start = end;
+  }
+
+  for (i = 0; i < thread_count; ++i) {
+    colopresso_thread_join(threads[i], NULL);
+  }
+
+  return true;
+}
+
+static double measure_pool(uint32_t thread_count, uint32_t iterations, uint32_t items, dispatch_ctx_t *ctx) {
+  double start;
+  uint32_t i;
+
+  start = get_time_us();
+  for (i = 0; i < iterations; ++i) {
+    colopresso_parallel_for(thread_count, items, dispatch_noop_worker, ctx);
+  }
+
+  return (get_time_us() - start) / (double)iterations;
+}
+
+static double measure_spawn(uint32_t thread_count, uint32_t iterations, uint32_t items, dispatch_ctx_t *ctx) {
+  double start;
+  uint32_t i;
+
+  start = get_time_us();
+  for (i = 0; i < iterations; ++i) {
+    if (!spawn_parallel_for(thread_count, items, dispatch_noop_worker, ctx)) {
+      return -1.0;
+    }
+  }
+
+  return (get_time_us() - start) / (double)iterations;
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+  uint32_t thread_count = 0, iterations = DEFAULT_ITERATIONS, items = DEFAULT_ITEMS, *target;
+  volatile uint32_t *sink;
+  dispatch_ctx_t ctx;
+  const char *arg;
+  int i;
+#if COLOPRESSO_ENABLE_THREADS
+  double pool_us, spawn_us, cold_us;
+#endif
+
+  for (i = 1; i < argc; ++i) {
+    arg = argv[i];
+    if (strcmp(arg, "--threads") == 0 || strcmp(arg, "-t") == 0) {
+      target = &thread_count;
+    } else if (strcmp(arg, "--iterations") == 0 || strcmp(arg, "-n") == 0) {
+      target = &iterations;
+    } else if (strcmp(arg, "--items") == 0) {
+      target = &items;
+    } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+      print_usage(argv[0]);
+      return 0;
+    } else {
+      fprintf(stderr, "Error: Unknown option '%s'\n", arg);
+      print_usage(argv[0]);
+      return 1;
+    }
+
+    if (i + 1 >= argc || !parse_u32_value(argv[i + 1], target)) {
+      fprintf(stderr, "Error: %s requires a positive integer\n", arg);
+      print_usage(argv[0]);
+      return 1;
+    }
+    ++i;
+  }
+
+#if COLOPRESSO_ENABLE_THREADS
+  if (thread_count == 0) {
+    thread_count = cpres_get_max_thread_count();
+  }
+  if (thread_count < 2) {
+    thread_count = 2;
+  }
+
+  sink = (volatile uint32_t *)calloc(items, sizeof(uint32_t));
+  if (!sink) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 1;
+  }
+  ctx.sink = sink;
+
+  printf(COLOR_BOLD "parallel_for dispatch overhead" COLOR_RESET "\n");
+  printf("  Threads:    " COLOR_CYAN "%u" COLOR_RESET "\n", thread_count);
+  printf("  Iterations: " COLOR_CYAN "%u" COLOR_RESET "\n", iterations);
+  printf("  Items:      " COLOR_CYAN "%u" COLOR_RESET "\n\n", items);
+
+  cold_us = measure_pool(thread_count, 1, items, &ctx);
+  pool_us = measure_pool(thread_count, iterations, items, &ctx);
+  spawn_us = measure_spawn(thread_count, iterations, items, &ctx);
+
+  printf("  %-28s " COLOR_CYAN "%10.2f" COLOR_RESET " us\n", "pool (first call, cold)", cold_us);
+  printf("  %-28s " COLOR_CYAN "%10.2f" COLOR_RESET " us/call\n", "pool (warm)", pool_us);
+  if (spawn_us < 0.0) {
+    printf("  %-28s " COLOR_YELLOW "[FAILED]" COLOR_RESET "\n", "spawn + join per call");
+  } else {
+    printf("  %-28s " COLOR_CYAN "%10.2f" COLOR_RESET " us/call\n", "spawn + join per call", spawn_us);
+    if (pool_us > 0.0) {
+      printf("\n  " COLOR_GREEN "Pool speedup: %.1fx" COLOR_RESET "\n", spawn_us / pool_us);
+    }
+  }
+
+  cpres_thread_pool_shutdown();
+  free((void *)sink);
+#else
+  (void)sink;
+  (void)ctx;
+  printf(COLOR_YELLOW "Threads are disabled in this build; nothing to measure." COLOR_RESET "\n");
+#endif
+
+  return 0;
+}
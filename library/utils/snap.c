@@ -0,0 +1,204 @@
+/*
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This file is part of colopresso
+ *
+ * Copyright (C) 2025-2026 COLOPL, Inc.
+ *
+ * Author: Go Kudo <g-kudo@colopl.co.jp>
+ * Developed with AI (LLM) code assistance. See `NOTICE` for details.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <colopresso.h>
+
+#include "../src/internal/pngx_common.h"
+#include "../src/internal/simd.h"
+
+#define DEFAULT_ITERATIONS 20
+#define DEFAULT_PIXELS (2048u * 2048u)
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_BOLD "\033[1m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_CYAN "\033[36m"
+#define COLOR_YELLOW "\033[33m"
+
+typedef struct {
+  const char *name;
+  uint8_t bits_rgb;
+  uint8_t bits_alpha;
+} snap_case_t;
+
+static const snap_case_t kSnapCases[] = {
+    {"limited4444 (4/4)", 4, 4},
+    {"reduced_rgba32 (5/8)", 5, 8},
+    {"reduced_rgba32 (3/2)", 3, 2},
+};
+
+static const cpres_simd_level_t kLevels[] = {CPRES_SIMD_LEVEL_SSE2, CPRES_SIMD_LEVEL_SSE41, CPRES_SIMD_LEVEL_AVX2, CPRES_SIMD_LEVEL_NEON, CPRES_SIMD_LEVEL_WASM128};
+
+static double get_time_us(void) {
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+
+  return (double)tv.tv_sec * 1000000.0 + (double)tv.tv_usec;
+}
+
+static inline bool parse_u32_value(const char *value, uint32_t *out) {
+  char *endptr = NULL;
+  unsigned long parsed;
+
+  if (!value || !out) {
+    return false;
+  }
+
+  errno = 0;
+  parsed = strtoul(value, &endptr, 10);
+  if (errno != 0 || endptr == value || *endptr != '\0' || parsed == 0 || parsed > UINT32_MAX) {
+    return false;
+  }
+
+  *out = (uint32_t)parsed;
+  return true;
+}
+
+static void print_usage(const char *program_name) { printf("Usage: %s [--iterations N] [--pixels N]\n", program_name ? program_name : "snap"); }
+
+static void fill_source(uint8_t *rgba, size_t pixel_count) {
+  uint32_t state = 0x12345678u;
+  size_t i;
+
+  for (i = 0; i < pixel_count * 4; ++i) {
+    state = state * 1664525u + 1013904223u;
+    rgba[i] = (uint8_t)(state >> 24);
+  }
+}
+
+/* The per-channel loop snap_rgba_image_to_bits ran before the vector kernels. */
+static void snap_scalar(uint8_t *rgba, size_t pixel_count, uint8_t bits_rgb, uint8_t bits_alpha) {
+  size_t i;
+
+  for (i = 0; i < pixel_count; ++i) {
+    snap_rgba_to_bits(&rgba[i * 4 + 0], &rgba[i * 4 + 1], &rgba[i * 4 + 2], &rgba[i * 4 + 3], bits_rgb, bits_alpha);
+  }
+}
+
+static void snap_pixelwise(uint8_t *rgba, size_t pixel_count, uint8_t bits_rgb, uint8_t bits_alpha) {
+  size_t i;
+
+  for (i = 0; i < pixel_count; ++i) {
+    simd_snap_rgba_pixel(rgba + i * 4, bits_rgb, bits_alpha);
+  }
+}
+
+static void snap_block(uint8_t *rgba, size_t pixel_count, uint8_t bits_rgb, uint8_t bits_alpha) { simd_snap_rgba_bits(rgba, pixel_count, bits_rgb, bits_alpha); }
+
+static double measure(void (*kernel)(uint8_t *, size_t, uint8_t, uint8_t), const uint8_t *source, uint8_t *work, size_t pixel_count, uint32_t iterations, const snap_case_t *snap_case) {
+  double total = 0.0, start;
+  uint32_t i;
+
+  for (i = 0; i < iterations; ++i) {
+    memcpy(work, source, pixel_count * 4);
+    start = get_time_us();
+    kernel(work, pixel_count, snap_case->bits_rgb, snap_case->bits_alpha);
+    total += get_time_us() - start;
+  }
+
+  return total / (double)iterations;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t iterations = DEFAULT_ITERATIONS, pixels = DEFAULT_PIXELS, *target;
+  uint8_t *source, *expected, *work;
+  double scalar_us, pixel_us, block_us, mpix;
+  const char *arg;
+  size_t c, l;
+  int i;
+
+  for (i = 1; i < argc; ++i) {
+    arg = argv[i];
+    if (strcmp(arg, "--iterations") == 0 || strcmp(arg, "-n") == 0) {
+      target = &iterations;
+    } else if (strcmp(arg, "--pixels") == 0) {
+      target = &pixels;
+    } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+      print_usage(argv[0]);
+      return 0;
+    } else {
+      fprintf(stderr, "Error: Unknown option '%s'\n", arg);
+      print_usage(argv[0]);
+      return 1;
+    }
+
+    if (i + 1 >= argc || !parse_u32_value(argv[i + 1], target)) {
+      fprintf(stderr, "Error: %s requires a positive integer\n", arg);
+      print_usage(argv[0]);
+      return 1;
+    }
+    ++i;
+  }
+
+  source = (uint8_t *)malloc((size_t)pixels * 4);
+  expected = (uint8_t *)malloc((size_t)pixels * 4);
+  work = (uint8_t *)malloc((size_t)pixels * 4);
+  if (!source || !expected || !work) {
+    fprintf(stderr, "Error: Out of memory\n");
+    free(source);
+    free(expected);
+    free(work);
+    return 1;
+  }
+  fill_source(source, pixels);
+  mpix = (double)pixels / 1000000.0;
+
+  printf(COLOR_BOLD "RGBA bit-snapping kernels" COLOR_RESET "\n");
+  printf("  Detected:   " COLOR_CYAN "%s" COLOR_RESET "\n", cpres_simd_level_string(simd_detected_level()));
+  printf("  Pixels:     " COLOR_CYAN "%u" COLOR_RESET "\n", pixels);
+  printf("  Iterations: " COLOR_CYAN "%u" COLOR_RESET "\n", iterations);
+
+  for (c = 0; c < sizeof(kSnapCases) / sizeof(kSnapCases[0]); ++c) {
+    memcpy(expected, source, (size_t)pixels * 4);
+    snap_scalar(expected, pixels, kSnapCases[c].bits_rgb, kSnapCases[c].bits_alpha);
+    scalar_us = measure(snap_scalar, source, work, pixels, iterations, &kSnapCases[c]);
+
+    printf("\n  " COLOR_BOLD "%s" COLOR_RESET "\n", kSnapCases[c].name);
+    printf("    %-8s %8.1f Mpx/s\n", "scalar", mpix / (scalar_us / 1000000.0));
+
+    for (l = 0; l < sizeof(kLevels) / sizeof(kLevels[0]); ++l) {
+      if (!simd_force_level(kLevels[l])) {
+        continue;
+      }
+
+      pixel_us = measure(snap_pixelwise, source, work, pixels, iterations, &kSnapCases[c]);
+      if (memcmp(expected, work, (size_t)pixels * 4) != 0) {
+        printf("    %-8s " COLOR_YELLOW "[MISMATCH: pixel kernel]" COLOR_RESET "\n", cpres_simd_level_string(kLevels[l]));
+        continue;
+      }
+      block_us = measure(snap_block, source, work, pixels, iterations, &kSnapCases[c]);
+      if (memcmp(expected, work, (size_t)pixels * 4) != 0) {
+        printf("    %-8s " COLOR_YELLOW "[MISMATCH: block kernel]" COLOR_RESET "\n", cpres_simd_level_string(kLevels[l]));
+        continue;
+      }
+
+      printf("    %-8s pixel " COLOR_CYAN "%8.1f" COLOR_RESET " Mpx/s  block " COLOR_CYAN "%8.1f" COLOR_RESET " Mpx/s  " COLOR_GREEN "(%.1fx)" COLOR_RESET "\n", cpres_simd_level_string(kLevels[l]),
+             mpix / (pixel_us / 1000000.0), mpix / (block_us / 1000000.0), block_us > 0.0 ? scalar_us / block_us : 0.0);
+    }
+  }
+  simd_force_level(simd_detected_level());
+
+  free(source);
+  free(expected);
+  free(work);
+
+  return 0;
+}
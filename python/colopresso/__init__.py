@@ -12,11 +12,15 @@ colopresso - Image compression and color reduction library
 """
 
 from .core import (
+    CancelToken,
     Config,
     PngxLossyType,
     encode_webp,
     encode_avif,
     encode_pngx,
+    enable_cache,
+    disable_cache,
+    get_cache_stats,
     get_version,
     get_libwebp_version,
     get_libpng_version,
@@ -26,6 +30,7 @@ from .core import (
     get_buildtime,
     get_compiler_version_string,
     get_rust_version_string,
+    get_simd_level,
     is_threads_enabled,
     get_default_thread_count,
     get_max_thread_count,
@@ -33,11 +38,15 @@ from .core import (
 )
 
 __all__ = [
+    "CancelToken",
     "Config",
     "PngxLossyType",
     "encode_webp",
     "encode_avif",
     "encode_pngx",
+    "enable_cache",
+    "disable_cache",
+    "get_cache_stats",
     "get_version",
     "get_libwebp_version",
     "get_libpng_version",
@@ -47,6 +56,7 @@ __all__ = [
     "get_buildtime",
     "get_compiler_version_string",
     "get_rust_version_string",
+    "get_simd_level",
     "is_threads_enabled",
     "get_default_thread_count",
     "get_max_thread_count",
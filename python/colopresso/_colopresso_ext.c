@@ -22,11 +22,64 @@
 
 static PyObject *ColopressoError;
 
+#define CANCEL_TOKEN_CAPSULE_NAME "colopresso.cancel_token"
+
 typedef struct {
     cpres_rgba_color_t *colors;
     int count;
 } protected_colors_t;
 
+#if COLOPRESSO_WITH_FILE_OPS
+/* Encoders run without the GIL, so the cache handle is reference counted and only closed once the last encode using it returns. */
+typedef struct {
+    cpres_cache_t *cache;
+    Py_ssize_t refs;
+} cache_ref_t;
+
+static cache_ref_t *g_cache_ref = NULL;
+
+static cache_ref_t *acquire_cache(void) {
+    if (g_cache_ref) {
+        ++g_cache_ref->refs;
+    }
+    return g_cache_ref;
+}
+
+static void release_cache(cache_ref_t *ref) {
+    if (ref && --ref->refs == 0) {
+        cpres_cache_close(ref->cache);
+        free(ref);
+    }
+}
+#else
+typedef void cache_ref_t;
+
+static cache_ref_t *acquire_cache(void) {
+    return NULL;
+}
+
+static void release_cache(cache_ref_t *ref) {
+    (void)ref;
+}
+#endif
+
+static cpres_error_t encode_memory(cache_ref_t *ref, cpres_format_t format, const uint8_t *png_data, size_t png_size,
+                                   uint8_t **out_data, size_t *out_size, const cpres_config_t *config) {
+#if COLOPRESSO_WITH_FILE_OPS
+    return cpres_cache_encode_memory(ref ? ref->cache : NULL, format, png_data, png_size, out_data, out_size, config);
+#else
+    (void)ref;
+    switch (format) {
+    case CPRES_FORMAT_WEBP:
+        return cpres_encode_webp_memory(png_data, png_size, out_data, out_size, config);
+    case CPRES_FORMAT_AVIF:
+        return cpres_encode_avif_memory(png_data, png_size, out_data, out_size, config);
+    default:
+        return cpres_encode_pngx_memory(png_data, png_size, out_data, out_size, config);
+    }
+#endif
+}
+
 static inline char *get_utf8_string(PyObject *obj) {
     PyObject *bytes;
     Py_ssize_t len;
@@ -63,6 +116,25 @@ static PyObject *raise_colopresso_error(cpres_error_t err) {
     return NULL;
 }
 
+static void destroy_cancel_token(PyObject *capsule) {
+    cpres_cancel_token_destroy((cpres_cancel_token_t *)PyCapsule_GetPointer(capsule, CANCEL_TOKEN_CAPSULE_NAME));
+}
+
+/* The caller keeps the capsule alive for the whole call, so the token outlives the encode that polls it. */
+static int parse_cancel_token(PyObject *obj, cpres_config_t *config) {
+    if (obj == NULL || obj == Py_None) {
+        return 0;
+    }
+
+    config->cancel_token = (cpres_cancel_token_t *)PyCapsule_GetPointer(obj, CANCEL_TOKEN_CAPSULE_NAME);
+    if (!config->cancel_token) {
+        PyErr_SetString(PyExc_TypeError, "cancel_token must come from create_cancel_token()");
+        return -1;
+    }
+
+    return 0;
+}
+
 static int parse_protected_colors(PyObject *list, protected_colors_t *pcolors) {
     Py_ssize_t len, i;
     PyObject *item;
@@ -303,6 +375,16 @@ static int parse_config(PyObject *config_dict, cpres_config_t *config, protected
             config->pngx_palette256_tune_quality_max_target = (int)PyLong_AsLong(value);
         } else if (strcmp(key_str, "pngx_threads") == 0) {
             config->pngx_threads = (int)PyLong_AsLong(value);
+        } else if (strcmp(key_str, "pngx_parallel_branches") == 0) {
+            config->pngx_parallel_branches = PyObject_IsTrue(value);
+        } else if (strcmp(key_str, "pngx_search_enable") == 0) {
+            config->pngx_search_enable = PyObject_IsTrue(value);
+        } else if (strcmp(key_str, "pngx_tiled_dither_enable") == 0) {
+            config->pngx_tiled_dither_enable = PyObject_IsTrue(value);
+        } else if (strcmp(key_str, "memory_limited") == 0) {
+            config->memory_limited = PyObject_IsTrue(value);
+        } else if (strcmp(key_str, "time_budget_ms") == 0) {
+            config->time_budget_ms = (int)PyLong_AsLong(value);
         } else if (strcmp(key_str, "pngx_protected_colors") == 0) {
             free(key_str);
             free_protected_colors(pcolors);
@@ -326,19 +408,20 @@ static int parse_config(PyObject *config_dict, cpres_config_t *config, protected
 }
 
 static PyObject *py_encode_webp(PyObject *self, PyObject *args, PyObject *kwargs) {
-    static char *kwlist[] = {"png_data", "config", NULL};
-    PyObject *config_dict = Py_None, *result, *png_obj;
+    static char *kwlist[] = {"png_data", "config", "cancel_token", NULL};
+    PyObject *config_dict = Py_None, *cancel_obj = Py_None, *result, *png_obj;
     Py_ssize_t png_size;
     cpres_config_t config;
     cpres_error_t err;
     protected_colors_t pcolors = {NULL, 0};
+    cache_ref_t *cache_ref;
     uint8_t *out_data = NULL;
     size_t out_size = 0;
     char *png_data;
 
     (void)self;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, &png_obj, &config_dict)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OO", kwlist, &png_obj, &config_dict, &cancel_obj)) {
         return NULL;
     }
 
@@ -351,15 +434,17 @@ static PyObject *py_encode_webp(PyObject *self, PyObject *args, PyObject *kwargs
         return NULL;
     }
 
-    if (parse_config(config_dict, &config, &pcolors) < 0) {
+    if (parse_config(config_dict, &config, &pcolors) < 0 || parse_cancel_token(cancel_obj, &config) < 0) {
         free_protected_colors(&pcolors);
         return NULL;
     }
 
+    cache_ref = acquire_cache();
     Py_BEGIN_ALLOW_THREADS
-    err = cpres_encode_webp_memory((const uint8_t *)png_data, (size_t)png_size,
-                                   &out_data, &out_size, &config);
+    err = encode_memory(cache_ref, CPRES_FORMAT_WEBP, (const uint8_t *)png_data, (size_t)png_size,
+                        &out_data, &out_size, &config);
     Py_END_ALLOW_THREADS
+    release_cache(cache_ref);
 
     free_protected_colors(&pcolors);
 
@@ -373,19 +458,20 @@ static PyObject *py_encode_webp(PyObject *self, PyObject *args, PyObject *kwargs
 }
 
 static PyObject *py_encode_avif(PyObject *self, PyObject *args, PyObject *kwargs) {
-    static char *kwlist[] = {"png_data", "config", NULL};
-    PyObject *config_dict = Py_None, *png_obj, *result;
+    static char *kwlist[] = {"png_data", "config", "cancel_token", NULL};
+    PyObject *config_dict = Py_None, *cancel_obj = Py_None, *png_obj, *result;
     Py_ssize_t png_size;
     cpres_config_t config;
     cpres_error_t err;
     protected_colors_t pcolors = {NULL, 0};
+    cache_ref_t *cache_ref;
     uint8_t *out_data = NULL;
     size_t out_size = 0;
     char *png_data;
 
     (void)self;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, &png_obj, &config_dict)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OO", kwlist, &png_obj, &config_dict, &cancel_obj)) {
         return NULL;
     }
 
@@ -398,15 +484,17 @@ static PyObject *py_encode_avif(PyObject *self, PyObject *args, PyObject *kwargs
         return NULL;
     }
 
-    if (parse_config(config_dict, &config, &pcolors) < 0) {
+    if (parse_config(config_dict, &config, &pcolors) < 0 || parse_cancel_token(cancel_obj, &config) < 0) {
         free_protected_colors(&pcolors);
         return NULL;
     }
 
+    cache_ref = acquire_cache();
     Py_BEGIN_ALLOW_THREADS
-    err = cpres_encode_avif_memory((const uint8_t *)png_data, (size_t)png_size,
-                                   &out_data, &out_size, &config);
+    err = encode_memory(cache_ref, CPRES_FORMAT_AVIF, (const uint8_t *)png_data, (size_t)png_size,
+                        &out_data, &out_size, &config);
     Py_END_ALLOW_THREADS
+    release_cache(cache_ref);
 
     free_protected_colors(&pcolors);
 
@@ -420,19 +508,20 @@ static PyObject *py_encode_avif(PyObject *self, PyObject *args, PyObject *kwargs
 }
 
 static PyObject *py_encode_pngx(PyObject *self, PyObject *args, PyObject *kwargs) {
-    static char *kwlist[] = {"png_data", "config", NULL};
-    PyObject *config_dict = Py_None, *png_obj, *result;
+    static char *kwlist[] = {"png_data", "config", "cancel_token", NULL};
+    PyObject *config_dict = Py_None, *cancel_obj = Py_None, *png_obj, *result;
     Py_ssize_t png_size;
     cpres_config_t config;
     cpres_error_t err;
     protected_colors_t pcolors = {NULL, 0};
+    cache_ref_t *cache_ref;
     uint8_t *out_data = NULL;
     size_t out_size = 0;
     char *png_data;
 
     (void)self;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, &png_obj, &config_dict)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OO", kwlist, &png_obj, &config_dict, &cancel_obj)) {
         return NULL;
     }
 
@@ -445,15 +534,17 @@ static PyObject *py_encode_pngx(PyObject *self, PyObject *args, PyObject *kwargs
         return NULL;
     }
 
-    if (parse_config(config_dict, &config, &pcolors) < 0) {
+    if (parse_config(config_dict, &config, &pcolors) < 0 || parse_cancel_token(cancel_obj, &config) < 0) {
         free_protected_colors(&pcolors);
         return NULL;
     }
 
+    cache_ref = acquire_cache();
     Py_BEGIN_ALLOW_THREADS
-    err = cpres_encode_pngx_memory((const uint8_t *)png_data, (size_t)png_size,
-                                   &out_data, &out_size, &config);
+    err = encode_memory(cache_ref, CPRES_FORMAT_PNGX, (const uint8_t *)png_data, (size_t)png_size,
+                        &out_data, &out_size, &config);
     Py_END_ALLOW_THREADS
+    release_cache(cache_ref);
 
     free_protected_colors(&pcolors);
 
@@ -466,6 +557,51 @@ static PyObject *py_encode_pngx(PyObject *self, PyObject *args, PyObject *kwargs
     return result;
 }
 
+static PyObject *py_create_cancel_token(PyObject *self, PyObject *Py_UNUSED(args)) {
+    cpres_cancel_token_t *token;
+    PyObject *capsule;
+
+    (void)self;
+
+    token = cpres_cancel_token_create();
+    if (!token) {
+        return PyErr_NoMemory();
+    }
+
+    capsule = PyCapsule_New(token, CANCEL_TOKEN_CAPSULE_NAME, destroy_cancel_token);
+    if (!capsule) {
+        cpres_cancel_token_destroy(token);
+    }
+    return capsule;
+}
+
+static PyObject *py_cancel(PyObject *self, PyObject *capsule) {
+    cpres_cancel_token_t *token;
+
+    (void)self;
+
+    token = (cpres_cancel_token_t *)PyCapsule_GetPointer(capsule, CANCEL_TOKEN_CAPSULE_NAME);
+    if (!token) {
+        return NULL;
+    }
+
+    cpres_cancel_token_cancel(token);
+    Py_RETURN_NONE;
+}
+
+static PyObject *py_is_cancelled(PyObject *self, PyObject *capsule) {
+    cpres_cancel_token_t *token;
+
+    (void)self;
+
+    token = (cpres_cancel_token_t *)PyCapsule_GetPointer(capsule, CANCEL_TOKEN_CAPSULE_NAME);
+    if (!token) {
+        return NULL;
+    }
+
+    return PyBool_FromLong(cpres_cancel_token_is_cancelled(token));
+}
+
 static PyObject *py_get_version(PyObject *self, PyObject *Py_UNUSED(args)) {
     (void)self;
     return PyLong_FromUnsignedLong(cpres_get_version());
@@ -515,6 +651,11 @@ static PyObject *py_get_rust_version_string(PyObject *self, PyObject *Py_UNUSED(
     return PyUnicode_FromString(s ? s : "");
 }
 
+static PyObject *py_get_simd_level(PyObject *self, PyObject *Py_UNUSED(args)) {
+    (void)self;
+    return PyUnicode_FromString(cpres_simd_level_string(cpres_get_simd_level()));
+}
+
 static PyObject *py_is_threads_enabled(PyObject *self, PyObject *Py_UNUSED(args)) {
     (void)self;
     return PyBool_FromLong(cpres_is_threads_enabled());
@@ -530,28 +671,120 @@ static PyObject *py_get_max_thread_count(PyObject *self, PyObject *Py_UNUSED(arg
     return PyLong_FromUnsignedLong(cpres_get_max_thread_count());
 }
 
+static PyObject *py_enable_cache(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"directory", "max_bytes", NULL};
+    PyObject *directory_obj;
+    unsigned long long max_bytes = 0;
+#if COLOPRESSO_WITH_FILE_OPS
+    cache_ref_t *ref;
+    cpres_error_t err;
+    char *directory;
+#endif
+
+    (void)self;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|K", kwlist, &directory_obj, &max_bytes)) {
+        return NULL;
+    }
+
+#if COLOPRESSO_WITH_FILE_OPS
+    directory = get_utf8_string(directory_obj);
+    if (!directory) {
+        return NULL;
+    }
+
+    ref = (cache_ref_t *)malloc(sizeof(cache_ref_t));
+    if (!ref) {
+        free(directory);
+        return PyErr_NoMemory();
+    }
+    ref->refs = 1;
+
+    Py_BEGIN_ALLOW_THREADS
+    err = cpres_cache_open(directory, (uint64_t)max_bytes, &ref->cache);
+    Py_END_ALLOW_THREADS
+
+    free(directory);
+
+    if (err != CPRES_OK) {
+        free(ref);
+        return raise_colopresso_error(err);
+    }
+
+    release_cache(g_cache_ref);
+    g_cache_ref = ref;
+
+    Py_RETURN_NONE;
+#else
+    (void)directory_obj;
+    (void)max_bytes;
+    PyErr_SetString(PyExc_RuntimeError, "colopresso was built without file operations");
+    return NULL;
+#endif
+}
+
+static PyObject *py_disable_cache(PyObject *self, PyObject *Py_UNUSED(args)) {
+    (void)self;
+#if COLOPRESSO_WITH_FILE_OPS
+    release_cache(g_cache_ref);
+    g_cache_ref = NULL;
+#endif
+    Py_RETURN_NONE;
+}
+
+static PyObject *py_get_cache_stats(PyObject *self, PyObject *Py_UNUSED(args)) {
+#if COLOPRESSO_WITH_FILE_OPS
+    cpres_cache_stats_t stats;
+
+    (void)self;
+
+    if (!g_cache_ref) {
+        Py_RETURN_NONE;
+    }
+
+    cpres_cache_get_stats(g_cache_ref->cache, &stats);
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:K,s:K}",
+                         "hits", (unsigned long long)stats.hits,
+                         "misses", (unsigned long long)stats.misses,
+                         "stores", (unsigned long long)stats.stores,
+                         "evictions", (unsigned long long)stats.evictions,
+                         "entries", (unsigned long long)stats.entries,
+                         "bytes", (unsigned long long)stats.bytes,
+                         "max_bytes", (unsigned long long)stats.max_bytes);
+#else
+    (void)self;
+    Py_RETURN_NONE;
+#endif
+}
+
 static PyMethodDef colopresso_methods[] = {
     {"encode_webp", (PyCFunction)py_encode_webp, METH_VARARGS | METH_KEYWORDS,
      "Encode PNG data to WebP format.\n\n"
      "Args:\n"
      "    png_data: Raw PNG file data (bytes)\n"
-     "    config: Optional configuration dictionary\n\n"
+     "    config: Optional configuration dictionary\n"
+     "    cancel_token: Optional token from create_cancel_token()\n\n"
      "Returns:\n"
      "    WebP encoded data (bytes)"},
     {"encode_avif", (PyCFunction)py_encode_avif, METH_VARARGS | METH_KEYWORDS,
      "Encode PNG data to AVIF format.\n\n"
      "Args:\n"
      "    png_data: Raw PNG file data (bytes)\n"
-     "    config: Optional configuration dictionary\n\n"
+     "    config: Optional configuration dictionary\n"
+     "    cancel_token: Optional token from create_cancel_token()\n\n"
      "Returns:\n"
      "    AVIF encoded data (bytes)"},
     {"encode_pngx", (PyCFunction)py_encode_pngx, METH_VARARGS | METH_KEYWORDS,
      "Optimize PNG data using PNGX encoder.\n\n"
      "Args:\n"
      "    png_data: Raw PNG file data (bytes)\n"
-     "    config: Optional configuration dictionary\n\n"
+     "    config: Optional configuration dictionary\n"
+     "    cancel_token: Optional token from create_cancel_token()\n\n"
      "Returns:\n"
      "    Optimized PNG data (bytes)"},
+    {"create_cancel_token", py_create_cancel_token, METH_NOARGS, "Create a token that stops an encode running on another thread"},
+    {"cancel", py_cancel, METH_O, "Cancel every encode using the token"},
+    {"is_cancelled", py_is_cancelled, METH_O, "Check whether the token has been cancelled"},
     {"get_version", py_get_version, METH_NOARGS, "Get colopresso version number"},
     {"get_libwebp_version", py_get_libwebp_version, METH_NOARGS, "Get libwebp version number"},
     {"get_libpng_version", py_get_libpng_version, METH_NOARGS, "Get libpng version number"},
@@ -561,9 +794,15 @@ static PyMethodDef colopresso_methods[] = {
     {"get_buildtime", py_get_buildtime, METH_NOARGS, "Get build timestamp"},
     {"get_compiler_version_string", py_get_compiler_version_string, METH_NOARGS, "Get compiler version string"},
     {"get_rust_version_string", py_get_rust_version_string, METH_NOARGS, "Get Rust version string"},
+    {"get_simd_level", py_get_simd_level, METH_NOARGS, "Get SIMD instruction set selected at runtime"},
     {"is_threads_enabled", py_is_threads_enabled, METH_NOARGS, "Check if threading is enabled"},
     {"get_default_thread_count", py_get_default_thread_count, METH_NOARGS, "Get default thread count"},
     {"get_max_thread_count", py_get_max_thread_count, METH_NOARGS, "Get maximum thread count"},
+    {"enable_cache", (PyCFunction)py_enable_cache, METH_VARARGS | METH_KEYWORDS,
+     "enable_cache(directory, max_bytes=0)\n\n"
+     "Reuse encode results stored under directory (max_bytes=0: default limit)."},
+    {"disable_cache", py_disable_cache, METH_NOARGS, "Stop using the encode result cache"},
+    {"get_cache_stats", py_get_cache_stats, METH_NOARGS, "Get cache hit/miss counters, or None if the cache is disabled"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -15,7 +15,7 @@ from __future__ import annotations
 
 from dataclasses import dataclass, field, asdict
 from enum import IntEnum
-from typing import List, Optional, Tuple
+from typing import Dict, List, Optional, Tuple
 
 from . import _colopresso
 
@@ -41,6 +41,7 @@ class ColopressoError(Exception):
         7: "IO error",
         8: "Invalid parameter",
         9: "Output not smaller",
+        10: "Cancelled",
     }
     
     def __init__(self, code: int, message: Optional[str] = None):
@@ -49,6 +50,27 @@ class ColopressoError(Exception):
         super().__init__(self.message)
 
 
+class CancelToken:
+    """
+    Stops encodes running on other threads.
+
+    Pass the same token to any number of encode calls; cancel() makes each
+    of them raise ColopressoError with code 10 at its next check.
+    """
+
+    def __init__(self) -> None:
+        self._token = _colopresso.create_cancel_token()
+
+    def cancel(self) -> None:
+        """Cancel every encode using this token"""
+        _colopresso.cancel(self._token)
+
+    @property
+    def cancelled(self) -> bool:
+        """Whether cancel() has been called"""
+        return _colopresso.is_cancelled(self._token)
+
+
 @dataclass
 class Config:
     """Configuration for colopresso encoders"""
@@ -124,6 +146,11 @@ class Config:
     pngx_palette256_tune_quality_min_floor: int = 90
     pngx_palette256_tune_quality_max_target: int = 100
     pngx_threads: int = 1
+    pngx_parallel_branches: bool = False
+    pngx_search_enable: bool = False
+    pngx_tiled_dither_enable: bool = False
+    memory_limited: bool = False
+    time_budget_ms: int = 0
     pngx_protected_colors: Optional[List[Tuple[int, int, int, int]]] = None
     
     def _to_dict(self) -> dict:
@@ -147,13 +174,14 @@ def _wrap_error(func):
 
 
 @_wrap_error
-def encode_webp(png_data: bytes, config: Optional[Config] = None) -> bytes:
+def encode_webp(png_data: bytes, config: Optional[Config] = None, cancel_token: Optional[CancelToken] = None) -> bytes:
     """
     Encode PNG data to WebP format.
     
     Args:
         png_data: Raw PNG file data
         config: Optional configuration (uses defaults if not provided)
+        cancel_token: Optional token to stop the encode from another thread
     
     Returns:
         WebP encoded data
@@ -162,17 +190,18 @@ def encode_webp(png_data: bytes, config: Optional[Config] = None) -> bytes:
         ColopressoError: If encoding fails
     """
     config_dict = config._to_dict() if config else None
-    return _colopresso.encode_webp(png_data, config_dict)
+    return _colopresso.encode_webp(png_data, config_dict, cancel_token._token if cancel_token else None)
 
 
 @_wrap_error
-def encode_avif(png_data: bytes, config: Optional[Config] = None) -> bytes:
+def encode_avif(png_data: bytes, config: Optional[Config] = None, cancel_token: Optional[CancelToken] = None) -> bytes:
     """
     Encode PNG data to AVIF format.
     
     Args:
         png_data: Raw PNG file data
         config: Optional configuration (uses defaults if not provided)
+        cancel_token: Optional token to stop the encode from another thread
     
     Returns:
         AVIF encoded data
@@ -181,11 +210,11 @@ def encode_avif(png_data: bytes, config: Optional[Config] = None) -> bytes:
         ColopressoError: If encoding fails
     """
     config_dict = config._to_dict() if config else None
-    return _colopresso.encode_avif(png_data, config_dict)
+    return _colopresso.encode_avif(png_data, config_dict, cancel_token._token if cancel_token else None)
 
 
 @_wrap_error
-def encode_pngx(png_data: bytes, config: Optional[Config] = None) -> bytes:
+def encode_pngx(png_data: bytes, config: Optional[Config] = None, cancel_token: Optional[CancelToken] = None) -> bytes:
     """
     Optimize PNG data using PNGX encoder.
     
@@ -195,6 +224,7 @@ def encode_pngx(png_data: bytes, config: Optional[Config] = None) -> bytes:
             For PALETTE256 mode, you can specify protected colors using
             config.pngx_protected_colors as a list of (r, g, b, a) tuples.
             These colors will always be included in the palette.
+        cancel_token: Optional token to stop the encode from another thread
     
     Returns:
         Optimized PNG data
@@ -203,7 +233,42 @@ def encode_pngx(png_data: bytes, config: Optional[Config] = None) -> bytes:
         ColopressoError: If encoding fails
     """
     config_dict = config._to_dict() if config else None
-    return _colopresso.encode_pngx(png_data, config_dict)
+    return _colopresso.encode_pngx(png_data, config_dict, cancel_token._token if cancel_token else None)
+
+
+@_wrap_error
+def enable_cache(directory: str, max_bytes: int = 0) -> None:
+    """
+    Reuse encode results stored on disk.
+
+    Results are keyed on the input bytes, the configuration and the
+    library/codec versions, so a hit skips decoding and encoding entirely.
+
+    Args:
+        directory: Cache directory (created if missing)
+        max_bytes: Size limit; least recently used entries are evicted
+            beyond it (0 uses the library default)
+
+    Raises:
+        ColopressoError: If the directory cannot be opened
+    """
+    _colopresso.enable_cache(directory, max_bytes)
+
+
+def disable_cache() -> None:
+    """Stop using the encode result cache"""
+    _colopresso.disable_cache()
+
+
+def get_cache_stats() -> Optional[Dict[str, int]]:
+    """
+    Get cache counters.
+
+    Returns:
+        Dict with hits, misses, stores, evictions, entries, bytes and
+        max_bytes, or None if the cache is disabled
+    """
+    return _colopresso.get_cache_stats()
 
 
 def get_version() -> int:
@@ -251,6 +316,11 @@ def get_rust_version_string() -> str:
     return _colopresso.get_rust_version_string()
 
 
+def get_simd_level() -> str:
+    """Get SIMD instruction set selected at runtime ("avx2", "sse4.1", "sse2", "neon", "wasm128" or "scalar")"""
+    return _colopresso.get_simd_level()
+
+
 def is_threads_enabled() -> bool:
     """Check if threading is enabled"""
     return _colopresso.is_threads_enabled()